@@ -0,0 +1,259 @@
+/**
+ * @file aabb_batch.cpp
+ * @brief Пакетная проверка пересечения коробок (AabbVsAabb) для массивов SoA.
+ *
+ * Коробки задаются массивами центров и половин размеров. Проверяется одна коробка против
+ * массива коробок или пары коробок с одинаковыми номерами из двух массивов; результат —
+ * битовая маска попаданий (бит i слова i / 32 — коробка i) и число попаданий.
+ *
+ * Векторные ядра (SSE2 по 4 коробки, AVX2 по 8) считают те же выражения, что AabbVsAabb,
+ * в том же порядке, поэтому маски совпадают с поштучной проверкой бит в бит; хвост
+ * массива доделывает AabbVsAabb.
+ *
+ * Для коробок одного размера (мячи режима "хаос") есть AabbVsAabbManyUniform: она сравнивает
+ * расстояние между центрами с суммой половин размеров. В точной арифметике это та же проверка,
+ * но округляется она иначе, поэтому маски сверяются с поштучным |dx| < reach, а не с AabbVsAabb.
+ */
+
+/**
+ * @brief Массив коробок (SoA): центры и половины размеров.
+ */
+struct Aabb_Soa {
+    const float* x; /**< X центров */
+    const float* y; /**< Y центров */
+    const float* half_x; /**< Половины размеров по X */
+    const float* half_y; /**< Половины размеров по Y */
+};
+
+/**
+ * @brief Уровень векторных инструкций для пакетных проверок: 0 — без SIMD, 1 — SSE2, 2 — AVX2.
+ *
+ * Определяется по процессору при запуске; тесты и замеры могут понизить его вручную.
+ */
+global_variable int aabb_simd_level =
+#if defined(SIMD_AVX2)
+    cpu_has_avx2() ? 2 : 1;
+#elif defined(SIMD_SSE2)
+    1;
+#else
+    0;
+#endif
+
+/**
+ * @brief Сколько слов маски нужно для count коробок.
+ */
+inline int AabbMaskWords(int count) {
+    return (count + 31) / 32;
+}
+
+/**
+ * @brief Считает попадания в маске count коробок.
+ */
+int CountAabbHits(const u32* hits, int count) {
+    int total = 0;
+    for (int word = 0; word < AabbMaskWords(count); word++) {
+        for (u32 bits = hits[word]; bits; bits &= bits - 1) total++;
+    }
+    return total;
+}
+
+#ifdef SIMD_SSE2
+/**
+ * @brief Одна коробка против коробок [begin, count) по 4 (SSE2).
+ *
+ * @return Номер первой непроверенной коробки.
+ */
+int AabbVsAabbManySse2(float px, float py, float hsx, float hsy, Aabb_Soa boxes, int begin, int count, u32* hits) {
+    __m128 right = _mm_set1_ps(px + hsx), left = _mm_set1_ps(px - hsx);
+    __m128 top = _mm_set1_ps(py + hsy), bottom = _mm_set1_ps(py - hsy);
+    int i = begin;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(boxes.x + i), half_x = _mm_loadu_ps(boxes.half_x + i);
+        __m128 y = _mm_loadu_ps(boxes.y + i), half_y = _mm_loadu_ps(boxes.half_y + i);
+        __m128 hit = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(right, _mm_sub_ps(x, half_x)), _mm_cmplt_ps(left, _mm_add_ps(x, half_x))),
+                                _mm_and_ps(_mm_cmpgt_ps(top, _mm_sub_ps(y, half_y)), _mm_cmplt_ps(bottom, _mm_add_ps(y, half_y))));
+        // i кратно 4, поэтому 4 бита группы не пересекают границу слова.
+        hits[i / 32] |= (u32)_mm_movemask_ps(hit) << (i % 32);
+    }
+    return i;
+}
+
+/**
+ * @brief Пары коробок [begin, count) по 4 (SSE2).
+ *
+ * @return Номер первой непроверенной пары.
+ */
+int AabbVsAabbPairsSse2(Aabb_Soa a, Aabb_Soa b, int begin, int count, u32* hits) {
+    int i = begin;
+    for (; i + 4 <= count; i += 4) {
+        __m128 ax = _mm_loadu_ps(a.x + i), ahx = _mm_loadu_ps(a.half_x + i);
+        __m128 ay = _mm_loadu_ps(a.y + i), ahy = _mm_loadu_ps(a.half_y + i);
+        __m128 bx = _mm_loadu_ps(b.x + i), bhx = _mm_loadu_ps(b.half_x + i);
+        __m128 by = _mm_loadu_ps(b.y + i), bhy = _mm_loadu_ps(b.half_y + i);
+        __m128 hit_x = _mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(ax, ahx), _mm_sub_ps(bx, bhx)),
+                                  _mm_cmplt_ps(_mm_sub_ps(ax, ahx), _mm_add_ps(bx, bhx)));
+        __m128 hit_y = _mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(ay, ahy), _mm_sub_ps(by, bhy)),
+                                  _mm_cmplt_ps(_mm_sub_ps(ay, ahy), _mm_add_ps(by, bhy)));
+        hits[i / 32] |= (u32)_mm_movemask_ps(_mm_and_ps(hit_x, hit_y)) << (i % 32);
+    }
+    return i;
+}
+
+/**
+ * @brief Одна коробка против коробок одного размера [begin, count) по 4 (SSE2).
+ *
+ * @return Номер первой непроверенной коробки.
+ */
+int AabbVsAabbManyUniformSse2(float px, float py, float reach_x, float reach_y, const float* xs, const float* ys,
+                              int begin, int count, u32* hits) {
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 x = _mm_set1_ps(px), y = _mm_set1_ps(py);
+    __m128 limit_x = _mm_set1_ps(reach_x), limit_y = _mm_set1_ps(reach_y);
+    int i = begin;
+    for (; i + 4 <= count; i += 4) {
+        __m128 ddx = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(xs + i), x), abs_mask);
+        __m128 ddy = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(ys + i), y), abs_mask);
+        __m128 hit = _mm_and_ps(_mm_cmplt_ps(ddx, limit_x), _mm_cmplt_ps(ddy, limit_y));
+        hits[i / 32] |= (u32)_mm_movemask_ps(hit) << (i % 32);
+    }
+    return i;
+}
+#endif
+
+#ifdef SIMD_AVX2
+/**
+ * @brief AVX2-версия AabbVsAabbManySse2 (по 8 коробок).
+ */
+TARGET_AVX2 int AabbVsAabbManyAvx2(float px, float py, float hsx, float hsy, Aabb_Soa boxes, int begin, int count, u32* hits) {
+    __m256 right = _mm256_set1_ps(px + hsx), left = _mm256_set1_ps(px - hsx);
+    __m256 top = _mm256_set1_ps(py + hsy), bottom = _mm256_set1_ps(py - hsy);
+    int i = begin;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(boxes.x + i), half_x = _mm256_loadu_ps(boxes.half_x + i);
+        __m256 y = _mm256_loadu_ps(boxes.y + i), half_y = _mm256_loadu_ps(boxes.half_y + i);
+        __m256 hit_x = _mm256_and_ps(_mm256_cmp_ps(right, _mm256_sub_ps(x, half_x), _CMP_GT_OQ),
+                                     _mm256_cmp_ps(left, _mm256_add_ps(x, half_x), _CMP_LT_OQ));
+        __m256 hit_y = _mm256_and_ps(_mm256_cmp_ps(top, _mm256_sub_ps(y, half_y), _CMP_GT_OQ),
+                                     _mm256_cmp_ps(bottom, _mm256_add_ps(y, half_y), _CMP_LT_OQ));
+        hits[i / 32] |= (u32)_mm256_movemask_ps(_mm256_and_ps(hit_x, hit_y)) << (i % 32);
+    }
+    // Остаток доделывает код без VEX-префикса: верхние половины регистров обнуляются заранее.
+    _mm256_zeroupper();
+    return i;
+}
+
+/**
+ * @brief AVX2-версия AabbVsAabbPairsSse2 (по 8 пар).
+ */
+TARGET_AVX2 int AabbVsAabbPairsAvx2(Aabb_Soa a, Aabb_Soa b, int begin, int count, u32* hits) {
+    int i = begin;
+    for (; i + 8 <= count; i += 8) {
+        __m256 ax = _mm256_loadu_ps(a.x + i), ahx = _mm256_loadu_ps(a.half_x + i);
+        __m256 ay = _mm256_loadu_ps(a.y + i), ahy = _mm256_loadu_ps(a.half_y + i);
+        __m256 bx = _mm256_loadu_ps(b.x + i), bhx = _mm256_loadu_ps(b.half_x + i);
+        __m256 by = _mm256_loadu_ps(b.y + i), bhy = _mm256_loadu_ps(b.half_y + i);
+        __m256 hit_x = _mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(ax, ahx), _mm256_sub_ps(bx, bhx), _CMP_GT_OQ),
+                                     _mm256_cmp_ps(_mm256_sub_ps(ax, ahx), _mm256_add_ps(bx, bhx), _CMP_LT_OQ));
+        __m256 hit_y = _mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(ay, ahy), _mm256_sub_ps(by, bhy), _CMP_GT_OQ),
+                                     _mm256_cmp_ps(_mm256_sub_ps(ay, ahy), _mm256_add_ps(by, bhy), _CMP_LT_OQ));
+        hits[i / 32] |= (u32)_mm256_movemask_ps(_mm256_and_ps(hit_x, hit_y)) << (i % 32);
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+/**
+ * @brief AVX2-версия AabbVsAabbManyUniformSse2 (по 8 коробок).
+ */
+TARGET_AVX2 int AabbVsAabbManyUniformAvx2(float px, float py, float reach_x, float reach_y, const float* xs, const float* ys,
+                                          int begin, int count, u32* hits) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 x = _mm256_set1_ps(px), y = _mm256_set1_ps(py);
+    __m256 limit_x = _mm256_set1_ps(reach_x), limit_y = _mm256_set1_ps(reach_y);
+    int i = begin;
+    for (; i + 8 <= count; i += 8) {
+        __m256 ddx = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(xs + i), x), abs_mask);
+        __m256 ddy = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(ys + i), y), abs_mask);
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(ddx, limit_x, _CMP_LT_OQ), _mm256_cmp_ps(ddy, limit_y, _CMP_LT_OQ));
+        hits[i / 32] |= (u32)_mm256_movemask_ps(hit) << (i % 32);
+    }
+    _mm256_zeroupper();
+    return i;
+}
+#endif
+
+/**
+ * @brief Проверяет одну коробку против массива коробок.
+ *
+ * @param px, py Центр коробки.
+ * @param hsx, hsy Половины размеров коробки.
+ * @param boxes Массив коробок.
+ * @param count Коробок в массиве.
+ * @param hits Маска попаданий, AabbMaskWords(count) слов (перезаписывается).
+ * @return Число попаданий.
+ */
+int AabbVsAabbMany(float px, float py, float hsx, float hsy, Aabb_Soa boxes, int count, u32* hits) {
+    memset(hits, 0, sizeof(u32) * AabbMaskWords(count));
+    int i = 0;
+#ifdef SIMD_AVX2
+    if (aabb_simd_level >= 2) i = AabbVsAabbManyAvx2(px, py, hsx, hsy, boxes, i, count, hits);
+#endif
+#ifdef SIMD_SSE2
+    if (aabb_simd_level >= 1) i = AabbVsAabbManySse2(px, py, hsx, hsy, boxes, i, count, hits);
+#endif
+    for (; i < count; i++) {
+        if (AabbVsAabb(px, py, hsx, hsy, boxes.x[i], boxes.y[i], boxes.half_x[i], boxes.half_y[i])) hits[i / 32] |= 1u << (i % 32);
+    }
+    return CountAabbHits(hits, count);
+}
+
+/**
+ * @brief Проверяет пары коробок a[i] и b[i].
+ *
+ * @param a, b Массивы коробок одинаковой длины.
+ * @param count Пар.
+ * @param hits Маска попаданий, AabbMaskWords(count) слов (перезаписывается).
+ * @return Число попаданий.
+ */
+int AabbVsAabbPairs(Aabb_Soa a, Aabb_Soa b, int count, u32* hits) {
+    memset(hits, 0, sizeof(u32) * AabbMaskWords(count));
+    int i = 0;
+#ifdef SIMD_AVX2
+    if (aabb_simd_level >= 2) i = AabbVsAabbPairsAvx2(a, b, i, count, hits);
+#endif
+#ifdef SIMD_SSE2
+    if (aabb_simd_level >= 1) i = AabbVsAabbPairsSse2(a, b, i, count, hits);
+#endif
+    for (; i < count; i++) {
+        if (AabbVsAabb(a.x[i], a.y[i], a.half_x[i], a.half_y[i], b.x[i], b.y[i], b.half_x[i], b.half_y[i])) hits[i / 32] |= 1u << (i % 32);
+    }
+    return CountAabbHits(hits, count);
+}
+
+/**
+ * @brief Проверяет одну коробку против массива коробок одного размера.
+ *
+ * Коробки пересекаются, если расстояние между центрами по каждой оси меньше reach —
+ * суммы половин размеров проверяемой коробки и коробки массива.
+ *
+ * @param px, py Центр коробки.
+ * @param reach_x, reach_y Суммы половин размеров по осям.
+ * @param xs, ys Центры коробок массива.
+ * @param count Коробок в массиве.
+ * @param hits Маска попаданий, AabbMaskWords(count) слов (перезаписывается).
+ * @return Число попаданий.
+ */
+int AabbVsAabbManyUniform(float px, float py, float reach_x, float reach_y, const float* xs, const float* ys, int count, u32* hits) {
+    memset(hits, 0, sizeof(u32) * AabbMaskWords(count));
+    int i = 0;
+#ifdef SIMD_AVX2
+    if (aabb_simd_level >= 2) i = AabbVsAabbManyUniformAvx2(px, py, reach_x, reach_y, xs, ys, i, count, hits);
+#endif
+#ifdef SIMD_SSE2
+    if (aabb_simd_level >= 1) i = AabbVsAabbManyUniformSse2(px, py, reach_x, reach_y, xs, ys, i, count, hits);
+#endif
+    for (; i < count; i++) {
+        if (fabsf(xs[i] - px) < reach_x && fabsf(ys[i] - py) < reach_y) hits[i / 32] |= 1u << (i % 32);
+    }
+    return CountAabbHits(hits, count);
+}
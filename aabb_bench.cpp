@@ -0,0 +1,188 @@
+/**
+ * @file aabb_bench.cpp
+ * @brief Сверка и замер пакетной проверки коробок (aabb_batch.cpp) на каждом уровне SIMD.
+ *
+ * Коробки случайные, но центры и половины размеров кратны 0.5, поэтому среди них много
+ * касающихся сторонами (касание — не пересечение). Для каждого доступного уровня SIMD
+ * маски AabbVsAabbMany и AabbVsAabbPairs сверяются с поштучной проверкой по интервалам,
+ * а AabbVsAabbManyUniform — с поштучным сравнением расстояния между центрами, для всех
+ * длин массивов от 0 до 80 и для сдвинутых на 1-3 элемента (невыровненных) массивов.
+ * Затем замеряется время одной проверки на массиве boxes коробок.
+ *
+ * Отдельно считается, сколько пар старая проверка по Y (верх первой коробки вместо низа)
+ * решала неверно.
+ *
+ * Использование: aabb_bench [-boxes N] [-repeat N] [-simd 0|1|2]
+ */
+
+#include "headless_platform.cpp"
+
+#include <vector>
+
+/**
+ * @brief Коробки SoA, владеющие массивами.
+ */
+struct Aabb_Arrays {
+    std::vector<float> x, y, half_x, half_y;
+
+    /**
+     * @brief Массивы, начиная с коробки first.
+     */
+    Aabb_Soa soa(int first) const {
+        return { x.data() + first, y.data() + first, half_x.data() + first, half_y.data() + first };
+    }
+};
+
+/**
+ * @brief Заполняет count случайных коробок с координатами и размерами, кратными 0.5.
+ */
+internal void
+random_aabb_arrays(Aabb_Arrays* boxes, int count, u32* random_state) {
+    std::vector<float>* arrays[] = { &boxes->x, &boxes->y, &boxes->half_x, &boxes->half_y };
+    for (int a = 0; a < 4; a++) {
+        arrays[a]->resize((size_t)count);
+        for (int i = 0; i < count; i++) {
+            u32 x = xorshift32(random_state);
+            // Центры в [-8, 8), половины размеров в [0, 4).
+            (*arrays[a])[i] = a < 2 ? (float)(int)(x % 32) * .5f - 8.f : (float)(int)(x % 8) * .5f;
+        }
+    }
+}
+
+/**
+ * @brief Эталон: коробки пересекаются, если открытые интервалы пересекаются по обеим осям.
+ */
+internal bool
+reference_aabb_overlap(float p1x, float p1y, float hs1x, float hs1y, float p2x, float p2y, float hs2x, float hs2y) {
+    float left_1 = p1x - hs1x, right_1 = p1x + hs1x, bottom_1 = p1y - hs1y, top_1 = p1y + hs1y;
+    float left_2 = p2x - hs2x, right_2 = p2x + hs2x, bottom_2 = p2y - hs2y, top_2 = p2y + hs2y;
+    return right_1 > left_2 && left_1 < right_2 && top_1 > bottom_2 && bottom_1 < top_2;
+}
+
+/**
+ * @brief Сравнивает маску с эталонными битами; печатает первые расхождения.
+ *
+ * @return Число расходящихся коробок.
+ */
+internal int
+compare_aabb_mask(const u32* hits, const std::vector<bool>& expected, int count, const char* what, int level) {
+    int mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        bool hit = (hits[i / 32] >> (i % 32)) & 1;
+        if (hit != expected[(size_t)i] && mismatches++ < 3) printf("%s (simd %d): box %d of %d differs\n", what, level, i, count);
+    }
+    // Биты за концом массива должны остаться нулевыми.
+    if (count % 32 && hits[count / 32] >> (count % 32)) mismatches++;
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    int box_count = 4096;
+    int repeat = 2000;
+    int max_level = aabb_simd_level;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (!strcmp(argv[i], "-boxes")) box_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-repeat")) repeat = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-simd")) max_level = atoi(argv[++i]);
+    }
+    if (box_count < 16 || repeat < 1) return EXIT_FAILURE;
+    if (max_level > aabb_simd_level) max_level = aabb_simd_level;
+
+    u32 random_state = 0x2545f491u;
+    int mismatches = 0;
+
+    // Поштучная проверка и старая проверка по Y против эталона.
+    Aabb_Arrays a, b;
+    random_aabb_arrays(&a, 1 << 16, &random_state);
+    random_aabb_arrays(&b, 1 << 16, &random_state);
+    int old_wrong = 0, touching = 0;
+    for (int i = 0; i < 1 << 16; i++) {
+        bool expected = reference_aabb_overlap(a.x[i], a.y[i], a.half_x[i], a.half_y[i], b.x[i], b.y[i], b.half_x[i], b.half_y[i]);
+        if (AabbVsAabb(a.x[i], a.y[i], a.half_x[i], a.half_y[i], b.x[i], b.y[i], b.half_x[i], b.half_y[i]) != expected) {
+            if (mismatches++ < 3) printf("AabbVsAabb: pair %d differs from the reference\n", i);
+        }
+        bool old_y = a.y[i] + a.half_y[i] > b.y[i] - b.half_y[i] && a.y[i] + a.half_y[i] < b.y[i] + b.half_y[i];
+        bool old = a.x[i] + a.half_x[i] > b.x[i] - b.half_x[i] && a.x[i] - a.half_x[i] < b.x[i] + b.half_x[i] && old_y;
+        old_wrong += old != expected;
+        touching += a.x[i] + a.half_x[i] == b.x[i] - b.half_x[i] || a.y[i] + a.half_y[i] == b.y[i] - b.half_y[i];
+    }
+    printf("%d random pairs: %d touching, old y test wrong on %d (%.1f%%)\n", 1 << 16, touching, old_wrong,
+           100.0 * old_wrong / (1 << 16));
+
+    // Пакетные проверки на всех уровнях: все длины до 80 и невыровненные начала.
+    std::vector<u32> hits((size_t)AabbMaskWords(1 << 16) + 1);
+    std::vector<bool> expected;
+    for (int level = 0; level <= max_level; level++) {
+        aabb_simd_level = level;
+        for (int first = 0; first < 4; first++) {
+            for (int count = 0; count <= 80; count++) {
+                int total = 0;
+                float px = a.x[0], py = a.y[0], hsx = a.half_x[0], hsy = a.half_y[0];
+                expected.assign((size_t)count, false);
+                for (int i = 0; i < count; i++) {
+                    int k = first + i;
+                    expected[(size_t)i] = reference_aabb_overlap(px, py, hsx, hsy, b.x[k], b.y[k], b.half_x[k], b.half_y[k]);
+                    total += expected[(size_t)i];
+                }
+                hits.assign(hits.size(), ~0u);
+                int found = AabbVsAabbMany(px, py, hsx, hsy, b.soa(first), count, hits.data());
+                mismatches += compare_aabb_mask(hits.data(), expected, count, "AabbVsAabbMany", level) + (found != total);
+
+                total = 0;
+                for (int i = 0; i < count; i++) {
+                    int k = first + i;
+                    expected[(size_t)i] = reference_aabb_overlap(a.x[k], a.y[k], a.half_x[k], a.half_y[k], b.x[k], b.y[k], b.half_x[k], b.half_y[k]);
+                    total += expected[(size_t)i];
+                }
+                hits.assign(hits.size(), ~0u);
+                found = AabbVsAabbPairs(a.soa(first), b.soa(first), count, hits.data());
+                mismatches += compare_aabb_mask(hits.data(), expected, count, "AabbVsAabbPairs", level) + (found != total);
+
+                // Коробки одного размера: reach — сумма половин размеров.
+                float reach_x = hsx + 1.5f, reach_y = hsy + 1.5f;
+                total = 0;
+                for (int i = 0; i < count; i++) {
+                    int k = first + i;
+                    expected[(size_t)i] = fabsf(b.x[k] - px) < reach_x && fabsf(b.y[k] - py) < reach_y;
+                    total += expected[(size_t)i];
+                }
+                hits.assign(hits.size(), ~0u);
+                found = AabbVsAabbManyUniform(px, py, reach_x, reach_y, b.x.data() + first, b.y.data() + first, count, hits.data());
+                mismatches += compare_aabb_mask(hits.data(), expected, count, "AabbVsAabbManyUniform", level) + (found != total);
+            }
+        }
+        // Весь массив целиком.
+        expected.assign((size_t)(1 << 16), false);
+        for (int i = 0; i < 1 << 16; i++) {
+            expected[(size_t)i] = reference_aabb_overlap(a.x[i], a.y[i], a.half_x[i], a.half_y[i], b.x[i], b.y[i], b.half_x[i], b.half_y[i]);
+        }
+        AabbVsAabbPairs(a.soa(0), b.soa(0), 1 << 16, hits.data());
+        mismatches += compare_aabb_mask(hits.data(), expected, 1 << 16, "AabbVsAabbPairs", level);
+    }
+
+    // Замер: одна коробка против массива и пары, время одной проверки.
+    if (box_count > 1 << 16) box_count = 1 << 16;
+    double base_ns[2] = {};
+    for (int level = 0; level <= max_level; level++) {
+        aabb_simd_level = level;
+        int sink = 0;
+        u64 begin_ns = headless_time_ns();
+        for (int r = 0; r < repeat; r++) {
+            int k = r & 1023;
+            sink += AabbVsAabbMany(a.x[k], a.y[k], a.half_x[k], a.half_y[k], b.soa(0), box_count, hits.data());
+        }
+        double many_ns = (double)(headless_time_ns() - begin_ns) / ((double)repeat * box_count);
+        begin_ns = headless_time_ns();
+        for (int r = 0; r < repeat; r++) sink += AabbVsAabbPairs(a.soa(r & 7), b.soa(0), box_count - 8, hits.data());
+        double pairs_ns = (double)(headless_time_ns() - begin_ns) / ((double)repeat * (box_count - 8));
+        if (level == 0) {
+            base_ns[0] = many_ns;
+            base_ns[1] = pairs_ns;
+        }
+        printf("simd %d: one vs %d boxes %.3f ns per box (%.1fx), pairs %.3f ns per pair (%.1fx) [%d]\n", level, box_count,
+               many_ns, base_ns[0] / many_ns, pairs_ns, base_ns[1] / pairs_ns, sink & 1);
+    }
+
+    printf("%d mismatches\n", mismatches);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,568 @@
+/**
+ * @file audio.cpp
+ * @brief Микшер звука на отдельном потоке: процедурные звуки игровых событий.
+ *
+ * Игровой цикл кладёт команды "сыграть звук" в кольцо без блокировок и никогда не ждёт.
+ * Поток микшера забирает команды, синтезирует голоса (треугольник или меандр с
+ * экспоненциальным затуханием) по 4 отсчёта за раз и складывает блоки по 2.5 мс
+ * в кольцо float-отсчётов, держа наготове не больше двух блоков (5 мс задержки).
+ * Поток вывода забирает блоки в темпе реального времени, как это делает звуковая карта;
+ * если блок не готов вовремя, это недогрузка (underrun), и она учитывается.
+ *
+ * Сумма голосов умножается на audio_master_gain (запас), а пики выше audio_limiter_knee
+ * плавно прижимаются мягким ограничителем, поэтому при переводе в 16 бит отсчёты не
+ * срезаются, даже когда звучат все голоса сразу.
+ *
+ * Вывод — в WAV-файл или в никуда ("null"), поэтому микшер собирается и проверяется
+ * без звуковой карты.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Частота дискретизации.
+ */
+global_variable constexpr int audio_sample_rate = 48000;
+
+/**
+ * @brief Размер блока микшера в стереокадрах: 2.5 мс, кратен 4 для SSE.
+ */
+global_variable constexpr int audio_block_frames = 120;
+
+/**
+ * @brief Сколько блоков микшер держит готовыми в кольце (задержка вывода).
+ */
+global_variable constexpr u32 audio_target_blocks = 2;
+
+/**
+ * @brief Вместимость кольца отсчётов в стереокадрах (степень двойки).
+ */
+global_variable constexpr u32 audio_ring_frames = 1024;
+
+/**
+ * @brief Вместимость кольца команд (степень двойки).
+ */
+global_variable constexpr u32 audio_command_ring_size = 256;
+
+/**
+ * @brief Максимум одновременно звучащих голосов.
+ */
+global_variable constexpr int audio_max_voices = 32;
+
+/**
+ * @brief Общая громкость суммы голосов: запас 6 дБ до ограничителя.
+ */
+global_variable constexpr float audio_master_gain = .5f;
+
+/**
+ * @brief Уровень, до которого ограничитель пропускает сигнал без изменений.
+ *
+ * Выше него уровень плавно (без излома) стремится к 1, но не достигает её.
+ */
+global_variable constexpr float audio_limiter_knee = .75f;
+
+/**
+ * @brief Форма волны голоса.
+ */
+enum Audio_Waveform {
+    AUDIO_TRIANGLE,
+    AUDIO_SQUARE,
+};
+
+/**
+ * @struct Audio_Sound
+ * @brief Описание процедурного звука: тон с линейным сдвигом частоты и затуханием.
+ */
+struct Audio_Sound {
+    Audio_Waveform waveform; /**< Форма волны. */
+    float start_hz, end_hz; /**< Частота в начале и в конце звука. */
+    float duration; /**< Длительность в секундах (затухание до -60 дБ). */
+    float volume; /**< Начальная громкость. */
+};
+
+/**
+ * @brief Звуки игровых событий.
+ */
+enum Audio_Sound_Id {
+    SOUND_PADDLE_HIT,
+    SOUND_WALL_BOUNCE,
+    SOUND_GOAL,
+    SOUND_MODE_CHANGE,
+
+    SOUND_COUNT,
+};
+
+global_variable const Audio_Sound audio_sounds[SOUND_COUNT] = {
+    { AUDIO_SQUARE, 440.f, 520.f, .08f, .25f },
+    { AUDIO_TRIANGLE, 260.f, 220.f, .06f, .35f },
+    { AUDIO_TRIANGLE, 880.f, 110.f, .6f, .45f },
+    { AUDIO_SQUARE, 660.f, 660.f, .04f, .15f },
+};
+
+/**
+ * @struct Audio_Command
+ * @brief Команда игрового цикла микшеру.
+ */
+struct Audio_Command {
+    u8 sound; /**< Audio_Sound_Id. */
+    float pan; /**< Панорама от -1 (слева) до 1 (справа). */
+};
+
+/**
+ * @struct Audio_Voice
+ * @brief Звучащий голос. Принадлежит потоку микшера.
+ */
+struct Audio_Voice {
+    const Audio_Sound* sound; /**< Звук или 0, если голос свободен. */
+    float phase; /**< Фаза в периодах, [0, 1). */
+    float gain; /**< Текущая громкость огибающей. */
+    float decay; /**< Множитель огибающей на отсчёт. */
+    float left, right; /**< Громкость каналов (панорама). */
+    int frame; /**< Сколько кадров уже сыграно. */
+    int frame_count; /**< Длительность в кадрах. */
+};
+
+/**
+ * @struct Audio_Stats
+ * @brief Счётчики микшера для отчёта и для внешних проверок.
+ */
+struct Audio_Stats {
+    u64 blocks_mixed; /**< Блоков сведено. */
+    u64 blocks_played; /**< Блоков забрано выводом. */
+    u64 underruns; /**< Блоков, которых не оказалось в кольце к сроку вывода. */
+    u64 commands_dropped; /**< Команд, потерянных из-за переполнения кольца команд. */
+    u64 voices_stolen; /**< Звуков, вытеснивших ещё звучащий голос. */
+    u64 max_mix_ns; /**< Самое долгое сведение одного блока. */
+};
+
+/**
+ * @struct Audio_Mixer
+ * @brief Состояние микшера: кольца, голоса, потоки и счётчики.
+ */
+struct Audio_Mixer {
+    bool active; /**< Микшер запущен. */
+    FILE* wav; /**< Выходной WAV-файл или 0 для вывода в никуда. */
+    u32 wav_frames; /**< Кадров записано в WAV. */
+    std::atomic<bool> wav_failed; /**< Запись в WAV не удалась; дальше вывод идёт в никуда. */
+
+    Audio_Command commands[audio_command_ring_size]; /**< Кольцо команд. */
+    std::atomic<u32> command_write; /**< Сколько команд положил игровой цикл. */
+    std::atomic<u32> command_read; /**< Сколько команд забрал микшер. */
+
+    alignas(16) float samples[audio_ring_frames * 2]; /**< Кольцо стереоотсчётов (L, R). */
+    std::atomic<u32> sample_write; /**< Сколько кадров свёл микшер. */
+    std::atomic<u32> sample_read; /**< Сколько кадров забрал вывод. */
+
+    Audio_Voice voices[audio_max_voices]; /**< Голоса. */
+
+    std::thread mixer; /**< Поток микшера. */
+    std::thread sink; /**< Поток вывода. */
+    std::atomic<bool> stop; /**< Запрос на остановку потоков. */
+
+    std::atomic<u64> blocks_mixed, blocks_played, underruns, commands_dropped, voices_stolen, max_mix_ns;
+};
+
+global_variable Audio_Mixer audio_mixer;
+
+/**
+ * @brief Занимает голос под новый звук. Если свободных нет, вытесняет самый близкий к концу.
+ */
+internal void
+start_audio_voice(Audio_Mixer* mixer, const Audio_Command* command) {
+    Audio_Voice* voice = mixer->voices;
+    for (int i = 0; i < audio_max_voices; i++) {
+        Audio_Voice* candidate = mixer->voices + i;
+        if (!candidate->sound) {
+            voice = candidate;
+            break;
+        }
+        if (candidate->frame_count - candidate->frame < voice->frame_count - voice->frame) voice = candidate;
+    }
+    if (voice->sound) mixer->voices_stolen.fetch_add(1, std::memory_order_relaxed);
+
+    const Audio_Sound* sound = audio_sounds + command->sound;
+    float pan = command->pan < -1.f ? -1.f : (command->pan > 1.f ? 1.f : command->pan);
+    voice->sound = sound;
+    voice->phase = 0.f;
+    voice->gain = sound->volume;
+    voice->frame = 0;
+    voice->frame_count = (int)(sound->duration * audio_sample_rate);
+    voice->decay = powf(.001f, 1.f / (float)voice->frame_count);
+    voice->left = sqrtf(.5f * (1.f - pan));
+    voice->right = sqrtf(.5f * (1.f + pan));
+}
+
+/**
+ * @brief Добавляет голос в стереоблок.
+ *
+ * Внутри блока частота постоянна: сдвиг частоты применяется между блоками (раз в 2.5 мс).
+ * Голос доигрывается группами по 4 кадра, поэтому может прозвучать на 1-3 кадра
+ * дольше — с громкостью около -60 дБ.
+ *
+ * @param voice Голос.
+ * @param out Стереоблок (L, R) длиной audio_block_frames кадров.
+ */
+internal void
+mix_audio_voice(Audio_Voice* voice, float* out) {
+    const Audio_Sound* sound = voice->sound;
+    float t = (float)voice->frame / (float)voice->frame_count;
+    float step = (sound->start_hz + (sound->end_hz - sound->start_hz) * t) / (float)audio_sample_rate;
+    int frames = voice->frame_count - voice->frame;
+    frames = frames < audio_block_frames ? (frames + 3) & ~3 : audio_block_frames;
+
+    float phase = voice->phase;
+    float gain = voice->gain;
+    int i = 0;
+#ifdef SIMD_SSE2
+    float decay = voice->decay;
+    __m128 one = _mm_set1_ps(1.f);
+    __m128 half = _mm_set1_ps(.5f);
+    __m128 sign = _mm_set1_ps(-0.f);
+    __m128 phases = _mm_add_ps(_mm_set1_ps(phase), _mm_mul_ps(_mm_set1_ps(step), _mm_setr_ps(0.f, 1.f, 2.f, 3.f)));
+    __m128 phase_step = _mm_set1_ps(4.f * step);
+    __m128 gains = _mm_mul_ps(_mm_set1_ps(gain), _mm_setr_ps(1.f, decay, decay * decay, decay * decay * decay));
+    __m128 gain_step = _mm_set1_ps(decay * decay * decay * decay);
+    __m128 left = _mm_set1_ps(voice->left);
+    __m128 right = _mm_set1_ps(voice->right);
+    for (; i < frames; i += 4) {
+        // step < 1/4, поэтому каждая дорожка переходит через 1 не больше одного раза за шаг.
+        phases = _mm_sub_ps(phases, _mm_and_ps(_mm_cmpge_ps(phases, one), one));
+        __m128 wave;
+        if (sound->waveform == AUDIO_TRIANGLE) {
+            __m128 distance = _mm_andnot_ps(sign, _mm_sub_ps(phases, half));
+            wave = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(4.f), distance), one);
+        } else {
+            wave = _mm_or_ps(one, _mm_and_ps(_mm_cmpge_ps(phases, half), sign));
+        }
+        __m128 value = _mm_mul_ps(wave, gains);
+        __m128 l = _mm_mul_ps(value, left);
+        __m128 r = _mm_mul_ps(value, right);
+        float* dst = out + 2 * i;
+        _mm_store_ps(dst, _mm_add_ps(_mm_load_ps(dst), _mm_unpacklo_ps(l, r)));
+        _mm_store_ps(dst + 4, _mm_add_ps(_mm_load_ps(dst + 4), _mm_unpackhi_ps(l, r)));
+        phases = _mm_add_ps(phases, phase_step);
+        gains = _mm_mul_ps(gains, gain_step);
+    }
+    phase = _mm_cvtss_f32(phases);
+    if (phase >= 1.f) phase -= 1.f;
+    gain = _mm_cvtss_f32(gains);
+#endif
+    for (; i < frames; i++) {
+        float wave = sound->waveform == AUDIO_TRIANGLE ? 4.f * fabsf(phase - .5f) - 1.f : (phase < .5f ? 1.f : -1.f);
+        out[2 * i] += wave * gain * voice->left;
+        out[2 * i + 1] += wave * gain * voice->right;
+        phase += step;
+        if (phase >= 1.f) phase -= 1.f;
+        gain *= voice->decay;
+    }
+
+    voice->phase = phase;
+    voice->gain = gain;
+    voice->frame += frames;
+    if (voice->frame >= voice->frame_count) voice->sound = 0;
+}
+
+/**
+ * @brief Мягкий ограничитель: до audio_limiter_knee сигнал не меняется, выше —
+ * knee + (1 - knee) * u / (1 + u), где u = (|x| - knee) / (1 - knee).
+ *
+ * Кривая непрерывна вместе с наклоном в колене и не выходит за [-1, 1].
+ */
+inline float
+soft_limit_audio(float x) {
+    float a = fabsf(x);
+    float u = (a > audio_limiter_knee ? a - audio_limiter_knee : 0.f) / (1.f - audio_limiter_knee);
+    float y = (a < audio_limiter_knee ? a : audio_limiter_knee) + (1.f - audio_limiter_knee) * u / (1.f + u);
+    return x < 0.f ? -y : y;
+}
+
+/**
+ * @brief Сводит один блок всех голосов и кладёт его в кольцо отсчётов.
+ */
+internal void
+mix_audio_block(Audio_Mixer* mixer) {
+    PROFILE_ZONE("audio_mix");
+    u64 begin_ns = profile_time_ns();
+
+    u32 read = mixer->command_read.load(std::memory_order_relaxed);
+    u32 write = mixer->command_write.load(std::memory_order_acquire);
+    for (; read != write; read++) {
+        start_audio_voice(mixer, mixer->commands + (read & (audio_command_ring_size - 1)));
+    }
+    mixer->command_read.store(read, std::memory_order_release);
+
+    alignas(16) float block[audio_block_frames * 2] = {};
+    for (int i = 0; i < audio_max_voices; i++) {
+        if (mixer->voices[i].sound) mix_audio_voice(mixer->voices + i, block);
+    }
+
+    // audio_ring_frames кратно 4, а блок кратен 4, поэтому группы по 2 кадра не переходят через край кольца.
+    u32 frame = mixer->sample_write.load(std::memory_order_relaxed);
+#ifdef SIMD_SSE2
+    __m128 sign = _mm_set1_ps(-0.f);
+    __m128 master = _mm_set1_ps(audio_master_gain);
+    __m128 knee = _mm_set1_ps(audio_limiter_knee);
+    __m128 range = _mm_set1_ps(1.f - audio_limiter_knee);
+    __m128 one = _mm_set1_ps(1.f);
+#endif
+    for (int i = 0; i < audio_block_frames; i += 2, frame += 2) {
+        float* dst = mixer->samples + 2 * (frame & (audio_ring_frames - 1));
+#ifdef SIMD_SSE2
+        // То же, что soft_limit_audio, по 4 отсчёта.
+        __m128 value = _mm_mul_ps(_mm_load_ps(block + 2 * i), master);
+        __m128 a = _mm_andnot_ps(sign, value);
+        __m128 u = _mm_div_ps(_mm_max_ps(_mm_sub_ps(a, knee), _mm_setzero_ps()), range);
+        __m128 y = _mm_add_ps(_mm_min_ps(a, knee), _mm_div_ps(_mm_mul_ps(range, u), _mm_add_ps(one, u)));
+        _mm_store_ps(dst, _mm_or_ps(y, _mm_and_ps(value, sign)));
+#else
+        for (int j = 0; j < 4; j++) dst[j] = soft_limit_audio(block[2 * i + j] * audio_master_gain);
+#endif
+    }
+    mixer->sample_write.store(frame, std::memory_order_release);
+    mixer->blocks_mixed.fetch_add(1, std::memory_order_relaxed);
+
+    u64 mix_ns = profile_time_ns() - begin_ns;
+    if (mix_ns > mixer->max_mix_ns.load(std::memory_order_relaxed)) mixer->max_mix_ns.store(mix_ns, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Поток микшера: держит в кольце audio_target_blocks готовых блоков.
+ */
+internal void
+audio_mixer_thread() {
+    Audio_Mixer* mixer = &audio_mixer;
+    while (!mixer->stop.load(std::memory_order_acquire)) {
+        while (mixer->sample_write.load(std::memory_order_relaxed) - mixer->sample_read.load(std::memory_order_acquire) +
+               audio_block_frames <= audio_target_blocks * audio_block_frames) {
+            mix_audio_block(mixer);
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+}
+
+/**
+ * @brief Пишет заголовок WAV (PCM 16 бит, стерео) с размером данных frames кадров.
+ */
+internal bool
+write_wav_header(FILE* file, u32 frames) {
+    u32 data_size = frames * 4;
+    u32 header[11] = {
+        0x46464952, 36 + data_size, 0x45564157, // "RIFF", размер, "WAVE"
+        0x20746d66, 16, 1 | (2 << 16), (u32)audio_sample_rate, (u32)audio_sample_rate * 4, 4 | (16 << 16), // "fmt "
+        0x61746164, data_size, // "data"
+    };
+    return fseek(file, 0, SEEK_SET) == 0 && fwrite(header, sizeof(header), 1, file) == 1;
+}
+
+/**
+ * @brief Забирает из кольца один блок и переводит его в 16 бит.
+ *
+ * Если блока в кольце нет, это недогрузка: она учитывается, а в pcm остаётся тишина.
+ *
+ * @param mixer Микшер.
+ * @param pcm Стереоблок (L, R) длиной audio_block_frames кадров.
+ * @return true, если блок был в кольце.
+ */
+internal bool
+play_audio_block(Audio_Mixer* mixer, s16* pcm) {
+    memset(pcm, 0, sizeof(s16) * audio_block_frames * 2);
+    u32 read = mixer->sample_read.load(std::memory_order_relaxed);
+    u32 write = mixer->sample_write.load(std::memory_order_acquire);
+    if (write - read < audio_block_frames) {
+        mixer->underruns.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    for (int i = 0; i < audio_block_frames; i++, read++) {
+        const float* src = mixer->samples + 2 * (read & (audio_ring_frames - 1));
+        pcm[2 * i] = (s16)(src[0] * 32767.f);
+        pcm[2 * i + 1] = (s16)(src[1] * 32767.f);
+    }
+    mixer->sample_read.store(read, std::memory_order_release);
+    mixer->blocks_played.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Поток вывода: раз в 2.5 мс забирает блок из кольца, как звуковая карта.
+ *
+ * Если поток проснулся поздно, он забирает все просроченные блоки подряд. Каждый блок,
+ * которого к сроку нет в кольце, считается недогрузкой и выводится тишиной.
+ * Если запись в WAV не удалась, файл больше не пишется, а end_audio сообщает об ошибке.
+ */
+internal void
+audio_sink_thread() {
+    Audio_Mixer* mixer = &audio_mixer;
+    auto period = std::chrono::nanoseconds(1000000000ll * audio_block_frames / audio_sample_rate);
+    auto deadline = std::chrono::steady_clock::now() + period * audio_target_blocks;
+    while (!mixer->stop.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_until(deadline);
+        deadline += period;
+
+        s16 pcm[audio_block_frames * 2];
+        play_audio_block(mixer, pcm);
+
+        if (mixer->wav && !mixer->wav_failed.load(std::memory_order_relaxed)) {
+            if (fwrite(pcm, sizeof(pcm), 1, mixer->wav) == 1) {
+                mixer->wav_frames += audio_block_frames;
+            } else {
+                mixer->wav_failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Запускает микшер и вывод.
+ *
+ * @param path Путь к выходному WAV-файлу или "null" для вывода в никуда.
+ *
+ * @return true, если микшер запущен.
+ */
+internal bool
+begin_audio(const char* path) {
+    Audio_Mixer* mixer = &audio_mixer;
+    if (mixer->active) return false;
+
+    mixer->wav = 0;
+    if (strcmp(path, "null")) {
+        mixer->wav = fopen(path, "wb");
+        if (!mixer->wav) return false;
+        if (!write_wav_header(mixer->wav, 0)) {
+            fclose(mixer->wav);
+            mixer->wav = 0;
+            return false;
+        }
+    }
+    mixer->wav_frames = 0;
+    mixer->wav_failed = false;
+
+    mixer->command_write = 0;
+    mixer->command_read = 0;
+    mixer->sample_write = 0;
+    mixer->sample_read = 0;
+    memset(mixer->voices, 0, sizeof(mixer->voices));
+    mixer->blocks_mixed = 0;
+    mixer->blocks_played = 0;
+    mixer->underruns = 0;
+    mixer->commands_dropped = 0;
+    mixer->voices_stolen = 0;
+    mixer->max_mix_ns = 0;
+    mixer->stop = false;
+
+    mixer->mixer = std::thread(audio_mixer_thread);
+    mixer->sink = std::thread(audio_sink_thread);
+    mixer->active = true;
+    return true;
+}
+
+/**
+ * @brief Кладёт команду в кольцо микшера; если кольцо полно, команда теряется и учитывается.
+ */
+internal void
+push_audio_command(Audio_Mixer* mixer, Audio_Sound_Id sound, float pan) {
+    u32 write = mixer->command_write.load(std::memory_order_relaxed);
+    if (write - mixer->command_read.load(std::memory_order_acquire) >= audio_command_ring_size) {
+        mixer->commands_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Audio_Command* command = mixer->commands + (write & (audio_command_ring_size - 1));
+    command->sound = (u8)sound;
+    command->pan = pan;
+    mixer->command_write.store(write + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Ставит звук в очередь микшера. Никогда не блокирует игровой цикл.
+ *
+ * @param sound Звук.
+ * @param pan Панорама от -1 (слева) до 1 (справа).
+ */
+internal void
+play_sound(Audio_Sound_Id sound, float pan) {
+    if (audio_mixer.active) push_audio_command(&audio_mixer, sound, pan);
+}
+
+/**
+ * @brief Панорама события: X события относительно арены правил, по которым идёт игра.
+ */
+internal float
+game_event_pan(const Game_State* state, const Game_Event* event) {
+    return event->x / ActiveRulesInfo(state)->arena_half_size_x;
+}
+
+/**
+ * @brief Озвучивает события последнего шага симуляции. Панорама — по X события.
+ *
+ * @param state Состояние игры после шага.
+ */
+internal void
+queue_game_sounds(const Game_State* state) {
+    for (int i = 0; i < state->event_count; i++) {
+        const Game_Event* event = state->events + i;
+        float pan = game_event_pan(state, event);
+        switch (event->kind) {
+        case kEventPaddleHit: play_sound(SOUND_PADDLE_HIT, pan); break;
+        case kEventWallBounce: play_sound(SOUND_WALL_BOUNCE, pan); break;
+        case kEventGoal: play_sound(SOUND_GOAL, pan); break;
+        case kEventModeChange: play_sound(SOUND_MODE_CHANGE, 0.f); break;
+        }
+    }
+}
+
+/**
+ * @brief Снимок счётчиков микшера.
+ */
+internal Audio_Stats
+get_audio_stats() {
+    Audio_Mixer* mixer = &audio_mixer;
+    Audio_Stats stats;
+    stats.blocks_mixed = mixer->blocks_mixed.load(std::memory_order_relaxed);
+    stats.blocks_played = mixer->blocks_played.load(std::memory_order_relaxed);
+    stats.underruns = mixer->underruns.load(std::memory_order_relaxed);
+    stats.commands_dropped = mixer->commands_dropped.load(std::memory_order_relaxed);
+    stats.voices_stolen = mixer->voices_stolen.load(std::memory_order_relaxed);
+    stats.max_mix_ns = mixer->max_mix_ns.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief Останавливает микшер и вывод, дописывает заголовок WAV.
+ *
+ * @param report Поток для итоговой статистики (может быть 0).
+ *
+ * @return false, если WAV-файл записан не целиком.
+ */
+internal bool
+end_audio(FILE* report) {
+    Audio_Mixer* mixer = &audio_mixer;
+    if (!mixer->active) return true;
+
+    mixer->stop.store(true, std::memory_order_release);
+    mixer->mixer.join();
+    mixer->sink.join();
+    mixer->active = false;
+    bool written = true;
+    if (mixer->wav) {
+        written = !mixer->wav_failed.load(std::memory_order_relaxed);
+        // Заголовок с размером дописанных кадров: без него файл не открыть, даже если данные неполные.
+        if (!write_wav_header(mixer->wav, mixer->wav_frames)) written = false;
+        if (fclose(mixer->wav) != 0) written = false;
+        mixer->wav = 0;
+    }
+
+    if (report) {
+        Audio_Stats stats = get_audio_stats();
+        fprintf(report, "audio: %llu blocks mixed, %llu played, %llu underruns, %llu commands dropped, "
+                "%llu voices stolen, max mix %.1f us\n",
+                (unsigned long long)stats.blocks_mixed, (unsigned long long)stats.blocks_played,
+                (unsigned long long)stats.underruns, (unsigned long long)stats.commands_dropped,
+                (unsigned long long)stats.voices_stolen, (double)stats.max_mix_ns / 1000.0);
+        if (!written) fprintf(report, "audio: WAV write failed\n");
+    }
+    return written;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file audio_check.cpp
+ * @brief Проверка микшера звука (audio.cpp): недогрузки, ограничитель, панорама, запись WAV.
+ *
+ * Сведение и вывод блоков вызываются напрямую на отдельном микшере, без потоков, поэтому
+ * проверки не зависят от планировщика:
+ * - вывод из пустого кольца — недогрузка с тишиной; сведённые блоки выводятся без недогрузок;
+ * - одиночный тихий звук проходит без изменений (ниже колена ограничителя);
+ * - все голоса сразу прижимаются ограничителем и не срезаются на краю 16 бит;
+ * - панорама события считается по арене правил матча, а не стандартной.
+ * Затем запускается настоящий микшер с потоками: вывод в /dev/full должен закончиться
+ * ошибкой записи WAV, а не молчаливо неполным файлом.
+ *
+ * Использование: audio_check
+ */
+
+#include "headless_platform.cpp"
+#include "audio.cpp"
+
+/**
+ * @brief Микшер проверки; потоки у него не запускаются.
+ */
+global_variable Audio_Mixer check_mixer;
+
+/**
+ * @brief Сводит один блок и сразу выводит его; возвращает наибольший модуль отсчёта по каналам.
+ */
+internal bool
+mix_and_play_block(Audio_Mixer* mixer, s16* pcm, int* peak_left, int* peak_right) {
+    mix_audio_block(mixer);
+    bool played = play_audio_block(mixer, pcm);
+    for (int i = 0; i < audio_block_frames; i++) {
+        int left = abs(pcm[2 * i]), right = abs(pcm[2 * i + 1]);
+        if (left > *peak_left) *peak_left = left;
+        if (right > *peak_right) *peak_right = right;
+    }
+    return played;
+}
+
+int main() {
+    int failures = 0;
+    Audio_Mixer* mixer = &check_mixer;
+    s16 pcm[audio_block_frames * 2];
+
+    // Недогрузки: пустое кольцо — тишина и счётчик; два сведённых блока выводятся, третий — нет.
+    bool played = play_audio_block(mixer, pcm);
+    bool silent = true;
+    for (int i = 0; i < audio_block_frames * 2; i++) silent = silent && !pcm[i];
+    mix_audio_block(mixer);
+    mix_audio_block(mixer);
+    int played_count = play_audio_block(mixer, pcm) + play_audio_block(mixer, pcm) + play_audio_block(mixer, pcm);
+    u64 underruns = mixer->underruns.load();
+    printf("underruns: empty ring played %d silent %d, then %d of 3 blocks played, %llu underruns\n", played, silent,
+           played_count, (unsigned long long)underruns);
+    if (played || !silent || played_count != 2 || underruns != 2 || mixer->blocks_played.load() != 2) failures++;
+
+    // Тихий звук по центру: линейный путь, пик — громкость звука с запасом и панорамой.
+    push_audio_command(mixer, SOUND_WALL_BOUNCE, 0.f);
+    int peak_left = 0, peak_right = 0;
+    mix_and_play_block(mixer, pcm, &peak_left, &peak_right);
+    int expected = (int)(audio_sounds[SOUND_WALL_BOUNCE].volume * audio_master_gain * sqrtf(.5f) * 32767.f);
+    printf("quiet: peak %d %d, expected at most %d\n", peak_left, peak_right, expected);
+    if (peak_left != peak_right || peak_left > expected || peak_left < expected * 9 / 10) failures++;
+    while (mixer->voices[0].sound) mix_and_play_block(mixer, pcm, &peak_left, &peak_right);
+
+    // Все голоса сразу: сумма в несколько раз выше полной шкалы, отсчёты прижаты, но не срезаны.
+    for (int i = 0; i < audio_max_voices; i++) push_audio_command(mixer, i % 2 ? SOUND_GOAL : SOUND_PADDLE_HIT, 0.f);
+    peak_left = peak_right = 0;
+    int full_scale = 0;
+    for (int block = 0; block < 8; block++) {
+        mix_and_play_block(mixer, pcm, &peak_left, &peak_right);
+        for (int i = 0; i < audio_block_frames * 2; i++) full_scale += pcm[i] >= 32767 || pcm[i] <= -32767;
+    }
+    printf("all voices: peak %d %d, %d samples at full scale\n", peak_left, peak_right, full_scale);
+    if (peak_left < 28000 || full_scale) failures++;
+
+    // Панорама: X события по арене правил матча.
+    Game_State state = {};
+    state.current_gamemode = kGameplay;
+    state.rules = kRulesBigArena;
+    Game_Event event = {};
+    event.kind = kEventWallBounce;
+    event.x = kGameRulesInfo[kRulesBigArena].arena_half_size_x * .5f;
+    float half_pan = game_event_pan(&state, &event);
+    event.x = kGameRulesInfo[kRulesBigArena].arena_half_size_x;
+    float right_pan = game_event_pan(&state, &event);
+    for (int i = 0; i < audio_max_voices; i++) mixer->voices[i].sound = 0;
+    push_audio_command(mixer, SOUND_WALL_BOUNCE, right_pan);
+    peak_left = peak_right = 0;
+    mix_and_play_block(mixer, pcm, &peak_left, &peak_right);
+    printf("pan: half arena %.3f, edge %.3f, edge peak %d %d\n", half_pan, right_pan, peak_left, peak_right);
+    if (half_pan != .5f || right_pan != 1.f || peak_left || !peak_right) failures++;
+
+    // Потоки и запись: /dev/full открывается, но запись в него не удаётся.
+    bool wav_ok = true;
+    if (begin_audio("/dev/full")) {
+        for (int i = 0; i < 40; i++) play_sound(SOUND_PADDLE_HIT, 0.f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        wav_ok = end_audio(stdout);
+    }
+    printf("wav to /dev/full: %s\n", wav_ok ? "reported written" : "reported failed");
+    if (wav_ok) failures++;
+
+    printf("%d failures\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,194 @@
+/**
+ * @file bot_plugin.cpp
+ * @brief Загрузка ботов из разделяемых библиотек (bots/pong_bot.h) и вызов их с бюджетом времени.
+ *
+ * Бот получает вид матча со своей стороны и возвращает ускорение ракетки, которое
+ * переводится в аналоговое управление Input::paddle_axis. Время каждого вызова act
+ * меряется часами процессорного времени потока (CLOCK_THREAD_CPUTIME_ID), поэтому
+ * соседние матчи на других ядрах и вытеснение потока не засчитываются боту. Ответ,
+ * посчитанный дольше бюджета, отбрасывается: в этот тик ракетка не ускоряется.
+ * Прервать зависший вызов в том же процессе нельзя, поэтому бюджет ограничивает
+ * пользу от долгого ответа, а не его длительность. Для сторожа в другом процессе
+ * run_bot_player отмечает, когда начался текущий вызов (Bot_Player::call_started_ns):
+ * турнир играет матч в дочернем процессе и убивает его, если вызов завис.
+ */
+
+#include <dlfcn.h>
+#include <time.h>
+
+#include <atomic>
+
+#include "bots/pong_bot.h"
+
+/**
+ * @struct Bot_Plugin
+ * @brief Загруженная библиотека бота.
+ */
+struct Bot_Plugin {
+    void* library; /**< Дескриптор dlopen. */
+    const Pong_Bot_Api* api; /**< Описание бота из pong_bot_entry. */
+    const char* path; /**< Путь к библиотеке. */
+};
+
+/**
+ * @struct Bot_Player
+ * @brief Экземпляр бота, управляющий одной ракеткой матча, и статистика его вызовов.
+ */
+struct Bot_Player {
+    const Bot_Plugin* plugin; /**< Бот. */
+    void* bot; /**< Экземпляр из create. */
+    int player; /**< 0 — первая ракетка (справа), 1 — вторая (слева). */
+    u64 budget_ns; /**< Бюджет процессорного времени на вызов. */
+    u64 calls; /**< Количество вызовов act. */
+    u64 total_ns; /**< Суммарное время act. */
+    u64 max_ns; /**< Самый долгий вызов. */
+    int overruns; /**< Сколько ответов отброшено из-за бюджета. */
+    std::atomic<u64>* call_started_ns; /**< Сюда пишется начало текущего вызова act (headless_time_ns, 0 — вне act); может быть 0. */
+};
+
+/**
+ * @brief Загружает библиотеку бота и проверяет версию ABI.
+ *
+ * @return false (с сообщением в stderr), если библиотека не загружена, нет точки входа
+ * или бот собран с другой версией ABI.
+ */
+internal bool
+load_bot_plugin(Bot_Plugin* plugin, const char* path) {
+    *plugin = Bot_Plugin();
+    plugin->path = path;
+    plugin->library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!plugin->library) {
+        fprintf(stderr, "%s\n", dlerror());
+        return false;
+    }
+    Pong_Bot_Entry entry = (Pong_Bot_Entry)dlsym(plugin->library, "pong_bot_entry");
+    plugin->api = entry ? entry() : 0;
+    if (!plugin->api || plugin->api->abi_version != PONG_BOT_ABI_VERSION || !plugin->api->act) {
+        fprintf(stderr, "%s: no pong_bot_entry with ABI version %d\n", path, PONG_BOT_ABI_VERSION);
+        dlclose(plugin->library);
+        *plugin = Bot_Plugin();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Выгружает библиотеку бота.
+ */
+internal void
+unload_bot_plugin(Bot_Plugin* plugin) {
+    if (plugin->library) dlclose(plugin->library);
+    *plugin = Bot_Plugin();
+}
+
+/**
+ * @brief Имя бота для таблиц: из описания или путь к библиотеке.
+ */
+inline const char*
+bot_plugin_name(const Bot_Plugin* plugin) {
+    return plugin->api->name ? plugin->api->name : plugin->path;
+}
+
+/**
+ * @brief Создаёт экземпляр бота для ракетки player (0 или 1).
+ */
+internal void
+start_bot_player(Bot_Player* player, const Bot_Plugin* plugin, int paddle, u64 budget_ns) {
+    *player = Bot_Player();
+    player->plugin = plugin;
+    player->player = paddle;
+    player->budget_ns = budget_ns;
+    player->bot = plugin->api->create ? plugin->api->create() : 0;
+}
+
+/**
+ * @brief Уничтожает экземпляр бота.
+ */
+internal void
+finish_bot_player(Bot_Player* player) {
+    if (player->plugin->api->destroy) player->plugin->api->destroy(player->bot);
+    player->bot = 0;
+}
+
+/**
+ * @brief Процессорное время потока в наносекундах.
+ */
+inline u64
+thread_cpu_time_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+/**
+ * @brief Заполняет вид матча со стороны ракетки player; вторая ракетка отражается на
+ * правую сторону, а скорость мяча дана с учётом множителя правил.
+ *
+ * @tparam Rules Правила матча.
+ */
+template <typename Rules>
+void fill_bot_view(Pong_Bot_View* view, const Game_State* state, int player, float dt) {
+    float mirror = player ? -1.f : 1.f;
+    view->arena_half_size_x = Rules::kArenaHalfSizeX;
+    view->arena_half_size_y = Rules::kArenaHalfSizeY;
+    view->paddle_x = Rules::kPaddleX;
+    view->paddle_half_size_x = Rules::kPlayerHalfSizeX;
+    view->paddle_half_size_y = Rules::kPlayerHalfSizeY;
+    view->ball_half_size = Rules::kBallHalfSize;
+    view->max_acceleration = Rules::kPlayerAcceleration;
+    view->paddle_damping = Rules::kPaddleDamping;
+    view->dt = dt;
+    view->own_p = player ? state->player_2_p : state->player_1_p;
+    view->own_dp = player ? state->player_2_dp : state->player_1_dp;
+    view->opponent_p = player ? state->player_1_p : state->player_2_p;
+    view->opponent_dp = player ? state->player_1_dp : state->player_2_dp;
+    view->ball_x = state->ball_p_x * mirror;
+    view->ball_y = state->ball_p_y;
+    view->ball_dx = state->ball_dp_x * Rules::kBallSpeedScale * mirror;
+    view->ball_dy = state->ball_dp_y * Rules::kBallSpeedScale;
+    // Очко player_1_score получает левая ракетка (мяч ушёл за правую), player_2_score — правая.
+    view->own_score = player ? state->player_1_score : state->player_2_score;
+    view->opponent_score = player ? state->player_2_score : state->player_1_score;
+}
+
+/**
+ * @brief Спрашивает бота и записывает ответ в input->paddle_axis его ракетки.
+ *
+ * Ответ ограничивается наибольшим ускорением правил; ответ дольше бюджета отбрасывается.
+ *
+ * @param player Экземпляр бота.
+ * @param state Состояние матча (kGameplay, enemy_is_ai = false).
+ * @param input Ввод, который затем получит StepGame.
+ * @param tick Номер тика.
+ * @param dt Длительность тика.
+ */
+internal void
+run_bot_player(Bot_Player* player, const Game_State* state, Input* input, u32 tick, float dt) {
+    Pong_Bot_View view = {};
+    view.abi_version = PONG_BOT_ABI_VERSION;
+    view.tick = tick;
+    switch (state->rules) {
+    case kRulesBigArena: fill_bot_view<Big_Arena_Rules>(&view, state, player->player, dt); break;
+    case kRulesFastBall: fill_bot_view<Fast_Ball_Rules>(&view, state, player->player, dt); break;
+    default: fill_bot_view<Standard_Rules>(&view, state, player->player, dt); break;
+    }
+
+    if (player->call_started_ns) player->call_started_ns->store(headless_time_ns(), std::memory_order_relaxed);
+    u64 begin_ns = thread_cpu_time_ns();
+    float acceleration = player->plugin->api->act(player->bot, &view);
+    u64 ns = thread_cpu_time_ns() - begin_ns;
+    if (player->call_started_ns) player->call_started_ns->store(0, std::memory_order_relaxed);
+    player->calls++;
+    player->total_ns += ns;
+    if (ns > player->max_ns) player->max_ns = ns;
+
+    float axis = 0.f;
+    if (ns > player->budget_ns) {
+        player->overruns++;
+    } else if (acceleration == acceleration) { // NaN — как отсутствие ответа.
+        axis = acceleration / view.max_acceleration;
+        if (axis > 1.f) axis = 1.f;
+        if (axis < -1.f) axis = -1.f;
+    }
+    input->paddle_axis[player->player] = axis;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file hang_bot.c
+ * @brief Пример бота, который зависает: играет как tracker, но на 120-м тике матча
+ * больше не возвращается из act.
+ *
+ * Нужен для проверки сторожа турнира: процесс матча убивается, бот проигрывает досрочно.
+ */
+
+#include "pong_bot.h"
+
+static float
+hang_act(void* bot, const Pong_Bot_View* view) {
+    (void)bot;
+    if (view->tick == 120) {
+        volatile unsigned spins = 0;
+        for (;;) spins++;
+    }
+    return (view->ball_y - view->own_p) * 100.f - view->own_dp * 10.f;
+}
+
+static const Pong_Bot_Api hang_api = {PONG_BOT_ABI_VERSION, "hang", 0, 0, hang_act};
+
+PONG_BOT_EXPORT const Pong_Bot_Api*
+pong_bot_entry(void) {
+    return &hang_api;
+}
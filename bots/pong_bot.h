@@ -0,0 +1,79 @@
+/**
+ * @file pong_bot.h
+ * @brief Стабильный C ABI ботов: бот — разделяемая библиотека, которая по виду матча возвращает ускорение ракетки.
+ *
+ * Библиотека экспортирует функцию pong_bot_entry (extern "C"), возвращающую описание
+ * бота с версией ABI. Игра создаёт отдельный экземпляр бота на каждый матч и вызывает
+ * act раз в тик. Экземпляры разных матчей могут работать одновременно в разных
+ * потоках, поэтому всё состояние бота должно жить в экземпляре, а не в глобальных.
+ *
+ * Вид матча всегда дан со стороны бота: его ракетка справа, в x = paddle_x,
+ * соперник — в x = -paddle_x; мяч летит к боту, когда ball_dx > 0.
+ * Время act ограничено бюджетом турнира: ответ, посчитанный дольше бюджета
+ * процессорного времени, отбрасывается (ракетка в этот тик не ускоряется). Бот, который
+ * не вернулся из act за hang_ms турнира или упал в нём, проигрывает матч досрочно.
+ *
+ * Структуры только дополняются новыми полями в конце; несовместимые изменения
+ * увеличивают PONG_BOT_ABI_VERSION.
+ */
+
+#ifndef PONG_BOT_H
+#define PONG_BOT_H
+
+#include <stdint.h>
+
+#define PONG_BOT_ABI_VERSION 1
+
+#ifdef _WIN32
+#define PONG_BOT_EXPORT __declspec(dllexport)
+#else
+#define PONG_BOT_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Вид матча со стороны бота (только для чтения).
+ */
+typedef struct Pong_Bot_View {
+    uint32_t abi_version; /**< PONG_BOT_ABI_VERSION игры. */
+    uint32_t tick; /**< Номер тика матча. */
+    float dt; /**< Длительность тика в секундах. */
+
+    float arena_half_size_x, arena_half_size_y; /**< Половины размеров арены. */
+    float paddle_x; /**< X ракетки бота (соперник в -paddle_x). */
+    float paddle_half_size_x, paddle_half_size_y; /**< Половины размеров ракетки. */
+    float ball_half_size; /**< Половина размера мяча. */
+    float max_acceleration; /**< Наибольшее ускорение ракетки. */
+    float paddle_damping; /**< Торможение: ускорение ракетки — ответ бота минус damping * скорость. */
+
+    float own_p, own_dp; /**< Позиция и скорость ракетки бота. */
+    float opponent_p, opponent_dp; /**< Позиция и скорость ракетки соперника. */
+    float ball_x, ball_y; /**< Позиция мяча. */
+    float ball_dx, ball_dy; /**< Скорость мяча. */
+    int32_t own_score, opponent_score; /**< Счёт. */
+} Pong_Bot_View;
+
+/**
+ * @brief Описание бота, которое возвращает pong_bot_entry.
+ */
+typedef struct Pong_Bot_Api {
+    uint32_t abi_version; /**< PONG_BOT_ABI_VERSION, с которой собран бот. */
+    const char* name; /**< Имя бота в таблице турнира. */
+    void* (*create)(void); /**< Создаёт экземпляр на матч (может вернуть 0, если состояние не нужно). */
+    void (*destroy)(void* bot); /**< Уничтожает экземпляр (может быть 0). */
+    float (*act)(void* bot, const Pong_Bot_View* view); /**< Ускорение ракетки, ограничивается ±max_acceleration. */
+} Pong_Bot_Api;
+
+/**
+ * @brief Точка входа библиотеки бота.
+ */
+typedef const Pong_Bot_Api* (*Pong_Bot_Entry)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file predictor_bot.c
+ * @brief Пример бота: прогнозирует, где мяч пересечёт линию ракетки (с отскоками
+ * от стенок), и встречает его краем ракетки, отправляя мяч в сторону, дальнюю от
+ * соперника; пока мяч летит к сопернику, возвращается к центру.
+ *
+ * Прогноз пересчитывается только при смене скорости мяча и хранится в экземпляре.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "pong_bot.h"
+
+typedef struct Predictor_Bot {
+    float ball_dx, ball_dy; /* Скорость мяча, для которой посчитан прогноз. */
+    float target; /* Куда вести ракетку. */
+} Predictor_Bot;
+
+static void*
+predictor_create(void) {
+    return calloc(1, sizeof(Predictor_Bot));
+}
+
+static void
+predictor_destroy(void* bot) {
+    free(bot);
+}
+
+/* Траектория с отскоками от стенок y = ±limit складывается в полосу с периодом 4 * limit. */
+static float
+predict_ball_y(const Pong_Bot_View* view) {
+    float limit = view->arena_half_size_y - view->ball_half_size;
+    float line_x = view->paddle_x - view->paddle_half_size_x - view->ball_half_size;
+    float period = 4 * limit;
+    float unfolded = fmodf(view->ball_y + view->ball_dy * (line_x - view->ball_x) / view->ball_dx + limit, period);
+    if (unfolded < 0) unfolded += period;
+    return unfolded < 2 * limit ? unfolded - limit : 3 * limit - unfolded;
+}
+
+static float
+predictor_act(void* bot, const Pong_Bot_View* view) {
+    Predictor_Bot* predictor = (Predictor_Bot*)bot;
+    if (!predictor) return 0.f;
+    if (view->ball_dx != predictor->ball_dx || view->ball_dy != predictor->ball_dy) {
+        predictor->ball_dx = view->ball_dx;
+        predictor->ball_dy = view->ball_dy;
+        predictor->target = 0.f;
+        if (view->ball_dx > 0) {
+            /* Мяч отскакивает со скоростью 2 * (ball_y - own_p): край ракетки даёт самый крутой угол. */
+            float edge = view->paddle_half_size_y * .8f;
+            predictor->target = predict_ball_y(view) + (view->opponent_p > 0 ? edge : -edge);
+        }
+    }
+    return (predictor->target - view->own_p) * 100.f - view->own_dp * 10.f;
+}
+
+static const Pong_Bot_Api predictor_api = {
+    PONG_BOT_ABI_VERSION, "predictor", predictor_create, predictor_destroy, predictor_act,
+};
+
+PONG_BOT_EXPORT const Pong_Bot_Api*
+pong_bot_entry(void) {
+    return &predictor_api;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file spin_bot.c
+ * @brief Пример бота, который не укладывается в бюджет: играет как tracker, но каждый
+ * восьмой тик тратит на ответ около миллисекунды процессорного времени.
+ *
+ * Нужен для проверки бюджета турнира: опоздавшие ответы отбрасываются, а при
+ * слишком многих опозданиях бот проигрывает матч.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "pong_bot.h"
+
+static void*
+spin_create(void) {
+    return calloc(1, sizeof(unsigned));
+}
+
+static void
+spin_destroy(void* bot) {
+    free(bot);
+}
+
+static float
+spin_act(void* bot, const Pong_Bot_View* view) {
+    unsigned* calls = (unsigned*)bot;
+    if (calls && (*calls)++ % 8 == 7) {
+        clock_t begin = clock();
+        while (clock() - begin < CLOCKS_PER_SEC / 1000) {
+        }
+    }
+    return (view->ball_y - view->own_p) * 100.f - view->own_dp * 10.f;
+}
+
+static const Pong_Bot_Api spin_api = {PONG_BOT_ABI_VERSION, "spin", spin_create, spin_destroy, spin_act};
+
+PONG_BOT_EXPORT const Pong_Bot_Api*
+pong_bot_entry(void) {
+    return &spin_api;
+}
@@ -0,0 +1,19 @@
+/**
+ * @file tracker_bot.c
+ * @brief Пример бота: ведёт ракетку за мячом по Y (ПД-регулятор), без состояния.
+ */
+
+#include "pong_bot.h"
+
+static float
+tracker_act(void* bot, const Pong_Bot_View* view) {
+    (void)bot;
+    return (view->ball_y - view->own_p) * 100.f - view->own_dp * 10.f;
+}
+
+static const Pong_Bot_Api tracker_api = {PONG_BOT_ABI_VERSION, "tracker", 0, 0, tracker_act};
+
+PONG_BOT_EXPORT const Pong_Bot_Api*
+pong_bot_entry(void) {
+    return &tracker_api;
+}
@@ -0,0 +1,440 @@
+/**
+ * @file chaos.cpp
+ * @brief Режим "хаос": тысячи мячей и несколько ракеток на одной арене.
+ *
+ * Мячи хранятся в пулах SoA. Столкновения ищутся через равномерную сетку:
+ * каждый кадр мячи сортируются подсчётом по ячейкам, поэтому мячи соседних
+ * ячеек лежат в памяти подряд и проверяются пачками (AabbVsAabbManyUniform из aabb_batch.cpp).
+ */
+
+#include <math.h>
+
+const int kMaxChaosBalls = 65536; /**< Вместимость пула мячей */
+const int kChaosPaddles = 4; /**< Ракеток в режиме: одна у человека, остальные у ИИ */
+const int kChaosInitialBalls = 2000; /**< Мячей при входе в режим */
+const int kChaosSpawnBatch = 1000; /**< Мячей, добавляемых по Enter */
+const float kChaosCellSize = 2.f; /**< Размер ячейки сетки: не меньше диаметра мяча */
+
+/**
+ * @brief Состояние режима "хаос".
+ *
+ * Массивы мячей выделяются из постоянной арены один раз. Для сортировки по
+ * ячейкам есть второй комплект массивов, указатели меняются местами каждый кадр.
+ */
+struct Chaos_State {
+    int ball_count; /**< Живых мячей */
+    int ball_capacity; /**< Размер пулов */
+    float *ball_x, *ball_y, *ball_dx, *ball_dy; /**< Мячи (SoA) */
+    float *sorted_x, *sorted_y, *sorted_dx, *sorted_dy; /**< Второй комплект для сортировки */
+    u32* ball_cell; /**< Ячейка каждого мяча */
+
+    int grid_width, grid_height; /**< Размер сетки в ячейках */
+    u32* cell_start; /**< Мячи ячейки c лежат в [cell_start[c], cell_start[c + 1]) */
+
+    int paddle_count; /**< Количество ракеток */
+    float *paddle_x, *paddle_p, *paddle_dp; /**< Ракетки (SoA): позиция по X, позиция по Y, скорость */
+    float max_ball_speed_x; /**< Наибольшая |dx| мячей при последней раскладке по сетке */
+
+    int player_1_score, player_2_score; /**< Счёт */
+    u32 random_state; /**< Состояние генератора случайных чисел */
+    u64 ball_contacts; /**< Столкновений мяч-мяч за всё время */
+};
+
+/**
+ * @brief Выделяет пулы режима "хаос" из постоянной арены.
+ *
+ * @param chaos Состояние режима.
+ * @param arena Постоянная арена.
+ * @param capacity Максимальное количество мячей.
+ * @param paddle_count Количество ракеток (не меньше одной): первая у человека, остальные у ИИ.
+ * @return false, если в арене не хватило места.
+ */
+bool InitChaos(Chaos_State* chaos, Memory_Arena* arena, int capacity, int paddle_count) {
+    *chaos = Chaos_State();
+    chaos->grid_width = (int)(2 * arena_half_size_x / kChaosCellSize) + 1;
+    chaos->grid_height = (int)(2 * arena_half_size_y / kChaosCellSize) + 1;
+    int cell_count = chaos->grid_width * chaos->grid_height;
+
+    float** arrays[] = { &chaos->ball_x, &chaos->ball_y, &chaos->ball_dx, &chaos->ball_dy,
+                         &chaos->sorted_x, &chaos->sorted_y, &chaos->sorted_dx, &chaos->sorted_dy };
+    for (float** array : arrays) {
+        *array = (float*)push_size(arena, sizeof(float) * capacity, 64);
+        if (!*array) return false;
+    }
+    chaos->ball_cell = push_array(arena, capacity, u32);
+    chaos->cell_start = push_array(arena, cell_count + 1, u32);
+    if (paddle_count < 1) paddle_count = 1;
+    chaos->paddle_x = push_array(arena, paddle_count, float);
+    chaos->paddle_p = push_array(arena, paddle_count, float);
+    chaos->paddle_dp = push_array(arena, paddle_count, float);
+    if (!chaos->ball_cell || !chaos->cell_start || !chaos->paddle_x || !chaos->paddle_p || !chaos->paddle_dp) return false;
+    chaos->ball_capacity = capacity;
+
+    // Ракетки парами у правой и левой стороны; каждая следующая пара на 30 ближе к центру,
+    // а если пар много, шаг сжимается, чтобы все поместились между центром и воротами.
+    int pairs = (paddle_count + 1) / 2;
+    float spacing = fminf(30.f, 75.f / (float)pairs);
+    chaos->paddle_count = paddle_count;
+    for (int i = 0; i < paddle_count; i++) {
+        chaos->paddle_x[i] = (i % 2 ? -1.f : 1.f) * (80.f - spacing * (float)(i / 2));
+        chaos->paddle_p[i] = 0;
+        chaos->paddle_dp[i] = 0;
+    }
+    chaos->random_state = 0x12345678u;
+    return true;
+}
+
+/**
+ * @brief Случайное число в [min, max) (xorshift32).
+ */
+float ChaosRandom(Chaos_State* chaos, float min, float max) {
+    u32 x = xorshift32(&chaos->random_state);
+    return min + (max - min) * (float)(x >> 8) * (1.f / 16777216.f);
+}
+
+/**
+ * @brief Ставит мяч в центр арены со случайной скоростью.
+ */
+void RespawnChaosBall(Chaos_State* chaos, int i) {
+    chaos->ball_x[i] = ChaosRandom(chaos, -5.f, 5.f);
+    chaos->ball_y[i] = ChaosRandom(chaos, -arena_half_size_y + 5.f, arena_half_size_y - 5.f);
+    float speed = ChaosRandom(chaos, 80.f, 160.f);
+    chaos->ball_dx[i] = ChaosRandom(chaos, 0.f, 1.f) < .5f ? -speed : speed;
+    chaos->ball_dy[i] = ChaosRandom(chaos, -60.f, 60.f);
+}
+
+/**
+ * @brief Добавляет мячи в пул (сколько поместится).
+ */
+void SpawnChaosBalls(Chaos_State* chaos, int count) {
+    for (int n = 0; n < count && chaos->ball_count < chaos->ball_capacity; n++) {
+        RespawnChaosBall(chaos, chaos->ball_count++);
+    }
+}
+
+/**
+ * @brief Разводит два пересекающихся мяча по оси наименьшего проникновения.
+ *
+ * Массы равны, поэтому при сближении мячи обмениваются скоростями вдоль этой оси.
+ */
+void ResolveChaosBalls(Chaos_State* chaos, int i, int j) {
+    float reach = 2 * ball_half_size;
+    float ddx = chaos->ball_x[j] - chaos->ball_x[i];
+    float ddy = chaos->ball_y[j] - chaos->ball_y[i];
+    float penetration_x = reach - fabsf(ddx);
+    float penetration_y = reach - fabsf(ddy);
+
+    if (penetration_x < penetration_y) {
+        float s = ddx < 0 ? -1.f : 1.f;
+        if ((chaos->ball_dx[j] - chaos->ball_dx[i]) * s < 0) {
+            float t = chaos->ball_dx[i];
+            chaos->ball_dx[i] = chaos->ball_dx[j];
+            chaos->ball_dx[j] = t;
+        }
+        chaos->ball_x[i] -= s * penetration_x * .5f;
+        chaos->ball_x[j] += s * penetration_x * .5f;
+    } else {
+        float s = ddy < 0 ? -1.f : 1.f;
+        if ((chaos->ball_dy[j] - chaos->ball_dy[i]) * s < 0) {
+            float t = chaos->ball_dy[i];
+            chaos->ball_dy[i] = chaos->ball_dy[j];
+            chaos->ball_dy[j] = t;
+        }
+        chaos->ball_y[i] -= s * penetration_y * .5f;
+        chaos->ball_y[j] += s * penetration_y * .5f;
+    }
+    chaos->ball_contacts++;
+}
+
+/**
+ * @brief Проверяет мяч i против мячей [begin, end) и разрешает найденные столкновения.
+ */
+void CollideChaosBallRange(Chaos_State* chaos, int i, int begin, int end) {
+    float reach = 2 * ball_half_size;
+    // Разведение сдвигает мяч i, поэтому следующие мячи проверяются уже с новым положением:
+    // четвёрками (одна проверка SSE), а хвост диапазона — по одному.
+    for (int j = begin, count; j < end; j += count) {
+        count = end - j < 4 ? 1 : 4;
+        u32 mask;
+        AabbVsAabbManyUniform(chaos->ball_x[i], chaos->ball_y[i], reach, reach, chaos->ball_x + j, chaos->ball_y + j, count, &mask);
+        while (mask) {
+            int k = 0;
+            while (!(mask & (1u << k))) k++;
+            mask &= mask - 1;
+            ResolveChaosBalls(chaos, i, j + k);
+        }
+    }
+}
+
+/**
+ * @brief Двигает мячи и отражает их от верхней и нижней стенок (по 4 мяча за итерацию).
+ */
+void IntegrateChaosBalls(Chaos_State* chaos, float dt) {
+    float top = arena_half_size_y - ball_half_size;
+    int n = chaos->ball_count;
+    int i = 0;
+#ifdef SIMD_SSE2
+    const __m128 sign = _mm_set1_ps(-0.f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 step = _mm_set1_ps(dt);
+    __m128 top4 = _mm_set1_ps(top);
+    __m128 bottom4 = _mm_set1_ps(-top);
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(chaos->ball_x + i);
+        __m128 y = _mm_loadu_ps(chaos->ball_y + i);
+        __m128 dx = _mm_loadu_ps(chaos->ball_dx + i);
+        __m128 dy = _mm_loadu_ps(chaos->ball_dy + i);
+        x = _mm_add_ps(x, _mm_mul_ps(dx, step));
+        y = _mm_add_ps(y, _mm_mul_ps(dy, step));
+
+        __m128 above = _mm_cmpgt_ps(y, top4);
+        __m128 below = _mm_cmplt_ps(y, bottom4);
+        y = _mm_or_ps(_mm_and_ps(above, top4), _mm_andnot_ps(above, y));
+        y = _mm_or_ps(_mm_and_ps(below, bottom4), _mm_andnot_ps(below, y));
+        // Скорость разворачивается, только если мяч уходит за стенку.
+        __m128 flip = _mm_or_ps(_mm_and_ps(above, _mm_cmpgt_ps(dy, zero)), _mm_and_ps(below, _mm_cmplt_ps(dy, zero)));
+        dy = _mm_xor_ps(dy, _mm_and_ps(flip, sign));
+
+        _mm_storeu_ps(chaos->ball_x + i, x);
+        _mm_storeu_ps(chaos->ball_y + i, y);
+        _mm_storeu_ps(chaos->ball_dy + i, dy);
+    }
+#endif
+    for (; i < n; i++) {
+        chaos->ball_x[i] += chaos->ball_dx[i] * dt;
+        chaos->ball_y[i] += chaos->ball_dy[i] * dt;
+        if (chaos->ball_y[i] > top) {
+            chaos->ball_y[i] = top;
+            if (chaos->ball_dy[i] > 0) chaos->ball_dy[i] *= -1;
+        } else if (chaos->ball_y[i] < -top) {
+            chaos->ball_y[i] = -top;
+            if (chaos->ball_dy[i] < 0) chaos->ball_dy[i] *= -1;
+        }
+    }
+}
+
+/**
+ * @brief Засчитывает голы и сортирует мячи подсчётом по ячейкам сетки.
+ */
+void BuildChaosGrid(Chaos_State* chaos) {
+    int cell_count = chaos->grid_width * chaos->grid_height;
+    u32* cell_start = chaos->cell_start;
+    memset(cell_start, 0, sizeof(u32) * (cell_count + 1));
+
+    float inverse_cell = 1.f / kChaosCellSize;
+    float max_speed_x = 0;
+    for (int i = 0; i < chaos->ball_count; i++) {
+        if (chaos->ball_x[i] + ball_half_size > arena_half_size_x) {
+            chaos->player_1_score++;
+            RespawnChaosBall(chaos, i);
+        } else if (chaos->ball_x[i] - ball_half_size < -arena_half_size_x) {
+            chaos->player_2_score++;
+            RespawnChaosBall(chaos, i);
+        }
+        int cx = clamp(0, (int)((chaos->ball_x[i] + arena_half_size_x) * inverse_cell), chaos->grid_width - 1);
+        int cy = clamp(0, (int)((chaos->ball_y[i] + arena_half_size_y) * inverse_cell), chaos->grid_height - 1);
+        u32 cell = (u32)(cx + cy * chaos->grid_width);
+        chaos->ball_cell[i] = cell;
+        cell_start[cell + 1]++;
+        max_speed_x = fmaxf(max_speed_x, fabsf(chaos->ball_dx[i]));
+    }
+    // Столкновения до следующей раскладки только обменивают и отражают dx, поэтому максимум держится.
+    chaos->max_ball_speed_x = max_speed_x;
+
+    for (int c = 0; c < cell_count; c++) cell_start[c + 1] += cell_start[c];
+
+    // После раскладки cell_start[c] указывает на конец ячейки c; сдвигаем обратно на начало.
+    for (int i = 0; i < chaos->ball_count; i++) {
+        u32 to = cell_start[chaos->ball_cell[i]]++;
+        chaos->sorted_x[to] = chaos->ball_x[i];
+        chaos->sorted_y[to] = chaos->ball_y[i];
+        chaos->sorted_dx[to] = chaos->ball_dx[i];
+        chaos->sorted_dy[to] = chaos->ball_dy[i];
+    }
+    memmove(cell_start + 1, cell_start, sizeof(u32) * cell_count);
+    cell_start[0] = 0;
+
+    float* t;
+    t = chaos->ball_x; chaos->ball_x = chaos->sorted_x; chaos->sorted_x = t;
+    t = chaos->ball_y; chaos->ball_y = chaos->sorted_y; chaos->sorted_y = t;
+    t = chaos->ball_dx; chaos->ball_dx = chaos->sorted_dx; chaos->sorted_dx = t;
+    t = chaos->ball_dy; chaos->ball_dy = chaos->sorted_dy; chaos->sorted_dy = t;
+}
+
+/**
+ * @brief Столкновения мяч-мяч: каждая пара соседних ячеек проверяется ровно один раз.
+ *
+ * Для мяча i проверяются два непрерывных диапазона: остаток его ячейки вместе с правой
+ * соседней и три ячейки строкой выше.
+ */
+void CollideChaosBalls(Chaos_State* chaos) {
+    int width = chaos->grid_width;
+    for (int cy = 0; cy < chaos->grid_height; cy++) {
+        for (int cx = 0; cx < width; cx++) {
+            int c = cx + cy * width;
+            int right = cx + 1 < width ? c + 1 : c;
+            int row_end = (int)chaos->cell_start[right + 1];
+            int up_begin = 0, up_end = 0;
+            if (cy + 1 < chaos->grid_height) {
+                int up = c + width;
+                up_begin = (int)chaos->cell_start[cx > 0 ? up - 1 : up];
+                up_end = (int)chaos->cell_start[(cx + 1 < width ? up + 1 : up) + 1];
+            }
+
+            for (int i = (int)chaos->cell_start[c]; i < (int)chaos->cell_start[c + 1]; i++) {
+                CollideChaosBallRange(chaos, i, i + 1, row_end);
+                if (up_begin < up_end) CollideChaosBallRange(chaos, i, up_begin, up_end);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Столкновения мячей с ракетками: проверяются только ячейки под ракеткой.
+ */
+void CollideChaosPaddles(Chaos_State* chaos) {
+    float reach_x = player_half_size_x + ball_half_size;
+    float reach_y = player_half_size_y + ball_half_size;
+    float inverse_cell = 1.f / kChaosCellSize;
+
+    for (int p = 0; p < chaos->paddle_count; p++) {
+        float px = chaos->paddle_x[p];
+        float py = chaos->paddle_p[p];
+        int cx0 = clamp(0, (int)((px - reach_x + arena_half_size_x) * inverse_cell), chaos->grid_width - 1);
+        int cx1 = clamp(0, (int)((px + reach_x + arena_half_size_x) * inverse_cell), chaos->grid_width - 1);
+        int cy0 = clamp(0, (int)((py - reach_y + arena_half_size_y) * inverse_cell), chaos->grid_height - 1);
+        int cy1 = clamp(0, (int)((py + reach_y + arena_half_size_y) * inverse_cell), chaos->grid_height - 1);
+
+        for (int cy = cy0; cy <= cy1; cy++) {
+            int row = cy * chaos->grid_width;
+            int begin = (int)chaos->cell_start[row + cx0];
+            int end = (int)chaos->cell_start[row + cx1 + 1];
+            // Ракетка не сдвигается, а отбитый мяч уже проверен: по 32 мяча (слово маски) за проверку.
+            for (int j = begin; j < end; j += 32) {
+                u32 mask;
+                AabbVsAabbManyUniform(px, py, reach_x, reach_y, chaos->ball_x + j, chaos->ball_y + j,
+                                      end - j < 32 ? end - j : 32, &mask);
+                while (mask) {
+                    int k = 0;
+                    while (!(mask & (1u << k))) k++;
+                    mask &= mask - 1;
+                    int i = j + k;
+                    // Как в StepGame: мяч выталкивается на сторону ракетки и получает наклон от точки удара.
+                    float side = chaos->ball_x[i] < px ? -1.f : 1.f;
+                    chaos->ball_x[i] = px + side * reach_x;
+                    chaos->ball_dx[i] = side * fabsf(chaos->ball_dx[i]);
+                    chaos->ball_dy[i] = (chaos->ball_y[i] - py) * 2 + chaos->paddle_dp[p] * .75f;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Y мяча, который раньше всех долетит до вертикали line_x (0, если ни один не летит к ней).
+ *
+ * Мячи берутся из сетки прошлой раскладки: столбцы ячеек просматриваются от столбца линии
+ * наружу и перестают, когда даже самый быстрый мяч из следующих столбцов не успеет раньше
+ * уже найденного. Поэтому обычно просматривается несколько столбцов, а не все мячи.
+ * Мячи, добавленные после раскладки, лежат за концом сетки и проверяются все.
+ */
+float ChaosIncomingBallY(const Chaos_State* chaos, float line_x) {
+    int width = chaos->grid_width;
+    int column = clamp(0, (int)((line_x + arena_half_size_x) / kChaosCellSize), width - 1);
+    float target = 0.f;
+    float best_time = 1e30f;
+    for (int ring = 0; ring < width; ring++) {
+        // До мяча в столбце ring не меньше ring - 2 ячеек: одна — положение линии внутри её
+        // ячейки, ещё одна — сдвиг мяча столкновениями после раскладки.
+        if (ring >= 2 && (float)(ring - 2) * kChaosCellSize >= best_time * chaos->max_ball_speed_x) break;
+        for (int side = -1; side <= 1; side += 2) {
+            int cx = column + side * ring;
+            if (cx < 0 || cx >= width || (ring == 0 && side > 0)) continue;
+            for (int cy = 0; cy < chaos->grid_height; cy++) {
+                int c = cx + cy * width;
+                for (int i = (int)chaos->cell_start[c]; i < (int)chaos->cell_start[c + 1]; i++) {
+                    float time = (line_x - chaos->ball_x[i]) / chaos->ball_dx[i];
+                    if (time > 0 && time < best_time) {
+                        best_time = time;
+                        target = chaos->ball_y[i];
+                    }
+                }
+            }
+        }
+    }
+    // Мячи, появившиеся после раскладки, ещё не в сетке — их немного, проверяются подряд.
+    int cell_count = width * chaos->grid_height;
+    for (int i = (int)chaos->cell_start[cell_count]; i < chaos->ball_count; i++) {
+        float time = (line_x - chaos->ball_x[i]) / chaos->ball_dx[i];
+        if (time > 0 && time < best_time) {
+            best_time = time;
+            target = chaos->ball_y[i];
+        }
+    }
+    return target;
+}
+
+/**
+ * @brief Двигает ракетки: первую — кнопками вверх/вниз, остальные — ИИ.
+ *
+ * ИИ ракетки целится в мяч, который долетит до неё раньше всех.
+ */
+void MoveChaosPaddles(Chaos_State* chaos, Input* input, float dt) {
+    for (int p = 0; p < chaos->paddle_count; p++) {
+        float ddp = 0.f;
+        if (p == 0) {
+            if (is_down(BUTTON_UP)) ddp += 2000;
+            if (is_down(BUTTON_DOWN)) ddp -= 2000;
+        } else {
+            float target = ChaosIncomingBallY(chaos, chaos->paddle_x[p]);
+            ddp = (target - chaos->paddle_p[p]) * 100;
+            if (ddp > 1300) ddp = 1300;
+            if (ddp < -1300) ddp = -1300;
+        }
+        SimulatePlayer(&chaos->paddle_p[p], &chaos->paddle_dp[p], ddp, dt);
+    }
+}
+
+/**
+ * @brief Один шаг режима "хаос".
+ *
+ * Enter добавляет мячи, Esc возвращает в меню.
+ *
+ * @param chaos Состояние режима.
+ * @param state Состояние игры (для смены режима).
+ * @param input Указатель на структуру ввода.
+ * @param dt Время, прошедшее с последнего шага симуляции.
+ */
+void StepChaos(Chaos_State* chaos, Game_State* state, Input* input, float dt) {
+    state->event_count = 0;
+    if (pressed(BUTTON_ESC)) {
+        state->current_gamemode = kMenu;
+        PushGameEvent(state, kEventModeChange, 0, 0, 0);
+        return;
+    }
+    if (!chaos->ball_count) SpawnChaosBalls(chaos, kChaosInitialBalls);
+    if (pressed(BUTTON_ENTER)) SpawnChaosBalls(chaos, kChaosSpawnBatch);
+
+    MoveChaosPaddles(chaos, input, dt);
+    IntegrateChaosBalls(chaos, dt);
+    BuildChaosGrid(chaos);
+    CollideChaosBalls(chaos);
+    CollideChaosPaddles(chaos);
+}
+
+/**
+ * @brief Составляет список отрисовки режима "хаос": все мячи — одной пакетной командой.
+ *
+ * @param chaos Состояние режима.
+ * @param list Список отрисовки кадра.
+ * @param arena Временная арена кадра.
+ */
+void RenderChaos(const Chaos_State* chaos, Draw_List* list, Memory_Arena* arena) {
+    push_number(list, chaos->player_1_score, -10, 40, 1.f, 0xbbffbb);
+    push_number(list, chaos->player_2_score, 10, 40, 1.f, 0xbbffbb);
+
+    push_rect_batch(list, arena, chaos->ball_x, chaos->ball_y, 0, chaos->ball_count, ball_half_size, ball_half_size, 0xffffff);
+    for (int p = 0; p < chaos->paddle_count; p++) {
+        push_rect(list, chaos->paddle_x[p], chaos->paddle_p[p], player_half_size_x, player_half_size_y, 0xff0000);
+    }
+}
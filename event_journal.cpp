@@ -0,0 +1,517 @@
+/**
+ * @file event_journal.cpp
+ * @brief Двоичный журнал игровых событий: кольцо на поток без блокировок и фоновая запись на диск (Linux).
+ *
+ * Каждый поток симуляции получает своё кольцо (add_journal_ring) и после шага матча
+ * кладёт в него события шага (удары ракеткой, отскоки, голы, смена режима) вместе
+ * с номером тика и состоянием матча. Поток игры только заполняет записи в кольце и
+ * публикует их одной атомарной записью; при полном кольце события отбрасываются
+ * и считаются, игра никогда не ждёт диска.
+ *
+ * Фоновый поток забирает записи из всех колец, кодирует их компактно и пишет в файл
+ * большими блоками, вызывая fdatasync не чаще раза в fsync_interval_ns.
+ *
+ * Формат файла: заголовок "PONGJRNL" и версия (u32), затем записи. Запись — байт длины
+ * и тело: вид события и игрок (байт), режим и правила (байт), номер матча, тик и счёт
+ * на момент события (varint), координаты события, скорость мяча и позиции ракеток (6 float, little-endian).
+ * Длина позволяет читателю пропускать поля, добавленные в следующих версиях.
+ *
+ * Записи одного кольца идут в файле в порядке публикации. Матч, который выполняли
+ * разные потоки (кража работы в match_scheduler.cpp), может иметь записи из разных
+ * колец не по порядку тиков в пределах одного прохода фонового потока.
+ */
+
+#include <atomic>
+#include <fcntl.h>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * @brief Сигнатура файла журнала.
+ */
+global_variable constexpr char journal_magic[8] = { 'P', 'O', 'N', 'G', 'J', 'R', 'N', 'L' };
+
+/**
+ * @brief Версия формата записей.
+ */
+global_variable constexpr u32 journal_version = 1;
+
+/**
+ * @brief Наибольшее количество колец (потоков-писателей) журнала.
+ */
+global_variable constexpr int max_journal_rings = 64;
+
+/**
+ * @brief Размер буфера фонового потока; блок пишется в файл, когда свободного места меньше записи.
+ */
+global_variable constexpr size_t journal_buffer_bytes = 1 << 20;
+
+/**
+ * @brief Наибольшая длина закодированной записи вместе с байтом длины.
+ */
+global_variable constexpr size_t max_journal_record_bytes = 64;
+
+/**
+ * @struct Journal_Record
+ * @brief Событие шага матча с номером тика и состоянием матча после шага.
+ */
+struct Journal_Record {
+    u32 tick; /**< Номер тика матча (с нуля). */
+    u32 match; /**< Номер матча. */
+    u8 kind; /**< Game_Event_Kind. */
+    u8 player; /**< Игрок события (Game_Event::player). */
+    u8 gamemode; /**< Gamemode после шага. */
+    u8 rules; /**< Game_Rules. */
+    u32 player_1_score, player_2_score; /**< Счёт на момент события (у гола — вместе с этим голом). */
+    float x, y; /**< Где произошло событие. */
+    float ball_dp_x, ball_dp_y; /**< Скорость мяча после шага. */
+    float player_1_p, player_2_p; /**< Позиции ракеток после шага. */
+};
+
+/**
+ * @struct Journal_Ring
+ * @brief Кольцо записей одного потока: один писатель (поток игры), один читатель (фоновый поток).
+ */
+struct Journal_Ring {
+    alignas(64) std::atomic<u64> head; /**< Следующая запись писателя. */
+    u64 cached_tail; /**< Последний прочитанный писателем tail (чтобы не трогать чужую линию кэша). */
+    std::atomic<u64> dropped; /**< Событий отброшено из-за полного кольца (пишет только писатель). */
+    alignas(64) std::atomic<u64> tail; /**< Следующая запись читателя. */
+    alignas(64) Journal_Record* records; /**< Записи. */
+    u64 mask; /**< Ёмкость - 1 (ёмкость — степень двойки). */
+};
+
+/**
+ * @struct Event_Journal
+ * @brief Файл журнала, кольца потоков-писателей и фоновый поток записи.
+ */
+struct Event_Journal {
+    int fd; /**< Файл журнала. */
+    Journal_Ring* rings[max_journal_rings]; /**< Кольца писателей. */
+    std::atomic<int> ring_count; /**< Сколько колец опубликовано фоновому потоку. */
+    std::mutex ring_mutex; /**< Регистрация колец. */
+    std::thread drain_thread; /**< Фоновый поток записи. */
+    std::atomic<bool> running; /**< Сбрасывается при закрытии журнала. */
+    u64 fsync_interval_ns; /**< Не чаще какого интервала вызывать fdatasync. */
+
+    // Только для фонового потока (читать после close_event_journal).
+    u8* buffer; /**< Закодированные записи, ещё не записанные в файл. */
+    size_t buffer_used; /**< Занято в buffer. */
+    u64 records_written; /**< Записей записано в файл. */
+    u64 bytes_written; /**< Байт записано в файл (с заголовком). */
+    u64 fsync_count; /**< Вызовов fdatasync. */
+    bool write_failed; /**< Запись в файл не удалась (дальше записи только считаются). */
+    u64 dropped_events; /**< Событий отброшено из-за полных колец (после close_event_journal). */
+};
+
+/**
+ * @brief Кладёт события последнего шага матча в кольцо потока (поток игры).
+ *
+ * Стоит одной проверки, если событий не было, и одной публикации на все события шага.
+ *
+ * @param ring Кольцо текущего потока.
+ * @param match Номер матча.
+ * @param tick Номер тика матча.
+ * @param state Состояние матча после StepGame.
+ */
+inline void
+journal_game_events(Journal_Ring* ring, u32 match, u32 tick, const Game_State* state) {
+    u64 count = (u64)state->event_count;
+    if (!count) return;
+    u64 head = ring->head.load(std::memory_order_relaxed);
+    if (head + count - ring->cached_tail > ring->mask + 1) {
+        ring->cached_tail = ring->tail.load(std::memory_order_acquire);
+        if (head + count - ring->cached_tail > ring->mask + 1) {
+            ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+            return;
+        }
+    }
+    // Гол — последнее событие шага: у событий до него в том же шаге счёт ещё без него.
+    u32 score_1 = (u32)state->player_1_score, score_2 = (u32)state->player_2_score;
+    const Game_Event* last = state->events + count - 1;
+    if (last->kind == kEventGoal) {
+        if (last->player == 1) score_1--;
+        else score_2--;
+    }
+    for (u64 i = 0; i < count; i++) {
+        const Game_Event* event = state->events + i;
+        if (event->kind == kEventGoal) {
+            score_1 = (u32)state->player_1_score;
+            score_2 = (u32)state->player_2_score;
+        }
+        Journal_Record* record = ring->records + ((head + i) & ring->mask);
+        record->tick = tick;
+        record->match = match;
+        record->kind = (u8)event->kind;
+        record->player = (u8)event->player;
+        record->gamemode = (u8)state->current_gamemode;
+        record->rules = (u8)state->rules;
+        record->player_1_score = score_1;
+        record->player_2_score = score_2;
+        record->x = event->x;
+        record->y = event->y;
+        record->ball_dp_x = state->ball_dp_x;
+        record->ball_dp_y = state->ball_dp_y;
+        record->player_1_p = state->player_1_p;
+        record->player_2_p = state->player_2_p;
+    }
+    ring->head.store(head + count, std::memory_order_release);
+}
+
+/**
+ * @brief Записывает беззнаковое число в varint (7 бит на байт, младшие вперёд).
+ */
+inline u8*
+put_journal_varint(u8* at, u64 value) {
+    while (value >= 0x80) {
+        *at++ = (u8)(value | 0x80);
+        value >>= 7;
+    }
+    *at++ = (u8)value;
+    return at;
+}
+
+/**
+ * @brief Читает varint, не заходя за end.
+ *
+ * @return Позиция после числа или 0, если число не помещается до end.
+ */
+inline const u8*
+get_journal_varint(const u8* at, const u8* end, u64* value) {
+    u64 result = 0;
+    for (int shift = 0; at < end && shift < 64; shift += 7) {
+        u8 byte = *at++;
+        result |= (u64)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return at;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Кодирует запись с байтом длины.
+ *
+ * @return Позиция после записи.
+ */
+internal u8*
+encode_journal_record(u8* out, const Journal_Record* record) {
+    u8* at = out + 1;
+    *at++ = (u8)(record->kind | record->player << 4);
+    *at++ = (u8)(record->gamemode | record->rules << 4);
+    at = put_journal_varint(at, record->match);
+    at = put_journal_varint(at, record->tick);
+    at = put_journal_varint(at, record->player_1_score);
+    at = put_journal_varint(at, record->player_2_score);
+    memcpy(at, &record->x, 6 * sizeof(float));
+    at += 6 * sizeof(float);
+    *out = (u8)(at - out - 1);
+    return at;
+}
+
+/**
+ * @brief Декодирует тело записи длины length.
+ *
+ * @return false, если тело короче полей этой версии.
+ */
+internal bool
+decode_journal_record(const u8* body, size_t length, Journal_Record* record) {
+    const u8* at = body;
+    const u8* end = body + length;
+    if (length < 2) return false;
+    record->kind = at[0] & 0xf;
+    record->player = at[0] >> 4;
+    record->gamemode = at[1] & 0xf;
+    record->rules = at[1] >> 4;
+    at += 2;
+    u64 match, tick, score_1, score_2;
+    if (!(at = get_journal_varint(at, end, &match)) || !(at = get_journal_varint(at, end, &tick)) ||
+        !(at = get_journal_varint(at, end, &score_1)) || !(at = get_journal_varint(at, end, &score_2))) {
+        return false;
+    }
+    if ((size_t)(end - at) < 6 * sizeof(float)) return false;
+    record->match = (u32)match;
+    record->tick = (u32)tick;
+    record->player_1_score = (u32)score_1;
+    record->player_2_score = (u32)score_2;
+    memcpy(&record->x, at, 6 * sizeof(float));
+    return true;
+}
+
+/**
+ * @brief Пишет буфер фонового потока в файл целиком.
+ */
+internal void
+flush_journal_buffer(Event_Journal* journal) {
+    size_t offset = 0;
+    while (!journal->write_failed && offset < journal->buffer_used) {
+        ssize_t written = write(journal->fd, journal->buffer + offset, journal->buffer_used - offset);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            fprintf(stderr, "event journal: write failed: %s\n", strerror(errno));
+            journal->write_failed = true;
+            break;
+        }
+        offset += (size_t)written;
+    }
+    journal->bytes_written += offset;
+    journal->buffer_used = 0;
+}
+
+/**
+ * @brief Забирает из всех колец опубликованные записи и кодирует их в буфер (фоновый поток).
+ *
+ * @return Сколько записей забрано.
+ */
+internal u64
+drain_journal_rings(Event_Journal* journal) {
+    u64 drained = 0;
+    int ring_count = journal->ring_count.load(std::memory_order_acquire);
+    for (int r = 0; r < ring_count; r++) {
+        Journal_Ring* ring = journal->rings[r];
+        u64 tail = ring->tail.load(std::memory_order_relaxed);
+        u64 head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++) {
+            if (journal->buffer_used + max_journal_record_bytes > journal_buffer_bytes) {
+                // Слот освобождается раньше записи в файл: записи уже скопированы в буфер.
+                ring->tail.store(tail, std::memory_order_release);
+                flush_journal_buffer(journal);
+            }
+            u8* end = encode_journal_record(journal->buffer + journal->buffer_used, ring->records + (tail & ring->mask));
+            journal->buffer_used = (size_t)(end - journal->buffer);
+            drained++;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    journal->records_written += drained;
+    return drained;
+}
+
+/**
+ * @brief Основной цикл фонового потока: забрать, записать, периодически fdatasync.
+ */
+internal void
+journal_drain_main(Event_Journal* journal) {
+    u64 last_sync_ns = headless_time_ns();
+    u64 synced_bytes = journal->bytes_written;
+    for (;;) {
+        // Флаг читается до прохода: после остановки проход забирает всё, что писатели успели положить.
+        bool stopping = !journal->running.load(std::memory_order_acquire);
+        u64 drained = drain_journal_rings(journal);
+        if (journal->buffer_used && (!drained || journal->buffer_used > journal_buffer_bytes / 2 || stopping)) {
+            flush_journal_buffer(journal);
+        }
+        u64 now_ns = headless_time_ns();
+        if (journal->bytes_written != synced_bytes && (stopping || now_ns - last_sync_ns >= journal->fsync_interval_ns)) {
+            if (!journal->write_failed) fdatasync(journal->fd);
+            journal->fsync_count++;
+            synced_bytes = journal->bytes_written;
+            last_sync_ns = now_ns;
+        }
+        if (stopping) break;
+        if (!drained) {
+            timespec pause = { 0, 500000 };
+            nanosleep(&pause, 0);
+        }
+    }
+}
+
+/**
+ * @brief Создаёт файл журнала и запускает фоновый поток записи.
+ *
+ * @param journal Журнал (создаётся вызывающим через new Event_Journal()).
+ * @param path Путь к файлу; существующий файл перезаписывается.
+ * @param fsync_interval_ms Не чаще какого интервала вызывать fdatasync.
+ * @return false (с сообщением в stderr), если файл не создан.
+ */
+internal bool
+open_event_journal(Event_Journal* journal, const char* path, int fsync_interval_ms) {
+    journal->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (journal->fd < 0) {
+        fprintf(stderr, "event journal: cannot create %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    journal->buffer = (u8*)malloc(journal_buffer_bytes);
+    if (!journal->buffer) {
+        close(journal->fd);
+        return false;
+    }
+    memcpy(journal->buffer, journal_magic, sizeof(journal_magic));
+    memcpy(journal->buffer + sizeof(journal_magic), &journal_version, sizeof(journal_version));
+    journal->buffer_used = sizeof(journal_magic) + sizeof(journal_version);
+    journal->fsync_interval_ns = (u64)(fsync_interval_ms > 0 ? fsync_interval_ms : 0) * 1000000ull;
+    journal->ring_count = 0;
+    journal->running = true;
+    journal->drain_thread = std::thread(journal_drain_main, journal);
+    return true;
+}
+
+/**
+ * @brief Создаёт кольцо для потока-писателя.
+ *
+ * Кольцо принадлежит одному потоку: journal_game_events для него вызывается только из этого потока.
+ *
+ * @param journal Журнал.
+ * @param capacity Ёмкость в записях (округляется вверх до степени двойки).
+ * @return Кольцо или 0, если колец уже max_journal_rings или нет памяти.
+ */
+internal Journal_Ring*
+add_journal_ring(Event_Journal* journal, u32 capacity) {
+    std::lock_guard<std::mutex> lock(journal->ring_mutex);
+    int index = journal->ring_count.load(std::memory_order_relaxed);
+    if (index == max_journal_rings) return 0;
+    u64 size = 64;
+    while (size < capacity) size <<= 1;
+    Journal_Ring* ring = new Journal_Ring();
+    ring->records = (Journal_Record*)malloc(size * sizeof(Journal_Record));
+    if (!ring->records) {
+        delete ring;
+        return 0;
+    }
+    ring->mask = size - 1;
+    journal->rings[index] = ring;
+    journal->ring_count.store(index + 1, std::memory_order_release);
+    return ring;
+}
+
+/**
+ * @brief Сколько событий отброшено во всех кольцах.
+ */
+internal u64
+journal_dropped_events(Event_Journal* journal) {
+    u64 dropped = 0;
+    int ring_count = journal->ring_count.load(std::memory_order_acquire);
+    for (int r = 0; r < ring_count; r++) dropped += journal->rings[r]->dropped.load(std::memory_order_relaxed);
+    return dropped;
+}
+
+/**
+ * @brief Записывает оставшиеся события, закрывает файл и освобождает кольца.
+ *
+ * Писатели к этому моменту должны быть остановлены. Счётчики журнала (записи, байты,
+ * fdatasync, отброшенные события) остаются доступными после закрытия.
+ *
+ * @param journal Журнал.
+ * @return false, если запись в файл не удалась.
+ */
+internal bool
+close_event_journal(Event_Journal* journal) {
+    journal->running.store(false, std::memory_order_release);
+    journal->drain_thread.join();
+    bool ok = close(journal->fd) == 0 && !journal->write_failed;
+    journal->dropped_events = journal_dropped_events(journal);
+    int ring_count = journal->ring_count.load(std::memory_order_relaxed);
+    for (int r = 0; r < ring_count; r++) {
+        free(journal->rings[r]->records);
+        delete journal->rings[r];
+    }
+    journal->ring_count = 0;
+    free(journal->buffer);
+    journal->buffer = 0;
+    return ok;
+}
+
+/**
+ * @struct Journal_Reader
+ * @brief Потоковое чтение журнала блоками, без загрузки файла в память.
+ */
+struct Journal_Reader {
+    int fd; /**< Файл журнала. */
+    u8* buffer; /**< Блок файла. */
+    size_t capacity; /**< Размер buffer. */
+    size_t size, at; /**< Прочитано в buffer и позиция следующей записи. */
+    bool end_of_file; /**< Файл дочитан до конца. */
+    bool truncated; /**< Последняя запись оборвана (например, процесс упал во время записи). */
+    bool corrupt; /**< Запись не разбирается. */
+    u64 records; /**< Прочитано записей. */
+    u64 bytes; /**< Прочитано байт файла. */
+};
+
+/**
+ * @brief Дочитывает файл в буфер, сдвигая непрочитанный остаток в начало.
+ */
+internal void
+refill_journal_reader(Journal_Reader* reader) {
+    memmove(reader->buffer, reader->buffer + reader->at, reader->size - reader->at);
+    reader->size -= reader->at;
+    reader->at = 0;
+    while (!reader->end_of_file && reader->size < reader->capacity) {
+        ssize_t count = read(reader->fd, reader->buffer + reader->size, reader->capacity - reader->size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) {
+            reader->end_of_file = true;
+            break;
+        }
+        reader->size += (size_t)count;
+        reader->bytes += (u64)count;
+    }
+}
+
+/**
+ * @brief Открывает журнал и проверяет заголовок.
+ *
+ * @return false (с сообщением в stderr), если файл не открыт или это не журнал этой версии.
+ */
+internal bool
+open_journal_reader(Journal_Reader* reader, const char* path) {
+    *reader = Journal_Reader();
+    reader->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (reader->fd < 0) {
+        fprintf(stderr, "event journal: cannot open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    posix_fadvise(reader->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    reader->capacity = 1 << 20;
+    reader->buffer = (u8*)malloc(reader->capacity);
+    if (!reader->buffer) {
+        close(reader->fd);
+        return false;
+    }
+    refill_journal_reader(reader);
+    u32 version = 0;
+    if (reader->size >= sizeof(journal_magic) + sizeof(version)) memcpy(&version, reader->buffer + sizeof(journal_magic), sizeof(version));
+    if (reader->size < sizeof(journal_magic) + sizeof(version) || memcmp(reader->buffer, journal_magic, sizeof(journal_magic)) ||
+        version != journal_version) {
+        fprintf(stderr, "event journal: %s is not a version %u journal\n", path, journal_version);
+        close(reader->fd);
+        free(reader->buffer);
+        return false;
+    }
+    reader->at = sizeof(journal_magic) + sizeof(version);
+    return true;
+}
+
+/**
+ * @brief Читает следующую запись.
+ *
+ * @return false в конце файла или на оборванной/испорченной записи (truncated, corrupt).
+ */
+internal bool
+next_journal_record(Journal_Reader* reader, Journal_Record* record) {
+    if (reader->size - reader->at < 1 + max_journal_record_bytes && !reader->end_of_file) refill_journal_reader(reader);
+    if (reader->at == reader->size) return false;
+    size_t length = reader->buffer[reader->at];
+    if (reader->size - reader->at < 1 + length) {
+        reader->truncated = true;
+        return false;
+    }
+    if (!decode_journal_record(reader->buffer + reader->at + 1, length, record)) {
+        reader->corrupt = true;
+        return false;
+    }
+    reader->at += 1 + length;
+    reader->records++;
+    return true;
+}
+
+/**
+ * @brief Закрывает журнал, открытый для чтения.
+ */
+internal void
+close_journal_reader(Journal_Reader* reader) {
+    close(reader->fd);
+    free(reader->buffer);
+    reader->buffer = 0;
+}
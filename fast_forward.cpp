@@ -0,0 +1,311 @@
+/**
+ * @file fast_forward.cpp
+ * @brief Промотка матча от события к событию без промежуточных кадров (для безоконного анализа).
+ *
+ * Между событиями мяч летит по прямой, поэтому время до ближайшей стенки, линии ракетки
+ * или линии гола считается делением. Ракетки между событиями подчиняются тем же
+ * уравнениям, что и в SimulatePlayer, но в непрерывном времени: p'' = F - 10 p'.
+ * Для удерживаемых кнопок F постоянна, для ИИ F = 100 (цель - p) с ограничением
+ * ±1300 — это затухающий осциллятор. Оба случая решаются в замкнутой форме, а моменты
+ * смены режима (насыщение ИИ, упор в стенку) ищутся методом Ньютона на участках,
+ * где позиция монотонна. Цель ИИ между событиями постоянна (см. UpdateAiPrediction),
+ * поэтому розыгрыш занимает несколько шагов вместо сотен тиков dt.
+ *
+ * Как и в StepGame, мяч, пропущенный на линии ракетки, ещё может быть отбит, пока
+ * пересекает ракетку по X: ракетка может наехать на него сбоку. На этом коротком
+ * отрезке столкновение проверяется с шагом kPaddleProbeStep.
+ *
+ * С шаговой симуляцией результаты совпадают с точностью до ошибки дискретизации:
+ * StepGame замечает столкновение на тике, когда мяч уже вошёл в ракетку.
+ * Промотка моделирует стандартные правила (Standard_Rules).
+ */
+
+#include <math.h>
+
+const double kPaddleDrag = Standard_Rules::kPaddleDamping; /**< Торможение ракетки из SimulatePlayer */
+const double kAiGain = Standard_Rules::kAiGain; /**< Коэффициент ИИ из StepGame */
+const double kAiMaxAccel = Standard_Rules::kAiMaxAcceleration; /**< Ограничение ускорения ИИ из StepGame */
+const int kMaxPaddleSegments = 16; /**< Предел смен режима ракетки за один интервал */
+const double kMaxPaddleSpeed = Standard_Rules::kPlayerAcceleration / kPaddleDrag; /**< Установившаяся скорость ракетки при зажатой кнопке (у ИИ меньше) */
+const double kPaddleProbeStep = 1.0 / 240; /**< Шаг проверки столкновения, пока мяч проходит ракетку насквозь */
+
+/**
+ * @brief Участок движения ракетки с постоянным законом силы.
+ */
+struct Paddle_Segment {
+    bool linear; /**< ИИ без насыщения: F = kAiGain * (target - p); иначе F = accel */
+    double p0, v0; /**< Позиция и скорость в начале участка */
+    double accel; /**< Постоянная сила */
+    double target; /**< Цель ИИ */
+};
+
+/**
+ * @brief Позиция и скорость ракетки через время t от начала участка.
+ */
+void EvaluatePaddleSegment(const Paddle_Segment* segment, double t, double* p, double* v) {
+    if (!segment->linear) {
+        double v_inf = segment->accel / kPaddleDrag;
+        double decay = exp(-kPaddleDrag * t);
+        *p = segment->p0 + v_inf * t + (segment->v0 - v_inf) * (1 - decay) / kPaddleDrag;
+        *v = v_inf + (segment->v0 - v_inf) * decay;
+    } else {
+        // x'' + 10 x' + 100 x = 0: x = e^(-5t) (x0 cos wt + b sin wt).
+        double w = sqrt(kAiGain - kPaddleDrag * kPaddleDrag * .25);
+        double x0 = segment->p0 - segment->target;
+        double b = (segment->v0 + kPaddleDrag * .5 * x0) / w;
+        double c = -kPaddleDrag * .5 * b - w * x0;
+        double decay = exp(-kPaddleDrag * .5 * t);
+        *p = segment->target + decay * (x0 * cos(w * t) + b * sin(w * t));
+        *v = decay * (segment->v0 * cos(w * t) + c * sin(w * t));
+    }
+}
+
+/**
+ * @brief Первый момент в (0, t_max], когда ракетка достигает одного из уровней.
+ *
+ * Участок разбивается на интервалы монотонности по моментам остановки ракетки;
+ * на интервале, где позиция переходит через уровень, момент уточняется методом Ньютона.
+ *
+ * @param segment Участок движения.
+ * @param levels Уровни позиции.
+ * @param level_count Количество уровней.
+ * @param t_max Длина интервала.
+ * @param hit_level Сюда записывается номер достигнутого уровня.
+ * @return Момент достижения или t_max, если уровни не достигнуты.
+ */
+double FirstPaddleCrossing(const Paddle_Segment* segment, const double* levels, int level_count, double t_max,
+                           int* hit_level) {
+    *hit_level = -1;
+    double stops[8];
+    int stop_count = 0;
+    if (!segment->linear) {
+        // v = v_inf + (v0 - v_inf) e^(-10t) обращается в ноль не больше одного раза.
+        double v_inf = segment->accel / kPaddleDrag;
+        if (v_inf != 0 && segment->v0 / v_inf < 0) stops[stop_count++] = log(1 - segment->v0 / v_inf) / kPaddleDrag;
+    } else {
+        // v = e^(-5t) (v0 cos wt + c sin wt) обращается в ноль через каждые pi / w.
+        double w = sqrt(kAiGain - kPaddleDrag * kPaddleDrag * .25);
+        double x0 = segment->p0 - segment->target;
+        double b = (segment->v0 + kPaddleDrag * .5 * x0) / w;
+        double c = -kPaddleDrag * .5 * b - w * x0;
+        double phase = atan2(c, segment->v0) + M_PI * .5;
+        phase = fmod(phase, M_PI);
+        if (phase <= 0) phase += M_PI;
+        for (double t = phase / w; t < t_max && stop_count < 8; t += M_PI / w) stops[stop_count++] = t;
+    }
+    stops[stop_count++] = t_max;
+
+    double t_a = 0, p_a = segment->p0;
+    for (int piece = 0; piece < stop_count; piece++) {
+        double t_b = stops[piece] < t_max ? stops[piece] : t_max;
+        double p_b, v_b;
+        EvaluatePaddleSegment(segment, t_b, &p_b, &v_b);
+
+        double best = t_b + 1;
+        for (int i = 0; i < level_count; i++) {
+            double from = p_a - levels[i], to = p_b - levels[i];
+            // Уровень, на котором участок начался, не считается.
+            if (fabs(from) < 1e-9 || (from > 0) == (to > 0)) continue;
+            // Метод Ньютона, а если он выходит из интервала — деление пополам.
+            double lo = t_a, hi = t_b, t = (lo + hi) * .5;
+            for (int iteration = 0; iteration < 40; iteration++) {
+                double p, v;
+                EvaluatePaddleSegment(segment, t, &p, &v);
+                if (fabs(p - levels[i]) < 1e-7) {
+                    hi = t;
+                    break;
+                }
+                if ((p - levels[i] > 0) == (from > 0)) lo = t;
+                else hi = t;
+                double next = v != 0 ? t - (p - levels[i]) / v : lo - 1;
+                t = next > lo && next < hi ? next : (lo + hi) * .5;
+            }
+            if (hi < best) {
+                best = hi;
+                *hit_level = i;
+            }
+        }
+        if (*hit_level >= 0) return best;
+        if (t_b >= t_max) break;
+        t_a = t_b;
+        p_a = p_b;
+    }
+    return t_max;
+}
+
+/**
+ * @brief Продвигает ракетку на время t в замкнутой форме.
+ *
+ * @param p Позиция ракетки.
+ * @param dp Скорость ракетки.
+ * @param is_ai Управляется ли ракетка ИИ.
+ * @param accel Ускорение от кнопок (для человека).
+ * @param target Цель ИИ.
+ * @param t Время.
+ */
+void AdvancePaddle(float* p, float* dp, bool is_ai, float accel, float target, double t) {
+    double limit = arena_half_size_y - player_half_size_y;
+    double position = *p, velocity = *dp;
+    for (int segment_index = 0; segment_index < kMaxPaddleSegments && t > 0; segment_index++) {
+        Paddle_Segment segment = {};
+        segment.p0 = position;
+        segment.v0 = velocity;
+        segment.accel = accel;
+        segment.target = target;
+
+        double saturation = kAiMaxAccel / kAiGain;
+        double levels[4] = { limit, -limit };
+        int level_count = 2;
+        if (is_ai) {
+            double x = position - target;
+            segment.linear = fabs(x) < saturation - 1e-9 || (fabs(x) <= saturation + 1e-9 && x * velocity <= 0);
+            if (!segment.linear) segment.accel = x > 0 ? -kAiMaxAccel : kAiMaxAccel;
+            levels[level_count++] = target + saturation;
+            levels[level_count++] = target - saturation;
+        }
+
+        // Ракетка стоит в стенке, и сила прижимает её туда же: дальше она не сдвинется.
+        double force = segment.linear ? kAiGain * (target - position) : segment.accel;
+        if (fabs(position) >= limit - 1e-9 && velocity == 0 && force * position >= 0) break;
+
+        int hit_level;
+        double step = FirstPaddleCrossing(&segment, levels, level_count, t, &hit_level);
+        EvaluatePaddleSegment(&segment, step, &position, &velocity);
+        t -= step;
+        if (hit_level == 0 || hit_level == 1) {
+            position = levels[hit_level];
+            velocity = 0;
+        } else if (hit_level >= 2) {
+            position = levels[hit_level];
+        }
+    }
+    *p = (float)position;
+    *dp = (float)velocity;
+}
+
+/**
+ * @brief Событие промотки с моментом, когда оно произошло.
+ */
+struct Fast_Forward_Event {
+    Game_Event event; /**< Событие */
+    float time; /**< Время от начала промотки */
+};
+
+/**
+ * @brief Продвигает обе ракетки и мяч на время t.
+ */
+void AdvanceMatch(Game_State* state, float player_1_accel, float player_2_accel, double t) {
+    AdvancePaddle(&state->player_1_p, &state->player_1_dp, state->enemy_is_ai, player_1_accel, state->ai_target_y, t);
+    AdvancePaddle(&state->player_2_p, &state->player_2_dp, false, player_2_accel, 0, t);
+    state->ball_p_x += (float)(state->ball_dp_x * t);
+    state->ball_p_y += (float)(state->ball_dp_y * t);
+}
+
+/**
+ * @brief Проматывает матч на duration секунд, перескакивая от события к событию.
+ *
+ * Кнопки и аналоговое управление input считаются удержанными всё время промотки. Ответы на события те же,
+ * что и в StepGame; цель ИИ пересчитывается после каждого события мяча.
+ *
+ * @param state Состояние матча (режим kGameplay, стандартные правила; иначе промотки нет).
+ * @param input Удерживаемые кнопки.
+ * @param duration Время промотки в секундах.
+ * @param events Сюда пишутся события (может быть 0).
+ * @param max_events Вместимость events.
+ * @param event_count Сюда записывается количество событий (включая не поместившиеся).
+ * @return Количество шагов промотки (интервалов между событиями).
+ */
+int FastForwardGame(Game_State* state, const Input* input, float duration, Fast_Forward_Event* events,
+                    int max_events, int* event_count) {
+    *event_count = 0;
+    if (state->current_gamemode != kGameplay || state->rules != kRulesStandard) return 0;
+
+    const float accel = Standard_Rules::kPlayerAcceleration;
+    float player_1_accel = state->enemy_is_ai ? 0.f : PlayerAcceleration(input, BUTTON_UP, BUTTON_DOWN, 0, accel);
+    float player_2_accel = PlayerAcceleration(input, BUTTON_W, BUTTON_S, 1, accel);
+    if (state->enemy_is_ai && !state->ai_prediction_valid) UpdateAiPrediction(state);
+
+    const float wall_y = arena_half_size_y - ball_half_size;
+    const float paddle_x = Standard_Rules::kPaddleX - player_half_size_x - ball_half_size;
+    const float goal_x = arena_half_size_x - ball_half_size;
+    const float exit_x = Standard_Rules::kPaddleX + player_half_size_x + ball_half_size;
+    double time = 0;
+    int steps = 0;
+    while (time < duration) {
+        if (state->enemy_is_ai && state->ai_reaction_timer <= 0) state->ai_target_y = state->ai_next_target_y;
+        float x = state->ball_p_x, y = state->ball_p_y;
+        float dx = state->ball_dp_x, dy = state->ball_dp_y;
+
+        // Время до каждого возможного события; ближайшее и будет следующим.
+        double t_wall = dy > 0 ? (wall_y - y) / dy : (dy < 0 ? (-wall_y - y) / dy : INFINITY);
+        // Линия ракетки, а за ней — проверки, пока мяч не вышел из ракетки по X.
+        double t_paddle = INFINITY;
+        float side_x = dx > 0 ? x : -x, speed_x = fabsf(dx);
+        if (side_x < paddle_x) t_paddle = (paddle_x - side_x) / speed_x;
+        else if (side_x < exit_x - 1e-4f) {
+            // Если ракетка не успеет дотянуться до мяча, пока он в ракетке, проверки не нужны.
+            double t_exit = (exit_x - side_x) / speed_x;
+            float paddle_p = dx > 0 ? state->player_1_p : state->player_2_p;
+            float paddle_dp = dx > 0 ? state->player_1_dp : state->player_2_dp;
+            double reach = (fmax(fabsf(paddle_dp), kMaxPaddleSpeed) + fabsf(dy)) * t_exit;
+            double gap = fabsf(y - paddle_p) - (player_half_size_y + ball_half_size) - 1;
+            t_paddle = gap > reach ? t_exit : fmin(kPaddleProbeStep, t_exit);
+        }
+        double t_goal = dx > 0 ? (goal_x - x) / dx : (-goal_x - x) / dx;
+        double t_reaction = state->enemy_is_ai && state->ai_reaction_timer > 0 ? state->ai_reaction_timer : INFINITY;
+        double t_end = duration - time;
+        t_wall = fmax(t_wall, 0.);
+        t_paddle = fmax(t_paddle, 0.);
+        t_goal = fmax(t_goal, 0.);
+
+        double t = fmin(fmin(t_wall, t_paddle), fmin(t_goal, fmin(t_reaction, t_end)));
+        AdvanceMatch(state, player_1_accel, player_2_accel, t);
+        time += t;
+        steps++;
+        if (state->enemy_is_ai) state->ai_reaction_timer -= (float)t;
+
+        Game_Event event = {};
+        bool ball_event = false;
+        if (t == t_end) {
+            break;
+        } else if (t == t_reaction) {
+            continue;
+        } else if (t == t_paddle) {
+            bool right = dx > 0;
+            float paddle_p = right ? state->player_1_p : state->player_2_p;
+            float paddle_dp = right ? state->player_1_dp : state->player_2_dp;
+            // На самой линии мяч сдвигается чуть дальше неё, чтобы проверка по X совпала со StepGame.
+            float side_x = fmaxf(right ? state->ball_p_x : -state->ball_p_x, paddle_x + 1e-3f);
+            if (AabbVsAabb(right ? side_x : -side_x, state->ball_p_y, ball_half_size, ball_half_size,
+                           right ? Standard_Rules::kPaddleX : -Standard_Rules::kPaddleX, paddle_p, player_half_size_x, player_half_size_y)) {
+                state->ball_p_x = right ? paddle_x : -paddle_x;
+                state->ball_dp_x *= -1;
+                state->ball_dp_y = (state->ball_p_y - paddle_p) * 2 + paddle_dp * .75f;
+                event = { kEventPaddleHit, right ? 1 : 2, state->ball_p_x, state->ball_p_y };
+                ball_event = true;
+            }
+        } else if (t == t_wall) {
+            state->ball_p_y = dy > 0 ? wall_y : -wall_y;
+            state->ball_dp_y *= -1;
+            event = { kEventWallBounce, 0, state->ball_p_x, state->ball_p_y };
+            ball_event = true;
+        } else {
+            bool right = dx > 0;
+            event = { kEventGoal, right ? 1 : 2, right ? goal_x : -goal_x, state->ball_p_y };
+            state->ball_dp_x *= -1;
+            state->ball_dp_y = 0;
+            state->ball_p_x = 0;
+            state->ball_p_y = 0;
+            if (right) state->player_1_score++;
+            else state->player_2_score++;
+            ball_event = true;
+        }
+
+        if (ball_event) {
+            if (*event_count < max_events && events) events[*event_count] = { event, (float)time };
+            ++*event_count;
+            if (state->enemy_is_ai) UpdateAiPrediction(state, event.kind != kEventWallBounce);
+        }
+    }
+    return steps;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file fast_forward_check.cpp
+ * @brief Сверка промотки FastForwardGame с шаговой симуляцией StepGame и замер скорости.
+ *
+ * Для случайных подач (мяч, ракетки, удерживаемые кнопки второго игрока) шаговая симуляция
+ * играет розыгрыш до гола, и каждое её событие сверяется с промоткой из состояния после
+ * предыдущего события (для первого — из подачи). Вид события должен совпасть, а момент
+ * и место — совпасть с точностью до ошибки дискретизации шаговой симуляции (один тик dt).
+ * Сравнивать весь розыгрыш одной промоткой по моментам нельзя: ошибка в тик при отбивании
+ * меняет скорость мяча, и к следующим событиям расхождение растёт без предела.
+ * События, где исход решают доли единицы (мяч задевает край ракетки или угол арены),
+ * могут разойтись по виду; их доля должна быть малой.
+ *
+ * Промотка всего розыгрыша от подачи должна заканчиваться голом в те же ворота, кроме
+ * малой доли розыгрышей, а за час матча суммарный счёт обеих симуляций — совпадать
+ * с точностью до check_max_score_error.
+ *
+ * Использование:
+ *   fast_forward_check [-serves N] [-hz частота_тиков]
+ */
+
+#include "headless_platform.cpp"
+#include "fast_forward.cpp"
+
+/**
+ * @brief Предел длительности розыгрыша: ИИ против ракетки с зажатой кнопкой пропускает раньше.
+ */
+global_variable constexpr float check_rally_seconds = 30.f;
+
+/**
+ * @brief Вместимость списка событий промотки одного розыгрыша.
+ */
+global_variable constexpr int check_max_rally_events = 256;
+
+/**
+ * @brief Допустимая доля событий, вид которых разошёлся.
+ */
+global_variable constexpr double check_max_mismatch_rate = .01;
+
+/**
+ * @brief Допустимая доля розыгрышей, которые промотка от подачи завершает голом в другие ворота.
+ */
+global_variable constexpr double check_max_outcome_rate = .01;
+
+/**
+ * @brief Допустимое относительное расхождение суммарного счёта за час матча.
+ */
+global_variable constexpr double check_max_score_error = .03;
+
+/**
+ * @brief Длительность матча для замера скорости.
+ */
+global_variable constexpr float check_match_seconds = 3600.f;
+
+/**
+ * @brief Случайное число в [min, max) (LCG).
+ */
+internal float
+check_random(u32* state, float min, float max) {
+    *state = *state * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(*state >> 8) * (1.f / 16777216.f);
+}
+
+/**
+ * @brief Игрок, получивший очко первым голом промотки розыгрыша от state; 0, если гола не было.
+ */
+internal int
+forward_rally_scorer(Game_State state, const Input* input) {
+    Fast_Forward_Event events[check_max_rally_events];
+    int event_count;
+    FastForwardGame(&state, input, check_rally_seconds, events, check_max_rally_events, &event_count);
+    if (event_count > check_max_rally_events) event_count = check_max_rally_events;
+    for (int i = 0; i < event_count; i++) {
+        if (events[i].event.kind == kEventGoal) return events[i].event.player;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int serves = 2000;
+    int tick_hz = 60;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-serves")) serves = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-hz")) tick_hz = atoi(argv[i + 1]);
+    }
+    if (serves < 1) serves = 1;
+    if (tick_hz < 1) tick_hz = 60;
+    float dt = 1.f / (float)tick_hz;
+
+    u32 random_state = 12345;
+    int events = 0, mismatched = 0, failed = 0, other_outcome = 0, unfinished = 0;
+    double max_time_error = 0, max_y_error = 0;
+    for (int serve = 0; serve < serves; serve++) {
+        Game_State stepped = {};
+        start_headless_match(&stepped);
+        // Ошибка прицеливания случайна, а случайные числа шаговая симуляция и промотка тратят в разном порядке.
+        stepped.ai_aim_error = 0;
+        stepped.ball_p_y = check_random(&random_state, -40, 40);
+        stepped.ball_dp_x = check_random(&random_state, 0, 1) < .5f ? 130.f : -130.f;
+        stepped.ball_dp_y = check_random(&random_state, -90, 90);
+        stepped.player_1_p = check_random(&random_state, -30, 30);
+        stepped.player_2_p = check_random(&random_state, -30, 30);
+        Input input = {};
+        input.buttons[BUTTON_W].is_down = serve % 3 == 1;
+        input.buttons[BUTTON_S].is_down = serve % 3 == 2;
+        int forward_scorer = forward_rally_scorer(stepped, &input);
+
+        // Промотка от состояния после последнего тика с событиями до событий следующего такого тика.
+        Game_State from = stepped;
+        int from_tick = 0, scorer = 0;
+        for (int tick = 1; tick * dt <= check_rally_seconds && !scorer; tick++) {
+            StepGame(&stepped, &input, dt);
+            if (!stepped.event_count) continue;
+            Game_State forwarded = from;
+            Fast_Forward_Event actual[kMaxGameEvents];
+            int event_count;
+            FastForwardGame(&forwarded, &input, check_rally_seconds, actual, stepped.event_count, &event_count);
+            for (int i = 0; i < stepped.event_count; i++) {
+                const Game_Event* expected = stepped.events + i;
+                if (expected->kind == kEventGoal) scorer = expected->player;
+                events++;
+                if (i >= event_count || expected->kind != actual[i].event.kind || expected->player != actual[i].event.player) {
+                    mismatched++;
+                    break;
+                }
+                double time_error = fabs((tick - from_tick) * dt - actual[i].time);
+                double y_error = fabs(expected->y - actual[i].event.y);
+                if (time_error > max_time_error) max_time_error = time_error;
+                if (y_error > max_y_error) max_y_error = y_error;
+                // Шаговая симуляция замечает событие на ближайшем тике после него: мяч успевает сместиться на dy * dt.
+                // Следующее событие того же тика она ищет ещё со скоростью до первого, и ошибка бывает вдвое больше.
+                float speed_y = fmaxf(fabsf(from.ball_dp_y), fabsf(stepped.ball_dp_y));
+                double ticks = i ? 2 : 1;
+                if (time_error > ticks * dt + 1e-4 || y_error > speed_y * ticks * dt + .05) {
+                    failed++;
+                    printf("serve %d tick %d: step %.4f s y %.3f, fast forward %.4f s y %.3f\n", serve, tick,
+                           (tick - from_tick) * dt, expected->y, actual[i].time, actual[i].event.y);
+                }
+            }
+            from = stepped;
+            from_tick = tick;
+        }
+        // Бывают и бесконечные розыгрыши: мяч ходит по циклу между неподвижной ракеткой и ИИ.
+        if (!scorer) unfinished++;
+        else if (forward_scorer != scorer) other_outcome++;
+    }
+    printf("%d rallies at %d Hz: %d events, %d event kinds differ (edge cases), %d out of tolerance, max error %.4f s / %.3f\n",
+           serves, tick_hz, events, mismatched, failed, max_time_error, max_y_error);
+    printf("fast forward from the serve scores in the other goal in %d rallies, %d rallies without a goal in %.0f s\n",
+           other_outcome, unfinished, check_rally_seconds);
+
+    // Скорость: час матча ИИ против ракетки с зажатой кнопкой.
+    Game_State stepped = {};
+    start_headless_match(&stepped);
+    Input input = {};
+    input.buttons[BUTTON_W].is_down = true;
+    Game_State forwarded = stepped;
+
+    u64 begin_ns = headless_time_ns();
+    u64 ticks = (u64)(check_match_seconds * tick_hz);
+    for (u64 tick = 0; tick < ticks; tick++) StepGame(&stepped, &input, dt);
+    u64 step_ns = headless_time_ns() - begin_ns;
+
+    begin_ns = headless_time_ns();
+    int event_count;
+    int steps = FastForwardGame(&forwarded, &input, check_match_seconds, 0, 0, &event_count);
+    u64 forward_ns = headless_time_ns() - begin_ns;
+    printf("%.0f s match: StepGame %llu ticks %.2f ms (score %d:%d), FastForwardGame %d steps %.2f ms (score %d:%d)\n",
+           check_match_seconds, (unsigned long long)ticks, (double)step_ns / 1e6, stepped.player_1_score,
+           stepped.player_2_score, steps, (double)forward_ns / 1e6, forwarded.player_1_score, forwarded.player_2_score);
+
+    int stepped_points = stepped.player_1_score + stepped.player_2_score;
+    int forwarded_points = forwarded.player_1_score + forwarded.player_2_score;
+    double score_error = fabs((double)(forwarded_points - stepped_points)) / (stepped_points > 0 ? stepped_points : 1);
+    printf("total points differ by %.2f%% (at most %.0f%%)\n", score_error * 100, check_max_score_error * 100);
+    bool ok = !failed && mismatched <= check_max_mismatch_rate * events && other_outcome <= check_max_outcome_rate * serves &&
+              score_error <= check_max_score_error;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,346 @@
+/**
+ * @file frame_bench.cpp
+ * @brief Сквозной замер кадра без окна с проверкой эталонных хешей буфера кадра.
+ *
+ * Гоняет SimulateGame с фиксированным сценарием ввода на нескольких разрешениях,
+ * печатает кадры в секунду, время шага симуляции и время рендеринга кадра,
+ * а в контрольных кадрах хеширует буфер кадра и сверяет с эталонами.
+ * Так оптимизации рендерера проверяются сразу на побитовое совпадение и на скорость.
+ *
+ * Использование:
+ *   frame_bench [-frames N] [-assets каталог] [-check файл] [-update файл] [-simd 0|1|2] [-trace файл.json]
+ *               [-audio файл.wav|null]
+ *
+ * -check завершает программу с ненулевым кодом, если хоть один хеш не совпал;
+ * -update перезаписывает файл эталонов текущими хешами.
+ * -audio озвучивает события всех прогонов микшером на отдельном потоке и печатает
+ * его счётчики (недогрузки при полностью занятом игровом цикле).
+ *
+ * После 60 кадров разогрева каждого прогона считаются выделения в куче: operator new
+ * (heap_allocation_count) и, если сборка обернула их при компоновке (FRAME_BENCH_WRAP_MALLOC,
+ * -Wl,--wrap=malloc,...), вызовы malloc/calloc/realloc/aligned_alloc. С -check выделение
+ * в установившемся кадре — такая же ошибка, как несовпавший хеш.
+ */
+
+#include "headless_platform.cpp"
+#include "audio.cpp"
+
+/**
+ * @brief Вызовы malloc/calloc/realloc/aligned_alloc (в том числе из operator new).
+ */
+global_variable std::atomic<u64> malloc_call_count;
+
+#ifdef FRAME_BENCH_WRAP_MALLOC
+// Компоновщик с --wrap направляет сюда вызовы из всего кода единицы трансляции (игра, платформа, замер).
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* memory, size_t size);
+void* __real_aligned_alloc(size_t alignment, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    malloc_call_count.fetch_add(1, std::memory_order_relaxed);
+    return __real_malloc(size);
+}
+void* __wrap_calloc(size_t count, size_t size) {
+    malloc_call_count.fetch_add(1, std::memory_order_relaxed);
+    return __real_calloc(count, size);
+}
+void* __wrap_realloc(void* memory, size_t size) {
+    malloc_call_count.fetch_add(1, std::memory_order_relaxed);
+    return __real_realloc(memory, size);
+}
+void* __wrap_aligned_alloc(size_t alignment, size_t size) {
+    malloc_call_count.fetch_add(1, std::memory_order_relaxed);
+    return __real_aligned_alloc(alignment, size);
+}
+}
+#endif
+
+/**
+ * @brief Кадров разогрева, после которых выделения в куче считаются ошибкой.
+ */
+global_variable constexpr int bench_warmup_frames = 60;
+
+/**
+ * @brief Выделения в куче в установившихся кадрах всех прогонов.
+ */
+global_variable u64 steady_heap_allocations;
+
+/**
+ * @brief Сценарии ввода.
+ */
+enum Bench_Scenario {
+    BENCH_SINGLE_PLAYER, /**< Меню, затем игра против ИИ: второй игрок двигается по расписанию. */
+    BENCH_SPRITES, /**< То же со спрайтами из каталога assets. */
+    BENCH_CHAOS, /**< Меню, затем режим "хаос" с добавлением мячей. */
+
+    BENCH_SCENARIO_COUNT,
+};
+
+global_variable const char* const bench_scenario_names[BENCH_SCENARIO_COUNT] = {
+    "single", "sprites", "chaos",
+};
+
+/**
+ * @brief Разрешения, на которых прогоняется каждый сценарий.
+ */
+global_variable const int bench_resolutions[][2] = {
+    { 640, 360 }, { 1280, 720 }, { 1920, 1080 },
+};
+
+/**
+ * @brief Максимум контрольных хешей (сценарий x разрешение x контрольный кадр).
+ */
+global_variable constexpr int max_bench_hashes = 256;
+
+/**
+ * @struct Bench_Hash
+ * @brief Хеш буфера кадра в контрольной точке.
+ */
+struct Bench_Hash {
+    char scenario[16]; /**< Имя сценария. */
+    int width, height; /**< Разрешение. */
+    int frame; /**< Номер кадра (с единицы). */
+    u64 hash; /**< FNV-1a буфера кадра. */
+};
+
+/**
+ * @brief FNV-1a (64 бита) по пикселям буфера кадра.
+ */
+internal u64
+hash_framebuffer() {
+    return fnv1a_64(render_state.memory, (size_t)render_state.width * render_state.height * sizeof(u32));
+}
+
+/**
+ * @brief Нажимает или отпускает кнопку так же, как это делает платформенный слой.
+ */
+internal void
+set_bench_button(Input* input, int button, bool is_down) {
+    input->buttons[button].changed = input->buttons[button].is_down != is_down;
+    input->buttons[button].is_down = is_down;
+}
+
+/**
+ * @brief Заполняет ввод кадра frame по сценарию. Ввод зависит только от номера кадра.
+ */
+internal void
+scripted_input(Input* input, Bench_Scenario scenario, int frame) {
+    for (int i = 0; i < BUTTON_COUNT; i++) input->buttons[i].changed = false;
+
+    // Меню: нажатие на кадре 10 * k, отпускание на следующем.
+    int menu_presses[4] = { BUTTON_RIGHT, BUTTON_LEFT, BUTTON_ENTER, -1 };
+    if (scenario == BENCH_CHAOS) {
+        menu_presses[0] = BUTTON_RIGHT;
+        menu_presses[1] = BUTTON_RIGHT;
+    }
+    for (int k = 0; menu_presses[k] >= 0; k++) {
+        if (frame == 10 * (k + 1)) set_bench_button(input, menu_presses[k], true);
+        if (frame == 10 * (k + 1) + 1) set_bench_button(input, menu_presses[k], false);
+    }
+    if (frame <= 31) return;
+
+    // Игра: второй игрок (или ракетка человека в хаосе) поочерёдно вверх, вниз и стоит.
+    int phase = (frame / 45) % 3;
+    int up = scenario == BENCH_CHAOS ? BUTTON_UP : BUTTON_W;
+    int down = scenario == BENCH_CHAOS ? BUTTON_DOWN : BUTTON_S;
+    set_bench_button(input, up, phase == 0);
+    set_bench_button(input, down, phase == 1);
+
+    if (scenario == BENCH_CHAOS) {
+        bool spawn = frame % 200 == 100;
+        set_bench_button(input, BUTTON_ENTER, spawn);
+    }
+}
+
+/**
+ * @brief Является ли кадр контрольным.
+ */
+internal bool
+is_bench_checkpoint(int frame, int frame_count) {
+    return frame == 1 || frame == 30 || frame == 60 || frame % 300 == 0 || frame == frame_count;
+}
+
+/**
+ * @brief Прогоняет один сценарий на одном разрешении.
+ *
+ * @return Количество записанных хешей.
+ */
+internal int
+run_bench(Bench_Scenario scenario, int width, int height, int frame_count, const char* assets_path,
+          Bench_Hash* hashes, int hash_capacity) {
+    Game_Memory memory;
+    if (!init_headless_memory(&memory, 64 << 20, 16 << 20)) return 0;
+    resize_headless_framebuffer(width, height);
+    if (scenario == BENCH_SPRITES && LoadGameAssets(&memory, assets_path) != 3) {
+        fprintf(stderr, "frame_bench: no sprites in %s, skipping\n", assets_path);
+        free_headless_memory(&memory);
+        return 0;
+    }
+
+    Input input = {};
+    const float dt = 1.f / 60.f;
+    u64 update_ns = 0, render_ns = 0;
+    int hash_count = 0;
+    u64 steady_allocations = 0;
+    u64 begin_ns = headless_time_ns();
+
+    for (int frame = 1; frame <= frame_count; frame++) {
+        scripted_input(&input, scenario, frame);
+        reset_arena(&memory.transient);
+        u64 allocations_before = heap_allocation_count.load(std::memory_order_relaxed) +
+                                 malloc_call_count.load(std::memory_order_relaxed);
+
+        u64 t0 = headless_time_ns();
+        UpdateGame(&memory, &input, dt);
+        queue_game_sounds(GameStateFromMemory(&memory));
+        u64 t1 = headless_time_ns();
+        RenderFrame(&memory);
+        u64 t2 = headless_time_ns();
+        update_ns += t1 - t0;
+        render_ns += t2 - t1;
+        flush_profile();
+        u64 allocations = heap_allocation_count.load(std::memory_order_relaxed) +
+                          malloc_call_count.load(std::memory_order_relaxed) - allocations_before;
+        if (frame > bench_warmup_frames) steady_allocations += allocations;
+
+        if (is_bench_checkpoint(frame, frame_count) && hash_count < hash_capacity) {
+            Bench_Hash* hash = hashes + hash_count++;
+            snprintf(hash->scenario, sizeof(hash->scenario), "%s", bench_scenario_names[scenario]);
+            hash->width = width;
+            hash->height = height;
+            hash->frame = frame;
+            hash->hash = hash_framebuffer();
+        }
+    }
+
+    double seconds = (double)(headless_time_ns() - begin_ns) / 1e9;
+    printf("%-8s %5dx%-5d %8.1f fps %12.0f ns/step %12.0f ns/render %6llu heap allocations\n",
+           bench_scenario_names[scenario], width, height, frame_count / seconds,
+           (double)update_ns / frame_count, (double)render_ns / frame_count, (unsigned long long)steady_allocations);
+    steady_heap_allocations += steady_allocations;
+    fflush(stdout);
+    free_headless_memory(&memory);
+    return hash_count;
+}
+
+/**
+ * @brief Читает файл эталонов: строки "сценарий ширина высота кадр хеш".
+ *
+ * @return Количество прочитанных хешей или -1, если файл не открылся.
+ */
+internal int
+read_golden_hashes(const char* path, Bench_Hash* hashes, int capacity) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+    int count = 0;
+    char line[256];
+    while (count < capacity && fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        Bench_Hash* hash = hashes + count;
+        unsigned long long value;
+        if (sscanf(line, "%15s %d %d %d %llx", hash->scenario, &hash->width, &hash->height, &hash->frame, &value) == 5) {
+            hash->hash = value;
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+/**
+ * @brief Сверяет полученные хеши с эталонами.
+ *
+ * @return Количество расхождений (хеш отличается или эталона нет).
+ */
+internal int
+check_golden_hashes(const Bench_Hash* hashes, int count, const Bench_Hash* golden, int golden_count) {
+    int failures = 0;
+    for (int i = 0; i < count; i++) {
+        const Bench_Hash* hash = hashes + i;
+        const Bench_Hash* expected = 0;
+        for (int j = 0; j < golden_count; j++) {
+            const Bench_Hash* g = golden + j;
+            if (!strcmp(g->scenario, hash->scenario) && g->width == hash->width &&
+                g->height == hash->height && g->frame == hash->frame) {
+                expected = g;
+                break;
+            }
+        }
+        if (!expected || expected->hash != hash->hash) {
+            failures++;
+            printf("MISMATCH %s %dx%d frame %d: got %016llx, expected %s%016llx\n",
+                   hash->scenario, hash->width, hash->height, hash->frame, (unsigned long long)hash->hash,
+                   expected ? "" : "(none) ", expected ? (unsigned long long)expected->hash : 0ull);
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    int frame_count = 600;
+    const char* assets_path = "assets";
+    const char* check_path = 0;
+    const char* update_path = 0;
+    const char* trace_path = 0;
+    const char* audio_path = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-frames")) frame_count = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-assets")) assets_path = argv[i + 1];
+        else if (!strcmp(argv[i], "-check")) check_path = argv[i + 1];
+        else if (!strcmp(argv[i], "-update")) update_path = argv[i + 1];
+        else if (!strcmp(argv[i], "-simd")) blit_simd_level = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-trace")) trace_path = argv[i + 1];
+        else if (!strcmp(argv[i], "-audio")) audio_path = argv[i + 1];
+    }
+    if (frame_count < 1) frame_count = 1;
+    if (trace_path && !begin_profile(trace_path, true)) fprintf(stderr, "frame_bench: cannot open %s\n", trace_path);
+    if (audio_path && !begin_audio(audio_path)) fprintf(stderr, "frame_bench: cannot open %s\n", audio_path);
+
+    static Bench_Hash hashes[max_bench_hashes];
+    int hash_count = 0;
+    for (int scenario = 0; scenario < BENCH_SCENARIO_COUNT; scenario++) {
+        for (const auto& resolution : bench_resolutions) {
+            hash_count += run_bench((Bench_Scenario)scenario, resolution[0], resolution[1], frame_count, assets_path,
+                                    hashes + hash_count, max_bench_hashes - hash_count);
+        }
+    }
+    end_audio(stdout);
+    end_profile(trace_path ? stdout : 0);
+
+    if (update_path) {
+        FILE* file = fopen(update_path, "w");
+        if (!file) {
+            fprintf(stderr, "frame_bench: cannot write %s\n", update_path);
+            return EXIT_FAILURE;
+        }
+        fprintf(file, "# frame_bench -frames %d: scenario width height frame fnv1a64\n", frame_count);
+        for (int i = 0; i < hash_count; i++) {
+            fprintf(file, "%s %d %d %d %016llx\n", hashes[i].scenario, hashes[i].width, hashes[i].height,
+                    hashes[i].frame, (unsigned long long)hashes[i].hash);
+        }
+        fclose(file);
+        printf("wrote %d hashes to %s\n", hash_count, update_path);
+    }
+
+    if (check_path) {
+        static Bench_Hash golden[max_bench_hashes];
+        int golden_count = read_golden_hashes(check_path, golden, max_bench_hashes);
+        if (golden_count < 0) {
+            fprintf(stderr, "frame_bench: cannot read %s\n", check_path);
+            return EXIT_FAILURE;
+        }
+        int failures = check_golden_hashes(hashes, hash_count, golden, golden_count);
+        printf("%d/%d checkpoints match golden hashes\n", hash_count - failures, hash_count);
+#ifdef FRAME_BENCH_WRAP_MALLOC
+        printf("%llu heap allocations (operator new and malloc) after %d warm-up frames\n",
+               (unsigned long long)steady_heap_allocations, bench_warmup_frames);
+#else
+        printf("%llu operator new allocations after %d warm-up frames (malloc not counted in this build)\n",
+               (unsigned long long)steady_heap_allocations, bench_warmup_frames);
+#endif
+        if (failures || !hash_count || steady_heap_allocations) return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
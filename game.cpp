@@ -3,40 +3,124 @@
  * @brief Pong AI + Multiplayer.
  */
 
+#include <math.h>
+#include <string.h>
+
 #define is_down(b) input->buttons[b].is_down
 #define pressed(b) (input->buttons[b].is_down && input->buttons[b].changed)
 #define released(b) (!input->buttons[b].is_down && input->buttons[b].changed)
 
-float player_1_p, player_1_dp, player_2_p, player_2_dp;
-float arena_half_size_x = 85, arena_half_size_y = 45;
-float player_half_size_x = 2.5, player_half_size_y = 12;
-float ball_p_x, ball_p_y, ball_dp_x = 130, ball_dp_y, ball_half_size = 1;
+/**
+ * @brief Стандартные правила: размеры арены, ракеток и мяча и константы физики.
+ *
+ * Правила — параметр шаблонов симуляции, а не глобальные переменные: константы
+ * подставляются в код ядра, ветви на них решаются при компиляции, и каждый вариант
+ * правил компилируется в отдельное ядро. Варианты переопределяют нужные константы.
+ */
+struct Standard_Rules {
+    static constexpr float kArenaHalfSizeX = 85, kArenaHalfSizeY = 45; /**< Половины размеров арены */
+    static constexpr float kPlayerHalfSizeX = 2.5f, kPlayerHalfSizeY = 12; /**< Половины размеров ракетки */
+    static constexpr float kBallHalfSize = 1; /**< Половина размера мяча */
+    static constexpr float kPaddleX = 80; /**< X первой ракетки (вторая — в -kPaddleX) */
+    static constexpr float kPaddleDamping = 10; /**< Торможение ракетки */
+    static constexpr float kPlayerAcceleration = 2000; /**< Ускорение ракетки при зажатой кнопке */
+    static constexpr float kAiGain = 100, kAiMaxAcceleration = 1300; /**< Коэффициент и ограничение ускорения ИИ */
+    static constexpr float kBallSpeedScale = 1; /**< Множитель скорости мяча */
+};
+
+/**
+ * @brief Большая арена: вдвое шире и выше, ракетки у её краёв.
+ */
+struct Big_Arena_Rules : Standard_Rules {
+    static constexpr float kArenaHalfSizeX = 170, kArenaHalfSizeY = 90;
+    static constexpr float kPaddleX = 165;
+};
+
+/**
+ * @brief Быстрый мяч: мяч вдвое быстрее, ракетки и ИИ резвее.
+ */
+struct Fast_Ball_Rules : Standard_Rules {
+    static constexpr float kBallSpeedScale = 2;
+    static constexpr float kPlayerAcceleration = 3000;
+    static constexpr float kAiMaxAcceleration = 2600;
+};
+
+/**
+ * @brief Вариант правил матча; выбирает ядро симуляции во время выполнения.
+ */
+enum Game_Rules {
+    kRulesStandard, /**< Standard_Rules */
+    kRulesBigArena, /**< Big_Arena_Rules */
+    kRulesFastBall, /**< Fast_Ball_Rules */
 
-int player_1_score, player_2_score;
+    kRulesCount,
+};
+
+/**
+ * @brief Размеры варианта правил для кода, которому они нужны во время выполнения (рендеринг, эффекты).
+ */
+struct Game_Rules_Info {
+    const char* name; /**< Имя варианта в параметрах командной строки */
+    float arena_half_size_x, arena_half_size_y; /**< Половины размеров арены */
+    float paddle_x; /**< X первой ракетки */
+};
+
+/**
+ * @brief Размеры вариантов правил, по индексу Game_Rules.
+ */
+const Game_Rules_Info kGameRulesInfo[kRulesCount] = {
+    { "standard", Standard_Rules::kArenaHalfSizeX, Standard_Rules::kArenaHalfSizeY, Standard_Rules::kPaddleX },
+    { "big", Big_Arena_Rules::kArenaHalfSizeX, Big_Arena_Rules::kArenaHalfSizeY, Big_Arena_Rules::kPaddleX },
+    { "fast", Fast_Ball_Rules::kArenaHalfSizeX, Fast_Ball_Rules::kArenaHalfSizeY, Fast_Ball_Rules::kPaddleX },
+};
+
+/**
+ * @brief Вариант правил по имени из kGameRulesInfo; неизвестное имя — стандартные правила.
+ */
+Game_Rules GameRulesFromName(const char* name) {
+    for (int i = 0; i < kRulesCount; i++) {
+        if (!strcmp(name, kGameRulesInfo[i].name)) return (Game_Rules)i;
+    }
+    return kRulesStandard;
+}
+
+// Размеры стандартных правил для режима "хаос", эффектов и рендеринга.
+const float arena_half_size_x = Standard_Rules::kArenaHalfSizeX, arena_half_size_y = Standard_Rules::kArenaHalfSizeY;
+const float player_half_size_x = Standard_Rules::kPlayerHalfSizeX, player_half_size_y = Standard_Rules::kPlayerHalfSizeY;
+const float ball_half_size = Standard_Rules::kBallHalfSize;
 
 /**
  * @brief Симулирует движение игрока.
  *
+ * @tparam Rules Правила матча.
  * @param p Указатель на позицию игрока.
  * @param dp Указатель на скорость игрока.
  * @param ddp Ускорение игрока.
  * @param dt Время, прошедшее с последнего шага симуляции.
  */
+template <typename Rules = Standard_Rules>
 void SimulatePlayer(float *p, float *dp, float ddp, float dt) {
-    ddp -= *dp * 10.f;
+    ddp -= *dp * Rules::kPaddleDamping;
 
     *p = *p + *dp * dt + ddp * dt * dt * .5f;
     *dp = *dp + ddp * dt;
 
-    if (*p + player_half_size_y > arena_half_size_y) {
-        *p = arena_half_size_y - player_half_size_y;
+    if (*p + Rules::kPlayerHalfSizeY > Rules::kArenaHalfSizeY) {
+        *p = Rules::kArenaHalfSizeY - Rules::kPlayerHalfSizeY;
         *dp = 0;
-    } else if (*p - player_half_size_y < -arena_half_size_y) {
-        *p = -arena_half_size_y + player_half_size_y;
+    } else if (*p - Rules::kPlayerHalfSizeY < -Rules::kArenaHalfSizeY) {
+        *p = -Rules::kArenaHalfSizeY + Rules::kPlayerHalfSizeY;
         *dp = 0;
     }
 }
 
+/**
+ * @brief SimulatePlayer по стандартным правилам (нешаблонная функция для кода вне игры, например тестов).
+ */
+void SimulatePlayer(float *p, float *dp, float ddp, float dt) {
+    SimulatePlayer<Standard_Rules>(p, dp, ddp, dt);
+}
+
 /**
  * @brief Проверяет столкновение осей параллелепипедов.
  *
@@ -56,7 +140,7 @@ bool AabbVsAabb(float p1x, float p1y, float hs1x, float hs1y,
     return (p1x + hs1x > p2x - hs2x &&
             p1x - hs1x < p2x + hs2x &&
             p1y + hs1y > p2y - hs2y &&
-            p1y + hs1y < p2y + hs2y);
+            p1y - hs1y < p2y + hs2y);
 }
 
 /**
@@ -65,103 +149,528 @@ bool AabbVsAabb(float p1x, float p1y, float hs1x, float hs1y,
 enum Gamemode {
     kMenu, /**< Режим меню */
     kGameplay, /**< Режим игры */
+    kChaos, /**< Режим "хаос": тысячи мячей и несколько ракеток */
 };
 
-Gamemode current_gamemode; /**< Текущий режим игры */
-int hot_button; /**< Текущая выбранная кнопка в меню */
-bool enemy_is_ai; /**< Управляется ли противник ИИ */
+/**
+ * @brief Виды событий, которые шаг симуляции сообщает остальной игре (эффекты, звук, журнал).
+ */
+enum Game_Event_Kind {
+    kEventPaddleHit, /**< Мяч отбит ракеткой */
+    kEventWallBounce, /**< Мяч отскочил от верхней или нижней стенки */
+    kEventGoal, /**< Гол */
+    kEventModeChange, /**< Смена режима игры */
+};
 
 /**
- * @brief Симулирует состояние игры.
+ * @brief Событие шага симуляции.
+ */
+struct Game_Event {
+    Game_Event_Kind kind; /**< Вид события */
+    int player; /**< Ракетка, отбившая мяч, или игрок, получивший очко (1 или 2); 0, если не важно */
+    float x, y; /**< Где произошло событие */
+};
+
+/**
+ * @brief Максимальное количество событий за один шаг.
+ */
+const int kMaxGameEvents = 8;
+
+/**
+ * @brief Версия раскладки Game_State. Увеличивается при любом изменении полей:
+ * состояние сохраняется на диск копией байтов (save_state.cpp).
+ */
+const u32 kGameStateVersion = 3;
+
+/**
+ * @brief Полное состояние одного матча.
  *
+ * Размеры арены и ракеток задаются вариантом правил (rules) и известны ядру
+ * симуляции при компиляции, а всё, что меняется во время игры, хранится здесь,
+ * поэтому в одном процессе может идти сколько угодно независимых матчей.
+ */
+struct Game_State {
+    float player_1_p, player_1_dp; /**< Позиция и скорость первого игрока */
+    float player_2_p, player_2_dp; /**< Позиция и скорость второго игрока */
+    float ball_p_x, ball_p_y; /**< Позиция мяча */
+    float ball_dp_x = 130, ball_dp_y; /**< Скорость мяча */
+    int player_1_score, player_2_score; /**< Счёт */
+
+    Gamemode current_gamemode; /**< Текущий режим игры */
+    int hot_button; /**< Текущая выбранная кнопка в меню */
+    bool enemy_is_ai; /**< Управляется ли противник ИИ */
+    Game_Rules rules = kRulesStandard; /**< Вариант правил */
+
+    float ai_reaction_delay = .15f; /**< Через сколько секунд ИИ реагирует на новый прогноз (сложность) */
+    float ai_aim_error = 5.f; /**< Наибольшая ошибка прицеливания ИИ по Y (сложность) */
+    float ai_target_y; /**< Куда ИИ ведёт ракетку сейчас */
+    float ai_next_target_y; /**< Новый прогноз, к которому ИИ перейдёт после задержки реакции */
+    float ai_reaction_timer; /**< Сколько осталось до перехода к новому прогнозу */
+    float ai_aim_offset; /**< Ошибка прицеливания текущего удара; отскок от стенки её не меняет */
+    bool ai_prediction_valid; /**< Посчитан ли прогноз для текущей скорости мяча */
+    u32 ai_random_state = 0x2545f491u; /**< Состояние генератора ошибок прицеливания */
+
+    Game_Event events[kMaxGameEvents]; /**< События последнего шага */
+    int event_count; /**< Количество событий последнего шага */
+};
+
+/**
+ * @brief Добавляет событие текущего шага. Лишние события отбрасываются.
+ */
+void PushGameEvent(Game_State* state, Game_Event_Kind kind, int player, float x, float y) {
+    if (state->event_count == kMaxGameEvents) return;
+    Game_Event* event = state->events + state->event_count++;
+    event->kind = kind;
+    event->player = player;
+    event->x = x;
+    event->y = y;
+}
+
+/**
+ * @brief Где мяч пересечёт вертикаль line_x с учётом отскоков от стенок.
+ *
+ * Без стенок траектория — прямая. Отскоки от стенок y = ±limit зеркально складывают
+ * её в полосу [-limit, limit] с периодом 4 * limit, поэтому точка пересечения
+ * считается в замкнутой форме, без пошаговой симуляции.
+ *
+ * @param x X позиция мяча.
+ * @param y Y позиция мяча.
+ * @param dx Скорость мяча по X (не ноль, в сторону line_x).
+ * @param dy Скорость мяча по Y.
+ * @param line_x Вертикаль, на которой центр мяча касается ракетки.
+ * @return Y центра мяча в момент пересечения.
+ *
+ * @tparam Rules Правила матча.
+ */
+template <typename Rules = Standard_Rules>
+float PredictBallY(float x, float y, float dx, float dy, float line_x) {
+    float limit = Rules::kArenaHalfSizeY - Rules::kBallHalfSize;
+    float period = 4 * limit;
+    float unfolded = fmodf(y + dy * (line_x - x) / dx + limit, period);
+    if (unfolded < 0) unfolded += period;
+    return unfolded < 2 * limit ? unfolded - limit : 3 * limit - unfolded;
+}
+
+/**
+ * @brief Пересчитывает цель ИИ. Вызывается, только когда меняется скорость мяча.
+ *
+ * Пока мяч летит к ИИ, цель — точка пересечения с линией ракетки плюс случайная
+ * ошибка прицеливания; пока от него — центр. На новом ударе (отбитый мяч, подача)
+ * ошибка выбирается заново и ИИ переходит к цели через ai_reaction_delay секунд.
+ * Отскок от стенки — тот же удар: траектория пересчитывается, а ошибка и отсчёт
+ * реакции остаются прежними.
+ *
+ * @param state Состояние матча.
+ * @param new_shot Новый удар, а не отскок от стенки.
+ *
+ * @tparam Rules Правила матча.
+ */
+template <typename Rules = Standard_Rules>
+void UpdateAiPrediction(Game_State* state, bool new_shot = true) {
+    float target = 0.f;
+    if (state->ball_dp_x > 0) {
+        if (new_shot) {
+            u32 x = xorshift32(&state->ai_random_state);
+            state->ai_aim_offset = state->ai_aim_error * ((float)(x >> 8) * (2.f / 16777216.f) - 1.f);
+        }
+        target = PredictBallY<Rules>(state->ball_p_x, state->ball_p_y, state->ball_dp_x, state->ball_dp_y,
+                                     Rules::kPaddleX - Rules::kPlayerHalfSizeX - Rules::kBallHalfSize);
+        target += state->ai_aim_offset;
+    }
+    state->ai_next_target_y = target;
+    if (new_shot) state->ai_reaction_timer = state->ai_reaction_delay;
+    state->ai_prediction_valid = true;
+}
+
+/**
+ * @brief Ускорение ракетки игрока: кнопки плюс аналоговое управление (боты),
+ * не больше ускорения зажатой кнопки.
+ *
+ * @param input Ввод.
+ * @param up Кнопка "вверх".
+ * @param down Кнопка "вниз".
+ * @param player 0 — первая ракетка, 1 — вторая.
+ * @param acceleration Ускорение зажатой кнопки.
+ */
+inline float PlayerAcceleration(const Input* input, int up, int down, int player, float acceleration) {
+    float ddp = input->paddle_axis[player] * acceleration;
+    if (is_down(up)) ddp += acceleration;
+    if (is_down(down)) ddp -= acceleration;
+    return ddp > acceleration ? acceleration : (ddp < -acceleration ? -acceleration : ddp);
+}
+
+/**
+ * @brief Шаг симуляции идущего матча (ракетки, мяч, ИИ) по правилам Rules.
+ *
+ * Все размеры и константы физики — константы времени компиляции, поэтому
+ * у каждого варианта правил своё ядро без чтения глобальных переменных.
+ *
+ * @tparam Rules Правила матча.
+ * @param state Состояние матча.
  * @param input Указатель на структуру ввода.
  * @param dt Время, прошедшее с последнего шага симуляции.
  */
-void SimulateGame(Input* input, float dt) {
-    DrawRect(0, 0, arena_half_size_x, arena_half_size_y, 0xffaa33);
-    DrawArenaBorders(arena_half_size_x, arena_half_size_y, 0xff5500);
+template <typename Rules>
+void StepMatch(Game_State* state, Input* input, float dt) {
+    const float paddle_x = Rules::kPaddleX;
+    const float ball_half_size = Rules::kBallHalfSize;
+    const float player_half_size_x = Rules::kPlayerHalfSizeX, player_half_size_y = Rules::kPlayerHalfSizeY;
+    const float arena_half_size_x = Rules::kArenaHalfSizeX, arena_half_size_y = Rules::kArenaHalfSizeY;
+    float& player_1_p = state->player_1_p;
+    float& player_1_dp = state->player_1_dp;
+    float& player_2_p = state->player_2_p;
+    float& player_2_dp = state->player_2_dp;
+    float& ball_p_x = state->ball_p_x;
+    float& ball_p_y = state->ball_p_y;
+    float& ball_dp_x = state->ball_dp_x;
+    float& ball_dp_y = state->ball_dp_y;
 
-    if (current_gamemode == kGameplay) {
-        float player_1_ddp = 0.f;
-        if (!enemy_is_ai) {
-            if (is_down(BUTTON_UP)) player_1_ddp += 2000;
-            if (is_down(BUTTON_DOWN)) player_1_ddp -= 2000;
-        } else {
-            player_1_ddp = (ball_p_y - player_1_p) * 100;
-            if (player_1_ddp > 1300) player_1_ddp = 1300;
-            if (player_1_ddp < -1300) player_1_ddp = -1300;
+    float player_1_ddp = 0.f;
+    if (!state->enemy_is_ai) {
+        player_1_ddp = PlayerAcceleration(input, BUTTON_UP, BUTTON_DOWN, 0, Rules::kPlayerAcceleration);
+    } else {
+        state->ai_reaction_timer -= dt;
+        if (state->ai_reaction_timer <= 0) state->ai_target_y = state->ai_next_target_y;
+        player_1_ddp = (state->ai_target_y - player_1_p) * Rules::kAiGain;
+        if (player_1_ddp > Rules::kAiMaxAcceleration) player_1_ddp = Rules::kAiMaxAcceleration;
+        if (player_1_ddp < -Rules::kAiMaxAcceleration) player_1_ddp = -Rules::kAiMaxAcceleration;
+    }
+
+    float player_2_ddp = PlayerAcceleration(input, BUTTON_W, BUTTON_S, 1, Rules::kPlayerAcceleration);
+
+    SimulatePlayer<Rules>(&player_1_p, &player_1_dp, player_1_ddp, dt);
+    SimulatePlayer<Rules>(&player_2_p, &player_2_dp, player_2_ddp, dt);
+
+    // Симуляция мяча
+    {
+        ball_p_x += ball_dp_x * (Rules::kBallSpeedScale * dt);
+        ball_p_y += ball_dp_y * (Rules::kBallSpeedScale * dt);
+
+        if (AabbVsAabb(ball_p_x, ball_p_y, ball_half_size, ball_half_size, paddle_x, player_1_p, player_half_size_x, player_half_size_y)) {
+            ball_p_x = paddle_x - player_half_size_x - ball_half_size;
+            ball_dp_x *= -1;
+            ball_dp_y = (ball_p_y - player_1_p) * 2 + player_1_dp * .75f;
+            PushGameEvent(state, kEventPaddleHit, 1, ball_p_x, ball_p_y);
+        } else if (AabbVsAabb(ball_p_x, ball_p_y, ball_half_size, ball_half_size, -paddle_x, player_2_p, player_half_size_x, player_half_size_y)) {
+            ball_p_x = -paddle_x + player_half_size_x + ball_half_size;
+            ball_dp_x *= -1;
+            ball_dp_y = (ball_p_y - player_2_p) * 2 + player_2_dp * .75f;
+            PushGameEvent(state, kEventPaddleHit, 2, ball_p_x, ball_p_y);
         }
 
-        float player_2_ddp = 0.f;
-        if (is_down(BUTTON_W)) player_2_ddp += 2000;
-        if (is_down(BUTTON_S)) player_2_ddp -= 2000;
-
-        SimulatePlayer(&player_1_p, &player_1_dp, player_1_ddp, dt);
-        SimulatePlayer(&player_2_p, &player_2_dp, player_2_ddp, dt);
-
-        // Симуляция мяча
-        {
-            ball_p_x += ball_dp_x * dt;
-            ball_p_y += ball_dp_y * dt;
-
-            if (AabbVsAabb(ball_p_x, ball_p_y, ball_half_size, ball_half_size, 80, player_1_p, player_half_size_x, player_half_size_y)) {
-                ball_p_x = 80 - player_half_size_x - ball_half_size;
-                ball_dp_x *= -1;
-                ball_dp_y = (ball_p_y - player_1_p) * 2 + player_1_dp * .75f;
-            } else if (AabbVsAabb(ball_p_x, ball_p_y, ball_half_size, ball_half_size, -80, player_2_p, player_half_size_x, player_half_size_y)) {
-                ball_p_x = -80 + player_half_size_x + ball_half_size;
-                ball_dp_x *= -1;
-                ball_dp_y = (ball_p_y - player_2_p) * 2 + player_2_dp * .75f;
-            }
+        if (ball_p_y + ball_half_size > arena_half_size_y) {
+            ball_p_y = arena_half_size_y - ball_half_size;
+            ball_dp_y *= -1;
+            PushGameEvent(state, kEventWallBounce, 0, ball_p_x, ball_p_y);
+        } else if (ball_p_y - ball_half_size < -arena_half_size_y) {
+            ball_p_y = -arena_half_size_y + ball_half_size;
+            ball_dp_y *= -1;
+            PushGameEvent(state, kEventWallBounce, 0, ball_p_x, ball_p_y);
+        }
 
-            if (ball_p_y + ball_half_size > arena_half_size_y) {
-                ball_p_y = arena_half_size_y - ball_half_size;
-                ball_dp_y *= -1;
-            } else if (ball_p_y - ball_half_size < -arena_half_size_y) {
-                ball_p_y = -arena_half_size_y + ball_half_size;
-                ball_dp_y *= -1;
-            }
+        if (ball_p_x + ball_half_size > arena_half_size_x) {
+            PushGameEvent(state, kEventGoal, 1, ball_p_x, ball_p_y);
+            ball_dp_x *= -1;
+            ball_dp_y = 0;
+            ball_p_x = 0;
+            ball_p_y = 0;
+            state->player_1_score++;
+        } else if (ball_p_x - ball_half_size < -arena_half_size_x) {
+            PushGameEvent(state, kEventGoal, 2, ball_p_x, ball_p_y);
+            ball_dp_x *= -1;
+            ball_dp_y = 0;
+            ball_p_x = 0;
+            ball_p_y = 0;
+            state->player_2_score++;
+        }
+    }
+
+    // Скорость мяча меняется только в событиях шага, поэтому прогноз ИИ пересчитывается только после них.
+    if (state->enemy_is_ai && (state->event_count || !state->ai_prediction_valid)) {
+        bool new_shot = !state->ai_prediction_valid;
+        for (int i = 0; i < state->event_count; i++) new_shot |= state->events[i].kind != kEventWallBounce;
+        UpdateAiPrediction<Rules>(state, new_shot);
+    }
+}
 
-            if (ball_p_x + ball_half_size > arena_half_size_x) {
-                ball_dp_x *= -1;
-                ball_dp_y = 0;
-                ball_p_x = 0;
-                ball_p_y = 0;
-                player_1_score++;
-            } else if (ball_p_x - ball_half_size < -arena_half_size_x) {
-                ball_dp_x *= -1;
-                ball_dp_y = 0;
-                ball_p_x = 0;
-                ball_p_y = 0;
-                player_2_score++;
+/**
+ * @brief Выполняет один шаг симуляции матча без рендеринга.
+ *
+ * Идущий матч симулируется ядром StepMatch, выбранным по варианту правил state->rules.
+ *
+ * @param state Состояние матча.
+ * @param input Указатель на структуру ввода.
+ * @param dt Время, прошедшее с последнего шага симуляции.
+ */
+void StepGame(Game_State* state, Input* input, float dt) {
+    state->event_count = 0;
+
+    if (state->current_gamemode == kGameplay) {
+        switch (state->rules) {
+        case kRulesBigArena: StepMatch<Big_Arena_Rules>(state, input, dt); break;
+        case kRulesFastBall: StepMatch<Fast_Ball_Rules>(state, input, dt); break;
+        default: StepMatch<Standard_Rules>(state, input, dt); break;
+        }
+    } else if (state->current_gamemode == kMenu) {
+        if (pressed(BUTTON_RIGHT)) state->hot_button = (state->hot_button + 1) % 3;
+        if (pressed(BUTTON_LEFT)) state->hot_button = (state->hot_button + 2) % 3;
+
+        if (pressed(BUTTON_ENTER)) {
+            if (state->hot_button == 2) {
+                state->current_gamemode = kChaos;
+            } else {
+                state->current_gamemode = kGameplay;
+                state->enemy_is_ai = state->hot_button ? 0 : 1;
             }
+            state->ai_prediction_valid = false;
+            PushGameEvent(state, kEventModeChange, 0, 0, 0);
         }
+    }
+}
 
-        DrawNumber(player_1_score, -10, 40, 1.f, 0xbbffbb);
-        DrawNumber(player_2_score, 10, 40, 1.f, 0xbbffbb);
+/**
+ * @brief Спрайты оформления. Незагруженные спрайты заменяются прямоугольниками.
+ */
+struct Game_Assets {
+    Sprite ball; /**< Мяч */
+    Sprite paddle; /**< Ракетка (белая, окрашивается через tint) */
+    Sprite logo; /**< Логотип в меню */
+};
 
-        // Рендеринг
-        DrawRect(ball_p_x, ball_p_y, ball_half_size, ball_half_size, 0xffffff);
-        DrawRect(80, player_1_p, player_half_size_x, player_half_size_y, 0xff0000);
-        DrawRect(-80, player_2_p, player_half_size_x, player_half_size_y, 0xff0000);
+/**
+ * @brief Добавляет спрайт, а если он не загружен — прямоугольник цвета color.
+ */
+void PushSpriteOrRect(Draw_List* list, const Sprite* sprite, float x, float y, float half_size_x, float half_size_y,
+                      u32 mode, u32 color) {
+    if (sprite->pixels) {
+        push_sprite(list, sprite, x, y, half_size_x, half_size_y, mode, color);
+    } else {
+        push_rect(list, x, y, half_size_x, half_size_y, color);
+    }
+}
+
+/**
+ * @brief Добавляет в статический слой фон арены и её границы.
+ *
+ * Слой не зависит от состояния матча: рендерер растеризует его один раз и дальше
+ * только восстанавливает из кэша под движущимися объектами.
+ *
+ * @param list Статический слой кадра.
+ */
+void RenderArena(Draw_List* list) {
+    push_rect(list, 0, 0, arena_half_size_x, arena_half_size_y, 0xffaa33);
+    push_arena_borders(list, arena_half_size_x, arena_half_size_y, 0xff5500);
+}
 
+/**
+ * @brief Размеры правил, по которым сейчас идёт игра: меню и режим "хаос" — стандартные.
+ */
+const Game_Rules_Info* ActiveRulesInfo(const Game_State* state) {
+    return kGameRulesInfo + (state->current_gamemode == kGameplay ? state->rules : kRulesStandard);
+}
+
+/**
+ * @brief Масштаб из координат матча в координаты экрана: арена любого варианта правил
+ * рисуется на месте стандартной. Меню и режим "хаос" всегда в стандартных координатах.
+ */
+float GameViewScale(const Game_State* state) {
+    return arena_half_size_y / ActiveRulesInfo(state)->arena_half_size_y;
+}
+
+/**
+ * @brief Составляет список отрисовки матча.
+ *
+ * @param state Состояние матча.
+ * @param assets Спрайты оформления.
+ * @param list Список отрисовки кадра.
+ */
+void RenderGame(const Game_State* state, const Game_Assets* assets, Draw_List* list) {
+    if (state->current_gamemode == kGameplay) {
+        push_number(list, state->player_1_score, -10, 40, 1.f, 0xbbffbb);
+        push_number(list, state->player_2_score, 10, 40, 1.f, 0xbbffbb);
+
+        // Рендеринг
+        float view = GameViewScale(state);
+        float paddle_x = kGameRulesInfo[state->rules].paddle_x * view;
+        PushSpriteOrRect(list, &assets->ball, state->ball_p_x * view, state->ball_p_y * view, ball_half_size * view,
+                         ball_half_size * view, SPRITE_BLEND, 0xffffff);
+        PushSpriteOrRect(list, &assets->paddle, paddle_x, state->player_1_p * view, player_half_size_x * view,
+                         player_half_size_y * view, SPRITE_TINT, 0xff0000);
+        PushSpriteOrRect(list, &assets->paddle, -paddle_x, state->player_2_p * view, player_half_size_x * view,
+                         player_half_size_y * view, SPRITE_TINT, 0xff0000);
     } else {
-        if (pressed(BUTTON_LEFT) || pressed(BUTTON_RIGHT)) {
-            hot_button = !hot_button;
-        }
+        if (assets->logo.pixels) push_sprite(list, &assets->logo, 0, 20, 32, 8, SPRITE_BLEND, 0xffffff);
 
-        if (pressed(BUTTON_ENTER)) {
-            current_gamemode = kGameplay;
-            enemy_is_ai = hot_button ? 0 : 1;
+        push_text(list, "SINGLE PLAYER", -80, -10, 1, state->hot_button == 0 ? 0xff0000 : 0xaaaaaa);
+        push_text(list, "MULTIPLAYER", 20, -10, 1, state->hot_button == 1 ? 0xff0000 : 0xaaaaaa);
+        push_text(list, "CHAOS", -15, -25, 1, state->hot_button == 2 ? 0xff0000 : 0xaaaaaa);
+    }
+}
+
+#include "aabb_batch.cpp"
+#include "chaos.cpp"
+#include "particles.cpp"
+#include "state_history.cpp"
+
+/**
+ * @brief Максимальное количество команд отрисовки за кадр.
+ */
+const int kMaxDrawCommands = 4096;
+
+/**
+ * @brief Максимальное количество команд статического слоя (фон арены и границы).
+ */
+const int kMaxBackgroundCommands = 16;
+
+/**
+ * @brief Всё, что игра хранит в начале постоянной арены.
+ *
+ * Пулы частиц и история для перемотки выделяются из той же арены следом за хранилищем,
+ * пулы режима "хаос" — при первом входе в режим.
+ */
+struct Game_Storage {
+    Game_State state; /**< Состояние матча */
+    Chaos_State chaos; /**< Состояние режима "хаос" */
+    Game_Assets assets; /**< Спрайты оформления */
+    Particle_System particles; /**< Частицы эффектов */
+    State_History history; /**< Состояния матча по тикам для перемотки */
+};
+
+/**
+ * @brief Возвращает хранилище игры, размещённое в начале постоянной арены.
+ *
+ * При первом вызове хранилище создаётся в арене.
+ *
+ * @param memory Память игры.
+ * @return Хранилище игры.
+ */
+Game_Storage* GameStorageFromMemory(Game_Memory* memory) {
+    if (!memory->permanent.used) {
+        Game_Storage* storage = new (push_struct(&memory->permanent, Game_Storage)) Game_Storage();
+        InitParticles(&storage->particles, &memory->permanent, kMaxParticles);
+        if (!InitStateHistory(&storage->history, &memory->permanent, kStateHistoryBytes)) {
+            // Игра идёт и без истории, но перемотка назад выключена: платформе не хватило постоянной арены.
+            fprintf(stderr, "game: no room for the %u MB state history in the permanent arena, rewind is off\n",
+                    (unsigned)(kStateHistoryBytes >> 20));
         }
+        return storage;
+    }
+    return (Game_Storage*)memory->permanent.base;
+}
+
+/**
+ * @brief Возвращает состояние игры, размещённое в начале постоянной арены.
+ *
+ * @param memory Память игры.
+ * @return Состояние матча.
+ */
+Game_State* GameStateFromMemory(Game_Memory* memory) {
+    return &GameStorageFromMemory(memory)->state;
+}
+
+/**
+ * @brief Загружает спрайты оформления (ball.tga, paddle.tga, logo.tga) в постоянную арену.
+ *
+ * Вызывается платформенным слоем один раз при запуске. Недостающие файлы не ошибка:
+ * вместо них рисуются прямоугольники.
+ *
+ * @param memory Память игры.
+ * @param directory Каталог с файлами.
+ * @return Количество загруженных спрайтов.
+ */
+int LoadGameAssets(Game_Memory* memory, const char* directory) {
+    Game_Assets* assets = &GameStorageFromMemory(memory)->assets;
+    struct { const char* name; Sprite* sprite; } files[] = {
+        { "ball.tga", &assets->ball },
+        { "paddle.tga", &assets->paddle },
+        { "logo.tga", &assets->logo },
+    };
+
+    int loaded = 0;
+    for (auto& file : files) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", directory, file.name);
+        if (load_tga_file(&memory->permanent, path, file.sprite)) loaded++;
+    }
+    return loaded;
+}
+
+/**
+ * @brief Выполняет шаг симуляции текущего режима без рендеринга.
+ *
+ * @param memory Память игры.
+ * @param input Указатель на структуру ввода.
+ * @param dt Время, прошедшее с последнего шага симуляции.
+ */
+void UpdateGame(Game_Memory* memory, Input* input, float dt) {
+    PROFILE_ZONE("UpdateGame");
+    Game_Storage* storage = GameStorageFromMemory(memory);
+    Game_State* state = &storage->state;
+    Chaos_State* chaos = &storage->chaos;
 
-        if (hot_button == 0) {
-            DrawText("SINGLE PLAYER", -80, -10, 1, 0xff0000);
-            DrawText("MULTIPLAYER", 20, -10, 1, 0xaaaaaa);
+    if (state->current_gamemode == kChaos) {
+        if (!chaos->ball_capacity && !InitChaos(chaos, &memory->permanent, kMaxChaosBalls, kChaosPaddles)) {
+            state->current_gamemode = kMenu;
         } else {
-            DrawText("SINGLE PLAYER", -80, -10, 1, 0xaaaaaa);
-            DrawText("MULTIPLAYER", 20, -10, 1, 0xff0000);
+            StepChaos(chaos, state, input, dt);
+        }
+    } else if (state->current_gamemode == kGameplay && is_down(BUTTON_BACKSPACE)) {
+        // Пока кнопка зажата, матч стоит, а состояние идёт назад по истории.
+        RewindStateHistory(&storage->history, state, dt * kRewindSpeed);
+    } else {
+        StepGame(state, input, dt);
+        if (state->current_gamemode == kGameplay) {
+            // Новый матч начинает историю заново.
+            if (state->event_count && state->events[state->event_count - 1].kind == kEventModeChange) {
+                ResetStateHistory(&storage->history);
+            }
+            RecordStateHistory(&storage->history, state, dt);
         }
     }
+
+    // Частицы живут в координатах экрана: за арену правил матча в масштабе вида.
+    const Game_Rules_Info* rules = ActiveRulesInfo(state);
+    float view = GameViewScale(state);
+    EmitGameEventParticles(&storage->particles, state);
+    StepParticles(&storage->particles, dt, rules->arena_half_size_x * view, rules->arena_half_size_y * view);
 }
 
+/**
+ * @brief Рисует текущее состояние игры в render_state.
+ *
+ * Списки отрисовки кадра (статический слой с ареной и динамический со всем остальным)
+ * выделяются из временной арены.
+ *
+ * @param memory Память игры.
+ */
+void RenderFrame(Game_Memory* memory) {
+    PROFILE_ZONE("RenderFrame");
+    Game_Storage* storage = GameStorageFromMemory(memory);
+    Draw_List* background = begin_draw_list(&memory->transient, kMaxBackgroundCommands);
+    Draw_List* list = begin_draw_list(&memory->transient, kMaxDrawCommands);
+    if (!background || !list) return;
+    RenderArena(background);
+    if (storage->state.current_gamemode == kChaos) {
+        RenderChaos(&storage->chaos, list, &memory->transient);
+    } else {
+        RenderGame(&storage->state, &storage->assets, list);
+    }
+    RenderParticles(&storage->particles, list, &memory->transient);
+    execute_layered_draw_lists(background, list);
+}
+
+/**
+ * @brief Симулирует состояние игры.
+ *
+ * Временная арена должна быть сброшена платформенным слоем перед вызовом:
+ * список отрисовки и раскладка текста этого кадра выделяются из неё.
+ *
+ * @param memory Память игры.
+ * @param input Указатель на структуру ввода.
+ * @param dt Время, прошедшее с последнего шага симуляции.
+ */
+void SimulateGame(Game_Memory* memory, Input* input, float dt) {
+    PROFILE_ZONE("SimulateGame");
+    UpdateGame(memory, input, dt);
+    RenderFrame(memory);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file headless_platform.cpp
+ * @brief Платформенный слой без окна для серверов, тестов и утилит.
+ *
+ * Собирает те же модули, что и win32_platform.cpp, но кадр рисуется
+ * в обычный буфер в памяти, а время берётся из монотонных часов POSIX.
+ */
+
+#include "utils.cpp"
+#include "memory_arena.cpp"
+#include "profiler.cpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+global_variable bool running = true;
+
+/**
+ * @struct Render_State
+ * @brief Буфер кадра без окна: тот же формат, что и DIB в win32_platform.cpp.
+ */
+struct Render_State {
+    int height, width;
+    void* memory;
+};
+
+global_variable Render_State render_state;
+
+#include "platform_common.cpp"
+#include "renderer.cpp"
+#include "game.cpp"
+
+/**
+ * @brief Выделяет (или перевыделяет) буфер кадра заданного размера и кэш статического слоя.
+ *
+ * @param width Ширина в пикселях.
+ * @param height Высота в пикселях.
+ */
+internal void
+resize_headless_framebuffer(int width, int height) {
+    render_state.width = width;
+    render_state.height = height;
+    free(render_state.memory);
+    free(background_cache.pixels);
+    render_state.memory = calloc((size_t)width * height, sizeof(u32));
+    set_background_cache_memory((u32*)malloc((size_t)width * height * sizeof(u32)));
+}
+
+/**
+ * @brief Выделяет постоянную и временную арены игры одним блоком.
+ *
+ * @param memory Память игры.
+ * @param permanent_size Размер постоянной арены.
+ * @param transient_size Размер временной арены.
+ *
+ * @return false, если память не выделена.
+ */
+internal bool
+init_headless_memory(Game_Memory* memory, size_t permanent_size, size_t transient_size) {
+    u8* block = (u8*)calloc(1, permanent_size + transient_size);
+    if (!block) return false;
+    init_arena(&memory->permanent, block, permanent_size);
+    init_arena(&memory->transient, block + permanent_size, transient_size);
+    return true;
+}
+
+/**
+ * @brief Освобождает память, выделенную init_headless_memory.
+ *
+ * @param memory Память игры.
+ */
+internal void
+free_headless_memory(Game_Memory* memory) {
+    free(memory->permanent.base);
+    *memory = Game_Memory();
+}
+
+/**
+ * @brief Монотонное время в наносекундах.
+ *
+ * Часы CLOCK_MONOTONIC общие для всех процессов машины, поэтому метки
+ * времени можно сравнивать между сервером и клиентами на одном хосте.
+ */
+internal u64
+headless_time_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+/**
+ * @brief Переводит матч сразу в режим игры против ИИ, минуя меню.
+ *
+ * @param state Состояние матча.
+ */
+internal void
+start_headless_match(Game_State* state) {
+    state->current_gamemode = kGameplay;
+    state->enemy_is_ai = true;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file history_bench.cpp
+ * @brief Замер истории состояний для перемотки (state_history.cpp) и сверка восстановленных тиков.
+ *
+ * Матч ИИ против автопилота идёт minutes минут с частотой 240 тиков в секунду, после каждого
+ * тика состояние пишется в историю, а хеш состояния запоминается. Затем:
+ * - случайные тики восстанавливаются из истории (ReadStateHistory) и сверяются с хешами;
+ * - история сматывается назад по одному тику (как при перемотке), каждый восстановленный
+ *   тик сверяется, время шага сравнивается с длительностью тика;
+ * - с восстановленного тика матч продолжается заново и должен пройти через те же состояния,
+ *   а новые записи истории — раскодироваться в них же;
+ * - в игре (UpdateGame) зажатый Backspace перематывает матч на записанное состояние.
+ *
+ * Использование: history_bench [-minutes N] [-rules standard|big|fast] [-scrub секунд]
+ */
+
+#include "headless_platform.cpp"
+
+#include <vector>
+
+/**
+ * @brief Хеш состояния (FNV-1a); число событий шага не учитывается — перемотка его обнуляет.
+ */
+internal u64
+history_state_hash(const Game_State* state) {
+    Game_State copy = *state;
+    copy.event_count = 0;
+    return fnv1a_64(&copy, sizeof(copy));
+}
+
+int main(int argc, char** argv) {
+    int minutes = 60;
+    double scrub_seconds = 0;
+    Game_Rules rules = kRulesStandard;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-minutes") && i + 1 < argc) minutes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-rules") && i + 1 < argc) rules = GameRulesFromName(argv[++i]);
+        else if (!strcmp(argv[i], "-scrub") && i + 1 < argc) scrub_seconds = atof(argv[++i]);
+    }
+    if (minutes < 1) return EXIT_FAILURE;
+
+    const int tick_rate = 240;
+    const float dt = 1.f / tick_rate;
+    const u64 ticks = (u64)minutes * 60 * tick_rate;
+    int mismatches = 0;
+
+    Memory_Arena arena;
+    size_t arena_size = kStateHistoryBytes + (4 << 20);
+    init_arena(&arena, (u8*)malloc(arena_size), arena_size);
+    State_History* history = new State_History();
+    if (!arena.base || !InitStateHistory(history, &arena, kStateHistoryBytes)) return EXIT_FAILURE;
+
+    // Запись: матч и история тик за тиком.
+    std::vector<u64> hashes(ticks);
+    Game_State state = Game_State();
+    start_headless_match(&state);
+    state.rules = rules;
+    Input input = {};
+    u64 record_ns = 0;
+    for (u64 t = 0; t < ticks; t++) {
+        autopilot_input(&input, state.ball_p_y, state.player_2_p);
+        StepGame(&state, &input, dt);
+        u64 begin_ns = headless_time_ns();
+        RecordStateHistory(history, &state, dt);
+        record_ns += headless_time_ns() - begin_ns;
+        hashes[t] = history_state_hash(&state);
+    }
+    u64 kept = StateHistoryTicks(history);
+    u64 first_tick = StateHistoryFirstTick(history);
+    u64 used = history->head - history->tail;
+    printf("%d min at %d Hz (%s rules): %llu ticks, Game_State %zu bytes\n", minutes, tick_rate, kGameRulesInfo[rules].name,
+           (unsigned long long)ticks, sizeof(Game_State));
+    printf("history: %llu ticks (%.1f min) in %.2f MB, %.2f bytes per tick, %.1f ns per record\n",
+           (unsigned long long)kept, kept / (60.0 * tick_rate), used / 1048576.0, (double)used / kept,
+           (double)record_ns / ticks);
+
+    // Произвольный доступ.
+    u32 random_state = 0x2545f491u;
+    const int reads = 2000;
+    u64 read_ns = 0, worst_read_ns = 0;
+    for (int r = 0; r < reads; r++) {
+        u64 tick = first_tick + xorshift32(&random_state) % kept;
+        Game_State restored;
+        float restored_dt;
+        u64 begin_ns = headless_time_ns();
+        bool found = ReadStateHistory(history, tick, &restored, &restored_dt);
+        u64 ns = headless_time_ns() - begin_ns;
+        read_ns += ns;
+        if (ns > worst_read_ns) worst_read_ns = ns;
+        if (!found || history_state_hash(&restored) != hashes[tick] || restored_dt != dt) {
+            if (mismatches++ < 5) printf("random read of tick %llu does not match\n", (unsigned long long)tick);
+        }
+    }
+    printf("random tick: mean %.2f us, worst %.2f us\n", (double)read_ns / reads * 1e-3, worst_read_ns * 1e-3);
+
+    // Перемотка назад по одному тику.
+    u64 scrub = scrub_seconds > 0 ? (u64)(scrub_seconds * tick_rate) : kept - 1;
+    if (scrub > kept - 1) scrub = kept - 1;
+    u64 scrub_begin_ns = headless_time_ns();
+    u64 worst_pop_ns = 0;
+    u64 tick = first_tick + kept - 1;
+    for (u64 s = 0; s < scrub; s++) {
+        float popped_dt;
+        u64 begin_ns = headless_time_ns();
+        bool popped = PopStateHistory(history, &state, &popped_dt);
+        u64 ns = headless_time_ns() - begin_ns;
+        if (ns > worst_pop_ns) worst_pop_ns = ns;
+        tick--;
+        if (!popped || history_state_hash(&state) != hashes[tick]) {
+            if (mismatches++ < 5) printf("rewind to tick %llu does not match\n", (unsigned long long)tick);
+            break;
+        }
+    }
+    u64 scrub_ns = headless_time_ns() - scrub_begin_ns;
+    double pop_ns = scrub ? (double)scrub_ns / scrub : 0;
+    printf("rewind: %llu ticks, mean %.1f ns per tick (%.0fx real time), worst %.2f us\n", (unsigned long long)scrub,
+           pop_ns, pop_ns > 0 ? 1e9 / tick_rate / pop_ns : 0.0, worst_pop_ns * 1e-3);
+
+    // Матч продолжается с восстановленного тика по тем же состояниям, история дописывается.
+    u64 resume_from = tick;
+    u64 resume = ticks - 1 - resume_from < 2000 ? ticks - 1 - resume_from : 2000;
+    for (u64 r = 1; r <= resume; r++) {
+        autopilot_input(&input, state.ball_p_y, state.player_2_p);
+        StepGame(&state, &input, dt);
+        RecordStateHistory(history, &state, dt);
+        Game_State restored;
+        float restored_dt;
+        if (history_state_hash(&state) != hashes[resume_from + r] ||
+            !ReadStateHistory(history, resume_from + r, &restored, &restored_dt) || history_state_hash(&restored) != hashes[resume_from + r]) {
+            if (mismatches++ < 5) printf("resumed tick %llu does not match\n", (unsigned long long)(resume_from + r));
+            break;
+        }
+    }
+    printf("resumed %llu ticks after rewind\n", (unsigned long long)resume);
+
+    // Перемотка в игре: Backspace зажат 60 кадров.
+    Game_Memory memory;
+    if (!init_headless_memory(&memory, 64 << 20, 1 << 20)) return EXIT_FAILURE;
+    Game_Storage* storage = GameStorageFromMemory(&memory);
+    Game_State* game = &storage->state;
+    start_headless_match(game);
+    game->rules = rules;
+    Input game_input = {};
+    std::vector<u64> game_hashes;
+    for (int t = 0; t < 600; t++) {
+        autopilot_input(&game_input, game->ball_p_y, game->player_2_p);
+        UpdateGame(&memory, &game_input, dt);
+        game_hashes.push_back(history_state_hash(game));
+    }
+    game_input = Input();
+    game_input.buttons[BUTTON_BACKSPACE].is_down = true;
+    for (int f = 0; f < 60; f++) UpdateGame(&memory, &game_input, dt);
+    u64 game_kept = StateHistoryTicks(&storage->history);
+    bool game_ok = game_kept && history_state_hash(game) == game_hashes[game_kept - 1] && game->event_count == 0;
+    printf("in game: 60 frames of Backspace rewound %llu ticks (speed %.0fx)%s\n", (unsigned long long)(600 - game_kept),
+           kRewindSpeed, game_ok ? "" : ", state does not match");
+    if (!game_ok) mismatches++;
+
+    free_headless_memory(&memory);
+    free(arena.base);
+    delete history;
+    printf("%d mismatches\n", mismatches);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file journal_bench.cpp
+ * @brief Замер журнала событий на потоке игры и при пакетной симуляции, сверка записанного файла.
+ *
+ * Сначала замеряется сама запись в кольцо: состояние с kMaxGameEvents событиями кладётся
+ * в журнал пачками по половине кольца (журнал пишется в /dev/null), и время пачки делится
+ * на число событий. Затем threads потоков симулируют каждый свои matches матчей ИИ против
+ * автопилота по ticks тиков дважды — без журнала и с журналом — и разница процессорного
+ * времени потоков игры делится на число событий. Наконец файл журнала читается потоково
+ * и сверяется: записей столько, сколько записал фоновый поток, и вместе с отброшенными
+ * их столько, сколько было событий.
+ *
+ * Использование:
+ *   journal_bench [-threads N] [-matches N] [-ticks N] [-rules standard|big|fast] [-ring N] [-fsync_ms N] [-out файл]
+ */
+
+#include "headless_platform.cpp"
+#include "event_journal.cpp"
+
+#include <vector>
+
+/**
+ * @struct Journal_Batch
+ * @brief Матчи одного потока пакетной симуляции.
+ */
+struct Journal_Batch {
+    u32 first_match; /**< Номер первого матча потока. */
+    int match_count; /**< Матчей в потоке. */
+    int ticks; /**< Тиков на матч. */
+    Game_Rules rules; /**< Правила матчей. */
+    Journal_Ring* ring; /**< Кольцо журнала потока или 0 (прогон без журнала). */
+    u64 events; /**< Событий за прогон. */
+    u64 ns; /**< Время прогона. */
+};
+
+/**
+ * @brief Симулирует матчи потока; события каждого шага кладутся в кольцо журнала.
+ */
+internal void
+simulate_journal_batch(Journal_Batch* batch) {
+    const float dt = 1.f / 240.f;
+    Game_State* states = (Game_State*)malloc((size_t)batch->match_count * sizeof(Game_State));
+    Input* inputs = (Input*)malloc((size_t)batch->match_count * sizeof(Input));
+    if (!states || !inputs) return;
+    for (int m = 0; m < batch->match_count; m++) {
+        states[m] = Game_State();
+        start_headless_match(states + m);
+        states[m].rules = batch->rules;
+        states[m].ball_dp_y = (float)((int)((batch->first_match + m) % 7) - 3) * 10.f;
+        // ИИ разной точности: часть матчей доходит до голов, а не тянет один розыгрыш весь прогон.
+        states[m].ai_aim_error = 5.f + (float)((batch->first_match + m) % 4) * 6.f;
+        inputs[m] = Input();
+    }
+
+    // Время потока, а не настенное: фоновый поток журнала на тех же ядрах в него не попадает.
+    timespec begin, end;
+    u64 events = 0;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &begin);
+    for (int tick = 0; tick < batch->ticks; tick++) {
+        for (int m = 0; m < batch->match_count; m++) {
+            Game_State* state = states + m;
+            autopilot_input(inputs + m, state->ball_p_y, state->player_2_p);
+            StepGame(state, inputs + m, dt);
+            events += (u64)state->event_count;
+            if (batch->ring) journal_game_events(batch->ring, batch->first_match + (u32)m, (u32)tick, state);
+        }
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    batch->ns = (u64)(end.tv_sec - begin.tv_sec) * 1000000000ull + (u64)end.tv_nsec - (u64)begin.tv_nsec;
+    batch->events = events;
+    free(states);
+    free(inputs);
+}
+
+/**
+ * @brief Прогоняет пакетную симуляцию на всех потоках; journal == 0 — без журнала.
+ *
+ * @return Процессорное время самого долгого потока.
+ */
+internal u64
+run_journal_batches(Journal_Batch* batches, int thread_count, Event_Journal* journal, u32 ring_capacity) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        batches[t].ring = journal ? add_journal_ring(journal, ring_capacity) : 0;
+        threads.emplace_back(simulate_journal_batch, batches + t);
+    }
+    u64 slowest_ns = 0;
+    for (int t = 0; t < thread_count; t++) {
+        threads[t].join();
+        if (batches[t].ns > slowest_ns) slowest_ns = batches[t].ns;
+    }
+    return slowest_ns;
+}
+
+int main(int argc, char** argv) {
+    int thread_count = (int)std::thread::hardware_concurrency();
+    int match_count = 1024;
+    int ticks = 4000;
+    Game_Rules rules = kRulesFastBall;
+    u32 ring_capacity = 1 << 16;
+    int fsync_ms = 100;
+    const char* out_path = "/tmp/pong_journal.bin";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-threads") && i + 1 < argc) thread_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-matches") && i + 1 < argc) match_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-ticks") && i + 1 < argc) ticks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-rules") && i + 1 < argc) rules = GameRulesFromName(argv[++i]);
+        else if (!strcmp(argv[i], "-ring") && i + 1 < argc) ring_capacity = (u32)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-fsync_ms") && i + 1 < argc) fsync_ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-out") && i + 1 < argc) out_path = argv[++i];
+    }
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > max_journal_rings) thread_count = max_journal_rings;
+    if (match_count < 1 || ticks < 1 || ring_capacity < 64) return EXIT_FAILURE;
+
+    // Запись в кольцо: пачки по половине кольца, между пачками фоновый поток успевает всё забрать.
+    {
+        Event_Journal* journal = new Event_Journal();
+        if (!open_event_journal(journal, "/dev/null", fsync_ms)) return EXIT_FAILURE;
+        Journal_Ring* ring = add_journal_ring(journal, ring_capacity);
+        Game_State state = Game_State();
+        for (int e = 0; e < kMaxGameEvents; e++) PushGameEvent(&state, (Game_Event_Kind)(e % 3), 1 + e % 2, (float)e, -(float)e);
+        u64 calls_per_burst = (ring->mask + 1) / 2 / kMaxGameEvents;
+        u64 events = 0, burst_ns = 0;
+        while (events < 8000000) {
+            u64 begin_ns = headless_time_ns();
+            for (u64 c = 0; c < calls_per_burst; c++) journal_game_events(ring, 0, (u32)(events / kMaxGameEvents + c), &state);
+            burst_ns += headless_time_ns() - begin_ns;
+            events += calls_per_burst * kMaxGameEvents;
+            while (ring->tail.load(std::memory_order_acquire) != ring->head.load(std::memory_order_relaxed)) {
+                timespec pause = { 0, 200000 };
+                nanosleep(&pause, 0);
+            }
+        }
+        close_event_journal(journal);
+        printf("ring write: %.1f ns per event (%llu events in bursts of %llu, %llu dropped)\n",
+               (double)burst_ns / (double)events, (unsigned long long)events,
+               (unsigned long long)(calls_per_burst * kMaxGameEvents), (unsigned long long)journal->dropped_events);
+        delete journal;
+    }
+
+    // Пакетная симуляция без журнала и с журналом.
+    std::vector<Journal_Batch> batches((size_t)thread_count);
+    for (int t = 0; t < thread_count; t++) {
+        batches[t] = Journal_Batch();
+        batches[t].first_match = (u32)(t * match_count);
+        batches[t].match_count = match_count;
+        batches[t].ticks = ticks;
+        batches[t].rules = rules;
+    }
+    u64 plain_ns = run_journal_batches(batches.data(), thread_count, 0, ring_capacity);
+    u64 plain_events = 0;
+    for (const Journal_Batch& batch : batches) plain_events += batch.events;
+
+    Event_Journal* journal = new Event_Journal();
+    if (!open_event_journal(journal, out_path, fsync_ms)) return EXIT_FAILURE;
+    u64 journal_ns = run_journal_batches(batches.data(), thread_count, journal, ring_capacity);
+    u64 events = 0;
+    for (const Journal_Batch& batch : batches) events += batch.events;
+    bool written = close_event_journal(journal);
+
+    double ticks_total = (double)thread_count * match_count * ticks;
+    printf("%d threads x %d matches x %d ticks (%s rules): %llu events\n", thread_count, match_count, ticks,
+           kGameRulesInfo[rules].name, (unsigned long long)events);
+    printf("without journal: %.1f ms CPU per thread, %.1f M ticks/s\n", plain_ns * 1e-6, ticks_total / (plain_ns * 1e-9) * 1e-6);
+    printf("with journal:    %.1f ms CPU per thread, %.1f M ticks/s, %.2f M events/s, %+.1f ns per event on the game threads\n",
+           journal_ns * 1e-6, ticks_total / (journal_ns * 1e-9) * 1e-6, events / (journal_ns * 1e-9) * 1e-6,
+           events ? ((double)journal_ns - (double)plain_ns) / ((double)events / thread_count) : 0.0);
+    printf("journal: %llu records, %llu bytes (%.1f per record), %llu dropped, %llu fsyncs\n",
+           (unsigned long long)journal->records_written, (unsigned long long)journal->bytes_written,
+           journal->records_written ? (double)journal->bytes_written / journal->records_written : 0.0,
+           (unsigned long long)journal->dropped_events, (unsigned long long)journal->fsync_count);
+
+    // Потоковое чтение и сверка.
+    Journal_Reader reader;
+    if (!open_journal_reader(&reader, out_path)) return EXIT_FAILURE;
+    Journal_Record record;
+    u64 kinds[4] = {};
+    u64 out_of_range = 0;
+    u64 read_begin_ns = headless_time_ns();
+    while (next_journal_record(&reader, &record)) {
+        if (record.kind < 4) kinds[record.kind]++;
+        if (record.match >= (u32)(thread_count * match_count) || record.tick >= (u32)ticks || record.kind > kEventModeChange) out_of_range++;
+    }
+    u64 read_ns = headless_time_ns() - read_begin_ns;
+    close_journal_reader(&reader);
+    printf("read back: %llu records in %.1f ms (%.0f MB/s): %llu paddle hits, %llu wall bounces, %llu goals, %llu mode changes\n",
+           (unsigned long long)reader.records, read_ns * 1e-6, reader.bytes / (read_ns * 1e-9) / 1e6,
+           (unsigned long long)kinds[kEventPaddleHit], (unsigned long long)kinds[kEventWallBounce],
+           (unsigned long long)kinds[kEventGoal], (unsigned long long)kinds[kEventModeChange]);
+
+    bool ok = written && !reader.truncated && !reader.corrupt && !out_of_range && events == plain_events &&
+              reader.records == journal->records_written && journal->records_written + journal->dropped_events == events;
+    if (!ok) {
+        printf("journal check failed: %llu records read, %llu written, %llu dropped, %llu events, %llu out of range%s%s\n",
+               (unsigned long long)reader.records, (unsigned long long)journal->records_written,
+               (unsigned long long)journal->dropped_events, (unsigned long long)events, (unsigned long long)out_of_range,
+               reader.truncated ? ", truncated" : "", reader.corrupt ? ", corrupt" : "");
+    }
+    delete journal;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
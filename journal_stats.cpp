@@ -0,0 +1,150 @@
+/**
+ * @file journal_stats.cpp
+ * @brief Статистика розыгрышей по журналу событий (event_journal.cpp) без загрузки файла в память.
+ *
+ * Журнал читается блоками; в памяти держится только состояние текущего розыгрыша
+ * каждого матча. Розыгрыш — всё между голами: удары ракетками, отскоки от стенок
+ * и длительность в тиках. Номер розыгрыша берётся из счёта в записи (сумма очков
+ * до гола), поэтому записи, пришедшие позже гола своего розыгрыша (матч переходил
+ * между потоками), и пропуски (события, отброшенные при полном кольце) видны и считаются отдельно.
+ *
+ * Использование: journal_stats файл_журнала
+ */
+
+#include "headless_platform.cpp"
+#include "event_journal.cpp"
+
+/**
+ * @brief Корзины гистограммы ударов за розыгрыш: 0, 1, 2-3, 4-7, ..., 64 и больше.
+ */
+global_variable constexpr int rally_hit_buckets = 8;
+
+/**
+ * @struct Rally_Tracker
+ * @brief Текущий розыгрыш одного матча.
+ */
+struct Rally_Tracker {
+    u32 rally; /**< Номер розыгрыша (сумма очков до его гола). */
+    u32 hits; /**< Ударов ракетками. */
+    u32 bounces; /**< Отскоков от стенок. */
+    u32 start_tick; /**< Тик начала. */
+    bool seen; /**< У матча уже были записи. */
+};
+
+/**
+ * @struct Rally_Stats
+ * @brief Итоги по всем завершённым розыгрышам.
+ */
+struct Rally_Stats {
+    u64 rallies; /**< Розыгрышей, завершённых голом. */
+    u64 hits, bounces, ticks; /**< Суммы по розыгрышам. */
+    u32 max_hits, max_ticks; /**< Самый длинный розыгрыш по ударам и по тикам. */
+    u64 hit_histogram[rally_hit_buckets]; /**< Розыгрыши по числу ударов. */
+    u64 goals[3]; /**< Голы по игроку события. */
+    u64 mode_changes; /**< Смен режима. */
+    u64 late; /**< Записи уже завершённого розыгрыша. */
+    u64 gaps; /**< Розыгрыши, начатые без гола предыдущего (записи отброшены). */
+};
+
+/**
+ * @brief Учитывает запись журнала в розыгрыше её матча.
+ */
+internal void
+track_rally(Rally_Tracker* tracker, Rally_Stats* stats, const Journal_Record* record) {
+    if (record->kind == kEventModeChange) {
+        stats->mode_changes++;
+        return;
+    }
+    u32 score_sum = record->player_1_score + record->player_2_score;
+    u32 rally = record->kind == kEventGoal && score_sum ? score_sum - 1 : score_sum;
+    if (!tracker->seen) {
+        tracker->seen = true;
+        tracker->rally = rally;
+    }
+    if (rally < tracker->rally) {
+        stats->late++;
+        return;
+    }
+    if (rally > tracker->rally) {
+        stats->gaps++;
+        tracker->rally = rally;
+        tracker->hits = tracker->bounces = 0;
+        tracker->start_tick = record->tick;
+    }
+
+    if (record->kind == kEventPaddleHit) {
+        tracker->hits++;
+    } else if (record->kind == kEventWallBounce) {
+        tracker->bounces++;
+    } else if (record->kind == kEventGoal) {
+        u32 ticks = record->tick - tracker->start_tick + 1;
+        stats->rallies++;
+        stats->hits += tracker->hits;
+        stats->bounces += tracker->bounces;
+        stats->ticks += ticks;
+        if (tracker->hits > stats->max_hits) stats->max_hits = tracker->hits;
+        if (ticks > stats->max_ticks) stats->max_ticks = ticks;
+        int bucket = 0;
+        while (bucket < rally_hit_buckets - 1 && (1u << bucket) <= tracker->hits) bucket++;
+        stats->hit_histogram[bucket]++;
+        if (record->player < 3) stats->goals[record->player]++;
+
+        tracker->rally = rally + 1;
+        tracker->hits = tracker->bounces = 0;
+        tracker->start_tick = record->tick + 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: journal_stats journal_file\n");
+        return EXIT_FAILURE;
+    }
+    Journal_Reader reader;
+    if (!open_journal_reader(&reader, argv[1])) return EXIT_FAILURE;
+
+    // Матчи нумеруются подряд, поэтому трекеры лежат массивом, растущим по наибольшему номеру.
+    Rally_Tracker* trackers = 0;
+    u32 tracker_count = 0;
+    u32 match_count = 0;
+    Rally_Stats stats = {};
+    Journal_Record record;
+    u64 begin_ns = headless_time_ns();
+    while (next_journal_record(&reader, &record)) {
+        if (record.match >= tracker_count) {
+            u32 count = tracker_count ? tracker_count : 1024;
+            while (count <= record.match) count *= 2;
+            Rally_Tracker* grown = (Rally_Tracker*)realloc(trackers, (size_t)count * sizeof(Rally_Tracker));
+            if (!grown) return EXIT_FAILURE;
+            memset(grown + tracker_count, 0, (size_t)(count - tracker_count) * sizeof(Rally_Tracker));
+            trackers = grown;
+            tracker_count = count;
+        }
+        if (!trackers[record.match].seen) match_count++;
+        track_rally(trackers + record.match, &stats, &record);
+    }
+    u64 ns = headless_time_ns() - begin_ns;
+    close_journal_reader(&reader);
+    free(trackers);
+
+    printf("%llu records from %u matches, %.1f MB in %.1f ms (%.0f MB/s)%s%s\n",
+           (unsigned long long)reader.records, match_count, reader.bytes / 1e6, ns * 1e-6, reader.bytes / (ns * 1e-9) / 1e6,
+           reader.truncated ? ", last record truncated" : "", reader.corrupt ? ", corrupt record" : "");
+    printf("%llu rallies: %.2f hits and %.2f wall bounces per rally, %.1f ticks per rally\n",
+           (unsigned long long)stats.rallies, stats.rallies ? (double)stats.hits / stats.rallies : 0.0,
+           stats.rallies ? (double)stats.bounces / stats.rallies : 0.0,
+           stats.rallies ? (double)stats.ticks / stats.rallies : 0.0);
+    printf("longest rally: %u hits, %u ticks\n", stats.max_hits, stats.max_ticks);
+    printf("hits per rally:");
+    for (int b = 0; b < rally_hit_buckets; b++) {
+        if (b == 0) printf(" 0: %llu", (unsigned long long)stats.hit_histogram[b]);
+        else if (b == rally_hit_buckets - 1) printf(", %u+: %llu", 1u << (b - 1), (unsigned long long)stats.hit_histogram[b]);
+        else if (b == 1) printf(", 1: %llu", (unsigned long long)stats.hit_histogram[b]);
+        else printf(", %u-%u: %llu", 1u << (b - 1), (1u << b) - 1, (unsigned long long)stats.hit_histogram[b]);
+    }
+    printf("\n");
+    printf("goals: %llu by player 1, %llu by player 2; %llu mode changes; %llu late records, %llu gaps\n",
+           (unsigned long long)stats.goals[1], (unsigned long long)stats.goals[2], (unsigned long long)stats.mode_changes,
+           (unsigned long long)stats.late, (unsigned long long)stats.gaps);
+    return reader.corrupt ? EXIT_FAILURE : EXIT_SUCCESS;
+}
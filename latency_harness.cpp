@@ -0,0 +1,376 @@
+/**
+ * @file latency_harness.cpp
+ * @brief Замер задержки от нажатия BUTTON_UP до изменения пикселей ракетки в показанном кадре.
+ *
+ * Харнесс гоняет игровой цикл без окна (UpdateGame и RenderFrame, как в платформенном слое)
+ * и подаёт в него синтетические нажатия с метками времени: нажатие "приходит" в случайный
+ * момент относительно кадра и попадает в Input при ближайшем опросе ввода, как сообщение
+ * из очереди окна. Задержка — от метки нажатия до момента, когда в показанном буфере
+ * изменился столбец пикселей под ракеткой первого игрока (относительно кадра до нажатия).
+ * Перед каждым нажатием ракетка возвращается в центр, мяч стоит в центре и не задевает столбец.
+ *
+ * Замеряются все сочетания:
+ * - режим цикла: variable — шаг на время прошлого кадра (win32_platform.cpp),
+ *   fixed — фиксированные шаги по 1/120 с с накоплением времени, кадр рисуется раз за проход;
+ * - ограничитель кадров: none — цикл без пауз, sleep — пауза до следующей границы 1/60 с
+ *   после показа (terminal_pong.cpp), spin — активное ожидание той же границы (без
+ *   запаздывания пробуждения из сна);
+ * - путь показа: direct — буфер кадра показывается на месте, copy — копия в отдельный
+ *   буфер экрана (как StretchDIBits), shm — публикация в кольцо разделяемой памяти и
+ *   зритель в отдельном потоке, разбуженный futex (shared_framebuffer.cpp).
+ *
+ * Использование:
+ *   latency_harness [-trials N] [-size ширина высота] [-mode variable|fixed] [-limiter none|sleep|spin] [-present direct|copy|shm]
+ *
+ * Код возврата ненулевой, если хотя бы одно нажатие не дошло до кадра за секунду.
+ */
+
+#include "headless_platform.cpp"
+#include "shared_framebuffer.cpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * @brief Режимы игрового цикла.
+ */
+enum Loop_Mode { LOOP_VARIABLE, LOOP_FIXED, LOOP_MODE_COUNT };
+
+/**
+ * @brief Ограничители кадров.
+ */
+enum Frame_Limiter { LIMITER_NONE, LIMITER_SLEEP, LIMITER_SPIN, LIMITER_COUNT };
+
+/**
+ * @brief Пути показа кадра.
+ */
+enum Present_Path { PRESENT_DIRECT, PRESENT_COPY, PRESENT_SHM, PRESENT_COUNT };
+
+global_variable const char* loop_mode_names[LOOP_MODE_COUNT] = { "variable", "fixed" };
+global_variable const char* frame_limiter_names[LIMITER_COUNT] = { "none", "sleep", "spin" };
+global_variable const char* present_path_names[PRESENT_COUNT] = { "direct", "copy", "shm" };
+
+/**
+ * @brief Период кадра ограничителя.
+ */
+global_variable constexpr u64 latency_frame_ns = 1000000000ull / 60;
+
+/**
+ * @brief Шаг симуляции режима fixed.
+ */
+global_variable constexpr float latency_fixed_dt = 1.f / 120.f;
+
+/**
+ * @brief Сколько ждать изменения кадра после нажатия, прежде чем считать нажатие потерянным.
+ */
+global_variable constexpr u64 latency_timeout_ns = 1000000000ull;
+
+/**
+ * @brief Сколько кадров ракетка стоит в центре перед нажатием (кадр до нажатия — образец столбца).
+ */
+global_variable constexpr int latency_settle_frames = 3;
+
+/**
+ * @struct Column_Watch
+ * @brief Образец столбца ракетки и результат наблюдения; общий для цикла и зрителя кольца.
+ */
+struct Column_Watch {
+    int x; /**< Столбец пикселей под ракеткой. */
+    int height; /**< Высота кадра. */
+    u32* baseline; /**< Столбец кадра до нажатия. */
+    std::atomic<bool> armed; /**< Нажатие подано, ждём изменения. */
+    std::atomic<u64> detected_ns; /**< Когда изменение замечено (0 — ещё нет). */
+    std::atomic<bool> stopping; /**< Зрителю пора выходить. */
+};
+
+/**
+ * @brief Отличается ли столбец кадра от образца.
+ */
+internal bool
+column_changed(const Column_Watch* watch, const u32* pixels, int width) {
+    for (int y = 0; y < watch->height; y++) {
+        if (pixels[(size_t)y * width + watch->x] != watch->baseline[y]) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Зритель кольца: спит на futex, смотрит столбец каждого нового кадра.
+ */
+internal void
+ring_watcher(const char* name, Column_Watch* watch) {
+    Shared_Frame_Ring ring;
+    if (!open_shared_frame_ring(&ring, name)) return;
+    while (!watch->stopping.load(std::memory_order_acquire)) {
+        Shared_Frame frame;
+        if (!wait_shared_frame(&ring, 10000000ull) || !acquire_shared_frame(&ring, &frame)) continue;
+        if (!watch->armed.load(std::memory_order_acquire)) continue;
+        bool changed = column_changed(watch, frame.pixels, frame.width);
+        u64 now_ns = headless_time_ns();
+        if (changed && shared_frame_still_valid(&ring, &frame)) {
+            watch->armed.store(false, std::memory_order_relaxed);
+            watch->detected_ns.store(now_ns, std::memory_order_release);
+        }
+    }
+    close_shared_frame_ring(&ring);
+}
+
+/**
+ * @brief Спит до момента deadline_ns по CLOCK_MONOTONIC.
+ */
+internal void
+sleep_until_ns(u64 deadline_ns) {
+    timespec wake = { (time_t)(deadline_ns / 1000000000ull), (long)(deadline_ns % 1000000000ull) };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, 0);
+}
+
+/**
+ * @brief Процентиль отсортированного массива.
+ */
+internal double
+latency_percentile(const u64* sorted, int count, double fraction) {
+    if (!count) return 0;
+    int index = (int)(fraction * (count - 1) + .5);
+    return (double)sorted[index];
+}
+
+/**
+ * @struct Latency_Result
+ * @brief Итог сочетания режима, ограничителя и пути показа.
+ */
+struct Latency_Result {
+    int detected, missed; /**< Нажатия, дошедшие и не дошедшие до кадра. */
+    double p50_ns, p99_ns, max_ns; /**< Распределение задержки. */
+    double frame_ns; /**< Средняя длительность кадра. */
+};
+
+/**
+ * @brief Гоняет цикл одного сочетания и меряет задержку trials нажатий.
+ */
+internal Latency_Result
+run_latency_trials(Loop_Mode mode, Frame_Limiter limiter, Present_Path present, int trials, int width, int height,
+                   Game_Memory* memory, u32* screen, u64* latencies, u32* random_state) {
+    Latency_Result result = {};
+    // Хранилище игры создаётся заново: постоянная арена пуста.
+    reset_arena(&memory->permanent);
+    Game_State* state = GameStateFromMemory(memory);
+    state->current_gamemode = kGameplay;
+    state->enemy_is_ai = false;
+
+    // Столбец под ракеткой первого игрока: то же преобразование, что в draw_rect.
+    render_state.width = width;
+    render_state.height = height;
+    Render_Viewport screen_view = screen_viewport();
+    Column_Watch watch;
+    watch.x = (int)(kGameRulesInfo[kRulesStandard].paddle_x * screen_view.scale + screen_view.center_x);
+    watch.height = height;
+    watch.baseline = (u32*)malloc((size_t)height * sizeof(u32));
+    watch.armed = false;
+    watch.detected_ns = 0;
+    watch.stopping = false;
+
+    Shared_Frame_Ring ring = {};
+    char ring_name[64];
+    std::thread watcher;
+    u32* frame_memory = (u32*)calloc((size_t)width * height, sizeof(u32));
+    if (present == PRESENT_SHM) {
+        snprintf(ring_name, sizeof(ring_name), "/pong_latency_%d", (int)getpid());
+        if (!create_shared_frame_ring(&ring, ring_name, 3, width, height)) {
+            free(frame_memory);
+            free(watch.baseline);
+            result.missed = trials;
+            return result;
+        }
+        watcher = std::thread(ring_watcher, ring_name, &watch);
+    }
+    render_state.memory = frame_memory;
+    background_cache.valid = false;
+
+    Input input = {};
+    int settle = latency_settle_frames;
+    u64 event_ns = 0; // Нажатие ждёт опроса ввода.
+    u64 pressed_ns = 0; // Нажатие доставлено, ждём изменения кадра.
+    float accumulator = 0;
+    u64 frame_begin_ns = headless_time_ns();
+    u64 next_frame_ns = frame_begin_ns + latency_frame_ns;
+    u64 total_frame_ns = 0;
+    int frames = 0;
+    float dt = 1.f / 60.f;
+
+    while (result.detected + result.missed < trials) {
+        u64 poll_ns = headless_time_ns();
+
+        // Опрос ввода: нажатие с меткой времени в прошлом попадает в Input.
+        for (int i = 0; i < BUTTON_COUNT; i++) input.buttons[i].changed = false;
+        if (event_ns && event_ns <= poll_ns) {
+            input.buttons[BUTTON_UP].is_down = true;
+            input.buttons[BUTTON_UP].changed = true;
+            pressed_ns = event_ns;
+            event_ns = 0;
+        }
+
+        // Симуляция и отрисовка.
+        if (present == PRESENT_SHM) begin_shared_frame(&ring, width, height);
+        reset_arena(&memory->transient);
+        if (mode == LOOP_VARIABLE) {
+            UpdateGame(memory, &input, dt);
+        } else {
+            accumulator += dt;
+            while (accumulator >= latency_fixed_dt) {
+                UpdateGame(memory, &input, latency_fixed_dt);
+                for (int i = 0; i < BUTTON_COUNT; i++) input.buttons[i].changed = false;
+                accumulator -= latency_fixed_dt;
+            }
+        }
+        RenderFrame(memory);
+
+        // Показ.
+        const u32* presented = (const u32*)render_state.memory;
+        if (present == PRESENT_COPY) {
+            memcpy(screen, render_state.memory, (size_t)width * height * sizeof(u32));
+            presented = screen;
+        } else if (present == PRESENT_SHM) {
+            publish_shared_frame(&ring, false);
+        }
+        u64 presented_ns = headless_time_ns();
+
+        if (pressed_ns && present != PRESENT_SHM && column_changed(&watch, presented, width)) {
+            watch.armed.store(false, std::memory_order_relaxed);
+            watch.detected_ns.store(presented_ns, std::memory_order_relaxed);
+        }
+        u64 detected_ns = watch.detected_ns.load(std::memory_order_acquire);
+        if (pressed_ns && (detected_ns || presented_ns - pressed_ns > latency_timeout_ns)) {
+            if (detected_ns) latencies[result.detected++] = detected_ns - pressed_ns;
+            else result.missed++;
+            watch.armed.store(false, std::memory_order_relaxed);
+            watch.detected_ns.store(0, std::memory_order_relaxed);
+            pressed_ns = 0;
+            settle = latency_settle_frames;
+            input.buttons[BUTTON_UP].is_down = false;
+            input.buttons[BUTTON_UP].changed = true;
+        }
+
+        // Между нажатиями: ракетка в центре и неподвижна, мяч стоит в центре.
+        if (!pressed_ns && !event_ns) {
+            state->player_1_p = state->player_1_dp = 0;
+            state->ball_p_x = state->ball_p_y = 0;
+            state->ball_dp_x = state->ball_dp_y = 0;
+            if (settle > 0) {
+                settle--;
+            } else {
+                // Кадр, показанный с ракеткой в центре, — образец; нажатие приходит через 0..2 кадра.
+                for (int y = 0; y < height; y++) watch.baseline[y] = presented[(size_t)y * width + watch.x];
+                event_ns = presented_ns + xorshift32(random_state) % (2 * latency_frame_ns);
+                watch.detected_ns.store(0, std::memory_order_relaxed);
+                watch.armed.store(true, std::memory_order_release);
+            }
+        }
+
+        // Ограничитель: следующий кадр начинается на границе 1/60 с (опоздавший кадр — на ближайшей).
+        if (limiter == LIMITER_SLEEP) sleep_until_ns(next_frame_ns);
+        if (limiter == LIMITER_SPIN) {
+            while (headless_time_ns() < next_frame_ns) {
+            }
+        }
+        if (limiter != LIMITER_NONE) {
+            u64 now_ns = headless_time_ns();
+            while (next_frame_ns <= now_ns) next_frame_ns += latency_frame_ns;
+        }
+
+        u64 frame_end_ns = headless_time_ns();
+        dt = (float)(frame_end_ns - frame_begin_ns) * 1e-9f;
+        if (dt > 1.f / 30.f) dt = 1.f / 30.f;
+        total_frame_ns += frame_end_ns - frame_begin_ns;
+        frames++;
+        frame_begin_ns = frame_end_ns;
+    }
+
+    if (present == PRESENT_SHM) {
+        watch.stopping.store(true, std::memory_order_release);
+        watcher.join();
+        close_shared_frame_ring(&ring);
+    }
+    render_state.memory = 0;
+    free(frame_memory);
+    free(watch.baseline);
+    background_cache.valid = false;
+
+    std::sort(latencies, latencies + result.detected);
+    result.p50_ns = latency_percentile(latencies, result.detected, .5);
+    result.p99_ns = latency_percentile(latencies, result.detected, .99);
+    result.max_ns = result.detected ? (double)latencies[result.detected - 1] : 0;
+    result.frame_ns = frames ? (double)total_frame_ns / frames : 0;
+    return result;
+}
+
+/**
+ * @brief Номер имени в списке или -1 (все варианты).
+ */
+internal int
+find_option_name(const char* const* names, int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (!strcmp(names[i], name)) return i;
+    }
+    return -1;
+}
+
+int main(int argc, char** argv) {
+    int trials = 100;
+    int width = 1280, height = 720;
+    int only_mode = -1, only_limiter = -1, only_present = -1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-trials") && i + 1 < argc) trials = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-mode") && i + 1 < argc) only_mode = find_option_name(loop_mode_names, LOOP_MODE_COUNT, argv[++i]);
+        else if (!strcmp(argv[i], "-limiter") && i + 1 < argc) only_limiter = find_option_name(frame_limiter_names, LIMITER_COUNT, argv[++i]);
+        else if (!strcmp(argv[i], "-present") && i + 1 < argc) only_present = find_option_name(present_path_names, PRESENT_COUNT, argv[++i]);
+        else if (!strcmp(argv[i], "-size") && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+    }
+    if (trials < 1 || width < 16 || height < 16) return EXIT_FAILURE;
+    if (kGameRulesInfo[kRulesStandard].paddle_x * height * render_scale + width / 2.f >= width) {
+        // Масштаб кадра берётся по высоте: в узком кадре ракетка за краем.
+        printf("paddle column is outside a %dx%d frame\n", width, height);
+        return EXIT_FAILURE;
+    }
+
+    Game_Memory memory;
+    if (!init_headless_memory(&memory, 64 << 20, 8 << 20)) return EXIT_FAILURE;
+    set_background_cache_memory((u32*)malloc((size_t)width * height * sizeof(u32)));
+    u32* screen = (u32*)malloc((size_t)width * height * sizeof(u32));
+    u64* latencies = (u64*)malloc((size_t)trials * sizeof(u64));
+    if (!screen || !latencies) return EXIT_FAILURE;
+    if (!GameStorageFromMemory(&memory)->history.bytes) {
+        printf("state history does not fit in %zu bytes of permanent memory\n", memory.permanent.size);
+        return EXIT_FAILURE;
+    }
+    u32 random_state = 0x9e3779b9u;
+
+    printf("%d presses per combination, %dx%d, BUTTON_UP to paddle column change\n", trials, width, height);
+    printf("%-9s %-10s %-7s %9s %9s %9s %9s %7s\n", "mode", "limiter", "present", "p50 ms", "p99 ms", "max ms", "frame ms", "missed");
+    int missed = 0;
+    for (int mode = 0; mode < LOOP_MODE_COUNT; mode++) {
+        if (only_mode >= 0 && mode != only_mode) continue;
+        for (int limiter = 0; limiter < LIMITER_COUNT; limiter++) {
+            if (only_limiter >= 0 && limiter != only_limiter) continue;
+            for (int present = 0; present < PRESENT_COUNT; present++) {
+                if (only_present >= 0 && present != only_present) continue;
+                Latency_Result result = run_latency_trials((Loop_Mode)mode, (Frame_Limiter)limiter, (Present_Path)present,
+                                                           trials, width, height, &memory, screen, latencies, &random_state);
+                printf("%-9s %-10s %-7s %9.3f %9.3f %9.3f %9.3f %7d\n", loop_mode_names[mode], frame_limiter_names[limiter],
+                       present_path_names[present], result.p50_ns * 1e-6, result.p99_ns * 1e-6, result.max_ns * 1e-6,
+                       result.frame_ns * 1e-6, result.missed);
+                fflush(stdout);
+                missed += result.missed;
+            }
+        }
+    }
+
+    free(latencies);
+    free(screen);
+    free_headless_memory(&memory);
+    return missed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
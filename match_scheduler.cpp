@@ -0,0 +1,383 @@
+/**
+ * @file match_scheduler.cpp
+ * @brief Планировщик тысяч независимых матчей на пуле потоков с перехватом работы (Linux).
+ *
+ * Каждый матч закреплён за "домашним" потоком, а поток — за ядром процессора.
+ * Домашний поток сам создаёт свои матчи (память оказывается рядом с его ядром),
+ * сам решает, какому матчу пора делать тик, и кладёт его в свою деку.
+ * Свободные потоки забирают работу из чужих дек, поэтому перегруженное ядро
+ * не задерживает тики, но в обычном режиме состояние матча остаётся в кэше своего ядра.
+ *
+ * Если планировщику передан журнал (event_journal.cpp), каждый поток пишет события
+ * выполненных им тиков в своё кольцо журнала.
+ */
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * @brief Количество корзин гистограммы задержек (корзина i — до 2^i мкс).
+ */
+global_variable constexpr int tick_latency_buckets = 24;
+
+/**
+ * @brief Сколько пропущенных тиков матч догоняет за один запуск, прежде чем сбросить отставание.
+ */
+global_variable constexpr int max_catch_up_ticks = 4;
+
+/**
+ * @struct Match
+ * @brief Один матч на сервере со своим состоянием, вводом и частотой тиков.
+ */
+struct alignas(64) Match {
+    Game_State state; /**< Состояние матча. */
+    Input input; /**< Ввод второго игрока (автопилот). */
+    u64 period_ns; /**< Период тика. */
+    u64 next_tick_ns; /**< Время следующего тика; меняется только пока queued == true. */
+    u64 ticks; /**< Выполнено тиков. */
+    int home_worker; /**< Поток, за которым закреплён матч. */
+    std::atomic<bool> queued; /**< Матч стоит в деке или выполняется. */
+};
+
+/**
+ * @struct Work_Deque
+ * @brief Дека Чейза–Лева: владелец кладёт и берёт с низа, остальные крадут с верха.
+ */
+struct Work_Deque {
+    std::atomic<s64> top;
+    std::atomic<s64> bottom;
+    std::atomic<u32>* items;
+    s64 mask;
+};
+
+/**
+ * @struct Scheduler_Worker
+ * @brief Рабочий поток: своя дека, свои матчи и свои счётчики.
+ */
+struct alignas(64) Scheduler_Worker {
+    Work_Deque deque;
+    std::thread thread;
+    int index; /**< Номер потока. */
+    int cpu; /**< Ядро, к которому привязан поток. */
+    u32 first_match, match_count; /**< Домашние матчи: непрерывный диапазон. */
+    u32 random_state; /**< Генератор для выбора жертвы при краже. */
+    Journal_Ring* journal_ring; /**< Кольцо журнала событий этого потока или 0. */
+
+    std::atomic<u64> ticks_executed; /**< Тиков выполнено этим потоком. */
+    std::atomic<u64> ticks_stolen; /**< Из них — тиков чужих матчей. */
+    std::atomic<u64> latency_sum_ns; /**< Сумма задержек тиков. */
+    std::atomic<u64> latency_histogram[tick_latency_buckets]; /**< Задержка от срока тика до его завершения. */
+};
+
+/**
+ * @struct Match_Scheduler
+ * @brief Все матчи сервера и пул рабочих потоков.
+ */
+struct Match_Scheduler {
+    Match* matches;
+    u32 match_count;
+    Scheduler_Worker* workers;
+    int worker_count;
+    const int* tick_rates; /**< Частоты тиков; матч i получает tick_rates[i % rate_count]. */
+    int rate_count;
+    u64 start_ns; /**< Время первого тика. */
+    std::atomic<bool> running;
+};
+
+internal bool
+deque_push(Work_Deque* deque, u32 item) {
+    s64 b = deque->bottom.load(std::memory_order_relaxed);
+    s64 t = deque->top.load(std::memory_order_acquire);
+    if (b - t > deque->mask) return false;
+    deque->items[b & deque->mask].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    deque->bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+internal bool
+deque_pop(Work_Deque* deque, u32* item) {
+    s64 b = deque->bottom.load(std::memory_order_relaxed) - 1;
+    deque->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    s64 t = deque->top.load(std::memory_order_relaxed);
+    if (t > b) {
+        deque->bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+    *item = deque->items[b & deque->mask].load(std::memory_order_relaxed);
+    if (t == b) {
+        // Последний элемент: соревнуемся с ворами за него.
+        bool won = deque->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        deque->bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+internal bool
+deque_steal(Work_Deque* deque, u32* item) {
+    s64 t = deque->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    s64 b = deque->bottom.load(std::memory_order_acquire);
+    if (t >= b) return false;
+    *item = deque->items[t & deque->mask].load(std::memory_order_relaxed);
+    return deque->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Номер корзины гистограммы для задержки.
+ */
+inline int
+tick_latency_bucket(u64 latency_ns) {
+    u64 us = latency_ns / 1000;
+    int bucket = 0;
+    while (bucket < tick_latency_buckets - 1 && (1ull << bucket) <= us) bucket++;
+    return bucket;
+}
+
+/**
+ * @brief Выполняет все наступившие тики матча (вызывается с queued == true).
+ */
+internal void
+run_match(Match* match, u32 index, Scheduler_Worker* worker) {
+    float dt = (float)match->period_ns * 1e-9f;
+    u64 now = headless_time_ns();
+    for (int i = 0; i < max_catch_up_ticks && match->next_tick_ns <= now; i++) {
+        autopilot_input(&match->input, match->state.ball_p_y, match->state.player_2_p);
+        StepGame(&match->state, &match->input, dt);
+        if (worker->journal_ring) journal_game_events(worker->journal_ring, index, (u32)match->ticks, &match->state);
+        match->ticks++;
+
+        u64 done = headless_time_ns();
+        u64 latency = done - match->next_tick_ns;
+        worker->latency_histogram[tick_latency_bucket(latency)].fetch_add(1, std::memory_order_relaxed);
+        worker->latency_sum_ns.fetch_add(latency, std::memory_order_relaxed);
+        worker->ticks_executed.fetch_add(1, std::memory_order_relaxed);
+        if (match->home_worker != worker->index) worker->ticks_stolen.fetch_add(1, std::memory_order_relaxed);
+        match->next_tick_ns += match->period_ns;
+    }
+    if (match->next_tick_ns <= now) match->next_tick_ns = now + match->period_ns;
+    match->queued.store(false, std::memory_order_release);
+}
+
+/**
+ * @brief Привязывает текущий поток к ядру.
+ */
+internal void
+pin_thread_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/**
+ * @brief Основной цикл рабочего потока.
+ */
+internal void
+scheduler_worker_main(Match_Scheduler* scheduler, Scheduler_Worker* worker) {
+    pin_thread_to_cpu(worker->cpu);
+
+    for (u32 i = worker->first_match; i < worker->first_match + worker->match_count; i++) {
+        // Первое касание памяти матча — с ядра, на котором он будет жить.
+        Match* match = new (scheduler->matches + i) Match();
+        start_headless_match(&match->state);
+        match->state.ball_dp_y = (float)((int)(i % 7) - 3) * 10.f;
+        match->home_worker = worker->index;
+        match->period_ns = 1000000000ull / (u64)scheduler->tick_rates[i % scheduler->rate_count];
+        // Матчи одного потока равномерно сдвинуты по фазе, чтобы тики не приходили пачкой.
+        u32 slot = i - worker->first_match;
+        match->next_tick_ns = scheduler->start_ns + match->period_ns * slot / worker->match_count;
+    }
+
+    while (scheduler->running.load(std::memory_order_relaxed)) {
+        u64 now = headless_time_ns();
+        u64 next_due = now + 1000000;
+
+        for (u32 i = worker->first_match; i < worker->first_match + worker->match_count; i++) {
+            Match* match = scheduler->matches + i;
+            if (match->queued.load(std::memory_order_acquire)) continue;
+            if (match->next_tick_ns <= now) {
+                match->queued.store(true, std::memory_order_relaxed);
+                deque_push(&worker->deque, i);
+            } else if (match->next_tick_ns < next_due) {
+                next_due = match->next_tick_ns;
+            }
+        }
+
+        u32 item;
+        for (;;) {
+            if (deque_pop(&worker->deque, &item)) {
+                run_match(scheduler->matches + item, item, worker);
+                continue;
+            }
+            bool stole = false;
+            for (int attempt = 0; attempt < scheduler->worker_count && !stole; attempt++) {
+                worker->random_state = worker->random_state * 1664525u + 1013904223u;
+                Scheduler_Worker* victim = scheduler->workers + (worker->random_state >> 8) % scheduler->worker_count;
+                if (victim != worker) stole = deque_steal(&victim->deque, &item);
+            }
+            if (!stole) break;
+            run_match(scheduler->matches + item, item, worker);
+        }
+
+        u64 after = headless_time_ns();
+        if (next_due > after) {
+            u64 wait = next_due - after;
+            // Просыпаемся не реже раза в 200 мкс, чтобы успеть помочь соседям.
+            if (wait > 200000) wait = 200000;
+            timespec ts = { 0, (long)wait };
+            nanosleep(&ts, 0);
+        }
+    }
+}
+
+/**
+ * @brief Создаёт матчи и запускает рабочие потоки.
+ *
+ * @param scheduler Планировщик.
+ * @param match_count Количество матчей.
+ * @param worker_count Количество рабочих потоков.
+ * @param tick_rates Частоты тиков; матч i получает tick_rates[i % rate_count].
+ * @param rate_count Количество частот.
+ * @param journal Открытый журнал событий или 0; кольца потоков вмещают journal_ring_capacity записей.
+ * @param journal_ring_capacity Ёмкость кольца журнала на поток.
+ */
+internal void
+start_match_scheduler(Match_Scheduler* scheduler, u32 match_count, int worker_count,
+                      const int* tick_rates, int rate_count, Event_Journal* journal, u32 journal_ring_capacity) {
+    scheduler->match_count = match_count;
+    scheduler->tick_rates = tick_rates;
+    scheduler->rate_count = rate_count;
+    scheduler->matches = (Match*)aligned_alloc(alignof(Match), sizeof(Match) * match_count);
+    scheduler->worker_count = worker_count;
+    scheduler->workers = new Scheduler_Worker[worker_count];
+    scheduler->start_ns = headless_time_ns() + 10000000;
+    scheduler->running = true;
+
+    int cpu_count = (int)std::thread::hardware_concurrency();
+    if (cpu_count < 1) cpu_count = 1;
+
+    u32 per_worker = (match_count + worker_count - 1) / worker_count;
+    for (int w = 0; w < worker_count; w++) {
+        Scheduler_Worker* worker = scheduler->workers + w;
+        worker->index = w;
+        worker->cpu = w % cpu_count;
+        worker->first_match = w * per_worker < match_count ? w * per_worker : match_count;
+        u32 end = worker->first_match + per_worker < match_count ? worker->first_match + per_worker : match_count;
+        worker->match_count = end - worker->first_match;
+        worker->random_state = 0x9e3779b9u * (u32)(w + 1);
+        worker->journal_ring = journal ? add_journal_ring(journal, journal_ring_capacity) : 0;
+
+        s64 capacity = 1;
+        while (capacity < (s64)worker->match_count) capacity <<= 1;
+        worker->deque.items = new std::atomic<u32>[capacity];
+        worker->deque.mask = capacity - 1;
+        worker->deque.top = 0;
+        worker->deque.bottom = 0;
+        worker->ticks_executed = 0;
+        worker->ticks_stolen = 0;
+        worker->latency_sum_ns = 0;
+        for (int b = 0; b < tick_latency_buckets; b++) worker->latency_histogram[b] = 0;
+    }
+
+    for (int w = 0; w < worker_count; w++) {
+        scheduler->workers[w].thread = std::thread(scheduler_worker_main, scheduler, scheduler->workers + w);
+    }
+}
+
+/**
+ * @brief Останавливает рабочие потоки. Матчи и счётчики остаются доступны до free_match_scheduler.
+ */
+internal void
+stop_match_scheduler(Match_Scheduler* scheduler) {
+    scheduler->running = false;
+    for (int w = 0; w < scheduler->worker_count; w++) scheduler->workers[w].thread.join();
+}
+
+/**
+ * @brief Освобождает память остановленного планировщика.
+ */
+internal void
+free_match_scheduler(Match_Scheduler* scheduler) {
+    for (int w = 0; w < scheduler->worker_count; w++) delete[] scheduler->workers[w].deque.items;
+    delete[] scheduler->workers;
+    free(scheduler->matches);
+}
+
+/**
+ * @brief Записывает метрики в формате Prometheus (text exposition).
+ *
+ * Гистограмма задержек тиков общая для сервера; счётчики матчей и тиков — по ядрам.
+ *
+ * @param scheduler Планировщик.
+ * @param out Поток вывода.
+ */
+internal void
+write_scheduler_metrics(Match_Scheduler* scheduler, FILE* out) {
+    u64 histogram[tick_latency_buckets] = {};
+    u64 total = 0, latency_sum = 0;
+
+    // Образцы каждого семейства идут подряд под своей строкой # TYPE: строгие парсеры не принимают чередование.
+    fprintf(out, "# TYPE pong_matches gauge\n");
+    for (int w = 0; w < scheduler->worker_count; w++) {
+        Scheduler_Worker* worker = scheduler->workers + w;
+        fprintf(out, "pong_matches{worker=\"%d\",cpu=\"%d\"} %u\n", w, worker->cpu, worker->match_count);
+    }
+    fprintf(out, "# TYPE pong_ticks_total counter\n");
+    for (int w = 0; w < scheduler->worker_count; w++) {
+        Scheduler_Worker* worker = scheduler->workers + w;
+        fprintf(out, "pong_ticks_total{worker=\"%d\",cpu=\"%d\"} %llu\n", w, worker->cpu,
+                (unsigned long long)worker->ticks_executed.load(std::memory_order_relaxed));
+    }
+    fprintf(out, "# TYPE pong_ticks_stolen_total counter\n");
+    for (int w = 0; w < scheduler->worker_count; w++) {
+        Scheduler_Worker* worker = scheduler->workers + w;
+        fprintf(out, "pong_ticks_stolen_total{worker=\"%d\",cpu=\"%d\"} %llu\n", w, worker->cpu,
+                (unsigned long long)worker->ticks_stolen.load(std::memory_order_relaxed));
+    }
+    for (int w = 0; w < scheduler->worker_count; w++) {
+        Scheduler_Worker* worker = scheduler->workers + w;
+        for (int b = 0; b < tick_latency_buckets; b++) {
+            histogram[b] += worker->latency_histogram[b].load(std::memory_order_relaxed);
+        }
+        latency_sum += worker->latency_sum_ns.load(std::memory_order_relaxed);
+    }
+
+    fprintf(out, "# TYPE pong_tick_latency_seconds histogram\n");
+    for (int b = 0; b < tick_latency_buckets; b++) {
+        total += histogram[b];
+        if (b < tick_latency_buckets - 1) {
+            fprintf(out, "pong_tick_latency_seconds_bucket{le=\"%g\"} %llu\n", (double)(1ull << b) * 1e-6, (unsigned long long)total);
+        }
+    }
+    fprintf(out, "pong_tick_latency_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)total);
+    fprintf(out, "pong_tick_latency_seconds_sum %g\n", (double)latency_sum * 1e-9);
+    fprintf(out, "pong_tick_latency_seconds_count %llu\n", (unsigned long long)total);
+}
+
+/**
+ * @brief Оценка перцентиля задержки тика по гистограмме (верхняя граница корзины, мкс).
+ */
+internal u64
+scheduler_latency_percentile_us(Match_Scheduler* scheduler, double fraction) {
+    u64 histogram[tick_latency_buckets] = {};
+    u64 total = 0;
+    for (int w = 0; w < scheduler->worker_count; w++) {
+        for (int b = 0; b < tick_latency_buckets; b++) {
+            u64 count = scheduler->workers[w].latency_histogram[b].load(std::memory_order_relaxed);
+            histogram[b] += count;
+            total += count;
+        }
+    }
+    u64 target = (u64)((double)total * fraction), seen = 0;
+    for (int b = 0; b < tick_latency_buckets; b++) {
+        seen += histogram[b];
+        if (seen > target) return 1ull << b;
+    }
+    return 1ull << (tick_latency_buckets - 1);
+}
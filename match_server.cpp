@@ -0,0 +1,113 @@
+/**
+ * @file match_server.cpp
+ * @brief Безоконный сервер, в одном процессе ведущий тысячи независимых матчей.
+ *
+ * Использование: match_server [матчей] [потоков] [секунд] [частоты через запятую] [файл метрик] [файл журнала]
+ * Например: match_server 5000 4 10 30,60,120 /tmp/pong_metrics.prom /tmp/pong_events.bin
+ * Файл метрик (формат Prometheus) перезаписывается раз в секунду. В файл журнала
+ * пишутся события всех матчей (event_journal.cpp, читается journal_stats).
+ * Код возврата ненулевой, если какой-то матч не получил хотя бы половины тиков своей частоты.
+ */
+
+#include "headless_platform.cpp"
+#include "event_journal.cpp"
+#include "match_scheduler.cpp"
+
+#include <stdio.h>
+
+/**
+ * @brief Атомарно перезаписывает файл метрик (через временный файл и rename).
+ */
+internal void
+export_scheduler_metrics(Match_Scheduler* scheduler, const char* path) {
+    char temp_path[512];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* file = fopen(temp_path, "w");
+    if (!file) return;
+    write_scheduler_metrics(scheduler, file);
+    fclose(file);
+    rename(temp_path, path);
+}
+
+int main(int argc, char** argv) {
+    u32 match_count = argc > 1 ? (u32)atoi(argv[1]) : 2000;
+    int worker_count = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    int seconds = argc > 3 ? atoi(argv[3]) : 10;
+    const char* rates_arg = argc > 4 ? argv[4] : "60";
+    const char* metrics_path = argc > 5 && *argv[5] ? argv[5] : 0;
+    const char* journal_path = argc > 6 ? argv[6] : 0;
+    if (worker_count < 1) worker_count = 1;
+    if (match_count < 1) match_count = 1;
+
+    int tick_rates[16];
+    int rate_count = 0;
+    for (const char* at = rates_arg; *at && rate_count < 16;) {
+        int rate = atoi(at);
+        if (rate > 0) tick_rates[rate_count++] = rate;
+        const char* comma = strchr(at, ',');
+        if (!comma) break;
+        at = comma + 1;
+    }
+    if (!rate_count) tick_rates[rate_count++] = 60;
+
+    double expected_ticks_per_second = 0;
+    for (u32 i = 0; i < match_count; i++) expected_ticks_per_second += tick_rates[i % rate_count];
+    printf("match_server: %u matches on %d workers, %.0f ticks/s expected\n",
+           match_count, worker_count, expected_ticks_per_second);
+
+    Event_Journal* journal = 0;
+    if (journal_path) {
+        journal = new Event_Journal();
+        if (!open_event_journal(journal, journal_path, 1000)) return EXIT_FAILURE;
+    }
+
+    Match_Scheduler scheduler;
+    start_match_scheduler(&scheduler, match_count, worker_count, tick_rates, rate_count, journal, 1 << 16);
+
+    u64 previous_ticks = 0;
+    for (int second = 0; second < seconds; second++) {
+        timespec one_second = { 1, 0 };
+        nanosleep(&one_second, 0);
+
+        u64 ticks = 0, stolen = 0;
+        for (int w = 0; w < worker_count; w++) {
+            ticks += scheduler.workers[w].ticks_executed.load(std::memory_order_relaxed);
+            stolen += scheduler.workers[w].ticks_stolen.load(std::memory_order_relaxed);
+        }
+        printf("%3ds: %llu ticks/s, stolen %.1f%%, latency p50 <%llu us, p99 <%llu us\n",
+               second + 1, (unsigned long long)(ticks - previous_ticks),
+               ticks ? 100.0 * (double)stolen / (double)ticks : 0.0,
+               (unsigned long long)scheduler_latency_percentile_us(&scheduler, 0.5),
+               (unsigned long long)scheduler_latency_percentile_us(&scheduler, 0.99));
+        fflush(stdout);
+        previous_ticks = ticks;
+        if (metrics_path) export_scheduler_metrics(&scheduler, metrics_path);
+    }
+
+    u64 stop_ns = headless_time_ns();
+    stop_match_scheduler(&scheduler);
+
+    // Каждый матч должен был дойти до конца прогона: хотя бы половина тиков его частоты.
+    double run_seconds = stop_ns > scheduler.start_ns ? (double)(stop_ns - scheduler.start_ns) / 1e9 : 0.0;
+    u32 behind = 0;
+    double fewest = 1.0;
+    for (u32 i = 0; i < match_count; i++) {
+        double expected = tick_rates[i % rate_count] * run_seconds;
+        double done = expected > 0 ? (double)scheduler.matches[i].ticks / expected : 1.0;
+        if (done < fewest) fewest = done;
+        if (done < 0.5) behind++;
+    }
+    printf("matches: %u of %u reached the end of the run, slowest at %.0f%% of its ticks\n",
+           match_count - behind, match_count, 100.0 * fewest);
+    free_match_scheduler(&scheduler);
+
+    if (journal) {
+        bool written = close_event_journal(journal);
+        printf("journal: %llu events, %llu bytes, %llu dropped, %llu fsyncs\n",
+               (unsigned long long)journal->records_written, (unsigned long long)journal->bytes_written,
+               (unsigned long long)journal->dropped_events, (unsigned long long)journal->fsync_count);
+        delete journal;
+        if (!written) return EXIT_FAILURE;
+    }
+    return behind ? EXIT_FAILURE : EXIT_SUCCESS;
+}
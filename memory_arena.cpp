@@ -0,0 +1,184 @@
+/**
+ * @file memory_arena.cpp
+ * @brief Линейные арены памяти и счётчик выделений в куче.
+ *
+ * Платформенный слой один раз резервирует память при запуске и раздаёт её
+ * аренами: постоянной (состояние игры) и временной (данные одного кадра,
+ * сбрасывается каждый кадр). Выделение из арены — сдвиг указателя, освобождение —
+ * сброс арены целиком, поэтому в установившемся игровом цикле куча не нужна.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @struct Memory_Arena
+ * @brief Непрерывный блок памяти с линейным выделением.
+ */
+struct Memory_Arena {
+    u8* base; /**< Начало блока. */
+    size_t size; /**< Размер блока. */
+    size_t used; /**< Сколько байт выделено. */
+    size_t high_water; /**< Максимум used за всё время (для подбора размеров). */
+};
+
+/**
+ * @brief Инициализирует арену поверх уже выделенного блока.
+ *
+ * @param arena Арена.
+ * @param base Начало блока.
+ * @param size Размер блока.
+ */
+internal void
+init_arena(Memory_Arena* arena, void* base, size_t size) {
+    arena->base = (u8*)base;
+    arena->size = size;
+    arena->used = 0;
+    arena->high_water = 0;
+}
+
+/**
+ * @brief Выделяет блок из арены.
+ *
+ * @param arena Арена.
+ * @param size Размер блока.
+ * @param alignment Выравнивание (степень двойки).
+ *
+ * @return Указатель на блок или 0, если арена исчерпана.
+ */
+internal void*
+push_size(Memory_Arena* arena, size_t size, size_t alignment = 16) {
+    size_t start = (arena->used + alignment - 1) & ~(alignment - 1);
+    if (start + size > arena->size) return 0;
+    arena->used = start + size;
+    if (arena->used > arena->high_water) arena->high_water = arena->used;
+    return arena->base + start;
+}
+
+/**
+ * @def push_struct
+ * @brief Выделяет из арены одну структуру типа type.
+ */
+#define push_struct(arena, type) ((type*)push_size(arena, sizeof(type), alignof(type)))
+
+/**
+ * @def push_array
+ * @brief Выделяет из арены массив из count элементов типа type.
+ */
+#define push_array(arena, count, type) ((type*)push_size(arena, (size_t)(count) * sizeof(type), alignof(type)))
+
+/**
+ * @brief Освобождает всё, что было выделено из арены.
+ */
+internal void
+reset_arena(Memory_Arena* arena) {
+    arena->used = 0;
+}
+
+/**
+ * @brief Делит арену: выделяет из parent блок и делает из него дочернюю арену.
+ *
+ * @param child Дочерняя арена.
+ * @param parent Родительская арена.
+ * @param size Размер дочерней арены.
+ *
+ * @return false, если в родительской арене не хватило места.
+ */
+internal bool
+sub_arena(Memory_Arena* child, Memory_Arena* parent, size_t size) {
+    void* base = push_size(parent, size, 64);
+    if (!base) return false;
+    init_arena(child, base, size);
+    return true;
+}
+
+/**
+ * @brief Количество выделений в куче за всё время работы.
+ *
+ * Считаются все замены operator new (обычные, выровненные, nothrow); замеры, которым
+ * нужны и выделения через malloc/calloc/realloc, добавляют их сами (frame_bench оборачивает
+ * их при компоновке). Платформенный слой сравнивает значение до и после кадра:
+ * в установившемся режиме разница должна быть нулевой.
+ */
+global_variable std::atomic<u64> heap_allocation_count;
+
+/**
+ * @brief Выделение для всех замен operator new; 0, если памяти нет.
+ *
+ * Выделение и освобождение не встраиваются в operator new/delete: иначе GCC видит free()
+ * на указателе из operator new и предупреждает (-Wmismatched-new-delete).
+ */
+no_inline internal void*
+counted_heap_allocate(size_t size, size_t alignment) {
+    heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (!size) size = 1;
+    if (alignment <= alignof(std::max_align_t)) return malloc(size);
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, alignment);
+#else
+    // aligned_alloc требует размер, кратный выравниванию.
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+/**
+ * @brief Освобождение для всех замен operator delete.
+ */
+no_inline internal void
+counted_heap_free(void* memory, size_t alignment) {
+#if defined(_MSC_VER)
+    if (alignment > alignof(std::max_align_t)) {
+        _aligned_free(memory);
+        return;
+    }
+#endif
+    (void)alignment;
+    free(memory);
+}
+
+// Замена глобальных operator new/delete: то же, что стандартные, плюс подсчёт выделений.
+// Заменяется весь набор (обычные, выровненные, nothrow, с размером), чтобы любая пара new/delete шла через одни функции.
+void* operator new(size_t size) {
+    if (void* memory = counted_heap_allocate(size, 0)) return memory;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    if (void* memory = counted_heap_allocate(size, 0)) return memory;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* memory = counted_heap_allocate(size, (size_t)alignment)) return memory;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    if (void* memory = counted_heap_allocate(size, (size_t)alignment)) return memory;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return counted_heap_allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return counted_heap_allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return counted_heap_allocate(size, (size_t)alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return counted_heap_allocate(size, (size_t)alignment);
+}
+
+void operator delete(void* memory) noexcept { counted_heap_free(memory, 0); }
+void operator delete[](void* memory) noexcept { counted_heap_free(memory, 0); }
+void operator delete(void* memory, size_t) noexcept { counted_heap_free(memory, 0); }
+void operator delete[](void* memory, size_t) noexcept { counted_heap_free(memory, 0); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { counted_heap_free(memory, 0); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { counted_heap_free(memory, 0); }
+void operator delete(void* memory, std::align_val_t alignment) noexcept { counted_heap_free(memory, (size_t)alignment); }
+void operator delete[](void* memory, std::align_val_t alignment) noexcept { counted_heap_free(memory, (size_t)alignment); }
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept { counted_heap_free(memory, (size_t)alignment); }
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept { counted_heap_free(memory, (size_t)alignment); }
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    counted_heap_free(memory, (size_t)alignment);
+}
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    counted_heap_free(memory, (size_t)alignment);
+}
@@ -0,0 +1,309 @@
+/**
+ * @file mosaic.cpp
+ * @brief Мозаика: десятки идущих матчей в одном буфере кадра, каждый в своей области.
+ *
+ * Кадр делится на сетку ячеек; у каждой ячейки своя область (Render_Viewport) с
+ * собственным масштабом и обрезкой, поэтому матчи рисуются обычными списками отрисовки
+ * (RenderArena и RenderGame) без глобального render_scale. Ячейки рисуются параллельно
+ * пулом потоков: потоки по очереди берут ячейки из общего счётчика, у каждого потока
+ * своя арена под списки. Ячейка, целиком ушедшая за край кадра (сетка больше страницы
+ * и прокручена), не рисуется вовсе, а ячейка, список которой совпал с прошлым кадром
+ * (матч на паузе, в меню, закончился), остаётся в буфере кадра как есть.
+ *
+ * Пул потоков создаётся один раз в init_mosaic, и кадр мозаики не выделяет память в куче.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Наибольшее количество потоков мозаики.
+ */
+global_variable constexpr int max_mosaic_threads = 64;
+
+/**
+ * @brief Вместимость списка отрисовки одной ячейки.
+ */
+global_variable constexpr int mosaic_draw_commands = 512;
+
+/**
+ * @brief Размер арены каждого потока под список ячейки.
+ */
+global_variable constexpr size_t mosaic_arena_size = 64 * 1024;
+
+/**
+ * @brief Цвет промежутков между ячейками.
+ */
+global_variable constexpr u32 mosaic_gap_color = 0x202020;
+
+/**
+ * @brief Ширина и высота ячейки в логических единицах (арена стандартных правил с полями).
+ */
+global_variable constexpr float mosaic_cell_units_x = 180.f;
+global_variable constexpr float mosaic_cell_units_y = 100.f;
+
+/**
+ * @struct Mosaic_View
+ * @brief Ячейка мозаики.
+ */
+struct Mosaic_View {
+    Render_Viewport viewport; /**< Область ячейки в буфере кадра. */
+    bool visible; /**< Область пересекается с кадром. */
+    bool drawn; /**< В буфере кадра лежит список с хешем key. */
+    u64 key; /**< Хеш списка, нарисованного в прошлый раз. */
+};
+
+/**
+ * @struct Mosaic_Stats
+ * @brief Что сделано за кадр мозаики.
+ */
+struct Mosaic_Stats {
+    int drawn; /**< Ячейки, нарисованные заново. */
+    int unchanged; /**< Ячейки, пропущенные без изменений. */
+    int offscreen; /**< Ячейки за краем кадра. */
+};
+
+/**
+ * @struct Mosaic
+ * @brief Сетка ячеек и пул потоков, который их рисует.
+ */
+struct Mosaic {
+    Mosaic_View* views; /**< Ячейки (индекс — номер матча). */
+    int view_count; /**< Количество ячеек. */
+    int page_size; /**< Сколько ячеек сетка вмещает на экран. */
+    int columns, rows; /**< Сетка страницы. */
+    int cell_width, cell_height; /**< Размер ячейки в пикселях. */
+    int scroll_y; /**< Прокрутка сетки вверх в пикселях. */
+    int width, height; /**< Размер кадра, под который рассчитана сетка (0 — не рассчитана). */
+
+    const Game_State* states; /**< Матчи текущего кадра. */
+    const Game_Assets* assets; /**< Спрайты оформления. */
+    std::atomic<int> next_view; /**< Следующая свободная ячейка кадра. */
+    std::atomic<int> drawn, unchanged, offscreen; /**< Счётчики кадра. */
+
+    std::thread threads[max_mosaic_threads]; /**< Потоки пула (нулевой — вызывающий поток). */
+    u8* arena_memory; /**< Память арен потоков под списки отрисовки. */
+    int thread_count; /**< Потоков вместе с вызывающим. */
+    std::mutex mutex;
+    std::condition_variable wake; /**< Новый кадр или остановка. */
+    std::condition_variable done; /**< Все потоки закончили кадр. */
+    u64 generation; /**< Номер кадра. */
+    int busy; /**< Потоков пула, ещё рисующих кадр. */
+    bool stopping; /**< Пул останавливается. */
+};
+
+/**
+ * @brief Рисует ячейку, если она видна и её список изменился.
+ */
+internal void
+render_mosaic_view(Mosaic* mosaic, int index, Memory_Arena* arena, Mosaic_Stats* stats) {
+    Mosaic_View* view = mosaic->views + index;
+    if (!view->visible) {
+        stats->offscreen++;
+        return;
+    }
+
+    reset_arena(arena);
+    Draw_List* list = begin_draw_list(arena, mosaic_draw_commands);
+    if (!list) return;
+    RenderArena(list);
+    RenderGame(mosaic->states + index, mosaic->assets, list);
+    u64 key = draw_list_key(list);
+    if (view->drawn && view->key == key) {
+        stats->unchanged++;
+        return;
+    }
+    execute_draw_list_in_viewport(list, &view->viewport);
+    view->key = key;
+    view->drawn = true;
+    stats->drawn++;
+}
+
+/**
+ * @brief Берёт ячейки кадра из общего счётчика, пока они не кончатся.
+ */
+internal void
+render_mosaic_views(Mosaic* mosaic, int thread_index) {
+    PROFILE_ZONE("render_mosaic_views");
+    // Арена на стеке потока: счётчик used не делит строку кэша с аренами других потоков.
+    Memory_Arena arena;
+    init_arena(&arena, mosaic->arena_memory + mosaic_arena_size * thread_index, mosaic_arena_size);
+    Mosaic_Stats stats = {};
+    for (;;) {
+        int index = mosaic->next_view.fetch_add(1, std::memory_order_relaxed);
+        if (index >= mosaic->view_count) break;
+        render_mosaic_view(mosaic, index, &arena, &stats);
+    }
+    mosaic->drawn.fetch_add(stats.drawn, std::memory_order_relaxed);
+    mosaic->unchanged.fetch_add(stats.unchanged, std::memory_order_relaxed);
+    mosaic->offscreen.fetch_add(stats.offscreen, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Поток пула: ждёт кадр, рисует свою долю ячеек и сообщает об окончании.
+ */
+internal void
+mosaic_worker(Mosaic* mosaic, int thread_index) {
+    u64 seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mosaic->mutex);
+            mosaic->wake.wait(lock, [&] { return mosaic->stopping || mosaic->generation != seen; });
+            if (mosaic->stopping) return;
+            seen = mosaic->generation;
+        }
+        render_mosaic_views(mosaic, thread_index);
+        std::lock_guard<std::mutex> lock(mosaic->mutex);
+        if (--mosaic->busy == 0) mosaic->done.notify_one();
+    }
+}
+
+/**
+ * @brief Создаёт мозаику на view_count матчей и запускает пул потоков.
+ *
+ * @param mosaic Мозаика, созданная как Mosaic() (все поля нулевые).
+ * @param view_count Количество матчей.
+ * @param page_size Сколько ячеек помещается на экран; остальные ниже края кадра (прокрутка).
+ * @param thread_count Потоков вместе с вызывающим (1 — без пула).
+ * @return false, если память не выделена.
+ */
+internal bool
+init_mosaic(Mosaic* mosaic, int view_count, int page_size, int thread_count) {
+    thread_count = clamp(1, thread_count, max_mosaic_threads);
+    mosaic->views = (Mosaic_View*)calloc((size_t)view_count, sizeof(Mosaic_View));
+    mosaic->arena_memory = (u8*)malloc(mosaic_arena_size * thread_count);
+    if (!mosaic->views || !mosaic->arena_memory) return false;
+    mosaic->view_count = view_count;
+    mosaic->page_size = clamp(1, page_size, view_count);
+    mosaic->thread_count = thread_count;
+    for (int i = 1; i < thread_count; i++) mosaic->threads[i] = std::thread(mosaic_worker, mosaic, i);
+    return true;
+}
+
+/**
+ * @brief Останавливает пул и освобождает память мозаики.
+ */
+internal void
+free_mosaic(Mosaic* mosaic) {
+    {
+        std::lock_guard<std::mutex> lock(mosaic->mutex);
+        mosaic->stopping = true;
+    }
+    mosaic->wake.notify_all();
+    for (int i = 1; i < mosaic->thread_count; i++) {
+        if (mosaic->threads[i].joinable()) mosaic->threads[i].join();
+    }
+    free(mosaic->views);
+    free(mosaic->arena_memory);
+    mosaic->views = 0;
+    mosaic->arena_memory = 0;
+}
+
+/**
+ * @brief Заставляет нарисовать все ячейки заново со следующего кадра (после чужой отрисовки в кадр).
+ */
+internal void
+invalidate_mosaic(Mosaic* mosaic) {
+    mosaic->width = 0;
+}
+
+/**
+ * @brief Прокручивает сетку: pixels > 0 — вниз по списку матчей.
+ */
+internal void
+scroll_mosaic(Mosaic* mosaic, int pixels) {
+    int total_rows = (mosaic->view_count + mosaic->columns - 1) / (mosaic->columns ? mosaic->columns : 1);
+    int max_scroll = total_rows * mosaic->cell_height - render_state.height;
+    mosaic->scroll_y = clamp(0, mosaic->scroll_y + pixels, max_scroll > 0 ? max_scroll : 0);
+    invalidate_mosaic(mosaic);
+}
+
+/**
+ * @brief Рассчитывает сетку под текущий размер кадра и заливает кадр цветом промежутков.
+ *
+ * Количество столбцов выбирается так, чтобы страница из page_size ячеек поместилась
+ * в кадр с наибольшим масштабом. Строки идут сверху вниз; между ячейками полоса в пиксель.
+ */
+internal void
+layout_mosaic(Mosaic* mosaic) {
+    int width = render_state.width, height = render_state.height;
+    float best_scale = -1.f;
+    for (int columns = 1; columns <= mosaic->page_size; columns++) {
+        int rows = (mosaic->page_size + columns - 1) / columns;
+        float scale = fminf((float)(width / columns) / mosaic_cell_units_x, (float)(height / rows) / mosaic_cell_units_y);
+        if (scale > best_scale) {
+            best_scale = scale;
+            mosaic->columns = columns;
+            mosaic->rows = rows;
+        }
+    }
+    mosaic->cell_width = width / mosaic->columns;
+    mosaic->cell_height = height / mosaic->rows;
+
+    for (int i = 0; i < mosaic->view_count; i++) {
+        Mosaic_View* view = mosaic->views + i;
+        int column = i % mosaic->columns, row = i / mosaic->columns;
+        // Буфер кадра идёт снизу вверх: первая строка сетки — у верхнего края.
+        int x0 = column * mosaic->cell_width;
+        int y1 = height - row * mosaic->cell_height + mosaic->scroll_y;
+        int y0 = y1 - mosaic->cell_height;
+        Render_Viewport* viewport = &view->viewport;
+        viewport->x0 = clamp(0, x0, width);
+        viewport->x1 = clamp(0, x0 + mosaic->cell_width - 1, width);
+        viewport->y0 = clamp(0, y0 + 1, height);
+        viewport->y1 = clamp(0, y1, height);
+        viewport->scale = best_scale;
+        viewport->center_x = x0 + mosaic->cell_width * .5f;
+        viewport->center_y = y0 + mosaic->cell_height * .5f;
+        view->visible = viewport->x1 > viewport->x0 && viewport->y1 > viewport->y0;
+        view->drawn = false;
+    }
+    mosaic->width = width;
+    mosaic->height = height;
+    clear_screen(mosaic_gap_color);
+}
+
+/**
+ * @brief Рисует кадр мозаики: матч states[i] — в ячейку i.
+ *
+ * Мозаика рисует в буфер кадра мимо кэша фона, поэтому кэш сбрасывается.
+ *
+ * @param mosaic Мозаика.
+ * @param states Состояния view_count матчей.
+ * @param assets Спрайты оформления.
+ * @return Сколько ячеек нарисовано, пропущено без изменений и за краем кадра.
+ */
+internal Mosaic_Stats
+render_mosaic(Mosaic* mosaic, const Game_State* states, const Game_Assets* assets) {
+    PROFILE_ZONE("render_mosaic");
+    if (mosaic->width != render_state.width || mosaic->height != render_state.height) layout_mosaic(mosaic);
+    background_cache.valid = false;
+
+    mosaic->states = states;
+    mosaic->assets = assets;
+    mosaic->next_view.store(0, std::memory_order_relaxed);
+    mosaic->drawn.store(0, std::memory_order_relaxed);
+    mosaic->unchanged.store(0, std::memory_order_relaxed);
+    mosaic->offscreen.store(0, std::memory_order_relaxed);
+    if (mosaic->thread_count > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mosaic->mutex);
+            mosaic->generation++;
+            mosaic->busy = mosaic->thread_count - 1;
+        }
+        mosaic->wake.notify_all();
+    }
+    render_mosaic_views(mosaic, 0);
+    if (mosaic->thread_count > 1) {
+        std::unique_lock<std::mutex> lock(mosaic->mutex);
+        mosaic->done.wait(lock, [&] { return mosaic->busy == 0; });
+    }
+
+    Mosaic_Stats stats;
+    stats.drawn = mosaic->drawn.load(std::memory_order_relaxed);
+    stats.unchanged = mosaic->unchanged.load(std::memory_order_relaxed);
+    stats.offscreen = mosaic->offscreen.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file mosaic_bench.cpp
+ * @brief Замер мозаики матчей и сверка её кадров с полной перерисовкой в один поток.
+ *
+ * Матчи ИИ против автопилота шагают StepGame, после каждого шага мозаика рисует кадр.
+ * Каждый paused-й матч стоит в меню (его ячейка не меняется), а матчи за пределами
+ * страницы лежат ниже края кадра. Время кадра сравнивается с бюджетом 60 кадров в секунду.
+ * Раз в check кадров тот же кадр рисуется второй мозаикой в один поток с нуля
+ * (без пропусков), и буферы кадра должны совпасть побитово.
+ *
+ * Использование:
+ *   mosaic_bench [-matches N] [-page N] [-frames N] [-size ширина высота] [-threads N] [-paused N] [-check N] [-dump файл.ppm]
+ *
+ * -dump сохраняет последний кадр мозаики в PPM.
+ */
+
+#include "headless_platform.cpp"
+#include "mosaic.cpp"
+
+int main(int argc, char** argv) {
+    int match_count = 64;
+    int page_size = 0;
+    int frames = 600;
+    int width = 1920, height = 1080;
+    int thread_count = (int)std::thread::hardware_concurrency();
+    int paused = 8;
+    int check_interval = 30;
+    const char* dump_path = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-matches") && i + 1 < argc) match_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-page") && i + 1 < argc) page_size = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-frames") && i + 1 < argc) frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-threads") && i + 1 < argc) thread_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-paused") && i + 1 < argc) paused = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-check") && i + 1 < argc) check_interval = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-dump") && i + 1 < argc) dump_path = argv[++i];
+        else if (!strcmp(argv[i], "-size") && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+    }
+    if (match_count < 1 || frames < 1 || width < 1 || height < 1) return EXIT_FAILURE;
+    if (page_size < 1) page_size = match_count;
+
+    Game_State* states = (Game_State*)malloc((size_t)match_count * sizeof(Game_State));
+    Input* inputs = (Input*)malloc((size_t)match_count * sizeof(Input));
+    if (!states || !inputs) return EXIT_FAILURE;
+    for (int i = 0; i < match_count; i++) {
+        states[i] = Game_State();
+        if (paused < 1 || i % paused != paused - 1) start_headless_match(states + i);
+        states[i].rules = (Game_Rules)(i % kRulesCount);
+        states[i].ball_p_y = (float)(i % 61) - 30.f;
+        inputs[i] = Input();
+    }
+
+    Game_Memory memory;
+    if (!init_headless_memory(&memory, 1 << 20, 4 << 20)) return EXIT_FAILURE;
+    resize_headless_framebuffer(width, height);
+    Game_Assets assets = {};
+    size_t frame_bytes = (size_t)width * height * sizeof(u32);
+    u32* frame = (u32*)malloc(frame_bytes);
+
+    Mosaic* mosaic = new Mosaic();
+    Mosaic* reference = new Mosaic();
+    if (!frame || !init_mosaic(mosaic, match_count, page_size, thread_count) ||
+        !init_mosaic(reference, match_count, page_size, 1)) {
+        return EXIT_FAILURE;
+    }
+
+    const float dt = 1.f / 60.f;
+    u64 total_ns = 0, worst_ns = 0, over_budget = 0;
+    u64 drawn = 0, unchanged = 0, offscreen = 0;
+    int checks = 0, mismatches = 0;
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < match_count; i++) {
+            autopilot_input(inputs + i, states[i].ball_p_y, states[i].player_2_p);
+            StepGame(states + i, inputs + i, dt);
+        }
+
+        u64 begin_ns = headless_time_ns();
+        Mosaic_Stats stats = render_mosaic(mosaic, states, &assets);
+        u64 ns = headless_time_ns() - begin_ns;
+        total_ns += ns;
+        if (ns > worst_ns) worst_ns = ns;
+        if (ns > 1000000000ull / 60) over_budget++;
+        drawn += (u64)stats.drawn;
+        unchanged += (u64)stats.unchanged;
+        offscreen += (u64)stats.offscreen;
+
+        if (check_interval > 0 && f % check_interval == check_interval - 1) {
+            // Полная перерисовка в один поток затирает кадр мозаики: после сверки он возвращается на место.
+            memcpy(frame, render_state.memory, frame_bytes);
+            invalidate_mosaic(reference);
+            render_mosaic(reference, states, &assets);
+            checks++;
+            if (memcmp(frame, render_state.memory, frame_bytes)) {
+                if (mismatches++ < 5) printf("frame %d: mosaic differs from full redraw\n", f);
+            }
+            memcpy(render_state.memory, frame, frame_bytes);
+        }
+    }
+
+    printf("%d matches (page %d, %dx%d cells of %dx%d px) in %dx%d, %d threads, %d frames\n",
+           match_count, mosaic->page_size, mosaic->columns, mosaic->rows, mosaic->cell_width, mosaic->cell_height,
+           width, height, mosaic->thread_count, frames);
+    printf("mosaic frame: mean %.3f ms, worst %.3f ms, %llu frames over the 60 fps budget\n",
+           (double)total_ns / frames * 1e-6, (double)worst_ns * 1e-6, (unsigned long long)over_budget);
+    printf("cells per frame: %.1f drawn, %.1f unchanged, %.1f off-screen\n",
+           (double)drawn / frames, (double)unchanged / frames, (double)offscreen / frames);
+    printf("%d checks against full single-thread redraw, %d mismatches\n", checks, mismatches);
+
+    FILE* dump = dump_path ? fopen(dump_path, "wb") : 0;
+    if (dump) {
+        // Буфер кадра идёт снизу вверх, PPM — сверху вниз.
+        fprintf(dump, "P6\n%d %d\n255\n", width, height);
+        const u32* pixels = (const u32*)render_state.memory;
+        for (int y = height - 1; y >= 0; y--) {
+            for (int x = 0; x < width; x++) {
+                u32 color = pixels[(size_t)y * width + x];
+                u8 rgb[3] = { (u8)(color >> 16), (u8)(color >> 8), (u8)color };
+                fwrite(rgb, 1, 3, dump);
+            }
+        }
+        fclose(dump);
+    }
+
+    free_mosaic(mosaic);
+    free_mosaic(reference);
+    delete mosaic;
+    delete reference;
+    free(frame);
+    free_headless_memory(&memory);
+    free(states);
+    free(inputs);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
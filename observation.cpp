@@ -0,0 +1,275 @@
+/**
+ * @file observation.cpp
+ * @brief Пакетный рендеринг наблюдений для агентов: маленькие кадры в оттенках серого для тысяч матчей.
+ *
+ * Наблюдения рисуются прямо из Game_State в общий непрерывный тензор u8
+ * [среда][слот стопки][строка][столбец], без полноразмерного буфера кадра и без
+ * списка отрисовки. В кадре только то, что нужно агенту: арена во весь кадр (строка 0 —
+ * верх арены), обе ракетки и мяч. Кадр собирается в маленьком буфере в кэше
+ * (заливки 16-байтными записями SSE2) и одним проходом уходит в тензор потоковыми
+ * записями: тензор тысяч сред не помещается в кэш, и запись мимо кэша не тратит
+ * пропускную способность на чтение строк, которые всё равно перезаписываются целиком.
+ *
+ * Стопка — кольцо из stack слотов, общее для всего пакета: новый шаг пишется в слот
+ * head, старые кадры не копируются. Кадр заданного возраста — observation_frame,
+ * стопка по порядку от старого к новому — copy_observation_stack. Среды независимы,
+ * поэтому диапазоны сред можно рисовать из разных потоков (render_observations_parallel).
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+
+/**
+ * @brief Наибольшее количество потоков render_observations_parallel.
+ */
+global_variable constexpr int max_observation_threads = 64;
+
+/**
+ * @struct Observation_Batch
+ * @brief Тензор наблюдений пакета сред.
+ */
+struct Observation_Batch {
+    u8* frames; /**< [env_count][stack][height][width] байт яркости. */
+    int env_count; /**< Количество сред. */
+    int width, height; /**< Размер кадра в пикселях. */
+    int stack; /**< Кадров в стопке каждой среды. */
+    int head; /**< Слот самого нового кадра. */
+};
+
+/**
+ * @brief Наибольший размер кадра, который собирается в буфере на стеке.
+ */
+global_variable constexpr int max_observation_frame_size = 64 * 1024;
+
+/**
+ * @brief Яркость цвета 0xRRGGBB в одном байте (веса 2:5:1).
+ */
+inline u8
+observation_luma(u32 color) {
+    return (u8)((((color >> 16) & 0xff) * 2 + ((color >> 8) & 0xff) * 5 + (color & 0xff)) / 8);
+}
+
+/**
+ * @brief Выделяет тензор наблюдений (заполнен нулями).
+ *
+ * @return false, если память не выделена или кадр больше max_observation_frame_size.
+ */
+internal bool
+init_observation_batch(Observation_Batch* batch, int env_count, int width, int height, int stack) {
+    *batch = Observation_Batch();
+    if ((size_t)width * height > max_observation_frame_size) return false;
+    batch->frames = (u8*)calloc((size_t)env_count * stack * width * height, 1);
+    if (!batch->frames) return false;
+    batch->env_count = env_count;
+    batch->width = width;
+    batch->height = height;
+    batch->stack = stack;
+    return true;
+}
+
+/**
+ * @brief Освобождает тензор наблюдений.
+ */
+internal void
+free_observation_batch(Observation_Batch* batch) {
+    free(batch->frames);
+    *batch = Observation_Batch();
+}
+
+/**
+ * @brief Размер одного кадра в байтах.
+ */
+inline size_t
+observation_frame_size(const Observation_Batch* batch) {
+    return (size_t)batch->width * batch->height;
+}
+
+/**
+ * @brief Кадр среды заданного возраста: 0 — самый новый, stack - 1 — самый старый.
+ */
+inline u8*
+observation_frame(const Observation_Batch* batch, int env, int age) {
+    int slot = (batch->head - age + batch->stack) % batch->stack;
+    return batch->frames + ((size_t)env * batch->stack + slot) * observation_frame_size(batch);
+}
+
+/**
+ * @brief Переходит к следующему шагу: слот самого старого кадра становится слотом нового.
+ *
+ * Вызывается один раз за шаг перед render_observations всех сред пакета.
+ */
+internal void
+advance_observation_stack(Observation_Batch* batch) {
+    batch->head = (batch->head + 1) % batch->stack;
+}
+
+/**
+ * @brief Копирует стопку среды по порядку, от самого старого кадра к самому новому.
+ *
+ * @param out stack * width * height байт.
+ */
+internal void
+copy_observation_stack(const Observation_Batch* batch, int env, u8* out) {
+    size_t frame_size = observation_frame_size(batch);
+    for (int age = batch->stack - 1; age >= 0; age--, out += frame_size) {
+        memcpy(out, observation_frame(batch, env, age), frame_size);
+    }
+}
+
+/**
+ * @brief Копирует собранный кадр в тензор; с SSE2 — потоковыми записями мимо кэша.
+ */
+internal void
+store_observation_frame(u8* dest, const u8* source, size_t size) {
+#ifdef SIMD_SSE2
+    if (((uintptr_t)dest & 15) == 0) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) _mm_stream_si128((__m128i*)(dest + i), _mm_loadu_si128((const __m128i*)(source + i)));
+        for (; i < size; i++) dest[i] = source[i];
+        return;
+    }
+#endif
+    memcpy(dest, source, size);
+}
+
+/**
+ * @brief Заливает прямоугольник [x0, x1) x [y0, y1) кадра значением value.
+ *
+ * Строки от 16 пикселей заливаются 16-байтными записями, последняя запись строки
+ * перекрывает предыдущую; узкие строки (ракетка, мяч) — побайтно.
+ */
+internal void
+fill_observation_rect(u8* frame, int pitch, int x0, int y0, int x1, int y1, u8 value) {
+    int count = x1 - x0;
+    if (count <= 0 || y1 <= y0) return;
+    u8* row = frame + (size_t)y0 * pitch + x0;
+#ifdef SIMD_SSE2
+    if (count >= 16) {
+        __m128i fill = _mm_set1_epi8((char)value);
+        for (int y = y0; y < y1; y++, row += pitch) {
+            for (int x = 0; x + 16 < count; x += 16) _mm_storeu_si128((__m128i*)(row + x), fill);
+            _mm_storeu_si128((__m128i*)(row + count - 16), fill);
+        }
+        return;
+    }
+#endif
+    for (int y = y0; y < y1; y++, row += pitch) {
+        for (int x = 0; x < count; x++) row[x] = value;
+    }
+}
+
+/**
+ * @struct Observation_Mapping
+ * @brief Перевод координат матча в пиксели кадра наблюдения.
+ */
+struct Observation_Mapping {
+    float scale_x, scale_y; /**< Пикселей на единицу длины. */
+    float offset_x, offset_y; /**< Пиксель левого верхнего угла арены. */
+    int width, height; /**< Размер кадра для обрезки. */
+};
+
+/**
+ * @brief Заливает прямоугольник в координатах матча (центр и половины размеров).
+ *
+ * Края округляются к ближайшему пикселю, но пиксель под центром закрашивается всегда,
+ * чтобы мяч не пропадал из маленького кадра. Ось Y кадра направлена вниз.
+ */
+internal void
+fill_observation_object(u8* frame, const Observation_Mapping* mapping, float x, float y,
+                        float half_size_x, float half_size_y, u8 value) {
+    float center_x = x * mapping->scale_x + mapping->offset_x;
+    float center_y = mapping->offset_y - y * mapping->scale_y;
+    float extent_x = half_size_x * mapping->scale_x;
+    float extent_y = half_size_y * mapping->scale_y;
+    int x0 = (int)floorf(center_x - extent_x + .5f), x1 = (int)floorf(center_x + extent_x + .5f);
+    int y0 = (int)floorf(center_y - extent_y + .5f), y1 = (int)floorf(center_y + extent_y + .5f);
+    int pixel_x = (int)floorf(center_x), pixel_y = (int)floorf(center_y);
+    if (x0 > pixel_x) x0 = pixel_x;
+    if (x1 <= pixel_x) x1 = pixel_x + 1;
+    if (y0 > pixel_y) y0 = pixel_y;
+    if (y1 <= pixel_y) y1 = pixel_y + 1;
+    x0 = clamp(0, x0, mapping->width);
+    x1 = clamp(0, x1, mapping->width);
+    y0 = clamp(0, y0, mapping->height);
+    y1 = clamp(0, y1, mapping->height);
+    fill_observation_rect(frame, mapping->width, x0, y0, x1, y1, value);
+}
+
+/**
+ * @brief Рисует наблюдения сред [first, first + count) в слот head.
+ *
+ * @param batch Тензор наблюдений.
+ * @param states Состояния всех сред пакета (индекс — номер среды).
+ * @param first Первая среда диапазона.
+ * @param count Количество сред.
+ */
+internal void
+render_observations(Observation_Batch* batch, const Game_State* states, int first, int count) {
+    PROFILE_ZONE("render_observations");
+    const u8 arena_value = observation_luma(0xffaa33);
+    const u8 paddle_value = observation_luma(0xff0000);
+    const u8 ball_value = observation_luma(0xffffff);
+    size_t frame_size = observation_frame_size(batch);
+    alignas(16) u8 frame[max_observation_frame_size];
+
+    for (int env = first; env < first + count; env++) {
+        const Game_State* state = states + env;
+
+        const Game_Rules_Info* rules = kGameRulesInfo + state->rules;
+        Observation_Mapping mapping;
+        mapping.width = batch->width;
+        mapping.height = batch->height;
+        mapping.scale_x = batch->width / (2 * rules->arena_half_size_x);
+        mapping.scale_y = batch->height / (2 * rules->arena_half_size_y);
+        mapping.offset_x = batch->width * .5f;
+        mapping.offset_y = batch->height * .5f;
+
+        fill_observation_rect(frame, batch->width, 0, 0, batch->width, batch->height, arena_value);
+        if (state->current_gamemode == kGameplay) {
+            fill_observation_object(frame, &mapping, rules->paddle_x, state->player_1_p, player_half_size_x, player_half_size_y, paddle_value);
+            fill_observation_object(frame, &mapping, -rules->paddle_x, state->player_2_p, player_half_size_x, player_half_size_y, paddle_value);
+            fill_observation_object(frame, &mapping, state->ball_p_x, state->ball_p_y, ball_half_size, ball_half_size, ball_value);
+        }
+        store_observation_frame(observation_frame(batch, env, 0), frame, frame_size);
+    }
+#ifdef SIMD_SSE2
+    // Потоковые записи должны стать видны другим потокам до возврата.
+    _mm_sfence();
+#endif
+}
+
+/**
+ * @brief Переходит к следующему шагу и рисует наблюдения всех сред, поделив среды
+ * на thread_count равных диапазонов.
+ *
+ * Потоки запускаются на один вызов: при тысячах сред в пакете их запуск
+ * несравнимо дешевле самого рендеринга.
+ *
+ * @param batch Тензор наблюдений.
+ * @param states Состояния всех сред пакета.
+ * @param thread_count Количество потоков (1 — в вызывающем потоке).
+ */
+internal void
+render_observations_parallel(Observation_Batch* batch, const Game_State* states, int thread_count) {
+    advance_observation_stack(batch);
+    thread_count = clamp(1, thread_count, max_observation_threads);
+    if (thread_count > batch->env_count) thread_count = batch->env_count;
+    if (thread_count <= 1) {
+        render_observations(batch, states, 0, batch->env_count);
+        return;
+    }
+
+    std::thread threads[max_observation_threads];
+    int per_thread = (batch->env_count + thread_count - 1) / thread_count;
+    for (int i = 1; i < thread_count; i++) {
+        int first = i * per_thread;
+        int count = batch->env_count - first < per_thread ? batch->env_count - first : per_thread;
+        if (count > 0) threads[i] = std::thread(render_observations, batch, states, first, count);
+    }
+    render_observations(batch, states, 0, per_thread < batch->env_count ? per_thread : batch->env_count);
+    for (int i = 1; i < thread_count; i++) {
+        if (threads[i].joinable()) threads[i].join();
+    }
+}
@@ -0,0 +1,147 @@
+/**
+ * @file observation_bench.cpp
+ * @brief Замер пакетного рендеринга наблюдений и проверка содержимого кадров.
+ *
+ * Пакет сред (матчи ИИ против автопилота) шагает StepGame, после каждого шага
+ * рисуются наблюдения всех сред. Для сравнения те же кадры рисуются обычным путём:
+ * список отрисовки матча в буфер кадра размером с наблюдение и перевод в яркость.
+ * В каждом кадре проверяется, что под центром мяча яркость мяча, а под центрами
+ * ракеток — яркость ракетки.
+ *
+ * Использование:
+ *   observation_bench [-envs N] [-steps N] [-size ширина высота] [-stack N] [-threads N] [-dump файл.pgm]
+ *
+ * -dump сохраняет стопку первой среды последнего шага (кадры друг под другом) в PGM.
+ */
+
+#include "headless_platform.cpp"
+#include "observation.cpp"
+
+/**
+ * @brief Проверяет пиксель кадра под точкой матча.
+ */
+internal bool
+check_observation_pixel(const Observation_Batch* batch, const u8* frame, const Game_State* state, float x, float y, u8 expected) {
+    const Game_Rules_Info* rules = kGameRulesInfo + state->rules;
+    int px = (int)floorf(x * (batch->width / (2 * rules->arena_half_size_x)) + batch->width * .5f);
+    int py = (int)floorf(batch->height * .5f - y * (batch->height / (2 * rules->arena_half_size_y)));
+    px = clamp(0, px, batch->width - 1);
+    py = clamp(0, py, batch->height - 1);
+    return frame[py * batch->width + px] == expected;
+}
+
+/**
+ * @brief Рисует кадр среды обычным путём (список отрисовки, буфер кадра) и переводит его в яркость.
+ */
+internal void
+render_observation_with_draw_list(Game_Memory* memory, const Game_State* state, const Game_Assets* assets, u8* frame) {
+    reset_arena(&memory->transient);
+    Draw_List* list = begin_draw_list(&memory->transient, kMaxDrawCommands);
+    RenderArena(list);
+    RenderGame(state, assets, list);
+    execute_draw_list(list);
+    const u32* pixels = (const u32*)render_state.memory;
+    for (int y = 0; y < render_state.height; y++) {
+        const u32* row = pixels + (size_t)(render_state.height - 1 - y) * render_state.width;
+        for (int x = 0; x < render_state.width; x++) *frame++ = observation_luma(row[x] & 0xffffff);
+    }
+}
+
+int main(int argc, char** argv) {
+    int env_count = 4096;
+    int steps = 100;
+    int width = 84, height = 84;
+    int stack = 4;
+    int thread_count = (int)std::thread::hardware_concurrency();
+    const char* dump_path = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-envs") && i + 1 < argc) env_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-steps") && i + 1 < argc) steps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-stack") && i + 1 < argc) stack = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-threads") && i + 1 < argc) thread_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-dump") && i + 1 < argc) dump_path = argv[++i];
+        else if (!strcmp(argv[i], "-size") && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+    }
+    if (env_count < 1 || steps < 1 || stack < 1 || width < 1 || height < 1) return EXIT_FAILURE;
+
+    Observation_Batch batch;
+    Game_State* states = (Game_State*)malloc((size_t)env_count * sizeof(Game_State));
+    Input* inputs = (Input*)malloc((size_t)env_count * sizeof(Input));
+    if (!states || !inputs || !init_observation_batch(&batch, env_count, width, height, stack)) return EXIT_FAILURE;
+    for (int i = 0; i < env_count; i++) {
+        states[i] = Game_State();
+        start_headless_match(states + i);
+        states[i].rules = (Game_Rules)(i % kRulesCount);
+        states[i].ball_p_y = (float)(i % 61) - 30.f;
+        inputs[i] = Input();
+    }
+
+    const u8 paddle_value = observation_luma(0xff0000);
+    const u8 ball_value = observation_luma(0xffffff);
+    const float dt = 1.f / 60.f;
+    u64 step_ns = 0, render_ns = 0;
+    int failures = 0;
+    for (int step = 0; step < steps; step++) {
+        u64 begin_ns = headless_time_ns();
+        for (int i = 0; i < env_count; i++) {
+            autopilot_input(inputs + i, states[i].ball_p_y, states[i].player_2_p);
+            StepGame(states + i, inputs + i, dt);
+        }
+        u64 stepped_ns = headless_time_ns();
+        render_observations_parallel(&batch, states, thread_count);
+        u64 rendered_ns = headless_time_ns();
+        step_ns += stepped_ns - begin_ns;
+        render_ns += rendered_ns - stepped_ns;
+
+        for (int i = 0; i < env_count; i++) {
+            const Game_State* state = states + i;
+            const u8* frame = observation_frame(&batch, i, 0);
+            float paddle_x = kGameRulesInfo[state->rules].paddle_x;
+            if (!check_observation_pixel(&batch, frame, state, state->ball_p_x, state->ball_p_y, ball_value) ||
+                !check_observation_pixel(&batch, frame, state, paddle_x, state->player_1_p, paddle_value) ||
+                !check_observation_pixel(&batch, frame, state, -paddle_x, state->player_2_p, paddle_value)) {
+                if (failures++ < 5) printf("env %d step %d: ball/paddle pixel mismatch\n", i, step);
+            }
+        }
+    }
+
+    // Обычный путь для сравнения: те же состояния через список отрисовки в буфер кадра размером с наблюдение.
+    Game_Memory memory;
+    if (!init_headless_memory(&memory, 1 << 20, 4 << 20)) return EXIT_FAILURE;
+    resize_headless_framebuffer(width, height);
+    Game_Assets assets = {};
+    u8* draw_list_frame = (u8*)malloc(observation_frame_size(&batch));
+    int draw_list_envs = env_count < 1024 ? env_count : 1024;
+    u64 begin_ns = headless_time_ns();
+    for (int i = 0; i < draw_list_envs; i++) render_observation_with_draw_list(&memory, states + i, &assets, draw_list_frame);
+    double draw_list_ns = (double)(headless_time_ns() - begin_ns) / draw_list_envs;
+
+    double frames = (double)env_count * steps;
+    printf("%d envs x %d steps, %dx%d x%d stack, %d threads\n", env_count, steps, width, height, stack, thread_count);
+    printf("observations: %.0f ns/frame (%.2f M frames/s), StepGame %.0f ns/env\n",
+           (double)render_ns / frames, frames / ((double)render_ns * 1e-9) / 1e6, (double)step_ns / frames);
+    printf("draw list + framebuffer: %.0f ns/frame\n", draw_list_ns);
+    printf("%d frames with ball/paddle pixel mismatches\n", failures);
+
+    if (dump_path) {
+        FILE* dump = fopen(dump_path, "wb");
+        u8* frames = (u8*)malloc(observation_frame_size(&batch) * stack);
+        if (dump && frames) {
+            copy_observation_stack(&batch, 0, frames);
+            fprintf(dump, "P5\n%d %d\n255\n", width, height * stack);
+            fwrite(frames, 1, observation_frame_size(&batch) * stack, dump);
+        }
+        if (dump) fclose(dump);
+        free(frames);
+    }
+
+    free(draw_list_frame);
+    free_headless_memory(&memory);
+    free_observation_batch(&batch);
+    free(states);
+    free(inputs);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file particle_bench.cpp
+ * @brief Замер системы частиц: шаг StepParticles и отрисовка пакета частиц.
+ *
+ * Перед каждым кадром пул доливается до N частиц снопами из случайных точек арены,
+ * поэтому шаг и отрисовка всегда работают с N живыми частицами. Шаг и отрисовка
+ * (execute_draw_list с одной пакетной командой) замеряются отдельно; печатается медиана
+ * по кадрам, чтобы вытеснение потока не портило замер.
+ *
+ * С -check программа завершается с ненулевым кодом, если медиана шага дольше -budget_us
+ * или медиана отрисовки дольше -render_budget_us. Отрисовка 100 тысяч частиц в 1 мс
+ * не укладывается (см. particles.cpp), поэтому её бюджет задаётся отдельно.
+ *
+ * Использование: particle_bench [-particles N] [-frames N] [-size ширина высота] [-budget_us N]
+ *                               [-render_budget_us N] [-check]
+ */
+
+#include "headless_platform.cpp"
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief Частиц в одном снопе долива.
+ */
+global_variable constexpr int particle_bench_burst = 500;
+
+/**
+ * @brief Медиана замеров (массив переупорядочивается).
+ */
+internal u64
+median_ns(std::vector<u64>* samples) {
+    std::nth_element(samples->begin(), samples->begin() + samples->size() / 2, samples->end());
+    return (*samples)[samples->size() / 2];
+}
+
+int main(int argc, char** argv) {
+    int particle_count = 100000;
+    int frames = 300;
+    int width = 1280, height = 720;
+    int budget_us = 1000;
+    int render_budget_us = 1000;
+    bool check = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-particles") && i + 1 < argc) particle_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-frames") && i + 1 < argc) frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-budget_us") && i + 1 < argc) budget_us = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-render_budget_us") && i + 1 < argc) render_budget_us = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-check")) check = true;
+        else if (!strcmp(argv[i], "-size") && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+    }
+    if (particle_count < 1 || particle_count > kMaxParticles || frames < 1 || width < 16 || height < 16) return EXIT_FAILURE;
+
+    Game_Memory memory;
+    if (!init_headless_memory(&memory, 16 << 20, 1 << 20)) return EXIT_FAILURE;
+    resize_headless_framebuffer(width, height);
+    Particle_System particles;
+    if (!InitParticles(&particles, &memory.permanent, kMaxParticles)) return EXIT_FAILURE;
+
+    const float dt = 1.f / 60.f;
+    std::vector<u64> step_ns, render_ns;
+    for (int frame = 0; frame < frames; frame++) {
+        while (particles.count < particle_count) {
+            float x = ParticleRandom(&particles, -arena_half_size_x, arena_half_size_x);
+            float y = ParticleRandom(&particles, -arena_half_size_y, arena_half_size_y);
+            int burst = std::min(particle_bench_burst, particle_count - particles.count);
+            EmitParticles(&particles, burst, x, y, 0.f, 6.3f, 60.f, 2.f, 0xffdd55, 0xffffff);
+        }
+
+        u64 begin_ns = headless_time_ns();
+        StepParticles(&particles, dt, arena_half_size_x, arena_half_size_y);
+        step_ns.push_back(headless_time_ns() - begin_ns);
+
+        reset_arena(&memory.transient);
+        Draw_List* list = begin_draw_list(&memory.transient, 4);
+        if (!list) return EXIT_FAILURE;
+        RenderParticles(&particles, list, &memory.transient);
+        clear_screen(0);
+        begin_ns = headless_time_ns();
+        execute_draw_list(list);
+        render_ns.push_back(headless_time_ns() - begin_ns);
+    }
+
+    double step_us = (double)median_ns(&step_ns) * 1e-3;
+    double render_us = (double)median_ns(&render_ns) * 1e-3;
+    printf("%d particles, %dx%d, median of %d frames: step %.1f us (budget %d), render %.1f us (budget %d)\n",
+           particle_count, width, height, frames, step_us, budget_us, render_us, render_budget_us);
+    bool ok = step_us <= budget_us && render_us <= render_budget_us;
+    if (check && !ok) printf("over budget\n");
+    free_headless_memory(&memory);
+    return check && !ok ? EXIT_FAILURE : EXIT_SUCCESS;
+}
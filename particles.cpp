@@ -0,0 +1,229 @@
+/**
+ * @file particles.cpp
+ * @brief Система частиц для эффектов: удар по ракетке, отскок от стенки, гол.
+ *
+ * Частицы лежат в пулах SoA фиксированного размера, выделенных из постоянной арены
+ * один раз. Живые частицы всегда занимают начало пула: умершая частица заменяется
+ * последней (swap-remove), поэтому интеграция идёт по плотным массивам по 4 частицы
+ * за итерацию, а рисуются все частицы одной пакетной командой.
+ *
+ * Бюджет — 1 мс на 100 тысяч частиц. Шаг в него укладывается (около 0.25 мс в
+ * particle_bench), а отрисовка в кадр 1280x720 — нет: около 2.7 мс. Время уходит на запись
+ * пикселей, а не на промахи кэша: раскладка пакета по полосам строк перед заливкой
+ * (попробована) заливку ускоряет меньше, чем стоит сама, поэтому пакет рисуется подряд.
+ */
+
+#include <math.h>
+
+const int kMaxParticles = 131072; /**< Вместимость пула частиц */
+const float kParticleHalfSize = .35f; /**< Половина размера частицы */
+const float kParticleGravity = -60.f; /**< Ускорение частиц по Y */
+const float kParticleDrag = 1.5f; /**< Затухание скорости частиц (1/с) */
+
+/**
+ * @brief Пул частиц (SoA).
+ */
+struct Particle_System {
+    int count; /**< Живых частиц */
+    int capacity; /**< Размер пулов */
+    float *x, *y; /**< Позиции */
+    float *dx, *dy; /**< Скорости */
+    float* life; /**< Оставшееся время жизни в секундах */
+    u32* color; /**< Цвет */
+    u32* dead_mask; /**< Биты частиц, умерших на текущем шаге (по 32 на слово) */
+    u32 random_state; /**< Состояние генератора случайных чисел */
+};
+
+/**
+ * @brief Выделяет пулы частиц из арены.
+ *
+ * @param particles Система частиц.
+ * @param arena Постоянная арена.
+ * @param capacity Максимальное количество частиц.
+ * @return false, если в арене не хватило места (эффекты тогда просто не рисуются).
+ */
+bool InitParticles(Particle_System* particles, Memory_Arena* arena, int capacity) {
+    *particles = Particle_System();
+    particles->random_state = 0x9e3779b9u;
+    size_t mark = arena->used;
+    float** arrays[] = { &particles->x, &particles->y, &particles->dx, &particles->dy, &particles->life };
+    for (float** array : arrays) {
+        *array = (float*)push_size(arena, sizeof(float) * capacity, 64);
+    }
+    particles->color = (u32*)push_size(arena, sizeof(u32) * capacity, 64);
+    particles->dead_mask = (u32*)push_size(arena, sizeof(u32) * (capacity / 32 + 1), 64);
+    if (!particles->life || !particles->color || !particles->dead_mask) {
+        arena->used = mark;
+        *particles = Particle_System();
+        return false;
+    }
+    particles->capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Случайное число в [min, max) (xorshift32).
+ */
+float ParticleRandom(Particle_System* particles, float min, float max) {
+    u32 x = xorshift32(&particles->random_state);
+    return min + (max - min) * (float)(x >> 8) * (1.f / 16777216.f);
+}
+
+/**
+ * @brief Выпускает сноп частиц из точки.
+ *
+ * Направления лежат в секторе шириной spread вокруг направления angle (в радианах).
+ *
+ * @param particles Система частиц.
+ * @param count Количество частиц (сколько поместится).
+ * @param x Координата X точки.
+ * @param y Координата Y точки.
+ * @param angle Среднее направление.
+ * @param spread Ширина сектора.
+ * @param speed Максимальная скорость.
+ * @param life Максимальное время жизни.
+ * @param color_a Один из двух цветов снопа.
+ * @param color_b Другой цвет снопа.
+ */
+void EmitParticles(Particle_System* particles, int count, float x, float y, float angle, float spread,
+                   float speed, float life, u32 color_a, u32 color_b) {
+    if (count > particles->capacity - particles->count) count = particles->capacity - particles->count;
+    for (int n = 0; n < count; n++) {
+        int i = particles->count++;
+        float direction = angle + ParticleRandom(particles, -.5f, .5f) * spread;
+        float v = ParticleRandom(particles, .2f, 1.f) * speed;
+        particles->x[i] = x;
+        particles->y[i] = y;
+        particles->dx[i] = cosf(direction) * v;
+        particles->dy[i] = sinf(direction) * v;
+        particles->life[i] = ParticleRandom(particles, .3f, 1.f) * life;
+        particles->color[i] = n & 1 ? color_a : color_b;
+    }
+}
+
+/**
+ * @brief Выпускает частицы для событий последнего шага симуляции.
+ *
+ * Частицы живут в координатах экрана, поэтому места событий переводятся через GameViewScale.
+ */
+void EmitGameEventParticles(Particle_System* particles, const Game_State* state) {
+    const float pi = 3.14159265f;
+    float view = GameViewScale(state);
+    for (int i = 0; i < state->event_count; i++) {
+        const Game_Event* event = state->events + i;
+        float x = event->x * view, y = event->y * view;
+        switch (event->kind) {
+        case kEventPaddleHit: {
+            // Сноп летит вслед за отбитым мячом.
+            float angle = event->player == 1 ? pi : 0.f;
+            EmitParticles(particles, 400, x, y, angle, 1.6f, 90.f, .6f, 0xff0000, 0xffffff);
+        } break;
+
+        case kEventWallBounce: {
+            float angle = y > 0 ? -pi * .5f : pi * .5f;
+            EmitParticles(particles, 150, x, y, angle, 2.4f, 50.f, .4f, 0xffdd55, 0xffffff);
+        } break;
+
+        case kEventGoal: {
+            float angle = x > 0 ? pi : 0.f;
+            EmitParticles(particles, 3000, x, y, angle, pi, 140.f, 1.2f, 0xbbffbb, 0x55ff55);
+        } break;
+
+        case kEventModeChange: break;
+        }
+    }
+}
+
+/**
+ * @brief Проверяет, умерла ли частица или вылетела за арену с половинами размеров half_x, half_y.
+ */
+inline bool IsParticleDead(const Particle_System* particles, int i, float half_x, float half_y) {
+    return particles->life[i] <= 0 ||
+           particles->x[i] < -half_x || particles->x[i] > half_x ||
+           particles->y[i] < -half_y || particles->y[i] > half_y;
+}
+
+/**
+ * @brief Двигает частицы и удаляет умершие и вылетевшие за арену.
+ *
+ * Проход интеграции заодно отмечает умершие частицы в битовой маске. Затем они
+ * удаляются swap-remove от старших индексов к младшим: к этому моменту все умершие
+ * частицы с большими индексами уже удалены, поэтому последняя частица всегда живая.
+ *
+ * @param particles Система частиц.
+ * @param dt Время, прошедшее с последнего шага симуляции.
+ * @param half_x, half_y Половины размеров арены в координатах частиц (экрана): вылетевшие за неё удаляются.
+ */
+void StepParticles(Particle_System* particles, float dt, float half_x, float half_y) {
+    float drag = 1.f - kParticleDrag * dt;
+    int n = particles->count;
+    if (!n) return;
+    u32* dead_mask = particles->dead_mask;
+    memset(dead_mask, 0, sizeof(u32) * (n / 32 + 1));
+    int i = 0;
+#ifdef SIMD_SSE2
+    __m128 step = _mm_set1_ps(dt);
+    __m128 drag4 = _mm_set1_ps(drag);
+    __m128 gravity = _mm_set1_ps(kParticleGravity * dt);
+    __m128 zero = _mm_setzero_ps();
+    __m128 max_x = _mm_set1_ps(half_x), min_x = _mm_set1_ps(-half_x);
+    __m128 max_y = _mm_set1_ps(half_y), min_y = _mm_set1_ps(-half_y);
+    for (; i + 4 <= n; i += 4) {
+        __m128 dx = _mm_mul_ps(_mm_load_ps(particles->dx + i), drag4);
+        __m128 dy = _mm_add_ps(_mm_mul_ps(_mm_load_ps(particles->dy + i), drag4), gravity);
+        __m128 x = _mm_add_ps(_mm_load_ps(particles->x + i), _mm_mul_ps(dx, step));
+        __m128 y = _mm_add_ps(_mm_load_ps(particles->y + i), _mm_mul_ps(dy, step));
+        __m128 life = _mm_sub_ps(_mm_load_ps(particles->life + i), step);
+        _mm_store_ps(particles->x + i, x);
+        _mm_store_ps(particles->y + i, y);
+        _mm_store_ps(particles->dx + i, dx);
+        _mm_store_ps(particles->dy + i, dy);
+        _mm_store_ps(particles->life + i, life);
+
+        __m128 dead = _mm_or_ps(_mm_cmple_ps(life, zero),
+                                _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(x, min_x), _mm_cmpgt_ps(x, max_x)),
+                                          _mm_or_ps(_mm_cmplt_ps(y, min_y), _mm_cmpgt_ps(y, max_y))));
+        // i кратно 4, поэтому 4 бита группы не пересекают границу слова.
+        dead_mask[i / 32] |= (u32)_mm_movemask_ps(dead) << (i % 32);
+    }
+#endif
+    for (; i < n; i++) {
+        particles->dx[i] *= drag;
+        particles->dy[i] = particles->dy[i] * drag + kParticleGravity * dt;
+        particles->x[i] += particles->dx[i] * dt;
+        particles->y[i] += particles->dy[i] * dt;
+        particles->life[i] -= dt;
+        if (IsParticleDead(particles, i, half_x, half_y)) dead_mask[i / 32] |= 1u << (i % 32);
+    }
+
+    for (int word = (n - 1) / 32; word >= 0; word--) {
+        for (u32 bits = dead_mask[word]; bits;) {
+            int bit = 31;
+            while (!(bits & (1u << bit))) bit--;
+            bits &= ~(1u << bit);
+
+            int dead = word * 32 + bit;
+            n--;
+            particles->x[dead] = particles->x[n];
+            particles->y[dead] = particles->y[n];
+            particles->dx[dead] = particles->dx[n];
+            particles->dy[dead] = particles->dy[n];
+            particles->life[dead] = particles->life[n];
+            particles->color[dead] = particles->color[n];
+        }
+    }
+    particles->count = n;
+}
+
+/**
+ * @brief Добавляет все живые частицы в список отрисовки одной пакетной командой.
+ *
+ * @param particles Система частиц.
+ * @param list Список отрисовки кадра.
+ * @param arena Временная арена кадра.
+ */
+void RenderParticles(const Particle_System* particles, Draw_List* list, Memory_Arena* arena) {
+    if (!particles->count) return;
+    push_rect_batch(list, arena, particles->x, particles->y, particles->color, particles->count,
+                    kParticleHalfSize, kParticleHalfSize, 0xffffff);
+}
@@ -24,6 +24,8 @@ enum {
     BUTTON_LEFT, /**< Кнопка "Влево". */
     BUTTON_RIGHT, /**< Кнопка "Вправо". */
     BUTTON_ENTER, /**< Кнопка "Enter". */
+    BUTTON_ESC, /**< Кнопка "Esc". */
+    BUTTON_BACKSPACE, /**< Кнопка "Backspace" (перемотка матча назад, пока зажата). */
 
     BUTTON_COUNT, /**< Количество кнопок. */
 };
@@ -34,4 +36,33 @@ enum {
  */
 struct Input {
     Button_State buttons[BUTTON_COUNT]; /**< Массив состояний кнопок. */
+    float paddle_axis[2]; /**< Аналоговое управление первой и второй ракетками от -1 до 1 (боты); складывается с кнопками. */
 };
+
+/**
+ * @struct Game_Memory
+ * @brief Память, которую платформенный слой резервирует при запуске и передаёт игре.
+ */
+struct Game_Memory {
+    Memory_Arena permanent; /**< Живёт всё время работы и целиком принадлежит игре: состояние игры в начале арены. */
+    Memory_Arena transient; /**< Данные одного кадра: сбрасывается перед каждым кадром. */
+};
+
+/**
+ * @brief Управляет вторым игроком (кнопки W/S) вместо человека.
+ *
+ * Нажимает W или S, пока ракетка не окажется напротив мяча.
+ *
+ * @param input Ввод, в который записываются нажатия.
+ * @param ball_y Координата Y мяча.
+ * @param paddle_y Координата Y ракетки второго игрока.
+ */
+internal void
+autopilot_input(Input* input, float ball_y, float paddle_y) {
+    bool up = ball_y > paddle_y + 2.f;
+    bool down = ball_y < paddle_y - 2.f;
+    input->buttons[BUTTON_W].changed = input->buttons[BUTTON_W].is_down != up;
+    input->buttons[BUTTON_W].is_down = up;
+    input->buttons[BUTTON_S].changed = input->buttons[BUTTON_S].is_down != down;
+    input->buttons[BUTTON_S].is_down = down;
+}
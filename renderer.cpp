@@ -3,6 +3,11 @@
  * @brief Реализация функции для работы с экраном.
  */
 
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
 /**
  * @brief Заполняет весь экран (или область памяти, представляющую экран) заданным цветом.
  * 
@@ -14,6 +19,7 @@
  */
 internal void
 clear_screen(u32 color) {
+  PROFILE_ZONE("clear_screen");
   unsigned int* pixel = (u32*)render_state.memory;
   for (int y = 0; y < render_state.height; y++) {
     for (int x = 0; x < render_state.width; x++) {
@@ -63,12 +69,77 @@ internal void draw_rect_in_pixels(int x0, int y0, int x1, int y1, u32 color) {
  */
 global_variable float render_scale = 0.01f;
 
+/**
+ * @struct Render_Viewport
+ * @brief Область буфера кадра со своим преобразованием логических координат в пиксели.
+ *
+ * Всё, что рисуется в области, обрезается по её прямоугольнику, поэтому области разных
+ * матчей можно рисовать одновременно из разных потоков.
+ */
+struct Render_Viewport {
+  int x0, y0, x1, y1; /**< Прямоугольник обрезки в пикселях: [x0, x1) x [y0, y1). */
+  float scale; /**< Пикселей на логическую единицу. */
+  float center_x, center_y; /**< Пиксель логического начала координат. */
+};
+
+/**
+ * @brief Область во весь кадр с глобальным масштабом render_scale (обычный кадр игры).
+ */
+inline Render_Viewport
+screen_viewport() {
+  Render_Viewport viewport;
+  viewport.x0 = 0;
+  viewport.y0 = 0;
+  viewport.x1 = render_state.width;
+  viewport.y1 = render_state.height;
+  viewport.scale = render_state.height * render_scale;
+  viewport.center_x = render_state.width / 2.f;
+  viewport.center_y = render_state.height / 2.f;
+  return viewport;
+}
+
+/**
+ * @brief Заливает прямоугольник в пикселях, обрезанный по области.
+ */
+internal void
+draw_rect_in_viewport_pixels(const Render_Viewport* viewport, int x0, int y0, int x1, int y1, u32 color) {
+  x0 = clamp(viewport->x0, x0, viewport->x1);
+  x1 = clamp(viewport->x0, x1, viewport->x1);
+  y0 = clamp(viewport->y0, y0, viewport->y1);
+  y1 = clamp(viewport->y0, y1, viewport->y1);
+
+  int width = render_state.width;
+  u32* row = (u32*)render_state.memory + x0 + (size_t)y0 * width;
+  for (int y = y0; y < y1; y++, row += width) {
+    for (int x = 0; x < x1 - x0; x++) row[x] = color;
+  }
+}
+
 
 /**
  * @file render.cpp
  * @brief Реализация функций для работы с экраном.
  */
 
+/**
+ * @brief Заливает часть области вокруг арены (аналог draw_arena_borders в области).
+ */
+internal void
+draw_arena_borders_in_viewport(const Render_Viewport* viewport, float arena_x, float arena_y, u32 color) {
+  arena_x *= viewport->scale;
+  arena_y *= viewport->scale;
+
+  int x0 = (int)(viewport->center_x - arena_x);
+  int x1 = (int)(viewport->center_x + arena_x);
+  int y0 = (int)(viewport->center_y - arena_y);
+  int y1 = (int)(viewport->center_y + arena_y);
+
+  draw_rect_in_viewport_pixels(viewport, viewport->x0, viewport->y0, viewport->x1, y0, color);
+  draw_rect_in_viewport_pixels(viewport, viewport->x0, y1, x1, viewport->y1, color);
+  draw_rect_in_viewport_pixels(viewport, viewport->x0, y0, x0, y1, color);
+  draw_rect_in_viewport_pixels(viewport, x1, y0, viewport->x1, viewport->y1, color);
+}
+
 /**
  * @brief Рисует границы арены на экране с заданным цветом.
  * 
@@ -82,18 +153,22 @@ global_variable float render_scale = 0.01f;
  * @return void Функция не возвращает значения.
  */
 internal void draw_arena_borders(float arena_x, float arena_y, u32 color) {
-  arena_x *= render_state.height * render_scale;
-  arena_y *= render_state.height * render_scale;
-
-  int x0 = (int)((float)render_state.width * .5f - arena_x);
-  int x1 = (int)((float)render_state.width * .5f + arena_x);
-  int y0 = (int)((float)render_state.height * .5f - arena_y);
-  int y1 = (int)((float)render_state.height * .5f + arena_y);
+  PROFILE_ZONE("draw_arena_borders");
+  Render_Viewport viewport = screen_viewport();
+  draw_arena_borders_in_viewport(&viewport, arena_x, arena_y, color);
+}
 
-  draw_rect_in_pixels(0, 0, render_state.width, y0, color);
-  draw_rect_in_pixels(0, y1, x1, render_state.height, color);
-  draw_rect_in_pixels(0, y0, x0, y1, color);
-  draw_rect_in_pixels(x1, y0, render_state.width, render_state.height, color);
+/**
+ * @brief Рисует прямоугольник в логических координатах области (аналог draw_rect).
+ */
+internal void
+draw_rect_in_viewport(const Render_Viewport* viewport, float x, float y, float half_size_x, float half_size_y, u32 color) {
+  x = x * viewport->scale + viewport->center_x;
+  y = y * viewport->scale + viewport->center_y;
+  half_size_x *= viewport->scale;
+  half_size_y *= viewport->scale;
+  draw_rect_in_viewport_pixels(viewport, (int)(x - half_size_x), (int)(y - half_size_y), (int)(x + half_size_x),
+                               (int)(y + half_size_y), color);
 }
 
 /**
@@ -111,24 +186,944 @@ internal void draw_arena_borders(float arena_x, float arena_y, u32 color) {
  * @return void Функция не возвращает значения.
  */
 internal void draw_rect(float x, float y, float half_size_x, float half_size_y, u32 color) {
+  Render_Viewport viewport = screen_viewport();
+  draw_rect_in_viewport(&viewport, x, y, half_size_x, half_size_y, color);
+}
+
+/**
+ * @brief Рисует много одинаковых прямоугольников области за один вызов.
+ * 
+ * Результат совпадает с вызовом draw_rect_in_viewport для каждого прямоугольника, но масштаб
+ * и смещение считаются один раз на весь пакет.
+ * 
+ * @param viewport Область.
+ * @param xs Координаты X центров в логических единицах.
+ * @param ys Координаты Y центров в логических единицах.
+ * @param colors Цвет каждого прямоугольника или 0, если у всех цвет color.
+ * @param count Количество прямоугольников.
+ * @param half_size_x Половина ширины в логических единицах.
+ * @param half_size_y Половина высоты в логических единицах.
+ * @param color Цвет прямоугольников.
+ * 
+ * @return void Функция не возвращает значения.
+ */
+internal void draw_rect_batch_in_viewport(const Render_Viewport* viewport, const float* xs, const float* ys, const u32* colors, int count,
+                                         float half_size_x, float half_size_y, u32 color) {
+  float scale = viewport->scale;
+  float offset_x = viewport->center_x;
+  float offset_y = viewport->center_y;
+  half_size_x *= scale;
+  half_size_y *= scale;
+
+  // Размеры и адрес буфера в локальных переменных: запись пикселя через u32* может
+  // совпасть по адресу с полями render_state, и в общем цикле компилятор перечитывал бы их.
+  int width = render_state.width;
+  int clip_x0 = viewport->x0, clip_x1 = viewport->x1;
+  int clip_y0 = viewport->y0, clip_y1 = viewport->y1;
+  u32* memory = (u32*)render_state.memory;
+
+  for (int i = 0; i < count; i++) {
+    float x = xs[i] * scale + offset_x;
+    float y = ys[i] * scale + offset_y;
+    int x0 = clamp(clip_x0, (int)(x - half_size_x), clip_x1);
+    int x1 = clamp(clip_x0, (int)(x + half_size_x), clip_x1);
+    int y0 = clamp(clip_y0, (int)(y - half_size_y), clip_y1);
+    int y1 = clamp(clip_y0, (int)(y + half_size_y), clip_y1);
+    u32 rect_color = colors ? colors[i] : color;
+
+    u32* row = memory + x0 + (size_t)y0 * width;
+    int row_width = x1 - x0;
+#ifdef SIMD_SSE2
+    // Узкие прямоугольники (4..8 пикселей) — две перекрывающиеся 16-байтные записи на строку.
+    if (row_width >= 4 && row_width <= 8) {
+      __m128i fill = _mm_set1_epi32((int)rect_color);
+      for (int py = y0; py < y1; py++, row += width) {
+        _mm_storeu_si128((__m128i*)row, fill);
+        _mm_storeu_si128((__m128i*)(row + row_width - 4), fill);
+      }
+      continue;
+    }
+#endif
+    for (int py = y0; py < y1; py++, row += width) {
+      for (int px = 0; px < row_width; px++) row[px] = rect_color;
+    }
+  }
+}
+
+/**
+ * @brief Рисует много одинаковых прямоугольников во весь кадр (см. draw_rect_batch_in_viewport).
+ */
+internal void draw_rect_batch(const float* xs, const float* ys, const u32* colors, int count, float half_size_x, float half_size_y, u32 color) {
+  PROFILE_ZONE("draw_rect_batch");
+  Render_Viewport viewport = screen_viewport();
+  draw_rect_batch_in_viewport(&viewport, xs, ys, colors, count, half_size_x, half_size_y, color);
+}
+
+/**
+ * @struct Sprite
+ * @brief Изображение для отрисовки поверх кадра.
+ *
+ * Пиксели в формате буфера кадра (0xAARRGGBB) с premultiplied alpha,
+ * строки идут снизу вверх, как и в буфере кадра.
+ */
+struct Sprite {
+  int width, height; /**< Размер в пикселях. */
+  u32* pixels; /**< Пиксели или 0, если спрайт не загружен. */
+};
+
+/**
+ * @brief Режимы вывода спрайта.
+ */
+enum {
+  SPRITE_OPAQUE, /**< Копирование пикселей без учёта альфы. */
+  SPRITE_BLEND, /**< Смешивание с premultiplied alpha: dst = src + dst * (1 - a). */
+  SPRITE_TINT, /**< Умножение цветов спрайта на цвет tint, затем смешивание. */
+};
+
+/**
+ * @brief Максимальная ширина и высота спрайта, а также ширина строки вывода.
+ */
+global_variable constexpr int max_sprite_size = 8192;
+
+/**
+ * @brief Точное округлённое a * b / 255 для a, b из [0, 255].
+ */
+inline u32 mul_div255(u32 a, u32 b) {
+  u32 t = a * b + 128;
+  return (t + (t >> 8)) >> 8;
+}
+
+/**
+ * @brief Загружает несжатый TGA (тип 2, 24 или 32 бита на пиксель) в арену.
+ *
+ * Альфа переводится в premultiplied, строки раскладываются снизу вверх.
+ * Если файл не подошёл, арена возвращается в прежнее состояние.
+ *
+ * @param arena Арена для пикселей.
+ * @param path Путь к файлу.
+ * @param sprite Спрайт, который нужно заполнить.
+ *
+ * @return false, если файл не найден, повреждён или в арене нет места.
+ */
+internal bool
+load_tga_file(Memory_Arena* arena, const char* path, Sprite* sprite) {
+  FILE* file = fopen(path, "rb");
+  if (!file) return false;
+
+  u8 header[18] = {};
+  bool ok = fread(header, 1, sizeof(header), file) == sizeof(header);
+  int width = header[12] | header[13] << 8;
+  int height = header[14] | header[15] << 8;
+  int bytes_per_pixel = header[16] / 8;
+  bool top_down = (header[17] & 0x20) != 0;
+  ok = ok && header[1] == 0 && header[2] == 2 && (header[16] == 24 || header[16] == 32);
+  ok = ok && width > 0 && height > 0 && width <= max_sprite_size && height <= max_sprite_size;
+  ok = ok && fseek(file, header[0], SEEK_CUR) == 0;
+
+  size_t mark = arena->used;
+  u32* pixels = ok ? push_array(arena, (size_t)width * height, u32) : 0;
+  u8 row[max_sprite_size * 4];
+  for (int y = 0; pixels && y < height; y++) {
+    if (fread(row, bytes_per_pixel, width, file) != (size_t)width) {
+      pixels = 0;
+      break;
+    }
+    u32* dst = pixels + (size_t)(top_down ? height - 1 - y : y) * width;
+    for (int x = 0; x < width; x++) {
+      const u8* p = row + x * bytes_per_pixel;
+      u32 a = bytes_per_pixel == 4 ? p[3] : 255;
+      dst[x] = a << 24 | mul_div255(p[2], a) << 16 | mul_div255(p[1], a) << 8 | mul_div255(p[0], a);
+    }
+  }
+  fclose(file);
+
+  if (!pixels) {
+    arena->used = mark;
+    return false;
+  }
+  sprite->width = width;
+  sprite->height = height;
+  sprite->pixels = pixels;
+  return true;
+}
+
+/**
+ * @brief Выводит строку пикселей без SIMD. Эталон для векторных версий: результат побитово совпадает.
+ *
+ * @param dst Пиксели буфера кадра.
+ * @param src Пиксели спрайта.
+ * @param count Количество пикселей.
+ * @param mode SPRITE_*.
+ * @param tint Цвет для SPRITE_TINT.
+ */
+internal void
+blit_row_scalar(u32* dst, const u32* src, int count, u32 mode, u32 tint) {
+  u32 tint_r = (tint >> 16) & 0xff, tint_g = (tint >> 8) & 0xff, tint_b = tint & 0xff;
+  for (int i = 0; i < count; i++) {
+    u32 s = src[i];
+    if (mode != SPRITE_OPAQUE && !s) continue;
+    if (mode == SPRITE_TINT) {
+      s = (s & 0xff000000) | mul_div255((s >> 16) & 0xff, tint_r) << 16 |
+          mul_div255((s >> 8) & 0xff, tint_g) << 8 | mul_div255(s & 0xff, tint_b);
+    }
+    if (mode == SPRITE_OPAQUE || (s >> 24) == 255) {
+      dst[i] = s;
+      continue;
+    }
+    u32 inverse_alpha = 255 - (s >> 24);
+    u32 d = dst[i];
+    u32 result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+      u32 channel = ((s >> shift) & 0xff) + mul_div255((d >> shift) & 0xff, inverse_alpha);
+      result |= (channel > 255 ? 255 : channel) << shift;
+    }
+    dst[i] = result;
+  }
+}
 
-  x *= render_state.height * render_scale;
-  y *= render_state.height * render_scale;
-  half_size_x *= render_state.height * render_scale;
-  half_size_y *= render_state.height * render_scale;
+#ifdef SIMD_SSE2
+/**
+ * @brief a * b / 255 с округлением для 16-битных каналов (на входе произведение a * b).
+ */
+inline __m128i div255_epu16_sse2(__m128i product) {
+  __m128i t = _mm_add_epi16(product, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
 
-  x += render_state.width / 2.f;
-  y += render_state.height / 2.f;
+/**
+ * @brief Умножает каналы 4 пикселей на tint16 (каналы b, g, r, a в 16-битных словах).
+ */
+inline __m128i tint_pixels_sse2(__m128i s, __m128i tint16) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = div255_epu16_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), tint16));
+  __m128i hi = div255_epu16_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), tint16));
+  return _mm_packus_epi16(lo, hi);
+}
 
-  // Преобразование в пиксели
-  int x0 = x - half_size_x;
-  int x1 = x + half_size_x;
-  int y0 = y - half_size_y;
-  int y1 = y + half_size_y;
+/**
+ * @brief Смешивает 4 пикселя спрайта с 4 пикселями кадра (premultiplied alpha).
+ */
+inline __m128i blend_pixels_sse2(__m128i s, __m128i d) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i full = _mm_set1_epi16(255);
+  __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+  __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+  __m128i inverse_lo = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, 0xff), 0xff));
+  __m128i inverse_hi = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, 0xff), 0xff));
+  __m128i d_lo = div255_epu16_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inverse_lo));
+  __m128i d_hi = div255_epu16_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inverse_hi));
+  return _mm_adds_epu8(s, _mm_packus_epi16(d_lo, d_hi));
+}
 
-  draw_rect_in_pixels(x0, y0, x1, y1, color);
+/**
+ * @brief Выводит строку пикселей по 4 за итерацию (SSE2).
+ */
+internal void
+blit_row_sse2(u32* dst, const u32* src, int count, u32 mode, u32 tint) {
+  __m128i tint16 = _mm_set_epi16(255, (tint >> 16) & 0xff, (tint >> 8) & 0xff, tint & 0xff,
+                                 255, (tint >> 16) & 0xff, (tint >> 8) & 0xff, tint & 0xff);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+    if (mode != SPRITE_OPAQUE) {
+      // Полностью прозрачные и полностью непрозрачные группы (большая часть спрайта) не смешиваются.
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, _mm_setzero_si128())) == 0xffff) continue;
+      bool opaque = (_mm_movemask_epi8(_mm_cmpeq_epi8(s, _mm_set1_epi8(-1))) & 0x8888) == 0x8888;
+      if (mode == SPRITE_TINT) s = tint_pixels_sse2(s, tint16);
+      if (!opaque) s = blend_pixels_sse2(s, _mm_loadu_si128((const __m128i*)(dst + i)));
+    }
+    _mm_storeu_si128((__m128i*)(dst + i), s);
+  }
+  blit_row_scalar(dst + i, src + i, count - i, mode, tint);
 }
+#endif
 
+#ifdef SIMD_AVX2
+/**
+ * @brief AVX2-версия div255_epu16_sse2.
+ */
+TARGET_AVX2 inline __m256i div255_epu16_avx2(__m256i product) {
+  __m256i t = _mm256_add_epi16(product, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+/**
+ * @brief AVX2-версия tint_pixels_sse2 (8 пикселей).
+ */
+TARGET_AVX2 inline __m256i tint_pixels_avx2(__m256i s, __m256i tint16) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i lo = div255_epu16_avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), tint16));
+  __m256i hi = div255_epu16_avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), tint16));
+  return _mm256_packus_epi16(lo, hi);
+}
+
+/**
+ * @brief AVX2-версия blend_pixels_sse2 (8 пикселей).
+ *
+ * Распаковка и упаковка работают внутри 128-битных половин, поэтому порядок пикселей сохраняется.
+ */
+TARGET_AVX2 inline __m256i blend_pixels_avx2(__m256i s, __m256i d) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i full = _mm256_set1_epi16(255);
+  __m256i s_lo = _mm256_unpacklo_epi8(s, zero);
+  __m256i s_hi = _mm256_unpackhi_epi8(s, zero);
+  __m256i inverse_lo = _mm256_sub_epi16(full, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_lo, 0xff), 0xff));
+  __m256i inverse_hi = _mm256_sub_epi16(full, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_hi, 0xff), 0xff));
+  __m256i d_lo = div255_epu16_avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inverse_lo));
+  __m256i d_hi = div255_epu16_avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inverse_hi));
+  return _mm256_adds_epu8(s, _mm256_packus_epi16(d_lo, d_hi));
+}
+
+/**
+ * @brief Выводит строку пикселей по 8 за итерацию (AVX2).
+ */
+internal TARGET_AVX2 void
+blit_row_avx2(u32* dst, const u32* src, int count, u32 mode, u32 tint) {
+  __m256i tint16 = _mm256_set_epi16(255, (tint >> 16) & 0xff, (tint >> 8) & 0xff, tint & 0xff,
+                                    255, (tint >> 16) & 0xff, (tint >> 8) & 0xff, tint & 0xff,
+                                    255, (tint >> 16) & 0xff, (tint >> 8) & 0xff, tint & 0xff,
+                                    255, (tint >> 16) & 0xff, (tint >> 8) & 0xff, tint & 0xff);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+    if (mode != SPRITE_OPAQUE) {
+      if (_mm256_testz_si256(s, s)) continue;
+      bool opaque = ((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(s, _mm256_set1_epi8(-1))) & 0x88888888u) == 0x88888888u;
+      if (mode == SPRITE_TINT) s = tint_pixels_avx2(s, tint16);
+      if (!opaque) s = blend_pixels_avx2(s, _mm256_loadu_si256((const __m256i*)(dst + i)));
+    }
+    _mm256_storeu_si256((__m256i*)(dst + i), s);
+  }
+  // Остаток доделывает SSE2-код без VEX-префикса: сначала обнуляем верхние половины регистров,
+  // иначе каждая его инструкция платит за смешение состояний AVX и SSE.
+  _mm256_zeroupper();
+  blit_row_sse2(dst + i, src + i, count - i, mode, tint);
+}
+#endif
+
+/**
+ * @brief Уровень векторных инструкций для вывода спрайтов: 0 — без SIMD, 1 — SSE2, 2 — AVX2.
+ *
+ * Определяется по процессору при запуске; тесты и замеры могут понизить его вручную.
+ */
+global_variable int blit_simd_level =
+#if defined(SIMD_AVX2)
+  cpu_has_avx2() ? 2 : 1;
+#elif defined(SIMD_SSE2)
+  1;
+#else
+  0;
+#endif
+
+/**
+ * @brief Выводит строку пикселей лучшим доступным набором инструкций.
+ */
+internal void
+blit_row(u32* dst, const u32* src, int count, u32 mode, u32 tint) {
+#ifdef SIMD_AVX2
+  if (blit_simd_level >= 2) {
+    blit_row_avx2(dst, src, count, mode, tint);
+    return;
+  }
+#endif
+#ifdef SIMD_SSE2
+  if (blit_simd_level >= 1) {
+    blit_row_sse2(dst, src, count, mode, tint);
+    return;
+  }
+#endif
+  blit_row_scalar(dst, src, count, mode, tint);
+}
+
+/**
+ * @brief Рисует спрайт, растянутый на прямоугольник в пикселях.
+ *
+ * Выборка — по ближайшему пикселю, прямоугольник обрезается по области.
+ * Если спрайт растянут, строка спрайта масштабируется один раз во временный буфер
+ * и переиспользуется для всех строк кадра, на которые она попадает.
+ *
+ * @param viewport Область обрезки.
+ * @param sprite Спрайт.
+ * @param x0 Координата X левого нижнего угла.
+ * @param y0 Координата Y левого нижнего угла.
+ * @param x1 Координата X правого верхнего угла (не включительно).
+ * @param y1 Координата Y правого верхнего угла (не включительно).
+ * @param mode SPRITE_*.
+ * @param tint Цвет для SPRITE_TINT.
+ */
+internal void
+draw_sprite_in_pixels(const Render_Viewport* viewport, const Sprite* sprite, int x0, int y0, int x1, int y1, u32 mode, u32 tint) {
+  if (!sprite->pixels || x1 <= x0 || y1 <= y0) return;
+
+  // Шаги выборки в формате 16.16, выборка по центрам пикселей.
+  u64 step_u = ((u64)sprite->width << 16) / (u64)(x1 - x0);
+  u64 step_v = ((u64)sprite->height << 16) / (u64)(y1 - y0);
+
+  int clip_x0 = clamp(viewport->x0, x0, viewport->x1);
+  int clip_x1 = clamp(viewport->x0, x1, viewport->x1);
+  int clip_y0 = clamp(viewport->y0, y0, viewport->y1);
+  int clip_y1 = clamp(viewport->y0, y1, viewport->y1);
+  int count = clip_x1 - clip_x0;
+  if (count > max_sprite_size) count = max_sprite_size;
+  if (count <= 0 || clip_y1 <= clip_y0) return;
+
+  u32 scaled_row[max_sprite_size];
+  int scaled_v = -1;
+  u64 u0 = (u64)(clip_x0 - x0) * step_u + step_u / 2;
+  bool unscaled = step_u == (1 << 16);
+
+  for (int y = clip_y0; y < clip_y1; y++) {
+    int v = (int)(((u64)(y - y0) * step_v + step_v / 2) >> 16);
+    if (v >= sprite->height) v = sprite->height - 1;
+    const u32* source = sprite->pixels + (size_t)v * sprite->width;
+
+    if (unscaled) {
+      source += u0 >> 16;
+    } else {
+      if (v != scaled_v) {
+        u64 u = u0;
+        for (int i = 0; i < count; i++, u += step_u) {
+          u64 column = u >> 16;
+          scaled_row[i] = source[column < (u64)sprite->width ? column : sprite->width - 1];
+        }
+        scaled_v = v;
+      }
+      source = scaled_row;
+    }
+
+    blit_row((u32*)render_state.memory + clip_x0 + (size_t)y * render_state.width, source, count, mode, tint);
+  }
+}
+
+/**
+ * @brief Рисует спрайт, растянутый на прямоугольник в логических координатах области.
+ *
+ * Прямоугольник переводится в пиксели так же, как в draw_rect_in_viewport.
+ *
+ * @param viewport Область.
+ * @param sprite Спрайт.
+ * @param x Координата X центра в логических единицах.
+ * @param y Координата Y центра в логических единицах.
+ * @param half_size_x Половина ширины в логических единицах.
+ * @param half_size_y Половина высоты в логических единицах.
+ * @param mode SPRITE_*.
+ * @param tint Цвет для SPRITE_TINT.
+ */
+internal void
+draw_sprite_in_viewport(const Render_Viewport* viewport, const Sprite* sprite, float x, float y, float half_size_x,
+                        float half_size_y, u32 mode, u32 tint) {
+  x = x * viewport->scale + viewport->center_x;
+  y = y * viewport->scale + viewport->center_y;
+  half_size_x *= viewport->scale;
+  half_size_y *= viewport->scale;
+
+  draw_sprite_in_pixels(viewport, sprite, (int)(x - half_size_x), (int)(y - half_size_y),
+                        (int)(x + half_size_x), (int)(y + half_size_y), mode, tint);
+}
+
+/**
+ * @brief Рисует спрайт во весь кадр (см. draw_sprite_in_viewport).
+ */
+internal void
+draw_sprite(const Sprite* sprite, float x, float y, float half_size_x, float half_size_y, u32 mode, u32 tint) {
+  Render_Viewport viewport = screen_viewport();
+  draw_sprite_in_viewport(&viewport, sprite, x, y, half_size_x, half_size_y, mode, tint);
+}
+
+
+/**
+ * @brief Виды команд списка отрисовки.
+ */
+enum {
+  DRAW_COMMAND_RECT, /**< Прямоугольник в логических координатах (draw_rect). */
+  DRAW_COMMAND_ARENA_BORDERS, /**< Заливка вокруг арены (draw_arena_borders). */
+  DRAW_COMMAND_RECT_BATCH, /**< Много одинаковых прямоугольников (draw_rect_batch). */
+  DRAW_COMMAND_SPRITE, /**< Спрайт в логических координатах (draw_sprite). */
+  DRAW_COMMAND_GLYPH, /**< Пиксель буквы или сегмент цифры (push_text, push_number): рисуется как DRAW_COMMAND_RECT. */
+};
+
+/**
+ * @struct Rect_Batch
+ * @brief Пакет одинаковых прямоугольников: центры в массивах SoA.
+ */
+struct Rect_Batch {
+  const float* xs; /**< Координаты X центров. */
+  const float* ys; /**< Координаты Y центров. */
+  const u32* colors; /**< Цвета или 0, если у всех цвет команды. */
+  int count; /**< Количество прямоугольников. */
+};
+
+/**
+ * @struct Draw_Command
+ * @brief Одна команда отрисовки в логических координатах.
+ */
+struct Draw_Command {
+  u32 kind; /**< DRAW_COMMAND_*. */
+  u32 color; /**< Цвет. */
+  float x, y; /**< Центр (для рамки арены не используется). */
+  float half_size_x, half_size_y; /**< Половины размеров. */
+  const Rect_Batch* batch; /**< Данные пакета для DRAW_COMMAND_RECT_BATCH. */
+  const Sprite* sprite; /**< Спрайт для DRAW_COMMAND_SPRITE; color — цвет tint. */
+  u32 sprite_mode; /**< SPRITE_* для DRAW_COMMAND_SPRITE. */
+};
+
+/**
+ * @struct Draw_List
+ * @brief Список команд одного кадра. Живёт во временной арене и сбрасывается вместе с ней.
+ */
+struct Draw_List {
+  Draw_Command* commands; /**< Команды. */
+  int count; /**< Количество команд. */
+  int capacity; /**< Вместимость. */
+  int overflow; /**< Сколько команд не поместилось. */
+};
+
+/**
+ * @brief Создаёт пустой список отрисовки во временной арене.
+ *
+ * @param arena Временная арена кадра.
+ * @param capacity Максимальное количество команд.
+ *
+ * @return Список или 0, если арена исчерпана.
+ */
+internal Draw_List*
+begin_draw_list(Memory_Arena* arena, int capacity) {
+  Draw_List* list = push_struct(arena, Draw_List);
+  if (!list) return 0;
+  list->commands = push_array(arena, capacity, Draw_Command);
+  list->count = 0;
+  list->capacity = list->commands ? capacity : 0;
+  list->overflow = 0;
+  return list;
+}
+
+/**
+ * @brief Добавляет команду в список. Если места нет, команда отбрасывается и учитывается в overflow.
+ */
+internal void
+push_draw_command(Draw_List* list, u32 kind, float x, float y, float half_size_x, float half_size_y, u32 color) {
+  if (list->count == list->capacity) {
+    list->overflow++;
+    return;
+  }
+  Draw_Command* command = list->commands + list->count++;
+  command->kind = kind;
+  command->color = color;
+  command->x = x;
+  command->y = y;
+  command->half_size_x = half_size_x;
+  command->half_size_y = half_size_y;
+  command->batch = 0;
+  command->sprite = 0;
+  command->sprite_mode = SPRITE_OPAQUE;
+}
+
+/**
+ * @brief Добавляет прямоугольник в список отрисовки (аналог draw_rect).
+ */
+internal void
+push_rect(Draw_List* list, float x, float y, float half_size_x, float half_size_y, u32 color) {
+  push_draw_command(list, DRAW_COMMAND_RECT, x, y, half_size_x, half_size_y, color);
+}
+
+/**
+ * @brief Добавляет прямоугольник текста; отличается от push_rect только видом команды,
+ * чтобы текст считался в профиле отдельно.
+ */
+internal void
+push_glyph(Draw_List* list, float x, float y, float half_size_x, float half_size_y, u32 color) {
+  push_draw_command(list, DRAW_COMMAND_GLYPH, x, y, half_size_x, half_size_y, color);
+}
+
+/**
+ * @brief Добавляет заливку вокруг арены в список отрисовки (аналог draw_arena_borders).
+ */
+internal void
+push_arena_borders(Draw_List* list, float arena_x, float arena_y, u32 color) {
+  push_draw_command(list, DRAW_COMMAND_ARENA_BORDERS, 0, 0, arena_x, arena_y, color);
+}
+
+/**
+ * @brief Добавляет пакет одинаковых прямоугольников одной командой.
+ *
+ * Массивы не копируются и должны жить до execute_draw_list.
+ *
+ * @param list Список отрисовки.
+ * @param arena Временная арена кадра (для описания пакета).
+ * @param xs Координаты X центров.
+ * @param ys Координаты Y центров.
+ * @param colors Цвет каждого прямоугольника или 0, если у всех цвет color.
+ * @param count Количество прямоугольников.
+ * @param half_size_x Половина ширины.
+ * @param half_size_y Половина высоты.
+ * @param color Цвет.
+ */
+internal void
+push_rect_batch(Draw_List* list, Memory_Arena* arena, const float* xs, const float* ys, const u32* colors, int count,
+                float half_size_x, float half_size_y, u32 color) {
+  Rect_Batch* batch = push_struct(arena, Rect_Batch);
+  if (!batch || list->count == list->capacity) {
+    list->overflow++;
+    return;
+  }
+  batch->xs = xs;
+  batch->ys = ys;
+  batch->colors = colors;
+  batch->count = count;
+  push_draw_command(list, DRAW_COMMAND_RECT_BATCH, 0, 0, half_size_x, half_size_y, color);
+  list->commands[list->count - 1].batch = batch;
+}
+
+/**
+ * @brief Добавляет спрайт в список отрисовки (аналог draw_sprite).
+ *
+ * Спрайт не копируется и должен жить до execute_draw_list.
+ */
+internal void
+push_sprite(Draw_List* list, const Sprite* sprite, float x, float y, float half_size_x, float half_size_y,
+            u32 mode, u32 tint) {
+  if (list->count == list->capacity) {
+    list->overflow++;
+    return;
+  }
+  push_draw_command(list, DRAW_COMMAND_SPRITE, x, y, half_size_x, half_size_y, tint);
+  list->commands[list->count - 1].sprite = sprite;
+  list->commands[list->count - 1].sprite_mode = mode;
+}
+
+/**
+ * @brief Рисует все команды списка в render_state по порядку.
+ *
+ * @param list Список отрисовки.
+ */
+internal void
+execute_draw_list(const Draw_List* list) {
+  PROFILE_ZONE("execute_draw_list");
+  // Команды идут сериями одного вида; у каждой серии своя зона профиля.
+  for (int i = 0; i < list->count;) {
+    u32 kind = list->commands[i].kind;
+    int end = i + 1;
+    while (end < list->count && list->commands[end].kind == kind) end++;
+
+    switch (kind) {
+    case DRAW_COMMAND_RECT: {
+      PROFILE_ZONE("draw_rects");
+      for (const Draw_Command* command = list->commands + i; command < list->commands + end; command++) {
+        draw_rect(command->x, command->y, command->half_size_x, command->half_size_y, command->color);
+      }
+    } break;
+
+    case DRAW_COMMAND_GLYPH: {
+      PROFILE_ZONE("draw_glyphs");
+      for (const Draw_Command* command = list->commands + i; command < list->commands + end; command++) {
+        draw_rect(command->x, command->y, command->half_size_x, command->half_size_y, command->color);
+      }
+    } break;
+
+    case DRAW_COMMAND_ARENA_BORDERS: {
+      for (const Draw_Command* command = list->commands + i; command < list->commands + end; command++) {
+        draw_arena_borders(command->half_size_x, command->half_size_y, command->color);
+      }
+    } break;
+
+    case DRAW_COMMAND_RECT_BATCH: {
+      for (const Draw_Command* command = list->commands + i; command < list->commands + end; command++) {
+        draw_rect_batch(command->batch->xs, command->batch->ys, command->batch->colors, command->batch->count,
+                        command->half_size_x, command->half_size_y, command->color);
+      }
+    } break;
+
+    case DRAW_COMMAND_SPRITE: {
+      PROFILE_ZONE("draw_sprites");
+      for (const Draw_Command* command = list->commands + i; command < list->commands + end; command++) {
+        draw_sprite(command->sprite, command->x, command->y, command->half_size_x, command->half_size_y,
+                    command->sprite_mode, command->color);
+      }
+    } break;
+    }
+    i = end;
+  }
+}
+
+/**
+ * @brief Рисует все команды списка в область буфера кадра по порядку.
+ *
+ * Пиксели вне области не меняются, поэтому списки разных областей можно
+ * выполнять одновременно из разных потоков.
+ *
+ * @param list Список отрисовки.
+ * @param viewport Область и её преобразование координат.
+ */
+internal void
+execute_draw_list_in_viewport(const Draw_List* list, const Render_Viewport* viewport) {
+  for (int i = 0; i < list->count; i++) {
+    const Draw_Command* command = list->commands + i;
+    switch (command->kind) {
+    case DRAW_COMMAND_RECT:
+    case DRAW_COMMAND_GLYPH: {
+      draw_rect_in_viewport(viewport, command->x, command->y, command->half_size_x, command->half_size_y, command->color);
+    } break;
+
+    case DRAW_COMMAND_ARENA_BORDERS: {
+      draw_arena_borders_in_viewport(viewport, command->half_size_x, command->half_size_y, command->color);
+    } break;
+
+    case DRAW_COMMAND_RECT_BATCH: {
+      draw_rect_batch_in_viewport(viewport, command->batch->xs, command->batch->ys, command->batch->colors,
+                                  command->batch->count, command->half_size_x, command->half_size_y, command->color);
+    } break;
+
+    case DRAW_COMMAND_SPRITE: {
+      draw_sprite_in_viewport(viewport, command->sprite, command->x, command->y, command->half_size_x,
+                              command->half_size_y, command->sprite_mode, command->color);
+    } break;
+    }
+  }
+}
+
+/**
+ * @struct Pixel_Rect
+ * @brief Прямоугольник в пикселях буфера кадра: [x0, x1) x [y0, y1).
+ */
+struct Pixel_Rect {
+  int x0, y0, x1, y1;
+};
+
+/**
+ * @brief Сколько прямоугольников динамического слоя запоминается поштучно; остальные
+ * восстанавливаются одним общим охватывающим прямоугольником.
+ */
+global_variable constexpr int max_dirty_rects = 4096;
+
+/**
+ * @struct Background_Cache
+ * @brief Растр статического слоя (фон арены и её границы) и места, где прошлый кадр его закрыл.
+ *
+ * Статический слой растеризуется заново только при изменении размера кадра или его команд
+ * (например, цветов темы). В остальных кадрах под прошлыми динамическими объектами
+ * копируется фон из кэша, и работа кадра пропорциональна площади движущихся объектов,
+ * а не площади экрана.
+ */
+struct Background_Cache {
+  u32* pixels; /**< Растр размером с буфер кадра или 0 — кэш отключён, кадр рисуется целиком. */
+  int width, height; /**< Размер, под который растеризован слой. */
+  u64 key; /**< Хеш команд статического слоя. */
+  bool valid; /**< pixels содержит слой, а буфер кадра frame — прошлый кадр поверх него. */
+  const void* frame; /**< Буфер кадра, в который рисовался прошлый кадр. */
+
+  Pixel_Rect dirty[max_dirty_rects]; /**< Прямоугольники, закрытые динамическим слоем прошлого кадра. */
+  int dirty_count; /**< Количество прямоугольников в dirty. */
+  int dirty_overflow; /**< Сколько прямоугольников не поместилось в dirty. */
+  Pixel_Rect dirty_bounds; /**< Охват всех закрытых прямоугольников. */
+  u64 dirty_area; /**< Суммарная площадь прямоугольников dirty в пикселях. */
+};
+
+global_variable Background_Cache background_cache;
+
+/**
+ * @brief Отдаёт кэшу фона память под растр; вызывается платформенным слоем при каждом
+ * изменении размера буфера кадра.
+ *
+ * @param pixels Память на render_state.width * render_state.height пикселей или 0, чтобы отключить кэш.
+ */
+internal void
+set_background_cache_memory(u32* pixels) {
+  background_cache.pixels = pixels;
+  background_cache.valid = false;
+}
+
+/**
+ * @brief Запоминает прямоугольник, который динамический слой закроет в этом кадре.
+ */
+internal void
+mark_dirty_rect(int x0, int y0, int x1, int y1) {
+  Background_Cache* cache = &background_cache;
+  x0 = clamp(0, x0, render_state.width);
+  x1 = clamp(0, x1, render_state.width);
+  y0 = clamp(0, y0, render_state.height);
+  y1 = clamp(0, y1, render_state.height);
+  if (x1 <= x0 || y1 <= y0) return;
+
+  if (cache->dirty_count + cache->dirty_overflow == 0) {
+    cache->dirty_bounds = { x0, y0, x1, y1 };
+  } else {
+    if (x0 < cache->dirty_bounds.x0) cache->dirty_bounds.x0 = x0;
+    if (y0 < cache->dirty_bounds.y0) cache->dirty_bounds.y0 = y0;
+    if (x1 > cache->dirty_bounds.x1) cache->dirty_bounds.x1 = x1;
+    if (y1 > cache->dirty_bounds.y1) cache->dirty_bounds.y1 = y1;
+  }
+  if (cache->dirty_count < max_dirty_rects) {
+    cache->dirty[cache->dirty_count++] = { x0, y0, x1, y1 };
+    cache->dirty_area += (u64)(x1 - x0) * (u64)(y1 - y0);
+  } else {
+    cache->dirty_overflow++;
+  }
+}
+
+/**
+ * @brief Запоминает пиксели, которые закроет команда: те же преобразования, что в draw_rect,
+ * draw_rect_batch и draw_sprite, с запасом в пиксель на округление.
+ */
+internal void
+mark_draw_command_dirty(const Draw_Command* command) {
+  float scale = render_state.height * render_scale;
+  float offset_x = render_state.width / 2.f;
+  float offset_y = render_state.height / 2.f;
+  float half_size_x = command->half_size_x * scale;
+  float half_size_y = command->half_size_y * scale;
+
+  switch (command->kind) {
+  case DRAW_COMMAND_RECT:
+  case DRAW_COMMAND_GLYPH:
+  case DRAW_COMMAND_SPRITE: {
+    float x = command->x * scale + offset_x;
+    float y = command->y * scale + offset_y;
+    mark_dirty_rect((int)(x - half_size_x) - 1, (int)(y - half_size_y) - 1, (int)(x + half_size_x) + 1, (int)(y + half_size_y) + 1);
+  } break;
+
+  case DRAW_COMMAND_RECT_BATCH: {
+    const Rect_Batch* batch = command->batch;
+    if (!batch->count) break;
+    if (batch->count > max_dirty_rects - background_cache.dirty_count) {
+      // Пакет не помещается поштучно (тысячи мячей "хаоса"): запоминается его охват.
+      float min_x = batch->xs[0], max_x = batch->xs[0], min_y = batch->ys[0], max_y = batch->ys[0];
+      for (int i = 1; i < batch->count; i++) {
+        min_x = fminf(min_x, batch->xs[i]);
+        max_x = fmaxf(max_x, batch->xs[i]);
+        min_y = fminf(min_y, batch->ys[i]);
+        max_y = fmaxf(max_y, batch->ys[i]);
+      }
+      mark_dirty_rect((int)(min_x * scale + offset_x - half_size_x) - 1, (int)(min_y * scale + offset_y - half_size_y) - 1,
+                      (int)(max_x * scale + offset_x + half_size_x) + 1, (int)(max_y * scale + offset_y + half_size_y) + 1);
+      break;
+    }
+    for (int i = 0; i < batch->count; i++) {
+      float x = batch->xs[i] * scale + offset_x;
+      float y = batch->ys[i] * scale + offset_y;
+      mark_dirty_rect((int)(x - half_size_x) - 1, (int)(y - half_size_y) - 1, (int)(x + half_size_x) + 1, (int)(y + half_size_y) + 1);
+    }
+  } break;
+
+  default: {
+    mark_dirty_rect(0, 0, render_state.width, render_state.height);
+  } break;
+  }
+}
+
+/**
+ * @brief Хеш команд списка (FNV-1a): меняется вместе с любым параметром статического слоя.
+ */
+internal u64
+draw_list_key(const Draw_List* list) {
+  u64 hash = fnv1a_offset_basis;
+  for (int i = 0; i < list->count; i++) {
+    const Draw_Command* command = list->commands + i;
+    u32 words[6] = { command->kind, command->color, 0, 0, 0, 0 };
+    memcpy(words + 2, &command->x, 4 * sizeof(float));
+    hash = fnv1a_64(words, sizeof(words), hash);
+    // Пакеты и спрайты в статическом слое хешируются по адресу: их содержимое не сравнивается.
+    u64 pointers = (u64)(uintptr_t)command->batch ^ ((u64)(uintptr_t)command->sprite << 1) ^ command->sprite_mode;
+    hash = fnv1a_64(&pointers, sizeof(pointers), hash);
+  }
+  return hash;
+}
+
+/**
+ * @brief Возвращает фон под прямоугольники, закрытые прошлым кадром.
+ *
+ * Копирование читает кэш и пишет кадр, а заливка только пишет, поэтому когда прошлый
+ * кадр закрыл больше половины экрана, статический слой дешевле нарисовать заново.
+ *
+ * @param background Статический слой.
+ */
+internal void
+restore_background(const Draw_List* background) {
+  PROFILE_ZONE("restore_background");
+  Background_Cache* cache = &background_cache;
+  int width = render_state.width;
+  const Pixel_Rect* rects = cache->dirty;
+  int count = cache->dirty_count;
+  u64 area = cache->dirty_area;
+  if (cache->dirty_overflow) {
+    rects = &cache->dirty_bounds;
+    count = 1;
+    area = (u64)(rects->x1 - rects->x0) * (u64)(rects->y1 - rects->y0);
+  }
+
+  if (area > (u64)width * render_state.height / 2) {
+    execute_draw_list(background);
+  } else {
+    PROFILE_ZONE("restore_background_copy");
+    u32* memory = (u32*)render_state.memory;
+    for (int i = 0; i < count; i++) {
+      const Pixel_Rect* rect = rects + i;
+      size_t row_bytes = (size_t)(rect->x1 - rect->x0) * sizeof(u32);
+      for (int y = rect->y0; y < rect->y1; y++) {
+        size_t offset = (size_t)y * width + rect->x0;
+        memcpy(memory + offset, cache->pixels + offset, row_bytes);
+      }
+    }
+  }
+  cache->dirty_count = 0;
+  cache->dirty_overflow = 0;
+  cache->dirty_area = 0;
+}
+
+/**
+ * @brief Рисует кадр из статического и динамического слоёв.
+ *
+ * Статический слой растеризуется в кэш, только когда изменился размер кадра или команды
+ * слоя; иначе под объектами прошлого кадра восстанавливается фон из кэша. Динамический
+ * слой рисуется поверх как обычно, а его прямоугольники запоминаются для следующего кадра.
+ * Результат побитово совпадает с execute_draw_list(background) и execute_draw_list(list)
+ * подряд, если буфер кадра между кадрами никто другой не трогает. Если render_state.memory
+ * сменился (кольцо кадров), статический слой рисуется целиком, без кэша.
+ * Без памяти кэша (set_background_cache_memory не вызывался) кадр рисуется целиком.
+ *
+ * @param background Статический слой: должен закрывать весь кадр.
+ * @param list Динамический слой.
+ */
+internal void
+execute_layered_draw_lists(const Draw_List* background, const Draw_List* list) {
+  PROFILE_ZONE("execute_layered_draw_lists");
+  Background_Cache* cache = &background_cache;
+  if (!cache->pixels) {
+    execute_draw_list(background);
+    execute_draw_list(list);
+    return;
+  }
+
+  u64 key = draw_list_key(background);
+  if (!cache->valid || cache->key != key || cache->width != render_state.width ||
+      cache->height != render_state.height) {
+    PROFILE_ZONE("rasterize_background");
+    execute_draw_list(background);
+    memcpy(cache->pixels, render_state.memory, (size_t)render_state.width * render_state.height * sizeof(u32));
+    cache->valid = true;
+    cache->key = key;
+    cache->width = render_state.width;
+    cache->height = render_state.height;
+    cache->dirty_count = 0;
+    cache->dirty_overflow = 0;
+    cache->dirty_area = 0;
+  } else if (cache->frame != render_state.memory) {
+    // Кадр рисуется в другой буфер (слот кольца кадров): в нём нет прошлого кадра, фон рисуется целиком.
+    PROFILE_ZONE("redraw_background");
+    execute_draw_list(background);
+    cache->dirty_count = 0;
+    cache->dirty_overflow = 0;
+    cache->dirty_area = 0;
+  } else {
+    restore_background(background);
+  }
+  cache->frame = render_state.memory;
+
+  {
+    PROFILE_ZONE("mark_dirty_rects");
+    for (int i = 0; i < list->count; i++) mark_draw_command_dirty(list->commands + i);
+  }
+  execute_draw_list(list);
+}
 
 const char* letters[][7] = {
     " 00",
@@ -357,10 +1352,12 @@ const char* letters[][7] = {
 };
 
 /**
- * @brief Рисует текст на экране с заданным цветом и размером.
+ * @brief Раскладывает текст на прямоугольники и добавляет их в список отрисовки.
  * 
- * Функция рисует строку текста, используя логические координаты и размер символов. Каждый символ преобразуется в пиксели и рисуется на экране.
+ * Функция рисует строку текста, используя логические координаты и размер символов. Каждый закрашенный пиксель
+ * шрифта становится прямоугольником в списке, поэтому раскладка текста живёт во временной арене кадра.
  * 
+ * @param list Список отрисовки.
  * @param text Указатель на строку, которую необходимо нарисовать.
  * @param x Координата X начала строки в логических единицах.
  * @param y Координата Y начала строки в логических единицах.
@@ -369,7 +1366,8 @@ const char* letters[][7] = {
  * 
  * @return void Функция не возвращает значения.
  */
-internal void draw_text(const char *text, float x, float y, float size, u32 color) {
+internal void push_text(Draw_List* list, const char *text, float x, float y, float size, u32 color) {
+  PROFILE_ZONE("push_text");
   float half_size = size * .5f;
   float original_y = y;
 
@@ -385,7 +1383,7 @@ internal void draw_text(const char *text, float x, float y, float size, u32 colo
         const char* row = letter[i];
         while (*row) {
           if (*row == '0') {
-            draw_rect(x, y, half_size, half_size, color);
+            push_glyph(list, x, y, half_size, half_size, color);
           }
           x += size;
           row++;
@@ -401,10 +1399,11 @@ internal void draw_text(const char *text, float x, float y, float size, u32 colo
 }
 
 /**
- * @brief Рисует число на экране с заданным цветом и размером.
+ * @brief Раскладывает число на прямоугольники и добавляет их в список отрисовки.
  * 
- * Функция рисует целое число, используя логические координаты и размер символов. Каждая цифра преобразуется в пиксели и рисуется на экране.
+ * Функция рисует целое число, используя логические координаты и размер символов. Каждая цифра преобразуется в прямоугольники списка.
  * 
+ * @param list Список отрисовки.
  * @param number Число, которое необходимо нарисовать.
  * @param x Координата X начала числа в логических единицах.
  * @param y Координата Y начала числа в логических единицах.
@@ -413,7 +1412,8 @@ internal void draw_text(const char *text, float x, float y, float size, u32 colo
  * 
  * @return void Функция не возвращает значения.
  */
-internal void draw_number(int number, float x, float y, float size, u32 color) {
+internal void push_number(Draw_List* list, int number, float x, float y, float size, u32 color) {
+  PROFILE_ZONE("push_number");
   float half_size = size * .5f;
 
   bool drew_number = false;
@@ -425,81 +1425,81 @@ internal void draw_number(int number, float x, float y, float size, u32 color) {
 
     switch (digit) {
     case 0: {
-      draw_rect(x - size, y, half_size, 2.5f * size, color);
-      draw_rect(x + size, y, half_size, 2.5f * size, color);
-      draw_rect(x, y + size * 2.f, half_size, half_size, color);
-      draw_rect(x, y - size * 2.f, half_size, half_size, color);
+      push_glyph(list, x - size, y, half_size, 2.5f * size, color);
+      push_glyph(list, x + size, y, half_size, 2.5f * size, color);
+      push_glyph(list, x, y + size * 2.f, half_size, half_size, color);
+      push_glyph(list, x, y - size * 2.f, half_size, half_size, color);
       x -= size * 4.f;
     } break;
 
     case 1: {
-      draw_rect(x + size, y, half_size, 2.5f * size, color);
+      push_glyph(list, x + size, y, half_size, 2.5f * size, color);
       x -= size * 2.f;
     } break;
 
     case 2: {
-      draw_rect(x, y + size * 2.f, 1.5f * size, half_size, color);
-      draw_rect(x, y, 1.5f * size, half_size, color);
-      draw_rect(x, y - size * 2.f, 1.5f * size, half_size, color);
-      draw_rect(x + size, y + size, half_size, half_size, color);
-      draw_rect(x - size, y - size, half_size, half_size, color);
+      push_glyph(list, x, y + size * 2.f, 1.5f * size, half_size, color);
+      push_glyph(list, x, y, 1.5f * size, half_size, color);
+      push_glyph(list, x, y - size * 2.f, 1.5f * size, half_size, color);
+      push_glyph(list, x + size, y + size, half_size, half_size, color);
+      push_glyph(list, x - size, y - size, half_size, half_size, color);
       x -= size * 4.f;
     } break;
 
     case 3: {
-      draw_rect(x - half_size, y + size * 2.f, size, half_size, color);
-      draw_rect(x - half_size, y, size, half_size, color);
-      draw_rect(x - half_size, y - size * 2.f, size, half_size, color);
-      draw_rect(x + size, y, half_size, 2.5f * size, color);
+      push_glyph(list, x - half_size, y + size * 2.f, size, half_size, color);
+      push_glyph(list, x - half_size, y, size, half_size, color);
+      push_glyph(list, x - half_size, y - size * 2.f, size, half_size, color);
+      push_glyph(list, x + size, y, half_size, 2.5f * size, color);
       x -= size * 4.f;
     } break;
 
     case 4: {
-      draw_rect(x + size, y, half_size, 2.5f * size, color);
-      draw_rect(x - size, y + size, half_size, 1.5f * size, color);
-      draw_rect(x, y, half_size, half_size, color);
+      push_glyph(list, x + size, y, half_size, 2.5f * size, color);
+      push_glyph(list, x - size, y + size, half_size, 1.5f * size, color);
+      push_glyph(list, x, y, half_size, half_size, color);
       x -= size * 4.f;
     } break;
 
     case 5: {
-      draw_rect(x, y + size * 2.f, 1.5f * size, half_size, color);
-      draw_rect(x, y, 1.5f * size, half_size, color);
-      draw_rect(x, y - size * 2.f, 1.5f * size, half_size, color);
-      draw_rect(x - size, y + size, half_size, half_size, color);
-      draw_rect(x + size, y - size, half_size, half_size, color);
+      push_glyph(list, x, y + size * 2.f, 1.5f * size, half_size, color);
+      push_glyph(list, x, y, 1.5f * size, half_size, color);
+      push_glyph(list, x, y - size * 2.f, 1.5f * size, half_size, color);
+      push_glyph(list, x - size, y + size, half_size, half_size, color);
+      push_glyph(list, x + size, y - size, half_size, half_size, color);
       x -= size * 4.f;
     } break;
 
     case 6: {
-      draw_rect(x + half_size, y + size * 2.f, size, half_size, color);
-      draw_rect(x + half_size, y, size, half_size, color);
-      draw_rect(x + half_size, y - size * 2.f, size, half_size, color);
-      draw_rect(x - size, y, half_size, 2.5f * size, color);
-      draw_rect(x + size, y - size, half_size, half_size, color);
+      push_glyph(list, x + half_size, y + size * 2.f, size, half_size, color);
+      push_glyph(list, x + half_size, y, size, half_size, color);
+      push_glyph(list, x + half_size, y - size * 2.f, size, half_size, color);
+      push_glyph(list, x - size, y, half_size, 2.5f * size, color);
+      push_glyph(list, x + size, y - size, half_size, half_size, color);
       x -= size * 4.f;
     } break;
 
     case 7: {
-      draw_rect(x + size, y, half_size, 2.5f * size, color);
-      draw_rect(x - half_size, y + size * 2.f, size, half_size, color);
+      push_glyph(list, x + size, y, half_size, 2.5f * size, color);
+      push_glyph(list, x - half_size, y + size * 2.f, size, half_size, color);
       x -= size * 4.f;
     } break;
 
     case 8: {
-      draw_rect(x - size, y, half_size, 2.5f * size, color);
-      draw_rect(x + size, y, half_size, 2.5f * size, color);
-      draw_rect(x, y + size * 2.f, half_size, half_size, color);
-      draw_rect(x, y - size * 2.f, half_size, half_size, color);
-      draw_rect(x, y, half_size, half_size, color);
+      push_glyph(list, x - size, y, half_size, 2.5f * size, color);
+      push_glyph(list, x + size, y, half_size, 2.5f * size, color);
+      push_glyph(list, x, y + size * 2.f, half_size, half_size, color);
+      push_glyph(list, x, y - size * 2.f, half_size, half_size, color);
+      push_glyph(list, x, y, half_size, half_size, color);
       x -= size * 4.f;
     } break;
 
     case 9: {
-      draw_rect(x - half_size, y + size * 2.f, size, half_size, color);
-      draw_rect(x - half_size, y, size, half_size, color);
-      draw_rect(x - half_size, y - size * 2.f, size, half_size, color);
-      draw_rect(x + size, y, half_size, 2.5f * size, color);
-      draw_rect(x - size, y + size, half_size, half_size, color);
+      push_glyph(list, x - half_size, y + size * 2.f, size, half_size, color);
+      push_glyph(list, x - half_size, y, size, half_size, color);
+      push_glyph(list, x - half_size, y - size * 2.f, size, half_size, color);
+      push_glyph(list, x + size, y, half_size, 2.5f * size, color);
+      push_glyph(list, x - size, y + size, half_size, half_size, color);
       x -= size * 4.f;
     } break;
     }
@@ -0,0 +1,146 @@
+/**
+ * @file rules_bench.cpp
+ * @brief Пакетная симуляция матчей для каждого варианта правил и сравнение с ядром на изменяемых глобальных.
+ *
+ * Пакет — много независимых матчей ИИ против автопилота, которые шагают по очереди,
+ * как на match_server. Каждый вариант правил идёт через StepGame (выбор ядра во время
+ * выполнения). Для сравнения тот же пакет стандартных матчей гоняется ядром StepMatch
+ * с правилами в изменяемых глобальных переменных, как было до шаблонов: такое ядро
+ * перечитывает константы из памяти после каждой записи в состояние. Результаты обоих
+ * ядер стандартных правил должны совпасть побитово.
+ *
+ * Использование:
+ *   rules_bench [-matches N] [-ticks N] [-repeat N]
+ */
+
+#include "headless_platform.cpp"
+
+/**
+ * @brief Стандартные правила в изменяемых глобальных переменных (ядро для сравнения).
+ */
+struct Runtime_Rules {
+    static float kArenaHalfSizeX, kArenaHalfSizeY;
+    static float kPlayerHalfSizeX, kPlayerHalfSizeY;
+    static float kBallHalfSize;
+    static float kPaddleX;
+    static float kPaddleDamping;
+    static float kPlayerAcceleration;
+    static float kAiGain, kAiMaxAcceleration;
+    static float kBallSpeedScale;
+};
+
+float Runtime_Rules::kArenaHalfSizeX = Standard_Rules::kArenaHalfSizeX;
+float Runtime_Rules::kArenaHalfSizeY = Standard_Rules::kArenaHalfSizeY;
+float Runtime_Rules::kPlayerHalfSizeX = Standard_Rules::kPlayerHalfSizeX;
+float Runtime_Rules::kPlayerHalfSizeY = Standard_Rules::kPlayerHalfSizeY;
+float Runtime_Rules::kBallHalfSize = Standard_Rules::kBallHalfSize;
+float Runtime_Rules::kPaddleX = Standard_Rules::kPaddleX;
+float Runtime_Rules::kPaddleDamping = Standard_Rules::kPaddleDamping;
+float Runtime_Rules::kPlayerAcceleration = Standard_Rules::kPlayerAcceleration;
+float Runtime_Rules::kAiGain = Standard_Rules::kAiGain;
+float Runtime_Rules::kAiMaxAcceleration = Standard_Rules::kAiMaxAcceleration;
+float Runtime_Rules::kBallSpeedScale = Standard_Rules::kBallSpeedScale;
+
+/**
+ * @brief Частота тиков пакета.
+ */
+global_variable constexpr int bench_tick_hz = 60;
+
+/**
+ * @brief Начинает пакет матчей заново: подачи с разной высоты.
+ */
+internal void
+reset_batch(Game_State* states, Input* inputs, int count, Game_Rules rules) {
+    for (int i = 0; i < count; i++) {
+        states[i] = Game_State();
+        start_headless_match(states + i);
+        states[i].rules = rules;
+        states[i].ball_p_y = (float)(i % 61) - 30.f;
+        states[i].player_2_p = (float)(i % 7) * 3.f - 9.f;
+        inputs[i] = Input();
+    }
+}
+
+/**
+ * @brief Шаг матча ядром на изменяемых глобальных; та же форма, что у StepGame.
+ */
+internal void
+step_game_with_globals(Game_State* state, Input* input, float dt) {
+    state->event_count = 0;
+    if (state->current_gamemode == kGameplay) StepMatch<Runtime_Rules>(state, input, dt);
+}
+
+/**
+ * @brief Шаг матча, которым прогоняется пакет.
+ */
+typedef void Step_Function(Game_State* state, Input* input, float dt);
+
+/**
+ * @brief Прогоняет пакет на ticks тиков и возвращает время в наносекундах.
+ */
+internal u64
+run_batch(Game_State* states, Input* inputs, int count, int ticks, Step_Function* step) {
+    const float dt = 1.f / bench_tick_hz;
+    u64 begin_ns = headless_time_ns();
+    for (int tick = 0; tick < ticks; tick++) {
+        for (int i = 0; i < count; i++) {
+            autopilot_input(inputs + i, states[i].ball_p_y, states[i].player_2_p);
+            step(states + i, inputs + i, dt);
+        }
+    }
+    return headless_time_ns() - begin_ns;
+}
+
+int main(int argc, char** argv) {
+    int match_count = 1024;
+    int ticks = 3600;
+    int repeat = 5;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-matches")) match_count = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-ticks")) ticks = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-repeat")) repeat = atoi(argv[i + 1]);
+    }
+    if (match_count < 1) match_count = 1;
+    if (ticks < 1) ticks = 1;
+    if (repeat < 1) repeat = 1;
+
+    Game_State* states = (Game_State*)malloc((size_t)match_count * sizeof(Game_State));
+    Game_State* expected = (Game_State*)malloc((size_t)match_count * sizeof(Game_State));
+    Input* inputs = (Input*)malloc((size_t)match_count * sizeof(Input));
+    if (!states || !expected || !inputs) return EXIT_FAILURE;
+
+    // Варианты правил через StepGame и ядро на глобальных. Замеры шумные: прогоны чередуются,
+    // и берётся лучший из повторов.
+    const int runs = kRulesCount + 1;
+    double best_ns[runs];
+    int goals[runs];
+    bool identical = true;
+    for (int r = 0; r < repeat; r++) {
+        for (int run = 0; run < runs; run++) {
+            bool globals = run == kRulesCount;
+            Game_Rules rules = globals ? kRulesStandard : (Game_Rules)run;
+            reset_batch(states, inputs, match_count, rules);
+            u64 ns = run_batch(states, inputs, match_count, ticks, globals ? step_game_with_globals : StepGame);
+            double tick_ns = (double)ns / ((double)match_count * ticks);
+            if (!r || tick_ns < best_ns[run]) best_ns[run] = tick_ns;
+
+            goals[run] = 0;
+            for (int i = 0; i < match_count; i++) goals[run] += states[i].player_1_score + states[i].player_2_score;
+            if (run == kRulesStandard) memcpy((void*)expected, states, (size_t)match_count * sizeof(Game_State));
+            if (globals && memcmp(expected, states, (size_t)match_count * sizeof(Game_State))) identical = false;
+        }
+    }
+
+    printf("%d matches x %d ticks at %d Hz (best of %d)\n", match_count, ticks, bench_tick_hz, repeat);
+    for (int run = 0; run < runs; run++) {
+        const char* name = run == kRulesCount ? "globals" : kGameRulesInfo[run].name;
+        printf("%-9s %7.2f ns/tick %10.1f Mticks/s  goals %d\n", name, best_ns[run], 1e3 / best_ns[run], goals[run]);
+    }
+    printf("standard kernel vs globals: %.2fx, results %s\n", best_ns[kRulesCount] / best_ns[kRulesStandard],
+           identical ? "identical" : "DIFFER");
+
+    free(states);
+    free(expected);
+    free(inputs);
+    return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
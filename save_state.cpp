@@ -0,0 +1,216 @@
+/**
+ * @file save_state.cpp
+ * @brief Сохранение матча в отображённый в память файл: мгновенное восстановление при запуске.
+ *
+ * Файл — две страницы, в каждой заголовок и копия Game_State как есть (без сериализации).
+ * Сохранение пишет в страницу, которая не содержит последнее сохранение, последним полем
+ * заголовка — номер сохранения, и просит ОС сбросить эту страницу на диск асинхронно.
+ * Если процесс упадёт посреди записи, контрольная сумма недописанной страницы не сойдётся,
+ * и при запуске восстановится предыдущее сохранение. Восстановление — выбор страницы
+ * с наибольшим номером и корректной суммой и одно копирование.
+ *
+ * Раскладка Game_State фиксирована версией kGameStateVersion и размером структуры:
+ * файл с другой версией или размером игнорируется.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Размер страницы (слота) файла сохранения.
+ */
+global_variable constexpr u32 save_slot_size = 4096;
+
+/**
+ * @brief Количество слотов: текущее сохранение и запись следующего.
+ */
+global_variable constexpr u32 save_slot_count = 2;
+
+/**
+ * @brief Сигнатура файла сохранения ("PSAV").
+ */
+global_variable constexpr u32 save_magic = 0x56415350;
+
+/**
+ * @struct Save_Header
+ * @brief Заголовок слота.
+ */
+struct Save_Header {
+    u32 magic; /**< save_magic. */
+    u32 version; /**< kGameStateVersion. */
+    u32 state_size; /**< sizeof(Game_State). */
+    u32 reserved;
+    u64 checksum; /**< FNV-1a полей выше и состояния. */
+    u64 sequence; /**< Номер сохранения; пишется последним, 0 — слот пуст. */
+};
+
+/**
+ * @struct Save_Slot
+ * @brief Слот файла сохранения: одна страница.
+ */
+struct Save_Slot {
+    Save_Header header; /**< Заголовок. */
+    Game_State state; /**< Состояние матча как есть. */
+};
+
+static_assert(std::is_trivially_copyable<Game_State>::value, "Game_State is saved by copying its bytes");
+static_assert(sizeof(Save_Slot) <= save_slot_size, "Game_State must fit in one page of the save file");
+
+/**
+ * @struct Save_File
+ * @brief Отображённый в память файл сохранения.
+ */
+struct Save_File {
+    u8* memory; /**< Отображение файла (save_slot_count страниц) или 0. */
+    u64 sequence; /**< Номер последнего сохранения. */
+    u32 current_slot; /**< Слот последнего сохранения. */
+#ifdef _WIN32
+    HANDLE file; /**< Файл. */
+    HANDLE mapping; /**< Отображение. */
+#else
+    int fd; /**< Файл. */
+#endif
+};
+
+/**
+ * @brief Контрольная сумма слота: FNV-1a (64 бита) полей заголовка до checksum и состояния.
+ */
+internal u64
+save_slot_checksum(const Save_Slot* slot) {
+    u64 hash = fnv1a_64(&slot->header, offsetof(Save_Header, checksum));
+    return fnv1a_64(&slot->state, sizeof(Game_State), hash);
+}
+
+/**
+ * @brief Корректен ли слот: текущая версия, размер и контрольная сумма.
+ */
+internal bool
+is_save_slot_valid(const Save_Slot* slot) {
+    return slot->header.sequence && slot->header.magic == save_magic && slot->header.version == kGameStateVersion &&
+           slot->header.state_size == sizeof(Game_State) && slot->header.checksum == save_slot_checksum(slot);
+}
+
+/**
+ * @brief Открывает (или создаёт) файл сохранения и отображает его в память.
+ *
+ * @param save Файл сохранения.
+ * @param path Путь к файлу.
+ *
+ * @return false, если файл не открылся.
+ */
+internal bool
+open_save_file(Save_File* save, const char* path) {
+    *save = Save_File();
+    u32 size = save_slot_size * save_slot_count;
+#ifdef _WIN32
+    save->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if (save->file == INVALID_HANDLE_VALUE) return false;
+    save->mapping = CreateFileMappingA(save->file, 0, PAGE_READWRITE, 0, size, 0);
+    if (save->mapping) save->memory = (u8*)MapViewOfFile(save->mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!save->memory) {
+        if (save->mapping) CloseHandle(save->mapping);
+        CloseHandle(save->file);
+        return false;
+    }
+#else
+    save->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (save->fd < 0) return false;
+    void* memory = MAP_FAILED;
+    if (ftruncate(save->fd, size) == 0) memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, save->fd, 0);
+    if (memory == MAP_FAILED) {
+        close(save->fd);
+        return false;
+    }
+    save->memory = (u8*)memory;
+#endif
+
+    for (u32 i = 0; i < save_slot_count; i++) {
+        const Save_Slot* slot = (const Save_Slot*)(save->memory + i * save_slot_size);
+        if (is_save_slot_valid(slot) && slot->header.sequence > save->sequence) {
+            save->sequence = slot->header.sequence;
+            save->current_slot = i;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Восстанавливает последнее корректное сохранение.
+ *
+ * @param save Файл сохранения.
+ * @param state Куда скопировать состояние.
+ *
+ * @return false, если корректного сохранения нет (state не меняется).
+ */
+internal bool
+load_save_state(const Save_File* save, Game_State* state) {
+    if (!save->memory || !save->sequence) return false;
+    const Save_Slot* slot = (const Save_Slot*)(save->memory + save->current_slot * save_slot_size);
+    memcpy((void*)state, &slot->state, sizeof(Game_State));
+    state->event_count = 0;
+    return true;
+}
+
+/**
+ * @brief Сохраняет состояние в свободный слот и просит ОС асинхронно сбросить его страницу.
+ *
+ * Номер сохранения пишется последним, после барьера, поэтому частично записанный слот
+ * либо пуст, либо не проходит проверку суммы.
+ *
+ * @param save Файл сохранения.
+ * @param state Состояние матча.
+ */
+internal void
+commit_save_state(Save_File* save, const Game_State* state) {
+    if (!save->memory) return;
+    u32 index = (save->current_slot + 1) % save_slot_count;
+    Save_Slot* slot = (Save_Slot*)(save->memory + index * save_slot_size);
+
+    slot->header.sequence = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->header.magic = save_magic;
+    slot->header.version = kGameStateVersion;
+    slot->header.state_size = sizeof(Game_State);
+    slot->header.reserved = 0;
+    memcpy((void*)&slot->state, state, sizeof(Game_State));
+    slot->header.checksum = save_slot_checksum(slot);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->header.sequence = save->sequence + 1;
+
+#ifdef _WIN32
+    FlushViewOfFile(slot, save_slot_size);
+#else
+    msync(slot, save_slot_size, MS_ASYNC);
+#endif
+    save->sequence++;
+    save->current_slot = index;
+}
+
+/**
+ * @brief Закрывает файл сохранения, дожидаясь записи страниц на диск.
+ *
+ * @param save Файл сохранения.
+ */
+internal void
+close_save_file(Save_File* save) {
+    if (!save->memory) return;
+    u32 size = save_slot_size * save_slot_count;
+#ifdef _WIN32
+    FlushViewOfFile(save->memory, size);
+    UnmapViewOfFile(save->memory);
+    CloseHandle(save->mapping);
+    CloseHandle(save->file);
+#else
+    msync(save->memory, size, MS_SYNC);
+    munmap(save->memory, size);
+    close(save->fd);
+#endif
+    save->memory = 0;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file save_state_check.cpp
+ * @brief Проверка файла сохранения (save_state.cpp): два слота, контрольная сумма, откат к прошлому сохранению.
+ *
+ * Матч сохраняется дважды, после чего слот последнего сохранения портится так, как его
+ * оставила бы оборванная запись: изменённый байт состояния, неверная сумма, незаписанный
+ * номер сохранения. После повторного открытия файла должно загружаться предыдущее
+ * сохранение. Новый файл без сохранений и файл из мусора загрузку не проходят.
+ *
+ * Использование: save_state_check [-file путь]
+ */
+
+#include "headless_platform.cpp"
+#include "save_state.cpp"
+
+/**
+ * @brief Способ испортить слот последнего сохранения.
+ */
+enum Save_Damage {
+    SAVE_DAMAGE_PAYLOAD, /**< Изменён байт состояния. */
+    SAVE_DAMAGE_CHECKSUM, /**< Изменена контрольная сумма. */
+    SAVE_DAMAGE_SEQUENCE, /**< Номер сохранения не записан (0). */
+
+    SAVE_DAMAGE_COUNT,
+};
+
+global_variable const char* const save_damage_names[SAVE_DAMAGE_COUNT] = { "payload", "checksum", "sequence" };
+
+/**
+ * @brief Переписывает size байт файла по смещению offset, минуя отображение.
+ */
+internal bool
+patch_save_file(const char* path, size_t offset, const void* data, size_t size) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) return false;
+    bool written = pwrite(fd, data, size, (off_t)offset) == (ssize_t)size;
+    return close(fd) == 0 && written;
+}
+
+/**
+ * @brief Открывает файл заново и загружает из него состояние.
+ *
+ * @return false, если файл не открылся или корректного сохранения в нём нет.
+ */
+internal bool
+reload_save_state(const char* path, Game_State* state) {
+    Save_File save;
+    if (!open_save_file(&save, path)) return false;
+    bool loaded = load_save_state(&save, state);
+    close_save_file(&save);
+    return loaded;
+}
+
+int main(int argc, char** argv) {
+    const char* path = "save_state_check.sav";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-file")) path = argv[i + 1];
+    }
+    int failures = 0;
+
+    // Новый файл: сохранений нет, загрузка не проходит.
+    unlink(path);
+    Game_State state = {};
+    state.player_1_score = -1;
+    bool loaded = reload_save_state(path, &state);
+    printf("empty file: %s\n", loaded ? "loaded" : "rejected");
+    if (loaded || state.player_1_score != -1) failures++;
+
+    for (int damage = 0; damage < SAVE_DAMAGE_COUNT; damage++) {
+        // Два сохранения: счёт 1 и счёт 2.
+        unlink(path);
+        Save_File save;
+        if (!open_save_file(&save, path)) {
+            printf("cannot open %s\n", path);
+            return EXIT_FAILURE;
+        }
+        Game_State saved = {};
+        saved.current_gamemode = kGameplay;
+        saved.player_1_score = 1;
+        commit_save_state(&save, &saved);
+        saved.player_1_score = 2;
+        saved.ball_p_x = 17.5f;
+        commit_save_state(&save, &saved);
+        u32 newest = save.current_slot;
+        close_save_file(&save);
+
+        Game_State restored = {};
+        loaded = reload_save_state(path, &restored);
+        bool newest_ok = loaded && restored.player_1_score == 2 && restored.ball_p_x == 17.5f;
+
+        // Порча последнего слота в файле.
+        size_t slot_offset = (size_t)newest * save_slot_size;
+        bool patched = false;
+        if (damage == SAVE_DAMAGE_PAYLOAD) {
+            float ball_p_x = 18.5f;
+            patched = patch_save_file(path, slot_offset + offsetof(Save_Slot, state) + offsetof(Game_State, ball_p_x),
+                                      &ball_p_x, sizeof(ball_p_x));
+        } else if (damage == SAVE_DAMAGE_CHECKSUM) {
+            u64 checksum = 0x0123456789abcdefull;
+            patched = patch_save_file(path, slot_offset + offsetof(Save_Header, checksum), &checksum, sizeof(checksum));
+        } else {
+            u64 sequence = 0;
+            patched = patch_save_file(path, slot_offset + offsetof(Save_Header, sequence), &sequence, sizeof(sequence));
+        }
+
+        restored = Game_State();
+        loaded = reload_save_state(path, &restored);
+        bool fallback_ok = patched && loaded && restored.player_1_score == 1;
+        printf("damaged %s: newest save %s, after damage %s score %d\n", save_damage_names[damage],
+               newest_ok ? "loaded" : "missing", loaded ? "loaded" : "rejected", restored.player_1_score);
+        if (!newest_ok || !fallback_ok) failures++;
+    }
+
+    // Файл из мусора: ни один слот не проходит проверку.
+    unlink(path);
+    u8 garbage[save_slot_size * save_slot_count];
+    u32 random_state = 0x2545f491u;
+    for (size_t i = 0; i < sizeof(garbage); i++) garbage[i] = (u8)xorshift32(&random_state);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    bool written = fd >= 0 && write(fd, garbage, sizeof(garbage)) == (ssize_t)sizeof(garbage);
+    if (fd >= 0) close(fd);
+    loaded = reload_save_state(path, &state);
+    printf("garbage file: %s\n", loaded ? "loaded" : "rejected");
+    if (!written || loaded) failures++;
+
+    unlink(path);
+    printf("%d failures\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,350 @@
+/**
+ * @file shared_framebuffer.cpp
+ * @brief Буфер кадра в именованной разделяемой памяти POSIX: кольцо из N кадров для внешнего зрителя (Linux).
+ *
+ * Игра рисует прямо в слот кольца (render_state.memory указывает в разделяемую память),
+ * а другой процесс (зритель, запись видео) читает готовые кадры на месте, без копий
+ * через сокеты. Кадр n лежит в слоте n % slot_count.
+ *
+ * Синхронизация без блокировок игры:
+ * - у слота есть номер кадра (как seqlock): перед отрисовкой он обнуляется, после — становится
+ *   номером кадра; читатель проверяет его до и после чтения и так узнаёт, что кадр успели
+ *   перезаписать;
+ * - номер последнего готового кадра и слово futex в заголовке: читатель засыпает на futex,
+ *   писатель будит его системным вызовом, только если кто-то спит;
+ * - писатель никогда не ждёт читателей: медленный читатель пропускает кадры, у него есть
+ *   slot_count - 1 кадров на чтение одного кадра, прежде чем слот будет перезаписан.
+ *
+ * Раскладка: страница заголовка (заголовок и описания слотов, читатель отображает её
+ * для записи — счётчик спящих), затем слоты пикселей (читатель отображает только для чтения).
+ */
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @brief Сигнатура кольца ("PFRM").
+ */
+global_variable constexpr u32 shared_frame_magic = 0x4d524650;
+
+/**
+ * @brief Версия раскладки кольца.
+ */
+global_variable constexpr u32 shared_frame_version = 1;
+
+/**
+ * @brief Наибольшее количество слотов кольца.
+ */
+global_variable constexpr int max_shared_frame_slots = 64;
+
+static_assert(std::atomic<u64>::is_always_lock_free && std::atomic<u32>::is_always_lock_free,
+              "shared frame ring atomics must be lock-free to work across processes");
+
+/**
+ * @struct Shared_Frame_Slot
+ * @brief Описание слота кольца.
+ */
+struct alignas(64) Shared_Frame_Slot {
+    std::atomic<u64> sequence; /**< Номер кадра в слоте; 0 — слот пишется или пуст. */
+    u64 publish_ns; /**< Когда кадр готов (CLOCK_MONOTONIC). */
+    u64 checksum; /**< Хеш пикселей или 0, если писатель его не считает. */
+    u32 width, height; /**< Размер кадра. */
+};
+
+/**
+ * @struct Shared_Frame_Header
+ * @brief Заголовок кольца в начале разделяемой памяти.
+ */
+struct Shared_Frame_Header {
+    std::atomic<u32> magic; /**< shared_frame_magic; пишется последним при создании. */
+    u32 version; /**< shared_frame_version. */
+    u32 slot_count; /**< Количество слотов. */
+    u32 max_width, max_height; /**< Наибольший размер кадра. */
+    u64 slot_bytes; /**< Размер слота пикселей (кратен странице). */
+    u64 pixels_offset; /**< Смещение первого слота пикселей (кратно странице). */
+
+    alignas(64) std::atomic<u64> published; /**< Номер последнего готового кадра (0 — кадров ещё не было). */
+    std::atomic<u32> ready; /**< Слово futex: увеличивается с каждым готовым кадром. */
+    std::atomic<u32> waiters; /**< Сколько читателей спит на ready. */
+
+    Shared_Frame_Slot slots[max_shared_frame_slots]; /**< Описания слотов. */
+};
+
+/**
+ * @struct Shared_Frame_Ring
+ * @brief Кольцо кадров, отображённое в процесс (писатель или читатель).
+ */
+struct Shared_Frame_Ring {
+    Shared_Frame_Header* header; /**< Заголовок. */
+    u8* pixels; /**< Слоты пикселей. */
+    size_t header_bytes; /**< Размер отображения заголовка. */
+    size_t pixel_bytes; /**< Размер слотов пикселей. */
+    char name[64]; /**< Имя объекта разделяемой памяти (писатель удаляет его при закрытии). */
+    bool owner; /**< Кольцо создано этим процессом. */
+    u64 sequence; /**< Писатель: номер рисуемого кадра; читатель: номер последнего полученного. */
+};
+
+/**
+ * @struct Shared_Frame
+ * @brief Кадр, полученный читателем: пиксели прямо в разделяемой памяти.
+ */
+struct Shared_Frame {
+    const u32* pixels; /**< Пиксели (строки снизу вверх, как в render_state). */
+    int width, height; /**< Размер. */
+    u64 sequence; /**< Номер кадра. */
+    u64 publish_ns; /**< Когда кадр готов. */
+    u64 checksum; /**< Хеш писателя или 0. */
+};
+
+/**
+ * @brief Ждёт, пока слово futex отличается от expected, не дольше timeout_ns (0 — без ограничения).
+ */
+internal void
+shared_futex_wait(std::atomic<u32>* word, u32 expected, u64 timeout_ns) {
+    timespec timeout = { (time_t)(timeout_ns / 1000000000ull), (long)(timeout_ns % 1000000000ull) };
+    syscall(SYS_futex, (u32*)word, FUTEX_WAIT, expected, timeout_ns ? &timeout : 0, 0, 0);
+}
+
+/**
+ * @brief Будит всех, кто спит на слове futex (в любом процессе).
+ */
+internal void
+shared_futex_wake(std::atomic<u32>* word) {
+    syscall(SYS_futex, (u32*)word, FUTEX_WAKE, INT_MAX, 0, 0, 0);
+}
+
+/**
+ * @brief Хеш пикселей кадра (FNV-1a) для проверки целостности у читателя.
+ */
+internal u64
+shared_frame_checksum(const u32* pixels, size_t count) {
+    u64 hash = fnv1a_64(pixels, count * sizeof(u32));
+    return hash ? hash : 1;
+}
+
+/**
+ * @brief Создаёт кольцо (писатель). Существующий объект с тем же именем пересоздаётся.
+ *
+ * @param ring Кольцо.
+ * @param name Имя объекта разделяемой памяти ("/pong_frames").
+ * @param slot_count Количество кадров в кольце (от 2).
+ * @param max_width Наибольшая ширина кадра.
+ * @param max_height Наибольшая высота кадра.
+ * @return false (с сообщением в stderr), если разделяемую память не удалось создать.
+ */
+internal bool
+create_shared_frame_ring(Shared_Frame_Ring* ring, const char* name, int slot_count, int max_width, int max_height) {
+    *ring = Shared_Frame_Ring();
+    slot_count = clamp(2, slot_count, max_shared_frame_slots);
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t header_bytes = (sizeof(Shared_Frame_Header) + page - 1) / page * page;
+    size_t slot_bytes = ((size_t)max_width * max_height * sizeof(u32) + page - 1) / page * page;
+    size_t total = header_bytes + slot_bytes * slot_count;
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "shm_open %s: %s\n", name, strerror(errno));
+        return false;
+    }
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, (off_t)total) == 0) memory = mmap(0, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "mmap %s: %s\n", name, strerror(errno));
+        shm_unlink(name);
+        return false;
+    }
+
+    // Память после ftruncate нулевая: все слоты пусты, кадров ещё не было.
+    ring->header = new (memory) Shared_Frame_Header();
+    ring->pixels = (u8*)memory + header_bytes;
+    ring->header_bytes = header_bytes;
+    ring->pixel_bytes = slot_bytes * slot_count;
+    ring->owner = true;
+    snprintf(ring->name, sizeof(ring->name), "%s", name);
+
+    Shared_Frame_Header* header = ring->header;
+    header->version = shared_frame_version;
+    header->slot_count = (u32)slot_count;
+    header->max_width = (u32)max_width;
+    header->max_height = (u32)max_height;
+    header->slot_bytes = slot_bytes;
+    header->pixels_offset = header_bytes;
+    header->magic.store(shared_frame_magic, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Подключается к кольцу (читатель).
+ *
+ * Заголовок отображается для записи (читатель отмечается в счётчике спящих),
+ * пиксели — только для чтения.
+ *
+ * @return false, если кольца нет или у него другая версия.
+ */
+internal bool
+open_shared_frame_ring(Shared_Frame_Ring* ring, const char* name) {
+    *ring = Shared_Frame_Ring();
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return false;
+    struct stat info;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t header_bytes = (sizeof(Shared_Frame_Header) + page - 1) / page * page;
+    bool ok = fstat(fd, &info) == 0 && (size_t)info.st_size > header_bytes;
+    void* header = ok ? mmap(0, header_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (header == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    Shared_Frame_Header* shared = (Shared_Frame_Header*)header;
+    if (shared->magic.load(std::memory_order_acquire) != shared_frame_magic || shared->version != shared_frame_version ||
+        shared->pixels_offset != header_bytes ||
+        shared->pixels_offset + shared->slot_bytes * shared->slot_count > (u64)info.st_size) {
+        munmap(header, header_bytes);
+        close(fd);
+        return false;
+    }
+    size_t pixel_bytes = (size_t)(shared->slot_bytes * shared->slot_count);
+    void* pixels = mmap(0, pixel_bytes, PROT_READ, MAP_SHARED, fd, (off_t)shared->pixels_offset);
+    close(fd);
+    if (pixels == MAP_FAILED) {
+        munmap(header, header_bytes);
+        return false;
+    }
+
+    ring->header = shared;
+    ring->pixels = (u8*)pixels;
+    ring->header_bytes = header_bytes;
+    ring->pixel_bytes = pixel_bytes;
+    ring->sequence = shared->published.load(std::memory_order_acquire);
+    snprintf(ring->name, sizeof(ring->name), "%s", name);
+    return true;
+}
+
+/**
+ * @brief Отключается от кольца; писатель удаляет объект разделяемой памяти.
+ */
+internal void
+close_shared_frame_ring(Shared_Frame_Ring* ring) {
+    if (!ring->header) return;
+    if (ring->owner) {
+        // У писателя заголовок и пиксели — одно отображение.
+        munmap(ring->header, ring->header_bytes + ring->pixel_bytes);
+        shm_unlink(ring->name);
+    } else {
+        munmap(ring->header, ring->header_bytes);
+        munmap(ring->pixels, ring->pixel_bytes);
+    }
+    *ring = Shared_Frame_Ring();
+}
+
+/**
+ * @brief Направляет рисование следующего кадра в свободный слот кольца (писатель).
+ *
+ * render_state.memory указывает в слот до publish_shared_frame. Слот помечается
+ * пустым до первой записи пикселей, чтобы читатель старого кадра этого слота узнал
+ * о перезаписи.
+ *
+ * @return false, если кадр больше наибольшего размера кольца.
+ */
+internal bool
+begin_shared_frame(Shared_Frame_Ring* ring, int width, int height) {
+    Shared_Frame_Header* header = ring->header;
+    if (width < 1 || height < 1 || (u32)width > header->max_width || (u32)height > header->max_height) return false;
+    ring->sequence = header->published.load(std::memory_order_relaxed) + 1;
+    u32 slot = (u32)(ring->sequence % header->slot_count);
+    header->slots[slot].sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    render_state.width = width;
+    render_state.height = height;
+    render_state.memory = ring->pixels + header->slot_bytes * slot;
+    return true;
+}
+
+/**
+ * @brief Публикует нарисованный кадр и будит спящих читателей (писатель).
+ *
+ * Системный вызов делается, только если хотя бы один читатель спит; ожидания
+ * читателей здесь нет.
+ *
+ * @param ring Кольцо.
+ * @param with_checksum Посчитать хеш пикселей для проверки у читателя.
+ */
+internal void
+publish_shared_frame(Shared_Frame_Ring* ring, bool with_checksum) {
+    Shared_Frame_Header* header = ring->header;
+    Shared_Frame_Slot* slot = header->slots + ring->sequence % header->slot_count;
+    slot->width = (u32)render_state.width;
+    slot->height = (u32)render_state.height;
+    slot->checksum = with_checksum ? shared_frame_checksum((const u32*)render_state.memory,
+                                                           (size_t)render_state.width * render_state.height) : 0;
+    slot->publish_ns = headless_time_ns();
+    slot->sequence.store(ring->sequence, std::memory_order_release);
+    header->published.store(ring->sequence, std::memory_order_release);
+    header->ready.fetch_add(1, std::memory_order_seq_cst);
+    if (header->waiters.load(std::memory_order_seq_cst)) shared_futex_wake(&header->ready);
+}
+
+/**
+ * @brief Берёт самый новый готовый кадр, если он новее полученного прошлый раз (читатель).
+ *
+ * Пиксели не копируются. Кадры между прошлым и этим пропущены (их можно посчитать
+ * по номерам). После чтения пикселей нужно проверить shared_frame_still_valid.
+ *
+ * @return false, если нового кадра нет или его слот уже перезаписывается.
+ */
+internal bool
+acquire_shared_frame(Shared_Frame_Ring* ring, Shared_Frame* frame) {
+    Shared_Frame_Header* header = ring->header;
+    u64 sequence = header->published.load(std::memory_order_acquire);
+    if (sequence == ring->sequence) return false;
+    u32 index = (u32)(sequence % header->slot_count);
+    const Shared_Frame_Slot* slot = header->slots + index;
+    if (slot->sequence.load(std::memory_order_acquire) != sequence) return false;
+
+    frame->pixels = (const u32*)(ring->pixels + header->slot_bytes * index);
+    frame->width = (int)slot->width;
+    frame->height = (int)slot->height;
+    frame->publish_ns = slot->publish_ns;
+    frame->checksum = slot->checksum;
+    frame->sequence = sequence;
+    ring->sequence = sequence;
+    return true;
+}
+
+/**
+ * @brief Не начал ли писатель перезаписывать слот кадра, пока читатель его читал.
+ *
+ * @return true, если прочитанные пиксели и поля кадра целы.
+ */
+internal bool
+shared_frame_still_valid(const Shared_Frame_Ring* ring, const Shared_Frame* frame) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const Shared_Frame_Slot* slot = ring->header->slots + frame->sequence % ring->header->slot_count;
+    return slot->sequence.load(std::memory_order_relaxed) == frame->sequence;
+}
+
+/**
+ * @brief Спит до нового кадра, не дольше timeout_ns (читатель).
+ *
+ * @return true, если есть кадр новее полученного прошлый раз.
+ */
+internal bool
+wait_shared_frame(Shared_Frame_Ring* ring, u64 timeout_ns) {
+    Shared_Frame_Header* header = ring->header;
+    header->waiters.fetch_add(1, std::memory_order_seq_cst);
+    u32 ready = header->ready.load(std::memory_order_seq_cst);
+    if (header->published.load(std::memory_order_acquire) == ring->sequence) shared_futex_wait(&header->ready, ready, timeout_ns);
+    header->waiters.fetch_sub(1, std::memory_order_seq_cst);
+    return header->published.load(std::memory_order_acquire) != ring->sequence;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file shm_host.cpp
+ * @brief Безоконный матч ИИ против автопилота, который рисует кадры прямо в кольцо разделяемой памяти.
+ *
+ * Кадры читает другой процесс (shm_viewer) на месте, без копирования. Хост не ждёт
+ * читателей: каждый тик кадр рисуется в следующий слот кольца и публикуется.
+ *
+ * Использование:
+ *   shm_host [-name /pong_frames] [-slots N] [-size ширина высота] [-hz N] [-seconds N] [-checksum]
+ *
+ * -checksum записывает в слот хеш пикселей, по которому зритель проверяет целостность кадров.
+ * 0 секунд — работать бесконечно.
+ */
+
+#include "headless_platform.cpp"
+#include "shared_framebuffer.cpp"
+
+int main(int argc, char** argv) {
+    const char* name = "/pong_frames";
+    int slot_count = 4;
+    int width = 1280, height = 720;
+    int tick_hz = 60;
+    int seconds = 10;
+    bool checksum = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-name") && i + 1 < argc) name = argv[++i];
+        else if (!strcmp(argv[i], "-slots") && i + 1 < argc) slot_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-hz") && i + 1 < argc) tick_hz = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-seconds") && i + 1 < argc) seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-checksum")) checksum = true;
+        else if (!strcmp(argv[i], "-size") && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+    }
+    if (width < 1 || height < 1 || tick_hz < 1) return EXIT_FAILURE;
+
+    Shared_Frame_Ring ring;
+    if (!create_shared_frame_ring(&ring, name, slot_count, width, height)) return EXIT_FAILURE;
+    printf("shm_host: %s, %d slots of %dx%d, %d Hz\n", name, (int)ring.header->slot_count, width, height, tick_hz);
+    fflush(stdout);
+
+    Game_Memory memory;
+    if (!init_headless_memory(&memory, 64 << 20, 4 << 20)) return EXIT_FAILURE;
+    set_background_cache_memory((u32*)malloc((size_t)width * height * sizeof(u32)));
+    if (!GameStorageFromMemory(&memory)->history.bytes) {
+        printf("shm_host: state history does not fit in %zu bytes of permanent memory\n", memory.permanent.size);
+        return EXIT_FAILURE;
+    }
+    start_headless_match(GameStateFromMemory(&memory));
+
+    Input input = {};
+    const float dt = 1.f / tick_hz;
+    const u64 period_ns = 1000000000ull / tick_hz;
+    u64 next_tick_ns = headless_time_ns();
+    u64 frame_ns = 0, max_frame_ns = 0, publish_ns = 0;
+    int frames = 0, late = 0;
+    u64 report_ns = next_tick_ns;
+    for (u64 tick = 0; running && (seconds <= 0 || tick < (u64)seconds * tick_hz); tick++) {
+        timespec wake = { (time_t)(next_tick_ns / 1000000000ull), (long)(next_tick_ns % 1000000000ull) };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, 0);
+
+        u64 begin_ns = headless_time_ns();
+        if (begin_ns > next_tick_ns + period_ns) late++;
+        begin_shared_frame(&ring, width, height);
+        reset_arena(&memory.transient);
+        Game_State* state = GameStateFromMemory(&memory);
+        autopilot_input(&input, state->ball_p_y, state->player_2_p);
+        SimulateGame(&memory, &input, dt);
+        u64 rendered_ns = headless_time_ns();
+        publish_shared_frame(&ring, checksum);
+        u64 end_ns = headless_time_ns();
+
+        frame_ns += end_ns - begin_ns;
+        publish_ns += end_ns - rendered_ns;
+        if (end_ns - begin_ns > max_frame_ns) max_frame_ns = end_ns - begin_ns;
+        frames++;
+        next_tick_ns += period_ns;
+
+        if (end_ns - report_ns >= 1000000000ull) {
+            printf("frame %llu: %.3f ms/frame (max %.3f), publish %.1f us, %d late ticks\n",
+                   (unsigned long long)ring.sequence, (double)frame_ns / frames * 1e-6, (double)max_frame_ns * 1e-6,
+                   (double)publish_ns / frames * 1e-3, late);
+            fflush(stdout);
+            frame_ns = max_frame_ns = publish_ns = 0;
+            frames = 0;
+            report_ns = end_ns;
+        }
+    }
+
+    close_shared_frame_ring(&ring);
+    free_headless_memory(&memory);
+    return EXIT_SUCCESS;
+}
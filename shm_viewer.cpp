@@ -0,0 +1,91 @@
+/**
+ * @file shm_viewer.cpp
+ * @brief Зритель кольца кадров в разделяемой памяти: получает кадры на месте, считает пропуски и задержку.
+ *
+ * Зритель спит на futex до нового кадра, берёт самый новый кадр без копирования и после
+ * чтения проверяет, что хост не начал перезаписывать слот. Если хост записал хеш кадра,
+ * целый кадр сверяется с ним. С -record кадры дописываются в файл как есть (запись видео),
+ * с -slow_ms зритель нарочно тормозит после каждого кадра: хост при этом не замедляется,
+ * а зритель пропускает кадры.
+ *
+ * Использование:
+ *   shm_viewer [-name /pong_frames] [-frames N] [-slow_ms N] [-record файл]
+ *
+ * Код возврата ненулевой, если получено меньше frames кадров или хеш целого кадра не сошёлся.
+ */
+
+#include "headless_platform.cpp"
+#include "shared_framebuffer.cpp"
+
+/**
+ * @brief Сколько ждать кольцо и кадры, прежде чем решить, что хоста нет.
+ */
+global_variable constexpr u64 viewer_timeout_ns = 3000000000ull;
+
+int main(int argc, char** argv) {
+    const char* name = "/pong_frames";
+    int frame_limit = 600;
+    int slow_ms = 0;
+    const char* record_path = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-name") && i + 1 < argc) name = argv[++i];
+        else if (!strcmp(argv[i], "-frames") && i + 1 < argc) frame_limit = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-slow_ms") && i + 1 < argc) slow_ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-record") && i + 1 < argc) record_path = argv[++i];
+    }
+
+    Shared_Frame_Ring ring;
+    u64 begin_ns = headless_time_ns();
+    while (!open_shared_frame_ring(&ring, name)) {
+        if (headless_time_ns() - begin_ns > viewer_timeout_ns) {
+            fprintf(stderr, "shm_viewer: no frame ring %s\n", name);
+            return EXIT_FAILURE;
+        }
+        timespec pause = { 0, 10000000 };
+        nanosleep(&pause, 0);
+    }
+    FILE* record = record_path ? fopen(record_path, "wb") : 0;
+
+    int received = 0, torn = 0, corrupt = 0, verified = 0;
+    u64 dropped = 0, last_sequence = 0;
+    u64 latency_ns = 0, max_latency_ns = 0;
+    u64 last_frame_ns = headless_time_ns();
+    while (received < frame_limit) {
+        Shared_Frame frame;
+        if (!wait_shared_frame(&ring, 100000000ull) || !acquire_shared_frame(&ring, &frame)) {
+            if (headless_time_ns() - last_frame_ns > viewer_timeout_ns) break;
+            continue;
+        }
+        u64 now_ns = headless_time_ns();
+        last_frame_ns = now_ns;
+        u64 latency = now_ns - frame.publish_ns;
+        latency_ns += latency;
+        if (latency > max_latency_ns) max_latency_ns = latency;
+        if (last_sequence) dropped += frame.sequence - last_sequence - 1;
+        last_sequence = frame.sequence;
+        received++;
+
+        size_t pixel_count = (size_t)frame.width * frame.height;
+        u64 checksum = frame.checksum ? shared_frame_checksum(frame.pixels, pixel_count) : 0;
+        if (record) fwrite(frame.pixels, sizeof(u32), pixel_count, record);
+        if (!shared_frame_still_valid(&ring, &frame)) {
+            torn++;
+        } else if (frame.checksum) {
+            verified++;
+            if (checksum != frame.checksum) corrupt++;
+        }
+
+        if (slow_ms > 0) {
+            timespec pause = { slow_ms / 1000, (long)(slow_ms % 1000) * 1000000 };
+            nanosleep(&pause, 0);
+        }
+    }
+
+    printf("shm_viewer: %d frames (%d verified), %llu skipped, %d overwritten while read, %d corrupt, "
+           "latency mean %.1f us, max %.1f us\n",
+           received, verified, (unsigned long long)dropped, torn, corrupt,
+           received ? (double)latency_ns / received * 1e-3 : 0., (double)max_latency_ns * 1e-3);
+    if (record) fclose(record);
+    close_shared_frame_ring(&ring);
+    return received >= frame_limit && !corrupt ? EXIT_SUCCESS : EXIT_FAILURE;
+}
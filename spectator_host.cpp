@@ -0,0 +1,88 @@
+/**
+ * @file spectator_host.cpp
+ * @brief Безоконный матч ИИ против автопилота с трансляцией зрителям.
+ *
+ * Использование: spectator_host [адрес] [частота_тиков] [макс_зрителей] [секунд] [файл_сохранения]
+ * Адрес по умолчанию unix:/tmp/pong_spectate.sock, 0 секунд — работать бесконечно.
+ * С файлом сохранения матч продолжается с того места, где хост был остановлен.
+ * Если задано число секунд, код возврата ненулевой, когда хост остановился раньше.
+ */
+
+#include "headless_platform.cpp"
+#include "spectator_server.cpp"
+#include "save_state.cpp"
+
+int main(int argc, char** argv) {
+    const char* address = argc > 1 ? argv[1] : "unix:/tmp/pong_spectate.sock";
+    int tick_hz = argc > 2 ? atoi(argv[2]) : 60;
+    int max_viewers = argc > 3 ? atoi(argv[3]) : 10000;
+    int seconds = argc > 4 ? atoi(argv[4]) : 0;
+    const char* save_path = argc > 5 ? argv[5] : 0;
+    if (tick_hz <= 0) tick_hz = 60;
+
+    Spectator_Server server;
+    if (!open_spectator_server(&server, address, max_viewers, tick_hz)) {
+        fprintf(stderr, "spectator_host: cannot listen on %s\n", address);
+        return EXIT_FAILURE;
+    }
+    printf("spectator_host: %s, %d Hz, up to %d viewers\n", address, tick_hz, max_viewers);
+
+    // Зрителям нужны только координаты, поэтому матч не рисуется.
+    Game_State game_state = {};
+    start_headless_match(&game_state);
+    Save_File save_file = {};
+    if (save_path) {
+        if (!open_save_file(&save_file, save_path)) fprintf(stderr, "spectator_host: cannot open %s\n", save_path);
+        else if (load_save_state(&save_file, &game_state)) printf("spectator_host: resumed from %s\n", save_path);
+    }
+
+    Input input = {};
+    float dt = 1.f / (float)tick_hz;
+    u32 tick = 0;
+    u64 broadcast_ns = 0;
+    u64 broadcasts = 0;
+    u64 last_report = headless_time_ns();
+    bool finished = false;
+
+    while (running) {
+        u64 ticks = wait_spectator_tick(&server);
+        if (!ticks) break;
+
+        for (u64 i = 0; i < ticks; i++) {
+            autopilot_input(&input, game_state.ball_p_y, game_state.player_2_p);
+            StepGame(&game_state, &input, dt);
+            tick++;
+            if (game_state.event_count || tick % tick_hz == 0) commit_save_state(&save_file, &game_state);
+        }
+
+        u64 begin = headless_time_ns();
+        Spectator_Packet packet = make_spectator_packet(&game_state, tick, begin);
+        broadcast_spectator_packet(&server, &packet);
+        broadcast_ns += headless_time_ns() - begin;
+        broadcasts++;
+
+        if (begin - last_report >= 1000000000ull) {
+            printf("tick %u: %d viewers, %llu slow dropped, %llu closed, %llu rejected, broadcast %.1f us each, score %d:%d\n",
+                   tick, server.client_count,
+                   (unsigned long long)server.dropped_slow, (unsigned long long)server.closed,
+                   (unsigned long long)server.rejected,
+                   (double)broadcast_ns / 1000.0 / (double)broadcasts,
+                   game_state.player_1_score, game_state.player_2_score);
+            fflush(stdout);
+            broadcast_ns = 0;
+            broadcasts = 0;
+            last_report = begin;
+        }
+        if (seconds > 0 && tick >= (u32)(seconds * tick_hz)) {
+            finished = true;
+            running = false;
+        }
+    }
+    printf("spectator_host: %s after %u ticks, %d viewers, score %d:%d\n", finished ? "finished" : "stopped",
+           tick, server.client_count, game_state.player_1_score, game_state.player_2_score);
+
+    commit_save_state(&save_file, &game_state);
+    close_save_file(&save_file);
+    close_spectator_server(&server);
+    return seconds > 0 && !finished ? EXIT_FAILURE : EXIT_SUCCESS;
+}
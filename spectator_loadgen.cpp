@@ -0,0 +1,193 @@
+/**
+ * @file spectator_loadgen.cpp
+ * @brief Генератор нагрузки для spectator_host: тысячи зрителей и их задержки.
+ *
+ * Использование: spectator_loadgen [адрес] [зрителей] [секунд] [доля_медленных]
+ *
+ * Все зрители обслуживаются одним потоком через epoll. Задержка пакета —
+ * разница между CLOCK_MONOTONIC при получении и меткой времени отправки в пакете.
+ * "Медленные" зрители ничего не читают: сервер должен их отключить, а не копить им данные.
+ * Код возврата ненулевой, если подключились не все зрители или кто-то из читающих не получил ни одного пакета.
+ */
+
+#include "headless_platform.cpp"
+#include "spectator_server.cpp"
+
+/**
+ * @brief Верхняя граница гистограммы задержек в микросекундах.
+ */
+global_variable constexpr int latency_histogram_us = 100000;
+
+/**
+ * @struct Viewer
+ * @brief Состояние одного зрителя генератора нагрузки.
+ */
+struct Viewer {
+    int fd; /**< Сокет, -1 после отключения. */
+    bool slow; /**< Зритель не читает данные. */
+    int buffered; /**< Байт неполного пакета в buffer. */
+    u8 buffer[spectator_packet_size]; /**< Неполный пакет. */
+    u64 packets; /**< Получено пакетов. */
+    u64 latency_sum_ns; /**< Сумма задержек. */
+    u64 latency_max_ns; /**< Максимальная задержка. */
+};
+
+/**
+ * @brief Значение перцентиля из гистограммы с шагом 1 мкс.
+ */
+internal int
+histogram_percentile(const u64* histogram, u64 total, double fraction) {
+    u64 target = (u64)((double)total * fraction);
+    u64 seen = 0;
+    for (int i = 0; i <= latency_histogram_us; i++) {
+        seen += histogram[i];
+        if (seen > target) return i;
+    }
+    return latency_histogram_us;
+}
+
+internal int
+compare_u64(const void* a, const void* b) {
+    u64 x = *(const u64*)a, y = *(const u64*)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char** argv) {
+    const char* address = argc > 1 ? argv[1] : "unix:/tmp/pong_spectate.sock";
+    int viewer_count = argc > 2 ? atoi(argv[2]) : 1000;
+    int seconds = argc > 3 ? atoi(argv[3]) : 10;
+    double slow_fraction = argc > 4 ? atof(argv[4]) : 0.0;
+
+    raise_file_limit();
+    sockaddr_storage storage;
+    socklen_t length;
+    int family = parse_socket_address(address, &storage, &length);
+    if (family < 0) {
+        fprintf(stderr, "spectator_loadgen: bad address %s\n", address);
+        return EXIT_FAILURE;
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    Viewer* viewers = (Viewer*)calloc(viewer_count, sizeof(Viewer));
+    int slow_every = slow_fraction > 0 ? (int)(1.0 / slow_fraction) : 0;
+    int connected = 0;
+
+    int requested = viewer_count;
+    for (int i = 0; i < viewer_count; i++) {
+        Viewer* viewer = viewers + i;
+        viewer->fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool connected_now = viewer->fd >= 0 && connect(viewer->fd, (sockaddr*)&storage, length) == 0;
+        // Хост мог ещё не открыть сокет (запуск вместе с ним): первый зритель ждёт до двух секунд.
+        for (int retry = 0; i == 0 && viewer->fd >= 0 && !connected_now && retry < 40; retry++) {
+            timespec pause = { 0, 50000000 };
+            nanosleep(&pause, 0);
+            close(viewer->fd);
+            viewer->fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            connected_now = viewer->fd >= 0 && connect(viewer->fd, (sockaddr*)&storage, length) == 0;
+        }
+        if (!connected_now) {
+            fprintf(stderr, "spectator_loadgen: connect failed after %d viewers\n", connected);
+            if (viewer->fd >= 0) close(viewer->fd);
+            viewer->fd = -1;
+            viewer_count = i;
+            break;
+        }
+        fcntl(viewer->fd, F_SETFL, fcntl(viewer->fd, F_GETFL) | O_NONBLOCK);
+        // Медленным зрителям уменьшаем приёмный буфер, чтобы сервер упёрся в него быстрее.
+        viewer->slow = slow_every && i % slow_every == slow_every - 1;
+        if (viewer->slow) {
+            int small = 1024;
+            setsockopt(viewer->fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+        } else {
+            epoll_event event = {};
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.u32 = (u32)i;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, viewer->fd, &event);
+        }
+        connected++;
+    }
+    printf("spectator_loadgen: %d viewers connected to %s\n", connected, address);
+
+    u64* histogram = (u64*)calloc(latency_histogram_us + 1, sizeof(u64));
+    u64 total_packets = 0;
+    u64 begin = headless_time_ns();
+    u64 end = begin + (u64)seconds * 1000000000ull;
+    epoll_event events[512];
+
+    for (u64 now = begin; now < end; now = headless_time_ns()) {
+        int count = epoll_wait(epoll_fd, events, 512, 100);
+        u64 received_at = headless_time_ns();
+
+        for (int e = 0; e < count; e++) {
+            Viewer* viewer = viewers + events[e].data.u32;
+            if (viewer->fd < 0) continue;
+
+            for (;;) {
+                ssize_t got = recv(viewer->fd, viewer->buffer + viewer->buffered,
+                                   spectator_packet_size - viewer->buffered, 0);
+                if (got <= 0) {
+                    if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                        close(viewer->fd);
+                        viewer->fd = -1;
+                    }
+                    break;
+                }
+                viewer->buffered += (int)got;
+                if (viewer->buffered < spectator_packet_size) continue;
+                viewer->buffered = 0;
+
+                Spectator_Packet packet;
+                if (!read_spectator_packet(viewer->buffer, &packet)) continue;
+                u64 latency = received_at > packet.send_time_ns ? received_at - packet.send_time_ns : 0;
+                u64 bucket = latency / 1000;
+                histogram[bucket < (u64)latency_histogram_us ? bucket : latency_histogram_us]++;
+                viewer->packets++;
+                viewer->latency_sum_ns += latency;
+                if (latency > viewer->latency_max_ns) viewer->latency_max_ns = latency;
+                total_packets++;
+            }
+        }
+    }
+
+    // Медленных зрителей сервер должен был отключить: проверяем, закрыт ли сокет с той стороны.
+    int fast_alive = 0, fast_silent = 0, slow_total = 0, slow_dropped = 0;
+    u64* viewer_means = (u64*)calloc(viewer_count ? viewer_count : 1, sizeof(u64));
+    int measured = 0;
+    for (int i = 0; i < viewer_count; i++) {
+        Viewer* viewer = viewers + i;
+        if (viewer->slow) {
+            slow_total++;
+            u8 drain[4096];
+            ssize_t got;
+            while ((got = recv(viewer->fd, drain, sizeof(drain), MSG_DONTWAIT)) > 0) {}
+            if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) slow_dropped++;
+        } else {
+            if (viewer->fd >= 0) fast_alive++;
+            if (!viewer->packets) fast_silent++;
+            if (viewer->packets) viewer_means[measured++] = viewer->latency_sum_ns / viewer->packets;
+        }
+        if (viewer->fd >= 0) close(viewer->fd);
+    }
+    qsort(viewer_means, measured, sizeof(u64), compare_u64);
+
+    double elapsed = (double)(headless_time_ns() - begin) / 1e9;
+    printf("packets: %llu (%.0f/s)\n", (unsigned long long)total_packets, (double)total_packets / elapsed);
+    printf("latency us: p50 %d, p99 %d, p99.9 %d, max %d\n",
+           histogram_percentile(histogram, total_packets, 0.5),
+           histogram_percentile(histogram, total_packets, 0.99),
+           histogram_percentile(histogram, total_packets, 0.999),
+           histogram_percentile(histogram, total_packets, 1.0 - 1e-12));
+    if (measured) {
+        printf("per-viewer mean latency us: best %.1f, median %.1f, worst %.1f\n",
+               viewer_means[0] / 1000.0, viewer_means[measured / 2] / 1000.0, viewer_means[measured - 1] / 1000.0);
+    }
+    printf("fast viewers still connected: %d/%d, slow viewers dropped by server: %d/%d\n",
+           fast_alive, viewer_count - slow_total, slow_dropped, slow_total);
+    printf("viewers connected: %d/%d, fast viewers without packets: %d\n", connected, requested, fast_silent);
+
+    free(viewer_means);
+    free(histogram);
+    free(viewers);
+    close(epoll_fd);
+    return connected < requested || fast_silent ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,478 @@
+/**
+ * @file spectator_server.cpp
+ * @brief Раздача состояния матча зрителям через epoll (Linux).
+ *
+ * Один поток обслуживает тысячи подключений по Unix-сокету или TCP на loopback.
+ * Каждый тик состояние сериализуется один раз в общий буфер, и этот же буфер
+ * отправляется всем зрителям. Буферизации без ограничений нет: если зритель не
+ * успел принять предыдущий пакет к моменту следующего тика, он отключается.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @brief Версия формата пакета зрителя.
+ */
+global_variable constexpr u8 spectator_packet_version = 1;
+
+/**
+ * @brief Размер пакета зрителя в байтах (формат фиксированный).
+ */
+global_variable constexpr int spectator_packet_size = 44;
+
+/**
+ * @brief Размер буфера отправки сокета зрителя в байтах.
+ */
+global_variable constexpr int spectator_send_buffer = 16 * 1024;
+
+/**
+ * @struct Spectator_Packet
+ * @brief Состояние матча за один тик — то, что видит зритель.
+ *
+ * На проводе пакет занимает spectator_packet_size байт в порядке little-endian:
+ * u16 размер, u8 версия, u8 режим, u32 тик, u64 время отправки (нс, CLOCK_MONOTONIC),
+ * 6 x f32 (мяч x, y, dx, dy, ракетки 1 и 2), 2 x u16 счёт.
+ */
+struct Spectator_Packet {
+    u8 mode; /**< Текущий режим игры (Gamemode). */
+    u32 tick; /**< Номер тика. */
+    u64 send_time_ns; /**< Время отправки по CLOCK_MONOTONIC. */
+    float ball_p_x, ball_p_y, ball_dp_x, ball_dp_y; /**< Позиция и скорость мяча. */
+    float player_1_p, player_2_p; /**< Позиции ракеток. */
+    u16 player_1_score, player_2_score; /**< Счёт. */
+};
+
+/**
+ * @brief Записывает пакет в буфер в проводном формате.
+ *
+ * @param out Буфер размером не меньше spectator_packet_size.
+ * @param packet Пакет.
+ */
+internal void
+write_spectator_packet(u8* out, const Spectator_Packet* packet) {
+    u16 size = spectator_packet_size;
+    memcpy(out + 0, &size, 2);
+    out[2] = spectator_packet_version;
+    out[3] = packet->mode;
+    memcpy(out + 4, &packet->tick, 4);
+    memcpy(out + 8, &packet->send_time_ns, 8);
+    memcpy(out + 16, &packet->ball_p_x, 4);
+    memcpy(out + 20, &packet->ball_p_y, 4);
+    memcpy(out + 24, &packet->ball_dp_x, 4);
+    memcpy(out + 28, &packet->ball_dp_y, 4);
+    memcpy(out + 32, &packet->player_1_p, 4);
+    memcpy(out + 36, &packet->player_2_p, 4);
+    memcpy(out + 40, &packet->player_1_score, 2);
+    memcpy(out + 42, &packet->player_2_score, 2);
+}
+
+/**
+ * @brief Читает пакет из проводного формата.
+ *
+ * @param in Буфер размером не меньше spectator_packet_size.
+ * @param packet Куда записать результат.
+ *
+ * @return false, если размер или версия не совпадают.
+ */
+internal bool
+read_spectator_packet(const u8* in, Spectator_Packet* packet) {
+    u16 size;
+    memcpy(&size, in, 2);
+    if (size != spectator_packet_size || in[2] != spectator_packet_version) return false;
+    packet->mode = in[3];
+    memcpy(&packet->tick, in + 4, 4);
+    memcpy(&packet->send_time_ns, in + 8, 8);
+    memcpy(&packet->ball_p_x, in + 16, 4);
+    memcpy(&packet->ball_p_y, in + 20, 4);
+    memcpy(&packet->ball_dp_x, in + 24, 4);
+    memcpy(&packet->ball_dp_y, in + 28, 4);
+    memcpy(&packet->player_1_p, in + 32, 4);
+    memcpy(&packet->player_2_p, in + 36, 4);
+    memcpy(&packet->player_1_score, in + 40, 2);
+    memcpy(&packet->player_2_score, in + 42, 2);
+    return true;
+}
+
+/**
+ * @brief Снимает пакет с состояния матча.
+ *
+ * @param state Состояние матча.
+ * @param tick Номер тика.
+ * @param send_time_ns Время отправки.
+ */
+internal Spectator_Packet
+make_spectator_packet(const Game_State* state, u32 tick, u64 send_time_ns) {
+    Spectator_Packet packet = {};
+    packet.mode = (u8)state->current_gamemode;
+    packet.tick = tick;
+    packet.send_time_ns = send_time_ns;
+    packet.ball_p_x = state->ball_p_x;
+    packet.ball_p_y = state->ball_p_y;
+    packet.ball_dp_x = state->ball_dp_x;
+    packet.ball_dp_y = state->ball_dp_y;
+    packet.player_1_p = state->player_1_p;
+    packet.player_2_p = state->player_2_p;
+    packet.player_1_score = (u16)state->player_1_score;
+    packet.player_2_score = (u16)state->player_2_score;
+    return packet;
+}
+
+/**
+ * @brief Разбирает адрес вида "unix:/путь" или "tcp:127.0.0.1:порт".
+ *
+ * @param address Строка адреса.
+ * @param storage Куда записать адрес сокета.
+ * @param length Длина записанного адреса.
+ *
+ * @return Семейство адресов (AF_UNIX или AF_INET) или -1 при ошибке.
+ */
+internal int
+parse_socket_address(const char* address, sockaddr_storage* storage, socklen_t* length) {
+    memset(storage, 0, sizeof(*storage));
+    if (strncmp(address, "unix:", 5) == 0) {
+        sockaddr_un* un = (sockaddr_un*)storage;
+        un->sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(un->sun_path)) return -1;
+        strcpy(un->sun_path, address + 5);
+        *length = sizeof(sockaddr_un);
+        return AF_UNIX;
+    }
+    if (strncmp(address, "tcp:", 4) == 0) {
+        char host[64] = {};
+        int port = 0;
+        if (sscanf(address + 4, "%63[^:]:%d", host, &port) != 2) return -1;
+        sockaddr_in* in = (sockaddr_in*)storage;
+        in->sin_family = AF_INET;
+        in->sin_port = htons((u16)port);
+        if (inet_pton(AF_INET, host, &in->sin_addr) != 1) return -1;
+        *length = sizeof(sockaddr_in);
+        return AF_INET;
+    }
+    return -1;
+}
+
+/**
+ * @brief Поднимает лимит открытых файлов до жёсткого максимума.
+ *
+ * Нужен и серверу, и генератору нагрузки: тысячи сокетов не помещаются в типичный лимит 1024.
+ */
+internal void
+raise_file_limit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+/**
+ * @struct Spectator_Client
+ * @brief Подключённый зритель.
+ *
+ * Неотправленный хвост пакета — единственное, что сервер хранит для зрителя,
+ * поэтому память на одного зрителя ограничена размером одного пакета.
+ */
+struct Spectator_Client {
+    int fd; /**< Сокет зрителя, -1 для свободной записи. */
+    int pending_offset; /**< Сколько байт текущего пакета уже отправлено. */
+    int pending_size; /**< Сколько байт текущего пакета нужно отправить (0 — ничего не ждём). */
+    int next_free; /**< Следующая свободная запись в пуле. */
+};
+
+/**
+ * @struct Spectator_Server
+ * @brief Сервер зрителей: слушающий сокет, epoll, таймер тиков и пул клиентов.
+ */
+struct Spectator_Server {
+    int listen_fd, epoll_fd, timer_fd;
+    int address_family;
+    char unix_path[108]; /**< Путь Unix-сокета для удаления при закрытии. */
+
+    Spectator_Client* clients; /**< Пул клиентов фиксированного размера. */
+    int max_clients;
+    int client_count;
+    int first_free;
+
+    u8 packet[spectator_packet_size]; /**< Общий буфер пакета текущего тика. */
+
+    u64 accepted; /**< Всего принято подключений. */
+    u64 rejected; /**< Отклонено из-за заполненного пула. */
+    u64 dropped_slow; /**< Отключено медленных зрителей. */
+    u64 closed; /**< Зрителей, закрывших соединение сами. */
+    u64 bytes_sent; /**< Всего отправлено байт. */
+};
+
+/**
+ * @brief Маркер слушающего сокета в epoll_event.data.u64.
+ */
+global_variable constexpr u64 spectator_listen_tag = ~0ull;
+
+/**
+ * @brief Маркер таймера тиков в epoll_event.data.u64.
+ */
+global_variable constexpr u64 spectator_timer_tag = ~0ull - 1;
+
+/**
+ * @brief Открывает сервер зрителей.
+ *
+ * @param server Сервер.
+ * @param address Адрес "unix:/путь" или "tcp:127.0.0.1:порт".
+ * @param max_clients Размер пула зрителей.
+ * @param tick_hz Частота тиков.
+ *
+ * @return true при успехе.
+ */
+internal bool
+open_spectator_server(Spectator_Server* server, const char* address, int max_clients, int tick_hz) {
+    memset(server, 0, sizeof(*server));
+    raise_file_limit();
+
+    sockaddr_storage storage;
+    socklen_t length;
+    server->address_family = parse_socket_address(address, &storage, &length);
+    if (server->address_family < 0) return false;
+
+    server->listen_fd = socket(server->address_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0) return false;
+    if (server->address_family == AF_UNIX) {
+        strcpy(server->unix_path, ((sockaddr_un*)&storage)->sun_path);
+        unlink(server->unix_path);
+    } else {
+        int one = 1;
+        setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (bind(server->listen_fd, (sockaddr*)&storage, length) < 0 || listen(server->listen_fd, 4096) < 0) {
+        close(server->listen_fd);
+        return false;
+    }
+
+    // Период делится на секунды и наносекунды: tv_nsec должен быть меньше секунды (иначе EINVAL при 1 Гц).
+    server->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    long long period_ns = 1000000000ll / tick_hz;
+    itimerspec period = {};
+    period.it_interval.tv_sec = (time_t)(period_ns / 1000000000ll);
+    period.it_interval.tv_nsec = (long)(period_ns % 1000000000ll);
+    period.it_value = period.it_interval;
+    if (server->timer_fd < 0 || timerfd_settime(server->timer_fd, 0, &period, 0) < 0) {
+        if (server->timer_fd >= 0) close(server->timer_fd);
+        close(server->listen_fd);
+        return false;
+    }
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = spectator_listen_tag;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &event);
+    event.data.u64 = spectator_timer_tag;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->timer_fd, &event);
+
+    server->max_clients = max_clients;
+    server->clients = (Spectator_Client*)malloc(sizeof(Spectator_Client) * max_clients);
+    for (int i = 0; i < max_clients; i++) {
+        server->clients[i].fd = -1;
+        server->clients[i].next_free = i + 1 < max_clients ? i + 1 : -1;
+    }
+    server->first_free = max_clients ? 0 : -1;
+    return true;
+}
+
+/**
+ * @brief Отключает зрителя и возвращает его запись в пул.
+ */
+internal void
+drop_spectator(Spectator_Server* server, int index) {
+    Spectator_Client* client = server->clients + index;
+    close(client->fd); // close также удаляет сокет из epoll
+    client->fd = -1;
+    client->next_free = server->first_free;
+    server->first_free = index;
+    server->client_count--;
+}
+
+/**
+ * @brief Принимает все ожидающие подключения.
+ */
+internal void
+accept_spectators(Spectator_Server* server) {
+    for (;;) {
+        int fd = accept4(server->listen_fd, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        if (server->first_free < 0) {
+            server->rejected++;
+            close(fd);
+            continue;
+        }
+        // Ядро тоже не должно копить для зрителя больше нескольких сотен пакетов.
+        int send_buffer = spectator_send_buffer;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer));
+        if (server->address_family == AF_INET) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        int index = server->first_free;
+        Spectator_Client* client = server->clients + index;
+        server->first_free = client->next_free;
+        client->fd = fd;
+        client->pending_offset = 0;
+        client->pending_size = 0;
+        server->client_count++;
+        server->accepted++;
+
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = (u64)index;
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+/**
+ * @brief Досылает зрителю хвост текущего пакета.
+ *
+ * @return false, если зритель отключён из-за ошибки сокета.
+ */
+internal bool
+flush_spectator(Spectator_Server* server, int index) {
+    Spectator_Client* client = server->clients + index;
+    while (client->pending_offset < client->pending_size) {
+        ssize_t sent = send(client->fd, server->packet + client->pending_offset,
+                            client->pending_size - client->pending_offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            server->closed++;
+            drop_spectator(server, index);
+            return false;
+        }
+        client->pending_offset += (int)sent;
+        server->bytes_sent += (u64)sent;
+    }
+
+    bool waiting = client->pending_offset < client->pending_size;
+    if (!waiting) client->pending_size = 0;
+    epoll_event event = {};
+    event.events = (u32)EPOLLIN | (u32)EPOLLRDHUP | (waiting ? (u32)EPOLLOUT : 0u);
+    event.data.u64 = (u64)index;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+    return true;
+}
+
+/**
+ * @brief Рассылает пакет тика всем зрителям из одного общего буфера.
+ *
+ * Зритель, который ещё не принял предыдущий пакет целиком, отключается:
+ * сервер не копит для него очередь.
+ *
+ * @param server Сервер.
+ * @param packet Состояние тика.
+ */
+internal void
+broadcast_spectator_packet(Spectator_Server* server, const Spectator_Packet* packet) {
+    write_spectator_packet(server->packet, packet);
+
+    for (int i = 0; i < server->max_clients; i++) {
+        Spectator_Client* client = server->clients + i;
+        if (client->fd < 0) continue;
+        if (client->pending_size) {
+            server->dropped_slow++;
+            drop_spectator(server, i);
+            continue;
+        }
+
+        ssize_t sent = send(client->fd, server->packet, spectator_packet_size, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent == spectator_packet_size) {
+            server->bytes_sent += spectator_packet_size;
+            continue;
+        }
+        if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            server->closed++;
+            drop_spectator(server, i);
+            continue;
+        }
+
+        // Сокет заполнен: остаток досылается по EPOLLOUT до следующего тика.
+        client->pending_offset = sent > 0 ? (int)sent : 0;
+        client->pending_size = spectator_packet_size;
+        server->bytes_sent += sent > 0 ? (u64)sent : 0;
+        flush_spectator(server, i);
+    }
+}
+
+/**
+ * @brief Обслуживает сокеты, пока не наступит следующий тик.
+ *
+ * @param server Сервер.
+ *
+ * @return Количество тиков, прошедших с прошлого вызова (больше 1, если цикл отстаёт).
+ */
+internal u64
+wait_spectator_tick(Spectator_Server* server) {
+    epoll_event events[256];
+    for (;;) {
+        int count = epoll_wait(server->epoll_fd, events, 256, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+
+        u64 expirations = 0;
+        bool accept_pending = false;
+        for (int i = 0; i < count; i++) {
+            u64 tag = events[i].data.u64;
+            if (tag == spectator_listen_tag) {
+                accept_pending = true;
+            } else if (tag == spectator_timer_tag) {
+                u64 value;
+                if (read(server->timer_fd, &value, sizeof(value)) == sizeof(value)) expirations += value;
+            } else {
+                int index = (int)tag;
+                Spectator_Client* client = server->clients + index;
+                if (client->fd < 0) continue;
+                if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    server->closed++;
+                    drop_spectator(server, index);
+                } else if (events[i].events & EPOLLIN) {
+                    // Зрители ничего не присылают: читаем и выбрасываем.
+                    u8 scratch[256];
+                    ssize_t got = recv(client->fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+                    if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                        server->closed++;
+                        drop_spectator(server, index);
+                    }
+                } else if (events[i].events & EPOLLOUT) {
+                    flush_spectator(server, index);
+                }
+            }
+        }
+        // Принимаем после разбора событий, чтобы освободившиеся в этой пачке записи
+        // не получили чужие события.
+        if (accept_pending) accept_spectators(server);
+        if (expirations) return expirations;
+    }
+}
+
+/**
+ * @brief Закрывает сервер и все подключения.
+ */
+internal void
+close_spectator_server(Spectator_Server* server) {
+    for (int i = 0; i < server->max_clients; i++) {
+        if (server->clients[i].fd >= 0) close(server->clients[i].fd);
+    }
+    free(server->clients);
+    close(server->epoll_fd);
+    close(server->timer_fd);
+    close(server->listen_fd);
+    if (server->address_family == AF_UNIX) unlink(server->unix_path);
+}
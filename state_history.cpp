@@ -0,0 +1,479 @@
+/**
+ * @file state_history.cpp
+ * @brief История состояний матча по тикам для перемотки назад: дельты в кольце байтов с опорными кадрами.
+ *
+ * Каждый тик матча состояние (Game_State и dt тика) записывается как массив 32-битных слов.
+ * Раз в kHistoryKeyframeInterval тиков пишется опорный кадр (слова целиком), между ними —
+ * только остатки предсказания: слово предсказывается по прошлым тикам, и в запись попадают
+ * лишь слова с ненулевым остатком (zigzag varint). Мяч и ракетки движутся почти равномерно,
+ * поэтому биты их float меняются почти линейно, и обычный тик занимает несколько байт.
+ *
+ * Порядок предсказания выбирается для каждого слова отдельно на весь сегмент: 1 — прошлое
+ * приращение ноль, 2 — приращение как в прошлый тик, 3 — приращение меняется как в прошлый тик.
+ * Кодер считает, сколько байт стоил бы каждый порядок, и в опорном кадре ставит самый дешёвый
+ * по прошедшему сегменту. Набор изменившихся слов обычно тот же, что в прошлый тик; тогда
+ * запись не повторяет номера слов.
+ *
+ * Опорный кадр с дельтами до следующего — сегмент. Сегменты лежат в кольце байтов фиксированного
+ * размера; когда место кончается, выбрасывается самый старый сегмент целиком.
+ *
+ * Перемотка снимает записи с конца истории. Сегмент, из которого снимаются записи, один раз
+ * раскодируется в кэш целиком, поэтому шаг назад стоит копирования одного состояния.
+ */
+
+/**
+ * @brief Через сколько тиков пишется опорный кадр (длина сегмента).
+ */
+const int kHistoryKeyframeInterval = 240;
+
+/**
+ * @brief Размер кольца байтов истории (степень двойки).
+ */
+const size_t kStateHistoryBytes = 16 << 20;
+
+/**
+ * @brief Слов в записи: Game_State и dt тика.
+ */
+const int kHistoryWords = (int)(sizeof(Game_State) / sizeof(u32)) + 1;
+
+static_assert(sizeof(Game_State) % sizeof(u32) == 0, "Game_State is stored as 32-bit words");
+static_assert(kHistoryWords < 64, "changed words fit a 64-bit mask and their count fits the record byte");
+
+/**
+ * @brief Скорость перемотки относительно записанного времени.
+ */
+const float kRewindSpeed = 2.f;
+
+/**
+ * @brief Вид записи истории (младшие два бита первого байта записи; у kHistoryDelta в старших — число слов).
+ */
+enum History_Record_Kind {
+    kHistoryDelta, /**< Номера изменившихся слов и их остатки */
+    kHistoryKeyframe, /**< Порядки предсказания и все слова целиком */
+    kHistorySameWords, /**< Остатки тех же слов, что в прошлой записи */
+};
+
+/**
+ * @brief Размер опорного кадра: вид, порядки по два бита на слово, слова.
+ */
+const int kHistoryKeyframeBytes = 1 + (kHistoryWords + 3) / 4 + kHistoryWords * 4;
+
+/**
+ * @brief Наибольший размер записи в байтах (дельта со всеми словами).
+ */
+const int kMaxHistoryRecordBytes = 1 + kHistoryWords * (1 + 5) > kHistoryKeyframeBytes
+                                       ? 1 + kHistoryWords * (1 + 5) : kHistoryKeyframeBytes;
+
+/**
+ * @brief Состояние предсказателя после записи: по нему раскодируется следующая.
+ */
+struct History_Coder {
+    u32 words[kHistoryWords]; /**< Слова записи */
+    u32 deltas[kHistoryWords]; /**< Приращения слов к прошлой записи */
+    u32 second_deltas[kHistoryWords]; /**< Изменения приращений */
+    u8 orders[kHistoryWords]; /**< Порядок предсказания слова в сегменте (1-3) */
+    u64 changed; /**< Слова с ненулевым остатком в записи */
+};
+
+/**
+ * @brief Опорный кадр и следующие за ним дельты.
+ */
+struct History_Segment {
+    u64 offset; /**< Начало опорного кадра в кольце (позиция без маски) */
+    u64 first_tick; /**< Тик опорного кадра */
+    int count; /**< Записей в сегменте (с опорным кадром) */
+};
+
+/**
+ * @brief История состояний матча.
+ */
+struct State_History {
+    u8* bytes; /**< Кольцо байтов записей; 0 — история недоступна */
+    u64 mask; /**< Размер кольца - 1 */
+    u64 head, tail; /**< Конец последней записи и начало самого старого сегмента (позиции без маски) */
+
+    History_Segment* segments; /**< Кольцо сегментов */
+    u64 segment_capacity; /**< Размер кольца сегментов */
+    u64 first_segment, segment_end; /**< Самый старый сегмент и следующий за последним (номера без маски) */
+
+    History_Coder coder; /**< Предсказатель после последней записи */
+    u32 order_bytes[kHistoryWords][3]; /**< Байт остатков слова при каждом порядке с начала сегмента */
+
+    History_Coder* cache_coders; /**< Предсказатели после каждой записи сегмента cache_segment */
+    u64* cache_offsets; /**< Начала записей сегмента cache_segment */
+    u64 cache_segment; /**< Сегмент в кэше */
+    bool cache_valid; /**< Кэш заполнен */
+
+    float rewind_debt; /**< Сколько секунд перемотки ещё не снято с истории */
+};
+
+/**
+ * @brief Выделяет кольцо истории и кэш сегмента из арены.
+ *
+ * @param history История.
+ * @param arena Постоянная арена.
+ * @param bytes Размер кольца байтов (степень двойки).
+ * @return false, если в арене не хватило места (перемотка тогда недоступна).
+ */
+bool InitStateHistory(State_History* history, Memory_Arena* arena, size_t bytes) {
+    *history = State_History();
+    size_t mark = arena->used;
+    // Сегмент занимает не меньше опорного кадра, поэтому сегментов в кольце не больше, чем опорных кадров.
+    history->segment_capacity = bytes / kHistoryKeyframeBytes + 2;
+    history->bytes = (u8*)push_size(arena, bytes, 64);
+    history->segments = (History_Segment*)push_size(arena, sizeof(History_Segment) * history->segment_capacity, 64);
+    history->cache_coders = (History_Coder*)push_size(arena, sizeof(History_Coder) * kHistoryKeyframeInterval, 64);
+    history->cache_offsets = (u64*)push_size(arena, sizeof(u64) * kHistoryKeyframeInterval, 64);
+    if (!history->bytes || !history->segments || !history->cache_coders || !history->cache_offsets) {
+        arena->used = mark;
+        *history = State_History();
+        return false;
+    }
+    history->mask = bytes - 1;
+    return true;
+}
+
+/**
+ * @brief Забывает все записи.
+ */
+void ResetStateHistory(State_History* history) {
+    history->tail = history->head;
+    history->first_segment = history->segment_end;
+    history->cache_valid = false;
+    history->rewind_debt = 0;
+}
+
+/**
+ * @brief Сколько тиков хранит история.
+ */
+u64 StateHistoryTicks(const State_History* history) {
+    if (history->first_segment == history->segment_end) return 0;
+    const History_Segment* first = history->segments + history->first_segment % history->segment_capacity;
+    const History_Segment* last = history->segments + (history->segment_end - 1) % history->segment_capacity;
+    return last->first_tick + (u64)last->count - first->first_tick;
+}
+
+/**
+ * @brief Тик самой старой записи истории.
+ */
+u64 StateHistoryFirstTick(const State_History* history) {
+    return history->segments[history->first_segment % history->segment_capacity].first_tick;
+}
+
+/**
+ * @brief Пишет байт в кольцо истории.
+ */
+inline void PutHistoryByte(State_History* history, u64* at, u8 value) {
+    history->bytes[(*at)++ & history->mask] = value;
+}
+
+/**
+ * @brief Читает байт из кольца истории.
+ */
+inline u8 GetHistoryByte(const State_History* history, u64* at) {
+    return history->bytes[(*at)++ & history->mask];
+}
+
+/**
+ * @brief Пишет число в varint (7 бит на байт, младшие вперёд).
+ */
+inline void PutHistoryVarint(State_History* history, u64* at, u32 value) {
+    while (value >= 0x80) {
+        PutHistoryByte(history, at, (u8)(value | 0x80));
+        value >>= 7;
+    }
+    PutHistoryByte(history, at, (u8)value);
+}
+
+/**
+ * @brief Читает число в varint.
+ */
+inline u32 GetHistoryVarint(const State_History* history, u64* at) {
+    u32 value = 0;
+    for (int shift = 0;; shift += 7) {
+        u8 byte = GetHistoryByte(history, at);
+        value |= (u32)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+}
+
+/**
+ * @brief Остаток со знаком в zigzag: малые по модулю числа дают малые коды.
+ */
+inline u32 HistoryZigzag(u32 residual) {
+    return (residual << 1) ^ (0u - (residual >> 31));
+}
+
+/**
+ * @brief Сколько байт займёт остаток в записи (ноль не пишется).
+ */
+inline u32 HistoryResidualBytes(u32 residual) {
+    u32 zigzag = HistoryZigzag(residual);
+    u32 bytes = 0;
+    while (zigzag) {
+        bytes++;
+        zigzag >>= 7;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Остаток слова word при предсказании порядка order.
+ */
+inline u32 HistoryResidual(const History_Coder* coder, int i, int order, u32 word) {
+    u32 delta = word - coder->words[i];
+    if (order == 1) return delta;
+    if (order == 2) return delta - coder->deltas[i];
+    return delta - coder->deltas[i] - coder->second_deltas[i];
+}
+
+/**
+ * @brief Переводит предсказатель на следующую запись по остаткам всех слов.
+ */
+void AdvanceHistoryCoder(History_Coder* coder, const u32* residuals) {
+    for (int i = 0; i < kHistoryWords; i++) {
+        u32 delta = residuals[i];
+        if (coder->orders[i] >= 2) delta += coder->deltas[i];
+        if (coder->orders[i] == 3) delta += coder->second_deltas[i];
+        coder->second_deltas[i] = delta - coder->deltas[i];
+        coder->deltas[i] = delta;
+        coder->words[i] += delta;
+    }
+}
+
+/**
+ * @brief Начинает сегмент с опорного кадра words.
+ */
+void ResetHistoryCoder(History_Coder* coder, const u32* words) {
+    memcpy(coder->words, words, sizeof(coder->words));
+    memset(coder->deltas, 0, sizeof(coder->deltas));
+    memset(coder->second_deltas, 0, sizeof(coder->second_deltas));
+    coder->changed = 0;
+}
+
+/**
+ * @brief Раскодирует запись с позиции at поверх предсказателя предыдущей записи.
+ */
+void DecodeHistoryRecord(const State_History* history, u64* at, History_Coder* coder) {
+    u8 kind = GetHistoryByte(history, at);
+    if ((kind & 3) == kHistoryKeyframe) {
+        u8 packed = 0;
+        for (int i = 0; i < kHistoryWords; i++) {
+            if (i % 4 == 0) packed = GetHistoryByte(history, at);
+            coder->orders[i] = (u8)((packed >> (2 * (i % 4))) & 3);
+        }
+        u32 words[kHistoryWords];
+        for (int i = 0; i < kHistoryWords; i++) {
+            u32 word = 0;
+            for (int b = 0; b < 4; b++) word |= (u32)GetHistoryByte(history, at) << (8 * b);
+            words[i] = word;
+        }
+        ResetHistoryCoder(coder, words);
+        return;
+    }
+
+    u64 changed = coder->changed;
+    if ((kind & 3) == kHistoryDelta) {
+        changed = 0;
+        u32 count = kind >> 2;
+        int index = 0;
+        for (u32 c = 0; c < count; c++) {
+            index += (int)GetHistoryVarint(history, at);
+            changed |= 1ull << index;
+        }
+    }
+    u32 residuals[kHistoryWords];
+    for (int i = 0; i < kHistoryWords; i++) {
+        u32 zigzag = changed >> i & 1 ? GetHistoryVarint(history, at) : 0;
+        residuals[i] = (zigzag >> 1) ^ (0u - (zigzag & 1));
+    }
+    coder->changed = changed;
+    AdvanceHistoryCoder(coder, residuals);
+}
+
+/**
+ * @brief Раскодирует сегмент целиком в кэш.
+ */
+void CacheHistorySegment(State_History* history, u64 segment_index) {
+    if (history->cache_valid && history->cache_segment == segment_index) return;
+    const History_Segment* segment = history->segments + segment_index % history->segment_capacity;
+    History_Coder coder;
+    u64 at = segment->offset;
+    for (int r = 0; r < segment->count; r++) {
+        history->cache_offsets[r] = at;
+        DecodeHistoryRecord(history, &at, &coder);
+        history->cache_coders[r] = coder;
+    }
+    history->cache_segment = segment_index;
+    history->cache_valid = true;
+}
+
+/**
+ * @brief Записывает состояние после тика в конец истории.
+ *
+ * @param history История.
+ * @param state Состояние после тика.
+ * @param dt Длительность тика.
+ */
+void RecordStateHistory(State_History* history, const Game_State* state, float dt) {
+    if (!history->bytes) return;
+    history->rewind_debt = 0;
+    u32 words[kHistoryWords];
+    memcpy(words, state, sizeof(Game_State));
+    memcpy(words + kHistoryWords - 1, &dt, sizeof(dt));
+
+    History_Segment* newest = history->first_segment < history->segment_end
+                                  ? history->segments + (history->segment_end - 1) % history->segment_capacity : 0;
+    bool keyframe = !newest || newest->count == kHistoryKeyframeInterval;
+
+    // Место освобождается целыми сегментами с начала истории; текущий сегмент не выбрасывается.
+    u64 keep = keyframe ? 0 : 1;
+    while ((history->head + kMaxHistoryRecordBytes - history->tail > history->mask + 1 ||
+            (keyframe && history->segment_end - history->first_segment == history->segment_capacity)) &&
+           history->segment_end - history->first_segment > keep) {
+        if (history->cache_valid && history->cache_segment == history->first_segment) history->cache_valid = false;
+        history->first_segment++;
+        history->tail = history->first_segment < history->segment_end
+                            ? history->segments[history->first_segment % history->segment_capacity].offset : history->head;
+    }
+    if (history->head + kMaxHistoryRecordBytes - history->tail > history->mask + 1) return;
+
+    History_Coder* coder = &history->coder;
+    u64 at = history->head;
+    if (keyframe) {
+        u64 tick = newest ? newest->first_tick + (u64)newest->count : 0;
+        newest = history->segments + history->segment_end++ % history->segment_capacity;
+        newest->offset = at;
+        newest->first_tick = tick;
+        newest->count = 0;
+
+        // Порядок слова — самый дешёвый на прошедшем сегменте; без статистики — второй.
+        PutHistoryByte(history, &at, kHistoryKeyframe);
+        u8 packed = 0;
+        for (int i = 0; i < kHistoryWords; i++) {
+            u8 order = 2;
+            if (history->order_bytes[i][0] < history->order_bytes[i][order - 1]) order = 1;
+            if (history->order_bytes[i][2] < history->order_bytes[i][order - 1]) order = 3;
+            coder->orders[i] = order;
+            packed |= (u8)(order << (2 * (i % 4)));
+            if (i % 4 == 3 || i == kHistoryWords - 1) {
+                PutHistoryByte(history, &at, packed);
+                packed = 0;
+            }
+        }
+        for (int i = 0; i < kHistoryWords; i++) {
+            for (int b = 0; b < 4; b++) PutHistoryByte(history, &at, (u8)(words[i] >> (8 * b)));
+        }
+        ResetHistoryCoder(coder, words);
+        for (int i = 0; i < kHistoryWords; i++) {
+            for (int order = 0; order < 3; order++) history->order_bytes[i][order] /= 2;
+        }
+    } else {
+        u32 residuals[kHistoryWords];
+        u64 changed = 0;
+        int count = 0;
+        for (int i = 0; i < kHistoryWords; i++) {
+            for (int order = 1; order <= 3; order++) {
+                history->order_bytes[i][order - 1] += HistoryResidualBytes(HistoryResidual(coder, i, order, words[i]));
+            }
+            residuals[i] = HistoryResidual(coder, i, coder->orders[i], words[i]);
+            if (residuals[i]) {
+                changed |= 1ull << i;
+                count++;
+            }
+        }
+        if (changed == coder->changed) {
+            PutHistoryByte(history, &at, kHistorySameWords);
+        } else {
+            PutHistoryByte(history, &at, (u8)(kHistoryDelta | count << 2));
+            int previous = 0;
+            for (int i = 0; i < kHistoryWords; i++) {
+                if (!residuals[i]) continue;
+                PutHistoryVarint(history, &at, (u32)(i - previous));
+                previous = i;
+            }
+        }
+        for (int i = 0; i < kHistoryWords; i++) {
+            if (residuals[i]) PutHistoryVarint(history, &at, HistoryZigzag(residuals[i]));
+        }
+        coder->changed = changed;
+        AdvanceHistoryCoder(coder, residuals);
+    }
+
+    if (history->cache_valid && history->cache_segment == history->segment_end - 1) {
+        history->cache_offsets[newest->count] = history->head;
+        history->cache_coders[newest->count] = *coder;
+    }
+    newest->count++;
+    history->head = at;
+}
+
+/**
+ * @brief Снимает последнюю запись истории и возвращает состояние, ставшее последним.
+ *
+ * @param history История.
+ * @param state Куда записать состояние, ставшее последним.
+ * @param dt Длительность снятого тика.
+ * @return false, если в истории меньше двух записей (назад идти некуда).
+ */
+bool PopStateHistory(State_History* history, Game_State* state, float* dt) {
+    if (StateHistoryTicks(history) < 2) return false;
+    u64 newest_index = history->segment_end - 1;
+    History_Segment* newest = history->segments + newest_index % history->segment_capacity;
+    CacheHistorySegment(history, newest_index);
+    memcpy(dt, history->cache_coders[newest->count - 1].words + kHistoryWords - 1, sizeof(*dt));
+    history->head = history->cache_offsets[newest->count - 1];
+    if (--newest->count == 0) {
+        history->segment_end--;
+        newest = history->segments + --newest_index % history->segment_capacity;
+        CacheHistorySegment(history, newest_index);
+    }
+
+    history->coder = history->cache_coders[newest->count - 1];
+    memcpy(state, history->coder.words, sizeof(Game_State));
+    return true;
+}
+
+/**
+ * @brief Восстанавливает состояние любого тика из истории (без изменения истории).
+ *
+ * @return false, если тика в истории нет.
+ */
+bool ReadStateHistory(const State_History* history, u64 tick, Game_State* state, float* dt) {
+    u64 ticks = StateHistoryTicks(history);
+    if (!ticks) return false;
+    u64 first_tick = StateHistoryFirstTick(history);
+    if (tick < first_tick || tick >= first_tick + ticks) return false;
+    // Все сегменты, кроме последнего, полные.
+    u64 segment_index = history->first_segment + (tick - first_tick) / kHistoryKeyframeInterval;
+    const History_Segment* segment = history->segments + segment_index % history->segment_capacity;
+    History_Coder coder;
+    u64 at = segment->offset;
+    for (u64 t = segment->first_tick; t <= tick; t++) DecodeHistoryRecord(history, &at, &coder);
+    memcpy(state, coder.words, sizeof(Game_State));
+    memcpy(dt, coder.words + kHistoryWords - 1, sizeof(*dt));
+    return true;
+}
+
+/**
+ * @brief Перематывает матч назад на seconds секунд записанного времени.
+ *
+ * Снимаются целые тики; остаток переносится на следующий кадр, поэтому перемотка идёт
+ * с постоянной скоростью при любой частоте кадров и тиков.
+ *
+ * @return false, если история кончилась.
+ */
+bool RewindStateHistory(State_History* history, Game_State* state, float seconds) {
+    history->rewind_debt += seconds;
+    float dt;
+    while (history->rewind_debt > 0) {
+        if (!PopStateHistory(history, state, &dt)) {
+            history->rewind_debt = 0;
+            return false;
+        }
+        history->rewind_debt -= dt;
+    }
+    // События снятого тика уже показаны: восстановленное состояние их не повторяет.
+    state->event_count = 0;
+    return true;
+}
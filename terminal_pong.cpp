@@ -0,0 +1,219 @@
+/**
+ * @file terminal_pong.cpp
+ * @brief Игра в терминале (например, по SSH): кадр выводится символами Брайля или полублоками.
+ *
+ * Кадр рисуется обычным рендерером в буфер размером с область терминала в пикселях
+ * ячеек, и в терминал уходят только изменившиеся ячейки. Управление: стрелки — первый
+ * игрок и меню, W/S — второй игрок, Enter, Esc, Backspace — перемотка матча назад;
+ * q — выход. Терминал не сообщает об отпускании клавиш, поэтому клавиша считается
+ * зажатой, пока приходят её автоповторы.
+ *
+ * Использование:
+ *   terminal_pong [-mode braille|half] [-frames N] [-size столбцы строки]
+ *
+ * С -frames игра идёт N кадров без клавиатуры (ИИ против автопилота) — так замеряется
+ * объём вывода, например: terminal_pong -frames 600 > /dev/null.
+ *
+ * Без -size область следует за размером терминала: по SIGWINCH размер перечитывается,
+ * а ячейки и буфер кадра создаются заново, и следующий кадр выводится целиком.
+ */
+
+#include "headless_platform.cpp"
+#include "terminal_renderer.cpp"
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * @brief Частота кадров.
+ */
+global_variable constexpr int terminal_frame_hz = 60;
+
+/**
+ * @brief Сколько кадров клавиша считается зажатой после последнего нажатия или автоповтора.
+ */
+global_variable constexpr int terminal_key_hold_frames = 8;
+
+/**
+ * @brief Настройки терминала до перевода в неканонический режим.
+ */
+global_variable termios terminal_saved_mode;
+
+/**
+ * @brief Терминал сменил размер (SIGWINCH); сбрасывается игровым циклом.
+ */
+global_variable volatile sig_atomic_t terminal_resized;
+
+internal void
+handle_terminal_signal(int) {
+    running = false;
+}
+
+internal void
+handle_terminal_resize(int) {
+    terminal_resized = 1;
+}
+
+/**
+ * @brief Размер области вывода по размеру терминала: последняя строка — под счётчики.
+ *
+ * @return false, если вывод не в терминал (тогда область 80x23).
+ */
+internal bool
+query_terminal_size(int* columns, int* rows) {
+    winsize size = {};
+    bool has_size = isatty(STDOUT_FILENO) && ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col && size.ws_row > 1;
+    *columns = has_size ? size.ws_col : 80;
+    *rows = has_size ? size.ws_row - 1 : 23;
+    return has_size;
+}
+
+/**
+ * @brief Пишет буфер в дескриптор целиком.
+ */
+internal void
+write_all(int fd, const char* data, size_t size) {
+    while (size) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) return;
+        data += written;
+        size -= (size_t)written;
+    }
+}
+
+/**
+ * @brief Читает доступные нажатия и продлевает удержание соответствующих кнопок.
+ *
+ * @param hold Сколько кадров ещё держать каждую кнопку.
+ */
+internal void
+read_terminal_keys(int* hold) {
+    char keys[64];
+    ssize_t count = read(STDIN_FILENO, keys, sizeof(keys));
+    for (ssize_t i = 0; i < count; i++) {
+        int button = -1;
+        if (keys[i] == '\x1b' && i + 2 < count && keys[i + 1] == '[') {
+            switch (keys[i + 2]) {
+            case 'A': button = BUTTON_UP; break;
+            case 'B': button = BUTTON_DOWN; break;
+            case 'C': button = BUTTON_RIGHT; break;
+            case 'D': button = BUTTON_LEFT; break;
+            }
+            i += 2;
+        } else {
+            switch (keys[i]) {
+            case '\x1b': button = BUTTON_ESC; break;
+            case '\r': case '\n': button = BUTTON_ENTER; break;
+            case 'w': case 'W': button = BUTTON_W; break;
+            case 's': case 'S': button = BUTTON_S; break;
+            case '\x7f': case '\b': button = BUTTON_BACKSPACE; break;
+            case 'q': case 'Q': running = false; break;
+            }
+        }
+        if (button >= 0) hold[button] = terminal_key_hold_frames;
+    }
+}
+
+int main(int argc, char** argv) {
+    Terminal_Mode mode = TERMINAL_BRAILLE;
+    int frame_count = 0;
+    int columns = 0, rows = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-mode") && i + 1 < argc) mode = strcmp(argv[++i], "half") ? TERMINAL_BRAILLE : TERMINAL_HALF_BLOCK;
+        else if (!strcmp(argv[i], "-frames") && i + 1 < argc) frame_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-size") && i + 2 < argc) {
+            columns = atoi(argv[++i]);
+            rows = atoi(argv[++i]);
+        }
+    }
+    bool interactive = !frame_count && isatty(STDIN_FILENO);
+    bool follow_terminal = !columns || !rows;
+    if (follow_terminal) query_terminal_size(&columns, &rows);
+
+    Game_Memory memory;
+    if (!init_headless_memory(&memory, 64 << 20, 16 << 20)) return EXIT_FAILURE;
+    Terminal_Renderer terminal = {};
+    int cell_width, cell_height;
+    terminal_cell_pixels(mode, &cell_width, &cell_height);
+    if (!init_terminal_renderer(&terminal, mode, columns, rows)) return EXIT_FAILURE;
+    resize_headless_framebuffer(columns * cell_width, rows * cell_height);
+    if (!interactive) start_headless_match(GameStateFromMemory(&memory));
+
+    if (interactive) {
+        tcgetattr(STDIN_FILENO, &terminal_saved_mode);
+        termios raw = terminal_saved_mode;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+    signal(SIGINT, handle_terminal_signal);
+    signal(SIGTERM, handle_terminal_signal);
+    if (follow_terminal) signal(SIGWINCH, handle_terminal_resize);
+    write_all(STDOUT_FILENO, "\x1b[?25l", 6);
+
+    Input input = {};
+    int hold[BUTTON_COUNT] = {};
+    int exit_code = EXIT_SUCCESS;
+    const float dt = 1.f / terminal_frame_hz;
+    u64 next_frame_ns = headless_time_ns();
+    for (int frame = 1; running && (!frame_count || frame <= frame_count); frame++) {
+        if (terminal_resized) {
+            terminal_resized = 0;
+            int new_columns, new_rows;
+            if (query_terminal_size(&new_columns, &new_rows) && (new_columns != columns || new_rows != rows)) {
+                columns = new_columns;
+                rows = new_rows;
+                // Счётчики кадров сбрасываются вместе с ячейками: итог — за последний размер.
+                if (!init_terminal_renderer(&terminal, mode, columns, rows)) {
+                    exit_code = EXIT_FAILURE;
+                    break;
+                }
+                resize_headless_framebuffer(columns * cell_width, rows * cell_height);
+            }
+        }
+
+        if (interactive) {
+            read_terminal_keys(hold);
+            for (int i = 0; i < BUTTON_COUNT; i++) {
+                bool is_down = hold[i] > 0;
+                input.buttons[i].changed = input.buttons[i].is_down != is_down;
+                input.buttons[i].is_down = is_down;
+                if (hold[i]) hold[i]--;
+            }
+            if (input.buttons[BUTTON_ESC].is_down && input.buttons[BUTTON_ESC].changed && GameStateFromMemory(&memory)->current_gamemode == kMenu) running = false;
+        } else {
+            Game_State* state = GameStateFromMemory(&memory);
+            autopilot_input(&input, state->ball_p_y, state->player_2_p);
+        }
+
+        reset_arena(&memory.transient);
+        SimulateGame(&memory, &input, dt);
+        encode_terminal_frame(&terminal, (const u32*)render_state.memory, render_state.width, render_state.height);
+        write_all(STDOUT_FILENO, terminal.output, terminal.output_size);
+
+        if (interactive) {
+            char status[128];
+            int length = snprintf(status, sizeof(status), "\x1b[0m\x1b[%d;1H\x1b[K%llu B/frame, encode %.0f us",
+                                  rows + 1, (unsigned long long)terminal.output_size,
+                                  (double)terminal.encode_ns / (double)terminal.frames / 1000.0);
+            write_all(STDOUT_FILENO, status, (size_t)length);
+            next_frame_ns += 1000000000ull / terminal_frame_hz;
+            u64 now = headless_time_ns();
+            if (next_frame_ns > now) {
+                timespec wait = { (time_t)((next_frame_ns - now) / 1000000000ull), (long)((next_frame_ns - now) % 1000000000ull) };
+                nanosleep(&wait, 0);
+            } else {
+                next_frame_ns = now;
+            }
+        }
+    }
+
+    write_all(STDOUT_FILENO, "\x1b[0m\x1b[?25h\n", 11);
+    if (interactive) tcsetattr(STDIN_FILENO, TCSANOW, &terminal_saved_mode);
+    report_terminal_stats(&terminal, stderr, terminal_frame_hz);
+    free_terminal_renderer(&terminal);
+    free_headless_memory(&memory);
+    return exit_code;
+}
@@ -57,6 +57,15 @@ TEST(AabbVsAabbTest, NoIntersection) {
     EXPECT_FALSE(AabbVsAabb(0, 0, 1, 1, -3, -3, 1, 1));
 }
 
+/**
+ * @brief Tests a tall box overlapping the bottom edge of a short box in AabbVsAabb function.
+ */
+TEST(AabbVsAabbTest, BottomEdgeOverlap) {
+    EXPECT_TRUE(AabbVsAabb(0, 0, 1, 5, 0, 0, 1, 1));
+    EXPECT_TRUE(AabbVsAabb(0, 2, 1, 1, 0, 0, 1, 12));
+    EXPECT_FALSE(AabbVsAabb(0, 2, 1, 1, 0, 0, 1, 1));
+}
+
 /**
  * @brief Tests the ball collision with the player in SimulateGame function.
  */
@@ -64,7 +73,7 @@ TEST(GameSimulationTest, BallCollisionWithPlayer) {
     float ball_p_x = 79.0f, ball_p_y = 0.0f, ball_half_size = 1.0f;
     float ball_dp_x = 130.0f, ball_dp_y = 0.0f;
     float player_1_p = 0.0f, player_half_size_x = 2.5f, player_half_size_y = 12.0f;
-    float dt = 0.1f;
+    float dt = 0.01f;
 
     ball_p_x += ball_dp_x * dt;
     if (AabbVsAabb(ball_p_x, ball_p_y, ball_half_size, ball_half_size, 80, player_1_p, player_half_size_x, player_half_size_y)) {
@@ -0,0 +1,340 @@
+/**
+ * @file tournament.cpp
+ * @brief Турнир ботов из разделяемых библиотек: круговая система, матчи параллельно на всех ядрах, рейтинг Эло.
+ *
+ * Каждая пара ботов играет games матчей по ticks тиков; в соседних матчах пары боты
+ * меняются сторонами при одной и той же подаче. Подачи задаются номером матча, поэтому
+ * результаты не зависят от количества потоков. Потоки берут матчи по очереди из общего
+ * счётчика; рейтинг Эло считается после всех матчей в порядке их номеров.
+ *
+ * Бот, ответы которого опоздали больше max_overruns раз (бюджет — budget_us
+ * процессорного времени на вызов), проигрывает матч досрочно.
+ *
+ * Каждый матч играется в дочернем процессе (fork), а поток турнира сторожит его: вызов
+ * act дольше hang_ms по часам считается зависанием, процесс матча убивается, и
+ * зависший бот проигрывает. Так же проигрывает бот, процесс которого упал внутри act.
+ * Результаты матча процесс пишет прямо в общую (MAP_SHARED) память матчей.
+ *
+ * Использование:
+ *   tournament [-ticks N] [-games N] [-budget_us N] [-max_overruns N] [-hang_ms N] [-threads N] [-rules имя]
+ *              бот.so бот.so...
+ */
+
+#include "headless_platform.cpp"
+#include "bot_plugin.cpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief Наибольшее количество ботов в турнире.
+ */
+global_variable constexpr int max_tournament_bots = 64;
+
+/**
+ * @brief Частота тиков матчей.
+ */
+global_variable constexpr int tournament_tick_hz = 60;
+
+/**
+ * @struct Tournament_Match
+ * @brief Матч турнира и его результат.
+ */
+struct Tournament_Match {
+    int bots[2]; /**< Боты первой (справа) и второй (слева) ракеток. */
+    u32 seed; /**< Подача. */
+    int points[2]; /**< Очки ботов. */
+    bool forfeit[2]; /**< Проиграл ли бот досрочно (опоздания, зависание или падение). */
+    bool hung[2]; /**< Завис или упал ли бот внутри act. */
+    int ticks; /**< Сыграно тиков. */
+    Bot_Player players[2]; /**< Статистика вызовов ботов. */
+    std::atomic<u64> call_started_ns[2]; /**< Начало текущего вызова act ботов (пишет процесс матча, читает сторож). */
+};
+
+/**
+ * @struct Tournament
+ * @brief Параметры и матчи турнира, общие для потоков.
+ */
+struct Tournament {
+    Bot_Plugin* plugins; /**< Боты. */
+    Tournament_Match* matches; /**< Все матчи. */
+    int match_count; /**< Количество матчей. */
+    int ticks; /**< Тиков в матче. */
+    int max_overruns; /**< Сколько опозданий бот может допустить в матче. */
+    u64 budget_ns; /**< Бюджет на вызов бота. */
+    u64 hang_ns; /**< Вызов дольше этого (по часам) — зависание. */
+    Game_Rules rules; /**< Правила матчей. */
+    std::atomic<int> next_match; /**< Следующий свободный матч. */
+};
+
+/**
+ * @brief Начинает матч с подачи, заданной seed: высота, направление и наклон мяча.
+ */
+internal void
+start_tournament_match(Game_State* state, Game_Rules rules, u32 seed) {
+    *state = Game_State();
+    state->current_gamemode = kGameplay;
+    state->enemy_is_ai = false;
+    state->rules = rules;
+    u32 random = seed * 0x9e3779b9u + 0x7f4a7c15u;
+    random ^= random >> 15;
+    random *= 0x2c1b3c6du;
+    random ^= random >> 12;
+    state->ball_p_y = (float)(random % 61) - 30.f;
+    state->ball_dp_y = (float)((random >> 8) % 81) - 40.f;
+    if (random & 0x80000000u) state->ball_dp_x = -state->ball_dp_x;
+}
+
+/**
+ * @brief Играет матч: оба бота отвечают каждый тик, затем шаг StepGame.
+ */
+internal void
+play_tournament_match(Tournament* tournament, Tournament_Match* match) {
+    const float dt = 1.f / tournament_tick_hz;
+    Game_State state;
+    start_tournament_match(&state, tournament->rules, match->seed);
+    Input input = {};
+    for (int side = 0; side < 2; side++) {
+        start_bot_player(match->players + side, tournament->plugins + match->bots[side], side, tournament->budget_ns);
+        match->players[side].call_started_ns = match->call_started_ns + side;
+    }
+
+    int tick = 0;
+    for (; tick < tournament->ticks; tick++) {
+        run_bot_player(match->players + 0, &state, &input, (u32)tick, dt);
+        run_bot_player(match->players + 1, &state, &input, (u32)tick, dt);
+        match->forfeit[0] = match->players[0].overruns > tournament->max_overruns;
+        match->forfeit[1] = match->players[1].overruns > tournament->max_overruns;
+        if (match->forfeit[0] || match->forfeit[1]) break;
+        StepGame(&state, &input, dt);
+    }
+
+    for (int side = 0; side < 2; side++) finish_bot_player(match->players + side);
+    match->ticks = tick;
+    // Очко player_2_score получает правая ракетка, player_1_score — левая.
+    match->points[0] = state.player_2_score;
+    match->points[1] = state.player_1_score;
+}
+
+/**
+ * @brief Играет матч в дочернем процессе и сторожит его.
+ *
+ * Если вызов act бота идёт дольше hang_ns, процесс убивается, а бот проигрывает матч
+ * досрочно; так же, если процесс упал внутри act. Если процесс создать не удалось,
+ * матч играется в этом потоке без сторожа.
+ */
+internal void
+run_tournament_match(Tournament* tournament, Tournament_Match* match) {
+    pid_t child = fork();
+    if (child < 0) {
+        play_tournament_match(tournament, match);
+        return;
+    }
+    if (child == 0) {
+        play_tournament_match(tournament, match);
+        _exit(0);
+    }
+
+    // Процесс будит сторожа, завершившись; пока он жив, сторож проверяет вызовы четыре раза за hang_ns.
+    int process_fd = (int)syscall(SYS_pidfd_open, child, 0);
+    int poll_ms = (int)(tournament->hang_ns / 4000000) + 1;
+    int status = 0;
+    int hung = -1;
+    while (waitpid(child, &status, WNOHANG) != child) {
+        u64 now_ns = headless_time_ns();
+        for (int side = 0; side < 2; side++) {
+            u64 started_ns = match->call_started_ns[side].load(std::memory_order_relaxed);
+            if (started_ns && now_ns - started_ns > tournament->hang_ns) hung = side;
+        }
+        if (hung >= 0) {
+            kill(child, SIGKILL);
+            waitpid(child, &status, 0);
+            break;
+        }
+        if (process_fd >= 0) {
+            pollfd process = { process_fd, POLLIN, 0 };
+            poll(&process, 1, poll_ms);
+        } else {
+            timespec pause = { 0, 1000000 };
+            nanosleep(&pause, 0);
+        }
+    }
+    if (process_fd >= 0) close(process_fd);
+
+    if (hung < 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+        // Процесс упал: виноват бот, внутри act которого это случилось.
+        for (int side = 0; side < 2; side++) {
+            if (match->call_started_ns[side].load(std::memory_order_relaxed)) hung = side;
+        }
+        if (hung < 0) fprintf(stderr, "tournament: match process %d failed outside the bots\n", (int)child);
+    }
+    if (hung >= 0) {
+        match->hung[hung] = true;
+        match->forfeit[hung] = true;
+    }
+}
+
+/**
+ * @brief Поток турнира: играет матчи, пока они не кончатся.
+ */
+internal void
+tournament_worker(Tournament* tournament) {
+    for (;;) {
+        int index = tournament->next_match.fetch_add(1, std::memory_order_relaxed);
+        if (index >= tournament->match_count) return;
+        run_tournament_match(tournament, tournament->matches + index);
+    }
+}
+
+/**
+ * @brief Итог матча для бота на стороне side: 1 — победа, .5 — ничья, 0 — поражение.
+ */
+internal float
+tournament_match_score(const Tournament_Match* match, int side) {
+    int other = 1 - side;
+    if (match->forfeit[side] != match->forfeit[other]) return match->forfeit[side] ? 0.f : 1.f;
+    if (match->forfeit[side]) return .5f;
+    if (match->points[side] == match->points[other]) return .5f;
+    return match->points[side] > match->points[other] ? 1.f : 0.f;
+}
+
+/**
+ * @struct Tournament_Standing
+ * @brief Строка итоговой таблицы.
+ */
+struct Tournament_Standing {
+    int bot; /**< Номер бота. */
+    int wins, draws, losses; /**< Итоги матчей. */
+    int forfeits; /**< Досрочных поражений. */
+    int hangs; /**< Из них из-за зависаний и падений. */
+    int points_for, points_against; /**< Забито и пропущено. */
+    u64 calls, total_ns, max_ns; /**< Вызовы act. */
+    u64 overruns; /**< Отброшенные ответы. */
+    double rating; /**< Рейтинг Эло. */
+};
+
+int main(int argc, char** argv) {
+    Tournament tournament;
+    tournament.ticks = 3600;
+    tournament.max_overruns = tournament_tick_hz;
+    tournament.budget_ns = 50000;
+    tournament.hang_ns = 1000000000;
+    tournament.rules = kRulesStandard;
+    tournament.next_match = 0;
+    int games = 4;
+    int thread_count = (int)std::thread::hardware_concurrency();
+    const char* paths[max_tournament_bots];
+    int bot_count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-ticks") && i + 1 < argc) tournament.ticks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-games") && i + 1 < argc) games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-budget_us") && i + 1 < argc) tournament.budget_ns = (u64)atoi(argv[++i]) * 1000;
+        else if (!strcmp(argv[i], "-max_overruns") && i + 1 < argc) tournament.max_overruns = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-hang_ms") && i + 1 < argc) tournament.hang_ns = (u64)atoi(argv[++i]) * 1000000;
+        else if (!strcmp(argv[i], "-threads") && i + 1 < argc) thread_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-rules") && i + 1 < argc) tournament.rules = GameRulesFromName(argv[++i]);
+        else if (argv[i][0] != '-' && bot_count < max_tournament_bots) paths[bot_count++] = argv[i];
+    }
+    if (bot_count < 2 || tournament.ticks < 1 || games < 1) {
+        fprintf(stderr, "usage: tournament [-ticks N] [-games N] [-budget_us N] [-max_overruns N] [-hang_ms N] [-threads N] [-rules name] "
+                        "bot.so bot.so...\n");
+        return EXIT_FAILURE;
+    }
+    if (thread_count < 1) thread_count = 1;
+
+    Bot_Plugin plugins[max_tournament_bots];
+    for (int i = 0; i < bot_count; i++) {
+        if (!load_bot_plugin(plugins + i, paths[i])) return EXIT_FAILURE;
+    }
+    tournament.plugins = plugins;
+
+    // Круговая система: в соседних матчах пары одна подача и боты на разных сторонах.
+    tournament.match_count = bot_count * (bot_count - 1) / 2 * games;
+    // Матчи в общей памяти: процессы матчей пишут туда результаты.
+    size_t matches_size = (size_t)tournament.match_count * sizeof(Tournament_Match);
+    void* matches = mmap(0, matches_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (matches == MAP_FAILED) return EXIT_FAILURE;
+    tournament.matches = (Tournament_Match*)matches;
+    int index = 0;
+    for (int a = 0; a < bot_count; a++) {
+        for (int b = a + 1; b < bot_count; b++) {
+            for (int game = 0; game < games; game++, index++) {
+                Tournament_Match* match = tournament.matches + index;
+                match->bots[0] = game & 1 ? b : a;
+                match->bots[1] = game & 1 ? a : b;
+                match->seed = (u32)(index - (game & 1));
+            }
+        }
+    }
+
+    if (thread_count > tournament.match_count) thread_count = tournament.match_count;
+    u64 begin_ns = headless_time_ns();
+    std::thread* threads = new std::thread[thread_count];
+    for (int i = 1; i < thread_count; i++) threads[i] = std::thread(tournament_worker, &tournament);
+    tournament_worker(&tournament);
+    for (int i = 1; i < thread_count; i++) threads[i].join();
+    delete[] threads;
+    double seconds = (double)(headless_time_ns() - begin_ns) * 1e-9;
+
+    Tournament_Standing standings[max_tournament_bots] = {};
+    for (int i = 0; i < bot_count; i++) {
+        standings[i].bot = i;
+        standings[i].rating = 1500;
+    }
+    u64 total_ticks = 0;
+    for (int m = 0; m < tournament.match_count; m++) {
+        const Tournament_Match* match = tournament.matches + m;
+        total_ticks += (u64)match->ticks;
+        Tournament_Standing* sides[2] = {standings + match->bots[0], standings + match->bots[1]};
+        double expected = 1 / (1 + pow(10., (sides[1]->rating - sides[0]->rating) / 400));
+        double change = 24 * (tournament_match_score(match, 0) - expected);
+        sides[0]->rating += change;
+        sides[1]->rating -= change;
+        for (int side = 0; side < 2; side++) {
+            Tournament_Standing* standing = sides[side];
+            float score = tournament_match_score(match, side);
+            if (score == 1.f) standing->wins++;
+            else if (score == 0.f) standing->losses++;
+            else standing->draws++;
+            if (match->forfeit[side]) standing->forfeits++;
+            if (match->hung[side]) standing->hangs++;
+            standing->points_for += match->points[side];
+            standing->points_against += match->points[1 - side];
+            const Bot_Player* player = match->players + side;
+            standing->calls += player->calls;
+            standing->total_ns += player->total_ns;
+            if (player->max_ns > standing->max_ns) standing->max_ns = player->max_ns;
+            standing->overruns += (u64)player->overruns;
+        }
+    }
+    qsort(standings, (size_t)bot_count, sizeof(Tournament_Standing), [](const void* a, const void* b) {
+        double ra = ((const Tournament_Standing*)a)->rating, rb = ((const Tournament_Standing*)b)->rating;
+        return ra < rb ? 1 : (ra > rb ? -1 : 0);
+    });
+
+    printf("%d bots, %d matches x %d ticks (%s rules), budget %.0f us, hang %.0f ms, %d threads: %.2f s, %.2f M ticks/s\n",
+           bot_count, tournament.match_count, tournament.ticks, kGameRulesInfo[tournament.rules].name,
+           (double)tournament.budget_ns * 1e-3, (double)tournament.hang_ns * 1e-6, thread_count, seconds,
+           (double)total_ticks / seconds * 1e-6);
+    printf("%-16s %6s %4s %4s %4s %4s %4s %11s %9s %9s %9s\n",
+           "bot", "rating", "W", "D", "L", "FF", "hung", "goals", "mean us", "max us", "overruns");
+    for (int i = 0; i < bot_count; i++) {
+        const Tournament_Standing* standing = standings + i;
+        printf("%-16s %6.0f %4d %4d %4d %4d %4d %5d:%-5d %9.2f %9.1f %9llu\n",
+               bot_plugin_name(plugins + standing->bot), standing->rating, standing->wins, standing->draws,
+               standing->losses, standing->forfeits, standing->hangs, standing->points_for, standing->points_against,
+               standing->calls ? (double)standing->total_ns / (double)standing->calls * 1e-3 : 0.,
+               (double)standing->max_ns * 1e-3, (unsigned long long)standing->overruns);
+    }
+
+    munmap(matches, matches_size);
+    for (int i = 0; i < bot_count; i++) unload_bot_plugin(plugins + i);
+    return EXIT_SUCCESS;
+}
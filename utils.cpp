@@ -63,6 +63,16 @@ typedef unsigned long long u64;
  */
 #define internal static
 
+/**
+ * @def no_inline
+ * @brief Запрещает встраивать функцию.
+ */
+#if defined(_MSC_VER)
+#define no_inline __declspec(noinline)
+#else
+#define no_inline __attribute__((noinline))
+#endif
+
 /**
  * @brief Ограничивает значение заданным диапазоном.
  *
@@ -79,3 +89,88 @@ inline int clamp(int min, int val, int max) {
     if (val > max) return max;
     return val;
 }
+
+/**
+ * @def SIMD_SSE2
+ * @brief Определён, если компилятор гарантирует наличие SSE2 (всегда верно для x64).
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/**
+ * @def SIMD_AVX2
+ * @brief Определён, если компилятор умеет собирать отдельные функции под AVX2.
+ *
+ * Такие функции помечаются TARGET_AVX2 и вызываются, только если cpu_has_avx2()
+ * вернула true: весь остальной код по-прежнему собирается под базовый SSE2.
+ */
+#if defined(SIMD_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+
+inline bool cpu_has_avx2() {
+    return __builtin_cpu_supports("avx2");
+}
+#elif defined(SIMD_SSE2) && defined(_MSC_VER)
+#define SIMD_AVX2 1
+#define TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+
+inline bool cpu_has_avx2() {
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    if (!os_saves_ymm) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+#endif
+
+#include <stddef.h>
+
+/**
+ * @brief Начальное значение хеша FNV-1a (64 бита).
+ */
+global_variable constexpr u64 fnv1a_offset_basis = 14695981039346656037ull;
+
+/**
+ * @brief Добавляет к хешу FNV-1a (64 бита) size байт.
+ *
+ * Цепочка вызовов с результатом предыдущего в hash хеширует несколько кусков как один.
+ *
+ * @param data Данные.
+ * @param size Размер данных в байтах.
+ * @param hash Хеш до этих данных.
+ * @return Хеш с учётом данных.
+ */
+internal u64
+fnv1a_64(const void* data, size_t size, u64 hash = fnv1a_offset_basis) {
+    const u8* bytes = (const u8*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Следующее число генератора xorshift32.
+ *
+ * @param state Состояние генератора (не ноль); заменяется следующим числом.
+ * @return Следующее число.
+ */
+internal u32
+xorshift32(u32* state) {
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
@@ -0,0 +1,425 @@
+/**
+ * @file video_capture.cpp
+ * @brief Асинхронная запись игрового процесса в несжатый файл Y4M.
+ *
+ * Игровой цикл только копирует готовый кадр `render_state.memory` в свободный
+ * буфер из пула и сразу возвращается. Фоновый поток переводит BGRA в YUV420
+ * и пишет кадры на диск. Если диск не успевает и свободных буферов нет,
+ * кадр отбрасывается и учитывается в счётчике — игровой цикл никогда не ждёт.
+ * Если запись на диск не удалась (например, диск заполнен), кодировщик перестаёт
+ * писать, а end_video_capture сообщает, что файл неполный.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Количество буферов в кольце между игровым циклом и кодировщиком.
+ */
+global_variable constexpr u32 capture_ring_size = 8;
+
+/**
+ * @brief Размер плитки (в пикселях) для режима записи только изменившихся областей.
+ */
+global_variable constexpr int capture_tile_size = 32;
+
+/**
+ * @brief Уровень векторных инструкций для перевода в YUV: 0 — без SIMD, 1 — SSE2.
+ *
+ * Тесты понижают его, чтобы сверить векторный путь со скалярным.
+ */
+global_variable int capture_simd_level =
+#ifdef SIMD_SSE2
+    1;
+#else
+    0;
+#endif
+
+/**
+ * @struct Video_Capture
+ * @brief Состояние записи: пул кадров, поток кодировщика и счётчики.
+ */
+struct Video_Capture {
+    bool active; /**< Запись запущена. */
+    bool changed_tiles_only; /**< Перекодировать только изменившиеся плитки. */
+    FILE* file; /**< Выходной файл Y4M. */
+
+    int source_width, source_height; /**< Размер кадра render_state. */
+    int width, height; /**< Размер записываемого кадра (округлён до чётного). */
+
+    u32* slots[capture_ring_size]; /**< Пул буферов кадров. */
+    std::atomic<u32> write_index; /**< Сколько кадров отдал игровой цикл. */
+    std::atomic<u32> read_index; /**< Сколько кадров забрал кодировщик. */
+
+    std::thread encoder; /**< Фоновый поток кодировщика. */
+    std::atomic<bool> stop; /**< Запрос на остановку кодировщика. */
+    std::mutex wake_mutex; /**< Мьютекс для ожидания новых кадров. */
+    std::condition_variable wake; /**< Пробуждение кодировщика. */
+
+    u8* yuv; /**< Плоскости Y, U, V текущего кадра. */
+    u32* previous; /**< Предыдущий кадр для сравнения плиток. */
+    bool has_previous; /**< previous содержит корректный кадр. */
+
+    std::atomic<u64> frames_submitted; /**< Кадров принято в кольцо. */
+    std::atomic<u64> frames_written; /**< Кадров записано на диск. */
+    std::atomic<u64> frames_dropped; /**< Кадров отброшено из-за переполнения кольца. */
+    std::atomic<bool> write_failed; /**< Запись в файл не удалась; следующие кадры не пишутся. */
+    u64 tiles_converted, tiles_skipped; /**< Статистика режима плиток. */
+};
+
+global_variable Video_Capture video_capture;
+
+/**
+ * @brief Яркость Y по BT.601 (ограниченный диапазон) для одного пикселя.
+ */
+inline u8 rgb_to_y(int r, int g, int b) {
+    return (u8)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+/**
+ * @brief Цветоразностная компонента U по BT.601 для усреднённого блока 2x2.
+ */
+inline u8 rgb_to_u(int r, int g, int b) {
+    return (u8)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+/**
+ * @brief Цветоразностная компонента V по BT.601 для усреднённого блока 2x2.
+ */
+inline u8 rgb_to_v(int r, int g, int b) {
+    return (u8)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+/**
+ * @brief Переводит прямоугольник кадра из BGRA в YUV420.
+ *
+ * Координаты задаются в системе выходного кадра (строка 0 — верх) и должны быть чётными.
+ * Строка y выходного кадра берётся из `top + y * stride`, что позволяет читать
+ * перевёрнутый DIB с отрицательным шагом. Основной цикл обрабатывает по 8 пикселей
+ * двух соседних строк за итерацию на SSE2 (если capture_simd_level >= 1), остаток
+ * считается скалярно с тем же результатом.
+ *
+ * @param top Указатель на верхнюю строку исходного кадра.
+ * @param stride Шаг между строками исходного кадра в пикселях (может быть отрицательным).
+ * @param x0 Левая граница (включительно).
+ * @param y0 Верхняя граница (включительно).
+ * @param x1 Правая граница (не включительно).
+ * @param y1 Нижняя граница (не включительно).
+ * @param planes Плоскости Y, U, V подряд.
+ * @param width Ширина выходного кадра.
+ * @param height Высота выходного кадра.
+ */
+internal void
+bgra_to_yuv420(const u32* top, int stride, int x0, int y0, int x1, int y1,
+               u8* planes, int width, int height) {
+    u8* y_plane = planes;
+    u8* u_plane = planes + width * height;
+    u8* v_plane = u_plane + (width / 2) * (height / 2);
+
+    for (int y = y0; y < y1; y += 2) {
+        const u32* row0 = top + (s64)y * stride;
+        const u32* row1 = top + (s64)(y + 1) * stride;
+        u8* y_out0 = y_plane + y * width;
+        u8* y_out1 = y_out0 + width;
+        u8* u_out = u_plane + (y / 2) * (width / 2);
+        u8* v_out = v_plane + (y / 2) * (width / 2);
+
+        int x = x0;
+#ifdef SIMD_SSE2
+        const __m128i mask = _mm_set1_epi32(0xff);
+        const __m128i ones = _mm_set1_epi16(1);
+        const __m128i c66 = _mm_set1_epi16(66), c129 = _mm_set1_epi16(129), c25 = _mm_set1_epi16(25);
+        const __m128i cu_r = _mm_set1_epi16(-38), cu_g = _mm_set1_epi16(-74), cu_b = _mm_set1_epi16(112);
+        const __m128i cv_r = _mm_set1_epi16(112), cv_g = _mm_set1_epi16(-94), cv_b = _mm_set1_epi16(-18);
+        const __m128i c2 = _mm_set1_epi32(2), c16 = _mm_set1_epi16(16), c128 = _mm_set1_epi16(128);
+
+        for (; capture_simd_level >= 1 && x + 8 <= x1; x += 8) {
+            __m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + x));
+            __m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + x + 4));
+            __m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + x));
+            __m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + x + 4));
+
+            // Разбор каналов в 16-битные дорожки: 8 пикселей на регистр.
+#define capture_channel(lo, hi, shift)\
+_mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, shift), mask), _mm_and_si128(_mm_srli_epi32(hi, shift), mask))
+
+            __m128i b_top = capture_channel(a0, a1, 0);
+            __m128i g_top = capture_channel(a0, a1, 8);
+            __m128i r_top = capture_channel(a0, a1, 16);
+            __m128i b_bot = capture_channel(b0, b1, 0);
+            __m128i g_bot = capture_channel(b0, b1, 8);
+            __m128i r_bot = capture_channel(b0, b1, 16);
+#undef capture_channel
+
+            // Y: сумма умещается в беззнаковые 16 бит, поэтому хватает mullo и логического сдвига.
+            __m128i luma_top = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r_top, c66), _mm_mullo_epi16(g_top, c129)),
+                                             _mm_add_epi16(_mm_mullo_epi16(b_top, c25), c128));
+            __m128i luma_bot = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r_bot, c66), _mm_mullo_epi16(g_bot, c129)),
+                                             _mm_add_epi16(_mm_mullo_epi16(b_bot, c25), c128));
+            luma_top = _mm_add_epi16(_mm_srli_epi16(luma_top, 8), c16);
+            luma_bot = _mm_add_epi16(_mm_srli_epi16(luma_bot, 8), c16);
+            _mm_storel_epi64((__m128i*)(y_out0 + x), _mm_packus_epi16(luma_top, luma_top));
+            _mm_storel_epi64((__m128i*)(y_out1 + x), _mm_packus_epi16(luma_bot, luma_bot));
+
+            // Усреднение блоков 2x2: madd складывает соседние пары, затем складываем строки.
+            __m128i r = _mm_add_epi32(_mm_madd_epi16(r_top, ones), _mm_madd_epi16(r_bot, ones));
+            __m128i g = _mm_add_epi32(_mm_madd_epi16(g_top, ones), _mm_madd_epi16(g_bot, ones));
+            __m128i b = _mm_add_epi32(_mm_madd_epi16(b_top, ones), _mm_madd_epi16(b_bot, ones));
+            r = _mm_srli_epi32(_mm_add_epi32(r, c2), 2);
+            g = _mm_srli_epi32(_mm_add_epi32(g, c2), 2);
+            b = _mm_srli_epi32(_mm_add_epi32(b, c2), 2);
+            r = _mm_packs_epi32(r, r);
+            g = _mm_packs_epi32(g, g);
+            b = _mm_packs_epi32(b, b);
+
+            // U и V укладываются в знаковые 16 бит, поэтому используем арифметический сдвиг.
+            __m128i u = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, cu_r), _mm_mullo_epi16(g, cu_g)),
+                                      _mm_add_epi16(_mm_mullo_epi16(b, cu_b), c128));
+            __m128i v = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, cv_r), _mm_mullo_epi16(g, cv_g)),
+                                      _mm_add_epi16(_mm_mullo_epi16(b, cv_b), c128));
+            u = _mm_add_epi16(_mm_srai_epi16(u, 8), c128);
+            v = _mm_add_epi16(_mm_srai_epi16(v, 8), c128);
+
+            int u4 = _mm_cvtsi128_si32(_mm_packus_epi16(u, u));
+            int v4 = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+            memcpy(u_out + x / 2, &u4, 4);
+            memcpy(v_out + x / 2, &v4, 4);
+        }
+#endif
+        for (; x < x1; x += 2) {
+            int r_sum = 0, g_sum = 0, b_sum = 0;
+            const u32 pixels[4] = { row0[x], row0[x + 1], row1[x], row1[x + 1] };
+            for (int i = 0; i < 4; i++) {
+                int r = (pixels[i] >> 16) & 0xff;
+                int g = (pixels[i] >> 8) & 0xff;
+                int b = pixels[i] & 0xff;
+                r_sum += r; g_sum += g; b_sum += b;
+                u8* out = (i < 2 ? y_out0 : y_out1) + x + (i & 1);
+                *out = rgb_to_y(r, g, b);
+            }
+            r_sum = (r_sum + 2) >> 2;
+            g_sum = (g_sum + 2) >> 2;
+            b_sum = (b_sum + 2) >> 2;
+            u_out[x / 2] = rgb_to_u(r_sum, g_sum, b_sum);
+            v_out[x / 2] = rgb_to_v(r_sum, g_sum, b_sum);
+        }
+    }
+}
+
+/**
+ * @brief Кодирует и записывает один кадр из пула (выполняется в потоке кодировщика).
+ *
+ * @param frame Кадр в формате render_state (снизу вверх).
+ */
+internal void
+encode_capture_frame(const u32* frame) {
+    Video_Capture* capture = &video_capture;
+    int stride = capture->source_width;
+    // DIB хранится снизу вверх, а Y4M — сверху вниз.
+    const u32* top = frame + (s64)(capture->source_height - 1) * stride;
+
+    if (!capture->changed_tiles_only) {
+        bgra_to_yuv420(top, -stride, 0, 0, capture->width, capture->height, capture->yuv, capture->width, capture->height);
+    } else {
+        const u32* previous_top = capture->previous + (s64)(capture->source_height - 1) * stride;
+        for (int ty = 0; ty < capture->height; ty += capture_tile_size) {
+            int ty1 = ty + capture_tile_size < capture->height ? ty + capture_tile_size : capture->height;
+            for (int tx = 0; tx < capture->width; tx += capture_tile_size) {
+                int tx1 = tx + capture_tile_size < capture->width ? tx + capture_tile_size : capture->width;
+                size_t row_bytes = (size_t)(tx1 - tx) * sizeof(u32);
+
+                bool changed = !capture->has_previous;
+                for (int y = ty; y < ty1 && !changed; y++) {
+                    changed = memcmp(top - (s64)y * stride + tx, previous_top - (s64)y * stride + tx, row_bytes) != 0;
+                }
+                if (!changed) {
+                    capture->tiles_skipped++;
+                    continue;
+                }
+
+                bgra_to_yuv420(top, -stride, tx, ty, tx1, ty1, capture->yuv, capture->width, capture->height);
+                for (int y = ty; y < ty1; y++) {
+                    memcpy((u32*)previous_top - (s64)y * stride + tx, top - (s64)y * stride + tx, row_bytes);
+                }
+                capture->tiles_converted++;
+            }
+        }
+        capture->has_previous = true;
+    }
+
+    if (capture->write_failed.load(std::memory_order_relaxed)) return;
+    size_t yuv_size = (size_t)capture->width * capture->height * 3 / 2;
+    if (fputs("FRAME\n", capture->file) < 0 || fwrite(capture->yuv, 1, yuv_size, capture->file) != yuv_size) {
+        capture->write_failed.store(true, std::memory_order_relaxed);
+        return;
+    }
+    capture->frames_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Основной цикл потока кодировщика: забирает кадры из кольца, пока запись не остановлена.
+ */
+internal void
+video_capture_thread() {
+    Video_Capture* capture = &video_capture;
+    for (;;) {
+        u32 read = capture->read_index.load(std::memory_order_relaxed);
+        u32 write = capture->write_index.load(std::memory_order_acquire);
+        if (read == write) {
+            if (capture->stop.load(std::memory_order_acquire)) break;
+            std::unique_lock<std::mutex> lock(capture->wake_mutex);
+            capture->wake.wait_for(lock, std::chrono::milliseconds(2));
+            continue;
+        }
+
+        encode_capture_frame(capture->slots[read % capture_ring_size]);
+        capture->read_index.store(read + 1, std::memory_order_release);
+    }
+    if (fflush(capture->file) != 0) capture->write_failed.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Освобождает буферы записи (нулевые указатели пропускаются).
+ */
+internal void
+free_video_capture_buffers(Video_Capture* capture) {
+    for (u32 i = 0; i < capture_ring_size; i++) {
+        free(capture->slots[i]);
+        capture->slots[i] = 0;
+    }
+    free(capture->yuv);
+    free(capture->previous);
+    capture->yuv = 0;
+    capture->previous = 0;
+}
+
+/**
+ * @brief Начинает запись видео в файл Y4M.
+ *
+ * Все буферы выделяются здесь, один раз; дальше запись не выделяет память.
+ * Размер кадра фиксируется: кадры другого размера (после изменения окна) отбрасываются.
+ *
+ * @param path Путь к выходному файлу.
+ * @param width Ширина кадра render_state.
+ * @param height Высота кадра render_state.
+ * @param changed_tiles_only Перекодировать только изменившиеся плитки 32x32.
+ *
+ * @return true, если запись запущена; false, если файл не открылся, память не выделилась
+ * или не записался заголовок.
+ */
+internal bool
+begin_video_capture(const char* path, int width, int height, bool changed_tiles_only) {
+    Video_Capture* capture = &video_capture;
+    if (capture->active || width < 2 || height < 2) return false;
+
+    capture->file = fopen(path, "wb");
+    if (!capture->file) return false;
+
+    capture->source_width = width;
+    capture->source_height = height;
+    capture->width = width & ~1;
+    capture->height = height & ~1;
+    capture->changed_tiles_only = changed_tiles_only;
+    capture->has_previous = false;
+
+    size_t frame_bytes = (size_t)width * height * sizeof(u32);
+    bool allocated = true;
+    for (u32 i = 0; i < capture_ring_size; i++) {
+        capture->slots[i] = (u32*)malloc(frame_bytes);
+        allocated = allocated && capture->slots[i];
+    }
+    capture->yuv = (u8*)malloc((size_t)capture->width * capture->height * 3 / 2);
+    capture->previous = changed_tiles_only ? (u32*)malloc(frame_bytes) : 0;
+    allocated = allocated && capture->yuv && (capture->previous || !changed_tiles_only);
+    if (!allocated || fprintf(capture->file, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C420jpeg\n", capture->width, capture->height) < 0) {
+        free_video_capture_buffers(capture);
+        fclose(capture->file);
+        capture->file = 0;
+        return false;
+    }
+
+    capture->write_index = 0;
+    capture->read_index = 0;
+    capture->frames_submitted = 0;
+    capture->frames_written = 0;
+    capture->frames_dropped = 0;
+    capture->write_failed = false;
+    capture->tiles_converted = 0;
+    capture->tiles_skipped = 0;
+    capture->stop = false;
+
+    capture->encoder = std::thread(video_capture_thread);
+    capture->active = true;
+    return true;
+}
+
+/**
+ * @brief Передаёт готовый кадр кодировщику. Никогда не блокирует игровой цикл.
+ *
+ * Если все буферы пула заняты (диск не успевает), кадр отбрасывается
+ * и увеличивается счётчик frames_dropped.
+ *
+ * @param memory Память кадра (render_state.memory).
+ * @param width Ширина кадра.
+ * @param height Высота кадра.
+ */
+internal void
+capture_frame(const void* memory, int width, int height) {
+    Video_Capture* capture = &video_capture;
+    if (!capture->active) return;
+
+    u32 write = capture->write_index.load(std::memory_order_relaxed);
+    u32 read = capture->read_index.load(std::memory_order_acquire);
+    if (width != capture->source_width || height != capture->source_height ||
+        write - read >= capture_ring_size) {
+        capture->frames_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    memcpy(capture->slots[write % capture_ring_size], memory, (size_t)width * height * sizeof(u32));
+    capture->write_index.store(write + 1, std::memory_order_release);
+    capture->frames_submitted.fetch_add(1, std::memory_order_relaxed);
+    capture->wake.notify_one();
+}
+
+/**
+ * @brief Останавливает запись: дожидается записи всех принятых кадров и освобождает буферы.
+ *
+ * @param report Поток для итоговой статистики (может быть 0).
+ *
+ * @return false, если файл записан не целиком.
+ */
+internal bool
+end_video_capture(FILE* report) {
+    Video_Capture* capture = &video_capture;
+    if (!capture->active) return true;
+
+    capture->stop.store(true, std::memory_order_release);
+    capture->wake.notify_one();
+    capture->encoder.join();
+    bool written = !capture->write_failed.load(std::memory_order_relaxed);
+    if (fclose(capture->file) != 0) written = false;
+    capture->file = 0;
+
+    if (report) {
+        fprintf(report, "capture: %llu written, %llu dropped",
+                (unsigned long long)capture->frames_written.load(),
+                (unsigned long long)capture->frames_dropped.load());
+        if (capture->changed_tiles_only) {
+            fprintf(report, ", tiles %llu converted / %llu skipped",
+                    (unsigned long long)capture->tiles_converted, (unsigned long long)capture->tiles_skipped);
+        }
+        fputc('\n', report);
+        if (!written) fprintf(report, "capture: write failed, the file is incomplete\n");
+    }
+
+    free_video_capture_buffers(capture);
+    capture->active = false;
+    return written;
+}
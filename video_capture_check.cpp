@@ -0,0 +1,137 @@
+/**
+ * @file video_capture_check.cpp
+ * @brief Проверка записи видео (video_capture.cpp) без окна.
+ *
+ * - Перевод BGRA в YUV420 на SSE2 сверяется со скалярным побайтно: случайные кадры,
+ *   разные чётные прямоугольники и отрицательный шаг строк (перевёрнутый DIB).
+ * - Несколько кадров матча записываются в Y4M целиком и только изменившимися плитками:
+ *   размер файла — заголовок и кадры ровно нужного размера, а оба файла совпадают.
+ * - Запись в /dev/full должна закончиться сообщением о неполном файле.
+ *
+ * Использование: video_capture_check [-frames N] [-size ширина высота] [-file путь]
+ */
+
+#include "headless_platform.cpp"
+#include "video_capture.cpp"
+
+#include <vector>
+
+/**
+ * @brief Читает файл целиком.
+ */
+internal bool
+read_capture_file(const char* path, std::vector<u8>* bytes) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    bytes->clear();
+    u8 buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) bytes->insert(bytes->end(), buffer, buffer + count);
+    fclose(file);
+    return true;
+}
+
+/**
+ * @brief Записывает frame_count кадров матча; каждый кадр дожидается кодировщика, чтобы не отбрасывался.
+ *
+ * @return false, если запись не запустилась или end_video_capture сообщил об ошибке.
+ */
+internal bool
+capture_match_frames(const char* path, int frame_count, bool changed_tiles_only) {
+    Game_Memory memory;
+    if (!init_headless_memory(&memory, 64 << 20, 16 << 20)) return false;
+    start_headless_match(GameStateFromMemory(&memory));
+    if (!begin_video_capture(path, render_state.width, render_state.height, changed_tiles_only)) {
+        free_headless_memory(&memory);
+        return false;
+    }
+
+    Input input = {};
+    for (int frame = 0; frame < frame_count; frame++) {
+        Game_State* state = GameStateFromMemory(&memory);
+        autopilot_input(&input, state->ball_p_y, state->player_2_p);
+        reset_arena(&memory.transient);
+        SimulateGame(&memory, &input, 1.f / 60.f);
+        capture_frame(render_state.memory, render_state.width, render_state.height);
+        while (video_capture.read_index.load() != video_capture.write_index.load()) std::this_thread::yield();
+    }
+    bool written = end_video_capture(stdout);
+    free_headless_memory(&memory);
+    return written;
+}
+
+int main(int argc, char** argv) {
+    int frame_count = 30;
+    int width = 321, height = 181;
+    const char* path = "video_capture_check.y4m";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-frames") && i + 1 < argc) frame_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-file") && i + 1 < argc) path = argv[++i];
+        else if (!strcmp(argv[i], "-size") && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+    }
+    if (frame_count < 1 || width < 16 || height < 16) return EXIT_FAILURE;
+    int failures = 0;
+
+    // SSE2 против скалярного перевода.
+    int simd_level = capture_simd_level;
+    int even_width = width & ~1, even_height = height & ~1;
+    size_t yuv_size = (size_t)even_width * even_height * 3 / 2;
+    std::vector<u32> pixels((size_t)width * height);
+    std::vector<u8> simd_yuv(yuv_size), scalar_yuv(yuv_size);
+    u32 random_state = 0x2545f491u;
+    int mismatches = 0;
+    for (int round = 0; round < 16; round++) {
+        for (u32& pixel : pixels) pixel = xorshift32(&random_state);
+        // Прямоугольник с чётными границами; в нулевом раунде — весь кадр.
+        int x0 = round ? (int)(xorshift32(&random_state) % (u32)(even_width / 2)) & ~1 : 0;
+        int y0 = round ? (int)(xorshift32(&random_state) % (u32)(even_height / 2)) & ~1 : 0;
+        int x1 = round ? x0 + 2 + ((int)(xorshift32(&random_state) % (u32)(even_width - x0 - 1)) & ~1) : even_width;
+        int y1 = round ? y0 + 2 + ((int)(xorshift32(&random_state) % (u32)(even_height - y0 - 1)) & ~1) : even_height;
+        const u32* top = pixels.data() + (size_t)(height - 1) * width;
+        for (int level = 0; level <= simd_level; level++) {
+            std::vector<u8>& yuv = level ? simd_yuv : scalar_yuv;
+            memset(yuv.data(), 0, yuv_size);
+            capture_simd_level = level;
+            bgra_to_yuv420(top, -width, x0, y0, x1, y1, yuv.data(), even_width, even_height);
+        }
+        if (simd_level && simd_yuv != scalar_yuv) mismatches++;
+    }
+    capture_simd_level = simd_level;
+    printf("yuv420: simd %d vs scalar, %d of 16 rounds differ\n", simd_level, mismatches);
+    if (mismatches) failures++;
+
+    // Кадры матча: весь кадр и только изменившиеся плитки.
+    resize_headless_framebuffer(width, height);
+    char header[128];
+    size_t header_size = (size_t)snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C420jpeg\n",
+                                          even_width, even_height);
+    size_t expected_size = header_size + (size_t)frame_count * (6 + yuv_size);
+    std::vector<u8> full_file, tiles_file;
+    for (int tiles = 0; tiles < 2; tiles++) {
+        bool written = capture_match_frames(path, frame_count, tiles != 0);
+        std::vector<u8>* bytes = tiles ? &tiles_file : &full_file;
+        bool read = read_capture_file(path, bytes);
+        u64 frames_written = video_capture.frames_written.load();
+        printf("%s: %zu bytes, expected %zu, %llu frames written\n", tiles ? "changed tiles" : "full frames",
+               bytes->size(), expected_size, (unsigned long long)frames_written);
+        if (!written || !read || bytes->size() != expected_size || frames_written != (u64)frame_count ||
+            memcmp(bytes->data(), header, header_size)) {
+            failures++;
+        }
+    }
+    bool same = full_file == tiles_file;
+    printf("changed tiles file %s the full-frame file\n", same ? "matches" : "differs from");
+    if (!same) failures++;
+    remove(path);
+
+    // Полный диск: запись должна сообщить о неполном файле.
+    bool written = capture_match_frames("/dev/full", frame_count, false);
+    printf("/dev/full: %s\n", written ? "reported written" : "reported failed");
+    if (written) failures++;
+
+    printf("%d failures\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
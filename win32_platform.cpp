@@ -1,5 +1,7 @@
 #include "utils.cpp"
 #include <windows.h>
+#include "memory_arena.cpp"
+#include "profiler.cpp"
 
 global_variable bool running = true;
 global_variable constexpr unsigned int window_width = 840;
@@ -16,9 +18,24 @@ struct Render_State {
 
 global_variable Render_State render_state;
 
+global_variable constexpr size_t permanent_memory_size = 64 * 1024 * 1024;
+global_variable constexpr size_t transient_memory_size = 16 * 1024 * 1024;
+global_variable constexpr int max_framebuffer_width = 7680;
+global_variable constexpr int max_framebuffer_height = 4320;
+
+/**
+ * @brief Арена буфера кадра и кэша статического слоя: резервируется при запуске под максимальный размер
+ * и переиспользуется при каждом изменении размера окна.
+ */
+global_variable Memory_Arena framebuffer_arena;
+
 #include "platform_common.cpp"
 #include "renderer.cpp"
 #include "game.cpp"
+#include "video_capture.cpp"
+#include "audio.cpp"
+#include "save_state.cpp"
+#include "mosaic.cpp"
 
 LRESULT CALLBACK window_callback(HWND hwnd, 
 	UINT uMsg, 
@@ -36,13 +53,14 @@ LRESULT CALLBACK window_callback(HWND hwnd,
 	case WM_SIZE: {
 		RECT rect;
 		GetClientRect(hwnd, &rect);
-		render_state.width = rect.right - rect.left;
-		render_state.height = rect.bottom - rect.top;
+		render_state.width = clamp(0, rect.right - rect.left, max_framebuffer_width);
+		render_state.height = clamp(0, rect.bottom - rect.top, max_framebuffer_height);
 
 		int size = render_state.width * render_state.height * sizeof(unsigned int);
 
-		if (render_state.memory) VirtualFree(render_state.memory, 0, MEM_RELEASE);
-		render_state.memory = VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		reset_arena(&framebuffer_arena);
+		render_state.memory = push_size(&framebuffer_arena, size, 64);
+		set_background_cache_memory((u32*)push_size(&framebuffer_arena, size, 64));
 
 		render_state.bitmap_info.bmiHeader.biSize = sizeof(render_state.bitmap_info.bmiHeader);
 		render_state.bitmap_info.bmiHeader.biWidth = render_state.width;
@@ -67,6 +85,22 @@ int WinMain(HINSTANCE hInstance,
 
 	ShowCursor(FALSE);
 
+	// Вся память резервируется один раз: постоянная и временная арены игры и буфер кадра.
+	Game_Memory game_memory = {};
+	{
+		// Буфер кадра и кэш статического слоя того же размера.
+		size_t framebuffer_size = 2 * ((size_t)max_framebuffer_width * max_framebuffer_height * sizeof(u32) + 64);
+		u8* memory = (u8*)VirtualAlloc(0, permanent_memory_size + transient_memory_size + framebuffer_size,
+			MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if (!memory) return EXIT_FAILURE;
+		init_arena(&game_memory.permanent, memory, permanent_memory_size);
+		init_arena(&game_memory.transient, memory + permanent_memory_size, transient_memory_size);
+		init_arena(&framebuffer_arena, memory + permanent_memory_size + transient_memory_size, framebuffer_size);
+	}
+
+	// Спрайты оформления; если каталога нет, игра рисует прямоугольники.
+	LoadGameAssets(&game_memory, "assets");
+
 	// Create Window Class
 	WNDCLASS window_class = {};
 	window_class.style = CS_HREDRAW | CS_VREDRAW;
@@ -97,6 +131,80 @@ int WinMain(HINSTANCE hInstance,
 
 	HDC hdc = GetDC(window);
 
+	// Запись видео: -capture <файл.y4m> [-capture-tiles]
+	{
+		const char* capture_arg = strstr(lpCmdLine, "-capture ");
+		if (capture_arg) {
+			char capture_path[260] = {};
+			sscanf(capture_arg + 9, "%259s", capture_path);
+			bool tiles_only = strstr(lpCmdLine, "-capture-tiles") != 0;
+			begin_video_capture(capture_path, render_state.width, render_state.height, tiles_only);
+		}
+	}
+
+	// Трасса для chrome://tracing: -trace <файл.json>
+	{
+		const char* trace_arg = strstr(lpCmdLine, "-trace ");
+		if (trace_arg) {
+			char trace_path[260] = {};
+			sscanf(trace_arg + 7, "%259s", trace_path);
+			begin_profile(trace_path, true);
+		}
+	}
+
+	// Звук: -audio <файл.wav|null>
+	{
+		const char* audio_arg = strstr(lpCmdLine, "-audio ");
+		if (audio_arg) {
+			char audio_path[260] = {};
+			sscanf(audio_arg + 7, "%259s", audio_path);
+			begin_audio(audio_path);
+		}
+	}
+
+	// Сохранение матча: -save <файл>, по умолчанию pong.sav. Последний матч восстанавливается при запуске.
+	Save_File save_file;
+	{
+		char save_path[260] = "pong.sav";
+		const char* save_arg = strstr(lpCmdLine, "-save ");
+		if (save_arg) sscanf(save_arg + 6, "%259s", save_path);
+		if (open_save_file(&save_file, save_path)) load_save_state(&save_file, GameStateFromMemory(&game_memory));
+	}
+
+	// Вариант правил: -rules <standard|big|fast>. Задаётся после восстановления сохранения и перекрывает его.
+	{
+		const char* rules_arg = strstr(lpCmdLine, "-rules ");
+		if (rules_arg) {
+			char rules_name[32] = {};
+			sscanf(rules_arg + 7, "%31s", rules_name);
+			GameStateFromMemory(&game_memory)->rules = GameRulesFromName(rules_name);
+		}
+	}
+
+	// Мозаика: -mosaic <N> — вместо игры N матчей ИИ против автопилота в сетке (до 64 на экране),
+	// стрелки вверх и вниз прокручивают сетку по строке.
+	int mosaic_count = 0;
+	Mosaic* mosaic = 0;
+	Game_State* mosaic_states = 0;
+	Input* mosaic_inputs = 0;
+	{
+		const char* mosaic_arg = strstr(lpCmdLine, "-mosaic ");
+		if (mosaic_arg) mosaic_count = atoi(mosaic_arg + 8);
+		if (mosaic_count > 0) {
+			mosaic_states = new Game_State[mosaic_count]();
+			mosaic_inputs = new Input[mosaic_count]();
+			for (int i = 0; i < mosaic_count; i++) {
+				mosaic_states[i].current_gamemode = kGameplay;
+				mosaic_states[i].enemy_is_ai = true;
+				mosaic_states[i].ball_p_y = (float)(i % 61) - 30.f;
+			}
+			mosaic = new Mosaic();
+			if (!init_mosaic(mosaic, mosaic_count, mosaic_count < 64 ? mosaic_count : 64, (int)std::thread::hardware_concurrency())) {
+				mosaic_count = 0;
+			}
+		}
+	}
+
 	Input input = {};
 
 	float delta_time = 0.016666f;
@@ -110,21 +218,29 @@ int WinMain(HINSTANCE hInstance,
 		performance_frequency = (float)perf.QuadPart;
 	}
 
+	// Выделения в куче в установившемся режиме (после первых кадров) должны отсутствовать.
+	u64 frame_index = 0;
+	u64 steady_state_allocations = 0;
+
 	while (running) {
+		u64 allocations_before_frame = heap_allocation_count.load(std::memory_order_relaxed);
+
 		// Input
-		MSG message;
+		{
+			PROFILE_ZONE("input");
+			MSG message;
 
-		for (int i = 0; i < BUTTON_COUNT; i++) {
-			input.buttons[i].changed = false;
-		}
+			for (int i = 0; i < BUTTON_COUNT; i++) {
+				input.buttons[i].changed = false;
+			}
 
-		while (PeekMessage(&message, window, 0, 0, PM_REMOVE)) {
+			while (PeekMessage(&message, window, 0, 0, PM_REMOVE)) {
 
-			switch (message.message) {
-			case WM_KEYUP:
-			case WM_KEYDOWN: {
-				u32 vk_code = (u32)message.wParam;
-				bool is_down = ((message.lParam & (1 << 31)) == 0);
+				switch (message.message) {
+				case WM_KEYUP:
+				case WM_KEYDOWN: {
+					u32 vk_code = (u32)message.wParam;
+					bool is_down = ((message.lParam & (1 << 31)) == 0);
 
 #define process_button(b, vk)\
 case vk: {\
@@ -132,49 +248,93 @@ input.buttons[b].changed = is_down != input.buttons[b].is_down;\
 input.buttons[b].is_down = is_down;\
 } break;
 
-				switch (vk_code) {
-					process_button(BUTTON_UP, VK_UP);
-					process_button(BUTTON_DOWN, VK_DOWN);
-					process_button(BUTTON_W, 'W');
-					process_button(BUTTON_S, 'S');
-					process_button(BUTTON_LEFT, VK_LEFT);
-					process_button(BUTTON_RIGHT, VK_RIGHT);
-					process_button(BUTTON_ENTER, VK_RETURN);
-					process_button(BUTTON_ESC, VK_ESCAPE);
-
+					switch (vk_code) {
+						process_button(BUTTON_UP, VK_UP);
+						process_button(BUTTON_DOWN, VK_DOWN);
+						process_button(BUTTON_W, 'W');
+						process_button(BUTTON_S, 'S');
+						process_button(BUTTON_LEFT, VK_LEFT);
+						process_button(BUTTON_RIGHT, VK_RIGHT);
+						process_button(BUTTON_ENTER, VK_RETURN);
+						process_button(BUTTON_ESC, VK_ESCAPE);
+						process_button(BUTTON_BACKSPACE, VK_BACK);
+
+					}
+				} break;
+
+				default: {
+					TranslateMessage(&message);
+					DispatchMessage(&message);
+				}
 				}
-			} break;
 
-			default: {
-				TranslateMessage(&message);
-				DispatchMessage(&message);
 			}
-			}
-
 		}
 
 		// Simulate
-		simulate_game(&input, delta_time);
+		{
+			PROFILE_ZONE("simulate");
+			if (mosaic_count) {
+				for (int i = 0; i < mosaic_count; i++) {
+					autopilot_input(mosaic_inputs + i, mosaic_states[i].ball_p_y, mosaic_states[i].player_2_p);
+					StepGame(mosaic_states + i, mosaic_inputs + i, delta_time);
+				}
+				if (input.buttons[BUTTON_DOWN].is_down && input.buttons[BUTTON_DOWN].changed) scroll_mosaic(mosaic, mosaic->cell_height);
+				if (input.buttons[BUTTON_UP].is_down && input.buttons[BUTTON_UP].changed) scroll_mosaic(mosaic, -mosaic->cell_height);
+				render_mosaic(mosaic, mosaic_states, &GameStorageFromMemory(&game_memory)->assets);
+			} else {
+				reset_arena(&game_memory.transient);
+				SimulateGame(&game_memory, &input, delta_time);
+				Game_State* game_state = GameStateFromMemory(&game_memory);
+				queue_game_sounds(game_state);
+				// Автосохранение: копия состояния в страницу файла раз в секунду и после событий.
+				if (game_state->event_count || frame_index % 60 == 0) commit_save_state(&save_file, game_state);
+			}
+		}
+
+		{
+			PROFILE_ZONE("capture");
+			capture_frame(render_state.memory, render_state.width, render_state.height);
+		}
 
 		// Render
-		StretchDIBits(hdc, 
-			0, 
-			0, 
-			render_state.width, 
-			render_state.height, 
-			0, 
-			0, 
-			render_state.width, 
-			render_state.height, 
-			render_state.memory, 
-			&render_state.bitmap_info, 
-			DIB_RGB_COLORS, SRCCOPY);
+		{
+			PROFILE_ZONE("present");
+			StretchDIBits(hdc, 
+				0, 
+				0, 
+				render_state.width, 
+				render_state.height, 
+				0, 
+				0, 
+				render_state.width, 
+				render_state.height, 
+				render_state.memory, 
+				&render_state.bitmap_info, 
+				DIB_RGB_COLORS, SRCCOPY);
+		}
 
 		LARGE_INTEGER frame_end_time;
 		QueryPerformanceCounter(&frame_end_time);
 		delta_time = (float)(frame_end_time.QuadPart - frame_begin_time.QuadPart) / performance_frequency;
 		frame_begin_time = frame_end_time;
+
+		flush_profile();
+
+		u64 frame_allocations = heap_allocation_count.load(std::memory_order_relaxed) - allocations_before_frame;
+		if (++frame_index > 60 && frame_allocations) {
+			steady_state_allocations += frame_allocations;
+			OutputDebugStringA("Heap allocation in steady-state frame loop\n");
+		}
 	}
+
+	commit_save_state(&save_file, GameStateFromMemory(&game_memory));
+	close_save_file(&save_file);
+	if (mosaic) free_mosaic(mosaic);
+	end_video_capture(stderr);
+	end_audio(stderr);
+	end_profile(stderr);
+	fprintf(stderr, "steady-state heap allocations: %llu\n", (unsigned long long)steady_state_allocations);
 	return EXIT_SUCCESS;
 }
 